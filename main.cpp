@@ -8,20 +8,52 @@
 #include "src/Collider.h"
 #include "src/Light.h"
 #include "src/ParticleSystem.h"
+#include "src/GpuParticleSystem.h"
 #include<glm/gtc/matrix_transform.hpp>
 #include<glm/gtc/type_ptr.hpp>
 #include <GLFW/glfw3.h>
+#include <chrono>
 #include <cmath>
-#include "src/tree_collider_utils.h"
+#include <cstdlib>
 #include "src/Cubemaps.h"
 #include "src/Campfire.h"
+#include "src/Options.h"
+#include "src/ThreadPool.h"
+#include "src/LightClusters.h"
+#include "src/LightCulling.h"
+#include "src/DeferredRenderer.h"
+#include "src/DepthPrepass.h"
+#include "src/OcclusionCuller.h"
+#include "src/OcclusionDebugView.h"
+#include "src/ShadowAtlas.h"
+#include "src/DynamicResolution.h"
+#include "src/UpscaleComparison.h"
+#include "src/FixedTimestep.h"
+#include "src/FramePipeline.h"
+#include "src/HeadlessContext.h"
+#include "src/HeadlessRun.h"
+#include "src/GpuProfiler.h"
+#include "src/CpuProfiler.h"
+#include "src/CameraPath.h"
+#include "src/Benchmark.h"
+#include "src/Input.h"
+#include "src/Scene.h"
+#include "src/EntityStore.h"
+#include "src/EntityBenchmark.h"
+#include "src/ParticleBenchmark.h"
+#include "src/EnvironmentLighting.h"
+#include "src/ReflectionProbes.h"
+#include "src/PlanarReflection.h"
+#include <memory>
+#include <thread>
 
 // Define this before including stb_image.h
 #define STB_IMAGE_IMPLEMENTATION
 #include "import/stb/stb_image.h"
 
-const unsigned int width = 1200;
-const unsigned int height = 1200;
+// Output size, --resolution
+unsigned int width = 1200;
+unsigned int height = 1200;
 
 Vertex vertices[] = {
 	Vertex{glm::vec3(-1.0f, 0.0f,  1.0f), glm::vec3(0.0f, 1.0f, 0.0f), glm::vec3(1.0f), glm::vec2(0.0f, 0.0f)},
@@ -43,48 +75,59 @@ GLuint lightIndices[] = {
 	0,1,2, 0,2,3, 0,4,7, 0,7,3, 3,7,6, 3,6,2,
 	2,6,5, 2,5,1, 1,5,4, 1,4,0, 4,5,6, 4,6,7
 };
-// Represents a tree instance in the scene with position and scale
-struct SceneTree {
-    glm::vec3 position; // World position of the tree
-    glm::vec3 scale;    // Scale of the tree
+// Draws the visible entities of one scene model with the lit shader. When a
+// culler is given, each entity's own light list is uploaded first so it only
+// shades the lights that can reach it; with probes, each entity reflects the
+// one nearest to it.
+void DrawEntities(Model& model, const EntityStore& entities, const DrawPackets& packets, uint32_t mesh, Shader& shader,
+                  Camera& camera, LightCuller* culler, const ReflectionProbes* probes) {
+    for (uint32_t p = packets.offsets[mesh]; p < packets.offsets[mesh + 1]; ++p) {
+        uint32_t entity = packets.entities[p];
+        if (culler) culler->apply(shader, entities.boundsMin[entity], entities.boundsMax[entity]);
+        if (probes) probes->bindNearest(shader, 0.5f * (entities.boundsMin[entity] + entities.boundsMax[entity]));
+        model.Draw(shader, camera, entities.worldMatrices[entity]);
+    }
+}
+
+// Extra animated light for the --lights stress scene
+struct StressLight {
+    glm::vec3 center; // Point the light circles around
+    float radius;     // Radius of the circle
+    float speed;      // Angular speed (rad/s)
+    float phase;      // Starting angle
 };
 
-// Utility function to draw all trees in the scene
-// Iterates over the list of SceneTree and draws each tree model at its position and scale
-void DrawTrees(const std::vector<SceneTree>& trees, Model& treeModel, Shader& shader, Camera& camera) {
-    for (const auto& tree : trees) {
-        glm::mat4 treeModelMatrix = glm::mat4(1.0f);
-        treeModelMatrix = glm::translate(treeModelMatrix, tree.position);
-        treeModelMatrix = glm::scale(treeModelMatrix, tree.scale);
-        treeModel.Draw(shader, camera, treeModelMatrix);
+// Appends `count` dim point and spot lights scattered over the terrain
+std::vector<StressLight> CreateStressLights(std::vector<Light>& lights, int count) {
+    std::vector<StressLight> stress;
+    for (int i = 0; i < count; ++i) {
+        StressLight s;
+        s.center = glm::vec3((rand() % 800) / 10.0f - 40.0f, 0.5f + (rand() % 30) / 10.0f, (rand() % 800) / 10.0f - 40.0f);
+        s.radius = 1.0f + (rand() % 40) / 10.0f;
+        s.speed = 0.2f + (rand() % 100) / 100.0f;
+        s.phase = (rand() % 628) / 100.0f;
+        glm::vec4 color((rand() % 100) / 100.0f, (rand() % 100) / 100.0f, (rand() % 100) / 100.0f, 1.0f);
+        color *= 0.1f;
+        int type = (i % 4 == 0) ? 2 : 1; // One in four is a spot light pointing down
+        lights.push_back(Light(type, s.center, glm::vec3(0.0f, -1.0f, 0.0f), color));
+        stress.push_back(s);
     }
+    return stress;
 }
 
-std::vector<SceneTree> trees = {
-    // First tree
-    { glm::vec3(-12.0f, 0.0f, -12.0f), glm::vec3(2.8f, 3.4f, 2.8f) },
-    // Row 1 (z = -22)
-    { glm::vec3(-9.0f, 0.0f, -22.0f), glm::vec3(3.3f, 2.6f, 3.3f) },
-    { glm::vec3(-3.0f, 0.0f, -22.0f), glm::vec3(2.5f, 3.5f, 2.5f) },
-    { glm::vec3(3.0f, 0.0f, -22.0f), glm::vec3(3.2f, 2.7f, 3.2f) },
-    { glm::vec3(9.0f, 0.0f, -22.0f), glm::vec3(2.6f, 3.4f, 2.6f) },
-    // Row 2 (z = -16)
-    { glm::vec3(-15.0f, 0.0f, -16.0f), glm::vec3(3.4f, 2.5f, 3.4f) },
-    { glm::vec3(-9.0f, 0.0f, -16.0f), glm::vec3(2.7f, 3.3f, 2.7f) },
-    { glm::vec3(-3.0f, 0.0f, -16.0f), glm::vec3(3.5f, 2.6f, 3.5f) },
-    { glm::vec3(3.0f, 0.0f, -16.0f), glm::vec3(2.5f, 3.5f, 2.5f) },
-    { glm::vec3(9.0f, 0.0f, -16.0f), glm::vec3(3.3f, 2.7f, 3.3f) },
-    // Row 3 (z = -10)
-    { glm::vec3(-15.0f, 0.0f, -10.0f), glm::vec3(2.6f, 3.4f, 2.6f) },
-    { glm::vec3(-9.0f, 0.0f, -10.0f), glm::vec3(3.4f, 2.5f, 3.4f) },
-    { glm::vec3(-3.0f, 0.0f, -10.0f), glm::vec3(2.7f, 3.3f, 2.7f) },
-    { glm::vec3(3.0f, 0.0f, -10.0f), glm::vec3(3.5f, 2.6f, 3.5f) },
-    { glm::vec3(9.0f, 0.0f, -10.0f), glm::vec3(2.5f, 3.5f, 2.5f) }
-};
+// Moves the stress lights along their circles
+void AnimateStressLights(std::vector<Light>& lights, size_t firstLight, const std::vector<StressLight>& stress, float time) {
+    for (size_t i = 0; i < stress.size(); ++i) {
+        const StressLight& s = stress[i];
+        float angle = s.phase + s.speed * time;
+        lights[firstLight + i].position = s.center + glm::vec3(cos(angle), 0.0f, sin(angle)) * s.radius;
+    }
+}
 
 // Helper function to initialize GLFW, create window, and load GLAD
-GLFWwindow* InitWindow(int width, int height, const char* title) {
+GLFWwindow* InitWindow(int width, int height, const char* title, bool visible = true) {
 	glfwInit();
+	glfwWindowHint(GLFW_VISIBLE, visible ? GLFW_TRUE : GLFW_FALSE);
 	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
 	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
 	glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
@@ -105,18 +148,78 @@ GLFWwindow* InitWindow(int width, int height, const char* title) {
 	return window;
 }
 
-int main() {
-    
-	GLFWwindow* window = InitWindow(width, height, "3D_game");
-	if (!window) return -1;
+int main(int argc, char** argv) {
+	Options options;
+	if (!ParseOptions(argc, argv, options)) return 1;
+	if (!options.cpuTracePath.empty()) {
+		CpuProfiler::Start();
+		CPU_PROFILE_THREAD_NAME("main");
+	}
+	// Everything random in the scene (stress lights, campfire shape) follows the seed
+	std::srand(options.randomSeed);
+
+	// Comparison of two benchmark summaries, no rendering
+	if (!options.compareBaselinePath.empty()) {
+		BenchmarkSummary baseline, current;
+		if (!ReadBenchmarkSummary(options.compareBaselinePath.c_str(), baseline) ||
+		    !ReadBenchmarkSummary(options.compareCurrentPath.c_str(), current)) {
+			std::cout << "ERROR: could not read the benchmark summaries" << std::endl;
+			return 1;
+		}
+		return CompareBenchmarks(baseline, current, options.regressionThreshold) > 0 ? 1 : 0;
+	}
+
+	// Scene compilation, no rendering
+	if (!options.compileSceneInput.empty())
+		return CompileScene(options.compileSceneInput.c_str(), options.compileSceneOutput.c_str()) ? 0 : 1;
+
+	// Scene traversal benchmark, no rendering
+	if (options.entityBenchmarkCount > 0) return RunEntityBenchmark(options.entityBenchmarkCount);
+	if (options.particleBenchmarkCount > 0) return RunParticleBenchmark(options.particleBenchmarkCount);
+
+	// Image-based lighting caches, no rendering
+	if (options.bakeEnvironments) {
+		ThreadPool bakePool;
+		return BakeEnvironments(bakePool);
+	}
+
+	CameraPath benchmarkPath = CameraPath::Flythrough();
+	if (!options.cameraPathFile.empty() && !benchmarkPath.load(options.cameraPathFile.c_str())) return 1;
+	bool benchmark = !options.benchmarkPath.empty();
+
+	width = (unsigned int)std::max(options.width, 64);
+	height = (unsigned int)std::max(options.height, 64);
+
+	// Headless runs (and the upscale comparison and benchmark, when EGL is there) need no window
+	bool headless = options.headlessFrames > 0
+		|| ((options.upscaleCompareFrames > 0 || benchmark || options.gpuParticleBenchmarkMax > 0) && HeadlessContext::supported());
+	HeadlessContext headlessContext;
+	GLFWwindow* window = nullptr;
+	if (headless) {
+		if (!headlessContext.create()) return -1;
+	}
+	else {
+		window = InitWindow(width, height, "3D_game", options.upscaleCompareFrames == 0 && !benchmark && options.gpuParticleBenchmarkMax == 0);
+		if (!window) return -1;
+	}
+
+	// Particle simulation scaling, needs the context only
+	if (options.gpuParticleBenchmarkMax > 0) {
+		int result = RunGpuParticleBenchmark(options.gpuParticleBenchmarkMax);
+		if (window) glfwDestroyWindow(window);
+		glfwTerminate();
+		return result;
+	}
 
 	std::string texPath = "assets/textures/";
 	Texture textures[] = { Texture((texPath + "planks.png").c_str(), "diffuse", 0),
                         Texture((texPath + "planksSpec.png").c_str(), "specular", 1)
                         };  
-    Texture bronzeTexture((texPath + "brick.png").c_str(), "diffuse", 0);
 
 	Shader shaderProgram("shader/default.vert", "shader/default.frag");
+	Shader clusteredShader("shader/default.vert", "shader/clustered.frag");
+	SetSpotConeUniforms(shaderProgram);
+	SetSpotConeUniforms(clusteredShader);
 	std::vector<Vertex> verts(vertices, vertices + 4);
 	std::vector<GLuint> ind(indices, indices + 6);
 	std::vector<Texture> tex(textures, textures + 1);
@@ -129,10 +232,10 @@ int main() {
 
     Shader particleShader("shader/particle.vert", "shader/particle.frag");
     Texture smokeTexture("assets/textures/smoke.png", "diffuse", 0);
-    ParticleSystem campfireSmoke(&particleShader, smokeTexture.ID);
 
     Shader reflectionShader("shader/reflect.vert", "shader/reflect.frag");
     Shader refractionShader("shader/refrac.vert", "shader/refrac.frag");
+    Shader planarShader("shader/planar_mirror.vert", "shader/planar_mirror.frag");
 
     // --- Mirror geometry setup ---
     // Simple quad for mirrors (XZ plane, centered at origin)
@@ -146,87 +249,110 @@ int main() {
     std::vector<Texture> emptyTex; // No texture needed for mirror
     Mesh mirrorMesh(mirrorVertices, mirrorIndices, emptyTex);
 
-    // Mirror 1: Reflection (vertical, like a wall)
-    glm::mat4 mirror1Model = glm::mat4(1.0f);
-    mirror1Model = glm::translate(mirror1Model, glm::vec3(- 10.0f, 1.0f, 0.0f)); // position
-    mirror1Model = glm::rotate(mirror1Model, glm::radians(90.0f), glm::vec3(1,0,0)); // vertical
-    mirror1Model = glm::scale(mirror1Model, glm::vec3(10.0f, 10.0f, 10.0f)); // size
+	// Models, instances, lights, colliders and mirrors come from the scene file (--scene)
+	Scene scene;
+	if (!scene.load(options.scenePath.c_str())) return 1;
+	std::vector<Light> lights = scene.lights;
+	// Lights past this index are stress-test lights (no proxy mesh)
+	const size_t sceneLightCount = lights.size();
+	std::vector<StressLight> stressLights = CreateStressLights(lights, options.stressLights);
 
-    // Mirror 2: Refraction (horizontal, like a pool)
-    glm::mat4 mirror2Model = glm::mat4(1.0f);
-    mirror2Model = glm::translate(mirror2Model, glm::vec3(-5.0f, 0.2f, 0.0f)); // position
-    mirror1Model = glm::rotate(mirror1Model, glm::radians(90.0f), glm::vec3(1,0,0)); // vertical
-    mirror2Model = glm::scale(mirror2Model, glm::vec3(10.0f, 10.0f, 10.0f)); // size
+	// Clustered lighting: light binning runs on the shared worker pool
+	ThreadPool threadPool;
+	// World matrices, bounds, instance colliders and attached lights of the scene
+	scene.updateTransforms(threadPool);
+	scene.placeLights(lights);
+	LightClusters lightClusters(threadPool);
+	if (options.deferredShading) {
+		options.clusteredLighting = false;
+		std::cout << "Deferred shading enabled (" << lights.size() << " lights)" << std::endl;
+	}
+	else if (options.clusteredLighting) {
+		std::cout << "Clustered lighting enabled (" << threadPool.threadCount() << " threads, "
+		          << lights.size() << " lights)" << std::endl;
+	}
+	else if (!options.perObjectLights && lights.size() > (size_t)MAX_SHADER_LIGHTS) {
+		std::cout << "WARNING: forward path only shades the first " << MAX_SHADER_LIGHTS
+		          << " of " << lights.size() << " lights without per-object light lists" << std::endl;
+	}
 
+	// Forward path: every object gets its own top-N light list
+	LightCuller lightCuller;
+	LightCuller* culler = (!options.clusteredLighting && !options.deferredShading && options.perObjectLights) ? &lightCuller : nullptr;
 
-	std::vector<Light> lights = {
-		{0, glm::vec3(-1.0f), glm::vec3(-0.0f, -1.0f, -0.0f), glm::vec4(1.0f)}, // Directional light, mesh at origin
-		{1, glm::vec3(-12.0f, 12.0f, 7.0f), glm::vec3(0.0f), glm::vec4(1.0f, 0.5f, 0.0f, 10.0f)}, // Point light
-		{2, glm::vec3(20.0f, 3.0f, 0.0f), glm::vec3(0.0f, -1.0f, 0.0f), glm::vec4(0.0f, 0.5f, 1.0f, 2.0f)},  // Spot light
-		{1, glm::vec3(5.0f, 1.0f, 0.0f), glm::vec3(0.0f), glm::vec4(1.0f, 0.7f, 0.2f, 5.0f)}  // Campfire light
-	};
-    std::vector<Collider> worldColliders;
-
-    // Load the models/objects
-	Model terrainModel("assets/objects/plane.obj");
-	terrainModel.SetTextureTiling(150.0f);
-	glm::mat4 terrainModelMatrix = glm::scale(glm::mat4(1.0f), glm::vec3(40.0f));
-	terrainModel.AddTexture(tex[0]);
-
-
-    Model treeModel("assets/objects/Tree 02/Tree.obj");
-    treeModel.SetTextureTiling(1.0f);
-    glm::mat4 treeModelMatrix = glm::mat4(1.0f);
-    treeModelMatrix = glm::translate(treeModelMatrix, glm::vec3(-12.0f, 0.0f, -12.0f));
-    treeModelMatrix = glm::scale(treeModelMatrix, glm::vec3(2.8f, 3.4f, 2.8f));
-    std::vector<glm::vec3> treePositions;
-    if (!trees.empty()) {
-        float firstX = trees[0].position.x;
-        for (const auto& tree : trees) {
-            if (tree.position.x == firstX) {
-                treePositions.push_back(tree.position);
-            }
-        }
-    }
+	// Deferred path: G-buffer and light volumes, only allocated when used
+	std::unique_ptr<DeferredRenderer> deferredRenderer;
+	if (options.deferredShading) deferredRenderer.reset(new DeferredRenderer(width, height));
 
-    // Build component-specific colliders for the tree
-    treeModel.buildComponentColliders(treeModelMatrix);
-    Collider* trunkCollider = treeModel.getComponentCollider("Trank_bark");
+	// Dynamic resolution / temporal upscaling: the scene goes to an offscreen target
+	// sized by the GPU frame time (--drs) or at a fixed scale (--taa alone)
+	std::unique_ptr<DynamicResolution> dynamicResolution;
+	if ((options.drsTargetMs > 0.0f || options.temporalUpscaling) && options.upscaleCompareFrames == 0) {
+		dynamicResolution.reset(new DynamicResolution(width, height,
+			options.temporalUpscaling ? DynamicResolution::Temporal : DynamicResolution::Spatial));
+		if (options.drsTargetMs > 0.0f) {
+			dynamicResolution->targetMs = options.drsTargetMs;
+			dynamicResolution->minScale = glm::clamp(options.drsMinScale, 0.1f, 1.0f);
+			dynamicResolution->maxScale = glm::clamp(options.drsMaxScale, dynamicResolution->minScale, 1.0f);
+		}
+		else {
+			dynamicResolution->targetMs = 0.0f;
+			dynamicResolution->minScale = dynamicResolution->maxScale = glm::clamp(options.upscaleScale, 0.1f, 1.0f);
+		}
+		dynamicResolution->kp = options.drsKp;
+		dynamicResolution->ki = options.drsKi;
+		dynamicResolution->kd = options.drsKd;
+		dynamicResolution->sharpness = options.drsSharpness;
+		std::cout << (options.temporalUpscaling ? "Temporal upscaling" : "Dynamic resolution") << ": target "
+		          << dynamicResolution->targetMs << "ms, scale "
+		          << dynamicResolution->minScale << "-" << dynamicResolution->maxScale
+		          << ", pid " << dynamicResolution->kp << "/" << dynamicResolution->ki << "/" << dynamicResolution->kd
+		          << ", sharpness " << dynamicResolution->sharpness << std::endl;
+	}
 
-    for (const auto& tree : trees) {
-        treePositions.push_back(tree.position);
-    }
+	// CPU occlusion culling: occluders are picked from the static models. Every
+	// instance is offered (unless marked nooccluder); addStaticModel keeps the big opaque ones
+	OcclusionCuller occlusionCuller(threadPool);
+	OcclusionCuller* occlusion = nullptr;
+	std::unique_ptr<OcclusionDebugView> occlusionDebugView;
+	if (options.occlusionCulling) {
+		const EntityStore& entities = scene.entities;
+		for (size_t i = 0; i < entities.size(); ++i) {
+			if (entities.meshes[i] == EntityStore::NO_MESH || !(entities.flags[i] & EntityStore::Occluder)) continue;
+			const Scene::Asset& asset = scene.assets[entities.meshes[i]];
+			occlusionCuller.addStaticModel(*asset.model, entities.worldMatrices[i], asset.name);
+		}
+		occlusion = &occlusionCuller;
+		if (options.occlusionDebug) occlusionDebugView.reset(new OcclusionDebugView(occlusionCuller.width(), occlusionCuller.height()));
+	}
 
-    // Create all tree colliders (one per tree)
-    std::vector<Collider> treeColliders = CreateTreeColliders(trunkCollider, treePositions);
-
-    // Add all tree colliders to worldColliders
-    worldColliders.insert(worldColliders.end(), treeColliders.begin(), treeColliders.end());
-
-    Model farmhouseModel("assets/textures/newhouse/farmhouse_obj.obj");
-    farmhouseModel.SetTextureTiling(1.0f); 
-    glm::mat4 farmhouseModelMatrix = glm::mat4(1.0f);
-    farmhouseModelMatrix = glm::translate(farmhouseModelMatrix, glm::vec3(0.0f, 0.0f, 0.0f));
-    farmhouseModelMatrix = glm::rotate(farmhouseModelMatrix, glm::radians(90.0f), glm::vec3(0.0f, 1.0f, 0.0f));
-    farmhouseModelMatrix = glm::scale(farmhouseModelMatrix, glm::vec3(0.5f, 0.5f, 0.5f));
-    farmhouseModel.buildCollider(farmhouseModelMatrix);
-    worldColliders.push_back(farmhouseModel.collider);
-
-    Model lampModel("assets/objects/LAMP/rv_lamp_post_4.obj", true);
-    lampModel.SetTextureTiling(1.0f);
-    glm::mat4 lampModelMatrix = glm::mat4(1.0f);
-    lampModelMatrix = glm::translate(lampModelMatrix, glm::vec3(-15.0f, 0.0f, 10.0f));
-    lampModelMatrix = glm::rotate(lampModelMatrix, glm::radians(45.0f), glm::vec3(0.0f, 1.0f, 0.0f));
-    lampModelMatrix = glm::scale(lampModelMatrix, glm::vec3(0.7f, 0.7f, 0.7f));
-    lampModel.AddTexture(bronzeTexture);
-    glm::vec3 lampBaseCenter = glm::vec3(-15.0f, 0.0f, 10.0f); // Base center of the lamp
-    float lampRadius = 0.6f; // Radius of the cylinder
-    float lampHeight = 2.5f; // Height of the cylinder
-    Collider lampCollider(lampBaseCenter, lampRadius, lampHeight);
-    worldColliders.push_back(lampCollider);
+	// Cached shadow maps for the scene lights (the stress lights don't cast shadows)
+	std::unique_ptr<ShadowAtlas> shadowAtlas;
+	if (options.shadows) {
+		shadowAtlas.reset(new ShadowAtlas());
+		const EntityStore& entities = scene.entities;
+		for (size_t i = 0; i < entities.size(); ++i) {
+			if (entities.meshes[i] == EntityStore::NO_MESH || !(entities.flags[i] & EntityStore::CastsShadow)) continue;
+			shadowAtlas->addCaster(*scene.assets[entities.meshes[i]].model, entities.worldMatrices[i]);
+		}
+		for (size_t i = 0; i < sceneLightCount; ++i) {
+			if (!shadowAtlas->addLight(lights, i)) std::cout << "WARNING: no room in the shadow atlas for light " << i << std::endl;
+		}
+		std::cout << "Shadow atlas: " << (int)(shadowAtlas->occupancy() * 100.0f) << "% allocated" << std::endl;
+	}
+
+	// GPU time per pass, reported every HISTORY_FRAMES frames
+	std::unique_ptr<GpuProfiler> gpuProfiler;
+	if (options.gpuProfile) {
+		gpuProfiler.reset(new GpuProfiler());
+		if (!options.gpuProfileCsv.empty() && gpuProfiler->openCsv(options.gpuProfileCsv.c_str()))
+			std::cout << "GPU profile: writing every frame to " << options.gpuProfileCsv << std::endl;
+	}
     
-	Player player(width, height, glm::vec3(-15.0f, 1.7f, 15.0f));
+	Player player(width, height, scene.spawn);
 	player.speed = 10.0f;
+	// What gets rendered: the player's camera at the interpolated eye position
+	Camera viewCamera = player.camera;
 	glEnable(GL_DEPTH_TEST);
     glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 	float time = 0.0f;
@@ -243,6 +369,20 @@ int main() {
     };
     Cubemaps skybox(skyboxFaces, "shader/skybox.vert", "shader/skybox.frag");
 
+	// Image-based lighting from the same skybox, computed once and cached next to the faces
+	std::unique_ptr<EnvironmentLighting> environment;
+	if (options.imageBasedLighting) {
+		environment.reset(new EnvironmentLighting());
+		if (environment->load(skyboxFaces, threadPool)) {
+			environment->upload();
+			std::cout << "Image-based lighting: " << (environment->fromCache ? "cached, " : "computed, ")
+			          << environment->computeMs << "ms" << std::endl;
+		}
+		else {
+			environment.reset();
+		}
+	}
+
     // Enable blending for skybox alpha
     glEnable(GL_BLEND);
     glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
@@ -253,119 +393,688 @@ int main() {
 	float growthDuration = 20.0f;    // Take 20 seconds to reach full size
 	float minScale = 1.0f;          // Starting scale
 	float maxScale = 12.0f;         // Target scale
-	bool growthComplete = false;
 
 	// Create campfire at specific position (start with small scale)
-	Campfire campfire(glm::vec3(5.0f, 0.05f, 0.0f), minScale);
+	Campfire campfire(scene.hasCampfire() ? scene.campfirePosition() : glm::vec3(0.0f), minScale);
 
-	while (!glfwWindowShouldClose(window)) {
-		glClearColor(0.07f, 0.13f, 0.17f, 1.0f);
-		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-		float deltaTime = glfwGetTime();
-		glfwSetTime(0);
+	// Optional depth-only pass in front of the lit pass
+	DepthPrepass depthPrepass((DepthPrepass::Mode)options.depthPrepass);
+
+	// Render thread's copy of the entity transforms. The game thread moves
+	// scene.entities; the world matrices and bounds of what moved reach this
+	// copy through the snapshots (applySnapshot), so the two never share arrays.
+	EntityStore renderEntities = scene.entities;
+	// Visible entities of the frame, by model (frustum and occlusion culled in renderScene)
+	DrawPackets drawPackets;
+
+	// Draws the opaque scene; the lit pass gets the per-object culler and the
+	// reflection probes (read by the reflective models), the depth pre-pass doesn't
+	auto drawOpaque = [&](Shader& shader, LightCuller* objectCuller, const ReflectionProbes* reflectionProbes) {
+		shader.Activate();
+		for (uint32_t mesh = 0; mesh < (uint32_t)scene.assets.size(); ++mesh) {
+			Scene::Asset& asset = scene.assets[mesh];
+			GpuProfiler::Scope scope(gpuProfiler.get(), asset.name.c_str());
+			glUniform1f(glGetUniformLocation(shader.ID, "reflectivity"), asset.reflectivity);
+			glUniform1f(glGetUniformLocation(shader.ID, "roughness"), asset.roughness);
+			DrawEntities(*asset.model, renderEntities, drawPackets, mesh, shader, viewCamera, objectCuller,
+			             asset.reflectivity > 0.0f ? reflectionProbes : nullptr);
+		}
+	};
+
+	// GPU time of the opaque pass (pre-pass included), read back one query late so it never stalls
+	GLuint litPassQueries[2];
+	glGenQueries(2, litPassQueries);
+	bool litPassUsedPrepass[2] = { false, false };
+	// Fragments that passed the depth test in the lit pass, i.e. how many got shaded
+	GLuint shadedQueries[2];
+	glGenQueries(2, shadedQueries);
+	int frameIndex = 0;
+	float litPassMsTotal = 0.0f;
+	int litPassSamples = 0;
+	double shadedFragmentsTotal = 0.0;
+	int prepassFrames = 0;
+
+	FixedTimestep timestep(options.tickRate, options.maxTicksPerFrame);
+	std::cout << "Simulation: " << options.tickRate << " ticks/s, at most " << options.maxTicksPerFrame << " per frame" << std::endl;
+
+	// The game thread can't share threadPool with the render thread (one job at a time)
+	ThreadPool gameThreadPool(0);
+
+	// Entities moved since the last snapshot, each listed once
+	std::vector<uint32_t> pendingMoved;
+	std::vector<uint8_t> isPendingMoved(scene.entities.size(), 0);
+
+	// Advances the simulation by one tick (the player is stepped separately).
+	// Moved entities get their world matrices, bounds and colliders here, on the
+	// game side where collision happens, and wait for the next snapshot.
+	auto simulate = [&](float deltaTime) {
 		time += deltaTime;
-		
-		// Handle campfire growth
-		if (!growthComplete && time > growthStartTime) {
-			float growthProgress = (time - growthStartTime) / growthDuration;
-			if (growthProgress >= 1.0f) {
-				growthProgress = 1.0f;
-				growthComplete = true;
-			}
-			
-			// Calculate current scale using smooth interpolation
-			float currentScale = minScale + (maxScale - minScale) * 
-			                     (growthProgress * growthProgress * (3.0f - 2.0f * growthProgress)); // Smooth step
-			                     
-			// Update campfire scale
-			campfire.SetScale(currentScale);
-		}
-		player.Update(window, worldColliders, deltaTime);
-
-		lights[1].color = glm::vec4(2.0f, 1.0f, 0.0f, 1.0f);
-		lights[2].color = glm::vec4(0.0f, 0.0f, 1.0f, 1.0f) * (0.5f + 0.5f * cos(time));
-		lights[0].color = glm::vec4(1.0f) * (0.3f + 0.7f * abs(sin(time * 0.5f)));
-		
-		// Animate campfire light with flickering effect
-		lights[3].color = glm::vec4(1.0f, 0.7f, 0.2f, 1.0f) * (0.8f + 0.2f * sin(time * 10.0f));
+		scene.updateTransforms(options.threadedRendering ? gameThreadPool : threadPool);
+		for (uint32_t i : scene.entities.moved) {
+			if (isPendingMoved[i]) continue;
+			isPendingMoved[i] = 1;
+			pendingMoved.push_back(i);
+		}
+	};
+
+	// Campfire size at a given time, a smooth step from minScale to maxScale
+	auto campfireScaleAt = [&](float atTime) {
+		if (atTime <= growthStartTime) return minScale;
+		float growthProgress = std::min((atTime - growthStartTime) / growthDuration, 1.0f);
+		return minScale + (maxScale - minScale) * 
+		       (growthProgress * growthProgress * (3.0f - 2.0f * growthProgress)); // Smooth step
+	};
+
+	// Light animation, a pure function of time so it can be evaluated at the interpolated render time
+	auto animateLights = [&](std::vector<Light>& animated, float atTime) {
+		scene.placeLights(animated);
+		scene.animateLights(animated, atTime);
+		AnimateStressLights(animated, sceneLightCount, stressLights, atTime);
+	};
+
+	// Game thread: captures the simulation state `alpha` of the way into the current tick
+	auto buildSnapshot = [&](RenderSnapshot& snapshot, float alpha) {
+		float atTime = time - (1.0f - alpha) * timestep.step();
+		snapshot.time = atTime;
+		snapshot.cameraPosition = player.InterpolatedPosition(alpha);
+		snapshot.cameraOrientation = player.camera.Orientation;
+		snapshot.lights = lights;
+		animateLights(snapshot.lights, atTime);
+		snapshot.campfireScale = campfireScaleAt(atTime);
+		if (scene.hasCampfire()) snapshot.campfirePosition = scene.campfirePosition();
+		snapshot.tickCount = timestep.tickCount;
+		snapshot.droppedSeconds = timestep.droppedSeconds;
+		const EntityStore& entities = scene.entities;
+		snapshot.movedEntities.clear();
+		snapshot.movedMatrices.clear();
+		snapshot.movedBoundsMin.clear();
+		snapshot.movedBoundsMax.clear();
+		for (uint32_t i : pendingMoved) {
+			snapshot.movedEntities.push_back(i);
+			snapshot.movedMatrices.push_back(entities.worldMatrices[i]);
+			snapshot.movedBoundsMin.push_back(entities.boundsMin[i]);
+			snapshot.movedBoundsMax.push_back(entities.boundsMax[i]);
+			isPendingMoved[i] = 0;
+		}
+		pendingMoved.clear();
+	};
 
+	// Campfire smoke (--smoke): a visual effect only, advanced on the render side with the snapshot time.
+	// It emits as many particles per lifetime as it holds, and starts one lifetime in.
+	// Simulated on the CPU, or on the GPU with --smoke-gpu.
+	std::unique_ptr<ParticleSystem> campfireSmoke;
+	std::unique_ptr<GpuParticleSystem> gpuCampfireSmoke;
+	float smokeTime = 0.0f, smokeToEmit = 0.0f;
+	auto advanceSmoke = [&](float dt, const glm::vec3& origin) {
+		if (gpuCampfireSmoke) {
+			gpuCampfireSmoke->emitter.origin = origin;
+			gpuCampfireSmoke->update(dt);
+			return;
+		}
+		campfireSmoke->emitter.origin = origin;
+		campfireSmoke->update(dt);
+		smokeToEmit += dt * options.smokeParticles / campfireSmoke->emitter.lifetime;
+		for (; smokeToEmit >= 1.0f; smokeToEmit -= 1.0f) campfireSmoke->emit();
+	};
+	if (options.smokeParticles > 0 && scene.hasCampfire()) {
+		ParticleEmitter smoke;
+		smoke.origin = scene.campfirePosition();
+		if (options.gpuSmoke) {
+			gpuCampfireSmoke.reset(new GpuParticleSystem(&particleShader, smokeTexture.ID, (size_t)options.smokeParticles,
+			                                             options.smokeParticles / smoke.lifetime, smoke));
+		} else {
+			campfireSmoke.reset(new ParticleSystem(&particleShader, smokeTexture.ID, (size_t)options.smokeParticles));
+			campfireSmoke->emitter = smoke;
+			for (float t = 0.0f; t < smoke.lifetime; t += 1.0f / 60.0f) advanceSmoke(1.0f / 60.0f, smoke.origin);
+		}
+	}
+
+	// Render thread: the state renderScene draws, copied from a snapshot
+	std::vector<Light> frameLights = lights;
+	float renderTime = 0.0f;
+	long long frameTickCount = 0;
+	float frameDroppedSeconds = 0.0f;
+	auto applySnapshot = [&](const RenderSnapshot& snapshot) {
+		viewCamera.Position = snapshot.cameraPosition;
+		viewCamera.Orientation = snapshot.cameraOrientation;
+		viewCamera.updateMatrix(45.0f, 0.1f, 100.0f);
+		frameLights = snapshot.lights;
+		renderTime = snapshot.time;
+		frameTickCount = snapshot.tickCount;
+		frameDroppedSeconds = snapshot.droppedSeconds;
+		for (size_t m = 0; m < snapshot.movedEntities.size(); ++m) {
+			uint32_t i = snapshot.movedEntities[m];
+			renderEntities.worldMatrices[i] = snapshot.movedMatrices[m];
+			renderEntities.boundsMin[i] = snapshot.movedBoundsMin[m];
+			renderEntities.boundsMax[i] = snapshot.movedBoundsMax[m];
+		}
+		campfire.SetScale(snapshot.campfireScale);
+		campfire.SetTime(snapshot.time);
+		campfire.SetPosition(snapshot.campfirePosition);
+		if (campfireSmoke || gpuCampfireSmoke) {
+			float dt = glm::clamp(snapshot.time - smokeTime, 0.0f, 0.25f);
+			smokeTime = snapshot.time;
+			advanceSmoke(dt, snapshot.campfirePosition);
+		}
+	};
+
+	// Skybox opacity over the clear color at a given time
+	auto skyboxAlphaAt = [](float atTime) {
+		float animated = 0.3f + 0.7f * std::abs(std::sin(atTime * 0.5f));
+		return glm::clamp(animated, 0.2f, 1.0f);
+	};
+
+	// Scene reflections from the probes of the scene file (--probes)
+	std::unique_ptr<ReflectionProbes> probes;
+	// What the probes see besides the entities
+	auto drawProbeExtras = [&](Camera& camera) {
+		if (scene.hasCampfire()) campfire.Draw(camera);
+		skybox.setAlpha(skyboxAlphaAt(renderTime));
+		skybox.Draw(camera);
+	};
+	if (options.reflectionProbes) {
+		if (scene.probes.empty()) {
+			std::cout << "WARNING: --probes, but the scene has no probe records" << std::endl;
+		} else {
+			probes.reset(new ReflectionProbes(scene.probes));
+			auto start = std::chrono::steady_clock::now();
+			probes->captureAll(scene, renderEntities, lights, environment.get(), threadPool, drawProbeExtras);
+			glFinish();
+			std::cout << "Reflection probes: " << probes->size() << ", first capture "
+			          << std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count() << "ms" << std::endl;
+		}
+	}
+
+	// Planar reflections of the reflect mirrors (--planar-reflections), by mirror
+	std::vector<std::unique_ptr<PlanarReflection>> planarReflections;
+	if (options.planarDivisor > 0) {
+		planarReflections.resize(scene.mirrors.size());
+		for (size_t m = 0; m < scene.mirrors.size(); ++m) {
+			if (scene.mirrors[m].kind == MirrorReflect)
+				planarReflections[m].reset(new PlanarReflection(scene.mirrors[m].matrix, options.planarDivisor, options.planarInterval));
+		}
+	}
+	// The scene in a mirror: the forward shader with the first lights, then the campfire and the skybox
+	DrawPackets mirrorPackets;
+	auto drawMirrorScene = [&](Camera& camera, const glm::mat4& cullMatrix) {
+		CullEntities(renderEntities, cullMatrix, mirrorPackets, threadPool);
+		BuildDrawPackets(renderEntities, mirrorPackets);
+		int forwardLights = std::min((int)frameLights.size(), MAX_SHADER_LIGHTS);
 		shaderProgram.Activate();
-		glUniform1i(glGetUniformLocation(shaderProgram.ID, "lightCount"), lights.size());
-		for (int i = 0; i < lights.size(); ++i) lights[i].sendToShader(shaderProgram, i);
+		glUniform1i(glGetUniformLocation(shaderProgram.ID, "lightCount"), forwardLights);
+		for (int i = 0; i < forwardLights; ++i) frameLights[i].sendToShader(shaderProgram, i);
+		glUniform1i(glGetUniformLocation(shaderProgram.ID, "cubemapSampler"), 3);
+		glActiveTexture(GL_TEXTURE3);
+		glBindTexture(GL_TEXTURE_CUBE_MAP, skybox.getCubemapID());
+		glUniform1i(glGetUniformLocation(shaderProgram.ID, "shadowAtlas"), SHADOW_ATLAS_UNIT);
+		if (shadowAtlas) shadowAtlas->bind(shaderProgram);
+		glUniform1i(glGetUniformLocation(shaderProgram.ID, "prefilteredEnv"), ENVIRONMENT_UNIT);
+		if (environment) environment->bind(shaderProgram);
+		for (uint32_t mesh = 0; mesh < (uint32_t)scene.assets.size(); ++mesh) {
+			Scene::Asset& asset = scene.assets[mesh];
+			glUniform1f(glGetUniformLocation(shaderProgram.ID, "reflectivity"), asset.reflectivity);
+			glUniform1f(glGetUniformLocation(shaderProgram.ID, "roughness"), asset.roughness);
+			DrawEntities(*asset.model, renderEntities, mirrorPackets, mesh, shaderProgram, camera, nullptr,
+			             asset.reflectivity > 0.0f ? probes.get() : nullptr);
+		}
+		if (scene.hasCampfire()) campfire.Draw(camera);
+		skybox.setAlpha(skyboxAlphaAt(renderTime));
+		skybox.Draw(camera);
+	};
+
+	// Draws one frame of the scene into `output` (native size). With an upscaler the
+	// scene goes through its offscreen target first; overlays are left to the caller.
+	auto renderScene = [&](DynamicResolution* upscaler, GLuint output) {
+		CPU_PROFILE_SCOPE("renderScene");
+		const glm::vec4 clearColor(0.07f, 0.13f, 0.17f, 1.0f);
+		glBindFramebuffer(GL_FRAMEBUFFER, output);
+		glViewport(0, 0, width, height);
+		glClearColor(clearColor.r, clearColor.g, clearColor.b, clearColor.a);
+		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+		if (upscaler) upscaler->beginFrame(clearColor, viewCamera);
+		int renderWidth = upscaler ? upscaler->renderWidth() : width;
+		int renderHeight = upscaler ? upscaler->renderHeight() : height;
+		GLuint sceneFramebuffer = upscaler ? upscaler->sceneFramebuffer() : output;
+
+		if (occlusion) occlusion->update(viewCamera.cameraMatrix);
+		CullEntities(renderEntities, viewCamera.cameraMatrix, drawPackets, threadPool);
+		BuildDrawPackets(renderEntities, drawPackets, occlusion);
+		if (shadowAtlas) {
+			GpuProfiler::Scope scope(gpuProfiler.get(), "shadows");
+			shadowAtlas->update(frameLights, viewCamera);
+		}
+		if (probes) {
+			GpuProfiler::Scope scope(gpuProfiler.get(), "probes");
+			probes->update(scene, renderEntities, frameLights, environment.get(), threadPool, drawProbeExtras);
+		}
+		if (!planarReflections.empty()) {
+			GpuProfiler::Scope scope(gpuProfiler.get(), "planar reflections");
+			for (auto& planar : planarReflections)
+				if (planar) planar->update(viewCamera, renderWidth, renderHeight, drawMirrorScene);
+		}
+
+		// The deferred geometry pass takes no lights; they are applied after it, in
+		// DeferredRenderer::lightingPass (culler is null with deferred shading)
+		Shader& litShader = deferredRenderer ? deferredRenderer->geometryShader()
+		                  : (options.clusteredLighting ? clusteredShader : shaderProgram);
+		if (options.clusteredLighting && !deferredRenderer) {
+			lightClusters.update(frameLights, viewCamera);
+			lightClusters.bind(litShader, 4, renderWidth, renderHeight);
+		}
+		else if (culler) {
+			culler->prepare(frameLights);
+		}
+		else if (!deferredRenderer) {
+			int forwardLights = std::min((int)frameLights.size(), MAX_SHADER_LIGHTS);
+			litShader.Activate();
+			glUniform1i(glGetUniformLocation(litShader.ID, "lightCount"), forwardLights);
+			for (int i = 0; i < forwardLights; ++i) frameLights[i].sendToShader(litShader, i);
+		}
 
-        glUseProgram(shaderProgram.ID);
-        glUniform1i(glGetUniformLocation(shaderProgram.ID, "cubemapSampler"), 3);
+        glUseProgram(litShader.ID);
+        glUniform1i(glGetUniformLocation(litShader.ID, "cubemapSampler"), 3);
         glActiveTexture(GL_TEXTURE3);
         glBindTexture(GL_TEXTURE_CUBE_MAP, skybox.getCubemapID());
+        // Always point the shadow sampler at its own unit, even without shadows
+        glUniform1i(glGetUniformLocation(litShader.ID, "shadowAtlas"), SHADOW_ATLAS_UNIT);
+        if (shadowAtlas && !deferredRenderer) shadowAtlas->bind(litShader);
+        // Same for the environment's samplerCube
+        glUniform1i(glGetUniformLocation(litShader.ID, "prefilteredEnv"), ENVIRONMENT_UNIT);
+        if (environment && !deferredRenderer) environment->bind(litShader);
+
+		bool usePrepass = depthPrepass.active();
+		// The forward lit pass writes motion vectors; deferred pixels are reprojected from depth
+		bool motionVectors = upscaler && !deferredRenderer;
+		litPassUsedPrepass[frameIndex % 2] = usePrepass;
+		glBeginQuery(GL_TIME_ELAPSED, litPassQueries[frameIndex % 2]);
+		if (deferredRenderer) deferredRenderer->beginGeometryPass(clearColor);
+		if (usePrepass) {
+			GpuProfiler::Scope scope(gpuProfiler.get(), "prepass");
+			depthPrepass.beginDepthPass();
+			drawOpaque(depthPrepass.depthShader(), nullptr, nullptr);
+			depthPrepass.beginShadingPass();
+		}
+		glBeginQuery(GL_SAMPLES_PASSED, shadedQueries[frameIndex % 2]);
+		if (motionVectors) upscaler->beginMotionVectors(litShader);
+		{
+			GpuProfiler::Scope scope(gpuProfiler.get(), deferredRenderer ? "gbuffer" : "opaque");
+			drawOpaque(litShader, culler, deferredRenderer ? nullptr : probes.get());
+		}
+		if (motionVectors) upscaler->endMotionVectors();
+		glEndQuery(GL_SAMPLES_PASSED);
+		if (usePrepass) depthPrepass.end();
+		if (deferredRenderer) {
+			GpuProfiler::Scope scope(gpuProfiler.get(), "lighting");
+			deferredRenderer->lightingPass(frameLights, viewCamera, skybox.getCubemapID(), sceneFramebuffer, shadowAtlas.get(),
+			                               environment.get(), probes.get());
+		}
+		glEndQuery(GL_TIME_ELAPSED);
+
+		// Read last frame's queries and report the averages every 120 frames
+		GLuint available = 0;
+		int lastSlot = (frameIndex + 1) % 2;
+		if (frameIndex > 0) glGetQueryObjectuiv(litPassQueries[lastSlot], GL_QUERY_RESULT_AVAILABLE, &available);
+		if (available) {
+			GLuint64 elapsedNs = 0;
+			glGetQueryObjectui64v(litPassQueries[lastSlot], GL_QUERY_RESULT, &elapsedNs);
+			// Issued before the time query ended, so it is ready as well
+			GLuint64 shadedFragments = 0;
+			glGetQueryObjectui64v(shadedQueries[lastSlot], GL_QUERY_RESULT, &shadedFragments);
+			litPassMsTotal += elapsedNs / 1.0e6f;
+			shadedFragmentsTotal += (double)shadedFragments;
+			if (litPassUsedPrepass[lastSlot]) prepassFrames++;
+			litPassSamples++;
+			depthPrepass.addSample(litPassUsedPrepass[lastSlot], elapsedNs / 1.0e6f);
+		}
+		if (litPassSamples == 120 && options.upscaleCompareFrames == 0) {
+			const char* mode = deferredRenderer ? "deferred" : (options.clusteredLighting ? "clustered" : (culler ? "per-object" : "forward"));
+			std::cout << "[lighting] " << mode
+			          << " lights=" << frameLights.size()
+			          << " lit pass=" << litPassMsTotal / litPassSamples << "ms"
+			          << " prepass=" << prepassFrames << "/" << litPassSamples
+			          << " shaded/pixel=" << shadedFragmentsTotal / litPassSamples / (renderWidth * renderHeight);
+			if (options.clusteredLighting) {
+				std::cout << " binning=" << lightClusters.lastBuildMs << "ms"
+				          << " indices=" << lightClusters.lastIndexCount;
+			}
+			else if (deferredRenderer) {
+				std::cout << " volumes=" << deferredRenderer->lastVolumeCount;
+			}
+			else if (culler && culler->objectCount > 0) {
+				std::cout << " lights/object=" << (float)culler->selectedCount / culler->objectCount;
+			}
+			if (occlusion) {
+				std::cout << " occlusion=" << occlusion->lastRasterMs << "ms"
+				          << " hidden=" << occlusion->occludedCount << "/" << occlusion->testedCount
+				          << " offscreen=" << occlusion->offscreenCount;
+			}
+			if (upscaler) {
+				std::cout << (upscaler->upscaler() == DynamicResolution::Temporal ? " taa=" : " drs=") << upscaler->scale()
+				          << " (" << upscaler->renderWidth() << "x" << upscaler->renderHeight() << ")"
+				          << " frame=" << upscaler->lastGpuMs << "ms"
+				          << " resizes=" << upscaler->resizeCount;
+			}
+			std::cout << " entities=" << drawPackets.entities.size() << "/" << renderEntities.size()
+			          << " (frustum " << drawPackets.frustumCulled << ", occluded " << drawPackets.occlusionCulled << ")";
+			std::cout << " ticks=" << frameTickCount << " dropped=" << frameDroppedSeconds << "s";
+			if (!planarReflections.empty()) {
+				int rendered = 0, reused = 0, culled = 0;
+				for (auto& planar : planarReflections) {
+					if (!planar) continue;
+					rendered += planar->renderedFrames;
+					reused += planar->reusedFrames;
+					culled += planar->culledFrames;
+				}
+				std::cout << " planar=" << rendered << "/" << reused << "/" << culled << " (rendered/reused/culled)";
+			}
+			if (probes) {
+				std::cout << " probes=" << probes->lastGpuMs << "ms"
+				          << " draws=" << probes->lastDrawCalls
+				          << " skipped=" << probes->lastSkipped;
+			}
+			if (shadowAtlas) {
+				std::cout << " shadows=" << shadowAtlas->lastGpuMs << "ms"
+				          << " views=" << shadowAtlas->lastViewsRendered
+				          << " (static " << shadowAtlas->lastStaticRenders << ")"
+				          << " draws=" << shadowAtlas->lastDrawCalls
+				          << " pending=" << shadowAtlas->pendingViews
+				          << " atlas=" << (int)(shadowAtlas->occupancy() * 100.0f) << "%";
+			}
+			std::cout << std::endl;
+		}
+		if (litPassSamples == 120) {
+			litPassMsTotal = 0.0f;
+			litPassSamples = 0;
+			shadedFragmentsTotal = 0.0;
+			prepassFrames = 0;
+		}
+		frameIndex++;
 
-        glUniform1f(glGetUniformLocation(shaderProgram.ID, "reflectivity"), 0.0f);
-		terrainModel.Draw(shaderProgram, player.camera, terrainModelMatrix);
-        glUniform1f(glGetUniformLocation(shaderProgram.ID, "reflectivity"), 0.2f);
-        lampModel.Draw(shaderProgram, player.camera, lampModelMatrix);
-        glUniform1f(glGetUniformLocation(shaderProgram.ID, "reflectivity"), 0.0f);
-        farmhouseModel.Draw(shaderProgram, player.camera, farmhouseModelMatrix);
-        DrawTrees(trees, treeModel, shaderProgram, player.camera);
+        {
+            GpuProfiler::Scope scope(gpuProfiler.get(), "mirrors");
+            for (size_t m = 0; m < scene.mirrors.size(); ++m) {
+                const SceneMirror& mirror = scene.mirrors[m];
+                if (!planarReflections.empty() && planarReflections[m]) {
+                    // Planar reflection, read at the fragment's screen position; nothing to draw from the back
+                    const PlanarReflection& planar = *planarReflections[m];
+                    if (!planar.visible()) continue;
+                    planarShader.Activate();
+                    glUniformMatrix4fv(glGetUniformLocation(planarShader.ID, "model"), 1, GL_FALSE, glm::value_ptr(mirror.matrix));
+                    glUniform2f(glGetUniformLocation(planarShader.ID, "screenSize"), (float)renderWidth, (float)renderHeight);
+                    glUniform1i(glGetUniformLocation(planarShader.ID, "reflectionTexture"), 0);
+                    glActiveTexture(GL_TEXTURE0);
+                    glBindTexture(GL_TEXTURE_2D, planar.textureID());
+                    mirrorMesh.Draw(planarShader, viewCamera);
+                    continue;
+                }
+                // Reflection (like a wall) or refraction (like a pool) of the skybox, or of the nearest probe
+                Shader& mirrorShader = mirror.kind == MirrorRefract ? refractionShader : reflectionShader;
+                mirrorShader.Activate();
 
-        // --- Draw Mirror 1 (Reflection) ---
-        reflectionShader.Activate();
+                // Passe les uniforms
+                glUniformMatrix4fv(glGetUniformLocation(mirrorShader.ID, "model"), 1, GL_FALSE, glm::value_ptr(mirror.matrix));
+                glUniform3fv(glGetUniformLocation(mirrorShader.ID, "u_view_pos"), 1, glm::value_ptr(viewCamera.Position));
+                if (mirror.kind == MirrorRefract)
+                    glUniform1f(glGetUniformLocation(mirrorShader.ID, "refractionIndice"), mirror.refractionIndex);
+                glUniform1i(glGetUniformLocation(mirrorShader.ID, "cubemapSampler"), 0);
 
-        // Passe les uniforms
-        glUniformMatrix4fv(glGetUniformLocation(reflectionShader.ID, "model"), 1, GL_FALSE, glm::value_ptr(mirror1Model));
-        glUniform3fv(glGetUniformLocation(reflectionShader.ID, "u_view_pos"), 1, glm::value_ptr(player.camera.Position));
-        glUniform1i(glGetUniformLocation(reflectionShader.ID, "cubemapSampler"), 0);
+                // Active la texture cubemap de skybox
+                glActiveTexture(GL_TEXTURE0);
+                glBindTexture(GL_TEXTURE_CUBE_MAP, probes ? probes->nearestTexture(glm::vec3(mirror.matrix[3]))
+                                                          : skybox.getCubemapID());
 
-        // Active la texture cubemap de skybox
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_CUBE_MAP, skybox.getCubemapID()); // <- nécessite une méthode getter
+                // Matrice de vue/projection
+                viewCamera.Matrix(mirrorShader, "camMatrix");
+                mirrorMesh.Draw(mirrorShader, viewCamera);
+            }
+        }
 
-        // Matrice de vue/projection
-        player.camera.Matrix(reflectionShader, "camMatrix");
+        // Draw the campfire (updated in simulate)
+        if (scene.hasCampfire()) {
+            GpuProfiler::Scope scope(gpuProfiler.get(), "campfire");
+            campfire.Draw(viewCamera);
+        }
+        if (campfireSmoke || gpuCampfireSmoke) {
+            GpuProfiler::Scope scope(gpuProfiler.get(), "smoke");
+            if (campfireSmoke) campfireSmoke->draw(viewCamera);
+            else gpuCampfireSmoke->draw(viewCamera);
+        }
 
-        // Dessine le miroir
-        mirrorMesh.Draw(reflectionShader, player.camera);
+		{
+			GpuProfiler::Scope scope(gpuProfiler.get(), "light proxies");
+			lightShader.Activate();
+			for (size_t i = 0; i < sceneLightCount; ++i) {
+				// Lights without a proxy (the campfire's) are only seen by what they light
+				if (!scene.lightProxies[i]) continue;
 
-        // --- Draw Mirror 2 (Refraction) ---
-        refractionShader.Activate();
+				glm::mat4 lightModelMatrix = glm::translate(glm::mat4(1.0f), frameLights[i].position);
+				lightModelMatrix = glm::scale(lightModelMatrix, glm::vec3(1.0f)); // Increased scale
+				glUniformMatrix4fv(glGetUniformLocation(lightShader.ID, "model"), 1, GL_FALSE, glm::value_ptr(lightModelMatrix));
+				glUniform4fv(glGetUniformLocation(lightShader.ID, "lightColor"), 1, glm::value_ptr(frameLights[i].color));
+				lightMesh.Draw(lightShader, viewCamera);
+			}
+		}
 
-        glUniformMatrix4fv(glGetUniformLocation(refractionShader.ID, "model"), 1, GL_FALSE, glm::value_ptr(mirror2Model));
-        glUniform3fv(glGetUniformLocation(refractionShader.ID, "u_view_pos"), 1, glm::value_ptr(player.camera.Position));
-        glUniform1f(glGetUniformLocation(refractionShader.ID, "refractionIndice"), 1.52f); // Verre standard
-        glUniform1i(glGetUniformLocation(refractionShader.ID, "cubemapSampler"), 0);
+        {
+            GpuProfiler::Scope scope(gpuProfiler.get(), "skybox");
+            skybox.setAlpha(skyboxAlphaAt(renderTime));
+            skybox.Draw(viewCamera);
+        }
 
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_CUBE_MAP, skybox.getCubemapID());
+		// Upscale to the output; overlays drawn after this stay at native resolution
+		if (upscaler) {
+			GpuProfiler::Scope scope(gpuProfiler.get(), "upscale");
+			upscaler->endFrame(output);
+		}
+	};
+
+	// A frame as shown: the scene plus the debug overlays, measured by the GPU profiler
+	long long profiledFrames = 0;
+	auto renderFrame = [&](DynamicResolution* upscaler, GLuint output) {
+		CPU_PROFILE_SCOPE("renderFrame");
+		if (gpuProfiler) gpuProfiler->beginFrame();
+		renderScene(upscaler, output);
+		glBindFramebuffer(GL_FRAMEBUFFER, output);
+		if (occlusionDebugView) occlusionDebugView->draw(occlusionCuller, viewCamera, width, height);
+		if (gpuProfiler) {
+			if (options.gpuProfileOverlay) gpuProfiler->drawGraph(width, height);
+			gpuProfiler->endFrame();
+			if (++profiledFrames % GpuProfiler::HISTORY_FRAMES == 0) gpuProfiler->report();
+		}
+	};
+
+	// One frame of game time: mouse look, then as many fixed ticks of player
+	// physics and simulation as `frameSeconds` of real time holds
+	auto stepGame = [&](float frameSeconds, const InputState& input) {
+		// Mouse look follows the display rate, it isn't simulated
+		player.camera.Inputs(input);
+		int ticks = timestep.advance(frameSeconds);
+		for (int i = 0; i < ticks; ++i) {
+			player.Update(input, scene.colliders, timestep.step());
+			simulate(timestep.step());
+		}
+	};
+
+	// --record-input / --replay-input
+	InputDevice inputDevice;
+	InputRecorder inputRecorder;
+	if (!options.recordInputPath.empty() && inputRecorder.open(options.recordInputPath.c_str()))
+		std::cout << "Recording input to " << options.recordInputPath << std::endl;
+	std::unique_ptr<InputReplay> inputReplay;
+	if (!options.replayInputPath.empty()) {
+		inputReplay.reset(new InputReplay());
+		if (!inputReplay->load(options.replayInputPath.c_str())) return 1;
+		std::cout << "Replaying " << inputReplay->frameCount() << " frames of input from " << options.replayInputPath << std::endl;
+	}
+	// End state of a replay, to compare runs
+	auto reportReplay = [&]() {
+		std::cout << "[replay] ticks=" << timestep.tickCount << " time=" << time
+		          << " position=(" << player.camera.Position.x << ", " << player.camera.Position.y << ", " << player.camera.Position.z << ")"
+		          << " orientation=(" << player.camera.Orientation.x << ", " << player.camera.Orientation.y << ", " << player.camera.Orientation.z << ")"
+		          << std::endl;
+	};
 
-        player.camera.Matrix(refractionShader, "camMatrix");
-        mirrorMesh.Draw(refractionShader, player.camera);
+	if (options.upscaleCompareFrames > 0 || options.headlessFrames > 0 || benchmark) {
+		RenderSnapshot snapshot;
+		auto simulateAndApply = [&](float deltaTime) {
+			if (inputReplay) {
+				// The recorded frame times drive the fixed timestep, as in the live run
+				float frameSeconds;
+				InputState input;
+				if (inputReplay->next(frameSeconds, input)) stepGame(frameSeconds, input);
+				buildSnapshot(snapshot, timestep.alpha());
+			}
+			else {
+				simulate(deltaTime);
+				buildSnapshot(snapshot, 1.0f);
+			}
+			applySnapshot(snapshot);
+		};
+		// A replay brings its own camera
+		Options runOptions = options;
+		if (inputReplay) runOptions.staticCamera = true;
+		int result = benchmark
+			? RunBenchmark(options, width, height, viewCamera, benchmarkPath, simulateAndApply, renderFrame, dynamicResolution.get())
+			: options.headlessFrames > 0
+			? RunHeadless(runOptions, width, height, viewCamera, simulateAndApply, renderFrame, dynamicResolution.get())
+			: RunUpscaleComparison(options, width, height, viewCamera, simulateAndApply, renderScene);
+		if (inputReplay) reportReplay();
+		if (gpuProfiler && profiledFrames % GpuProfiler::HISTORY_FRAMES != 0) gpuProfiler->report();
+		if (!options.cpuTracePath.empty()) CpuProfiler::WriteChromeTrace(options.cpuTracePath.c_str());
+		if (window) {
+			glfwDestroyWindow(window);
+			glfwTerminate();
+		}
+		return result;
+	}
 
-        // Update and draw the campfire
-        campfire.Update(deltaTime);
-        campfire.Draw(player.camera);
+	// Game side of a frame: input, player physics, campfire and growth at a fixed
+	// tick rate, then a snapshot interpolated between the last two ticks
+	double lastFrameStart = glfwGetTime();
+	long long producedFrames = 0;
+	// --record-camera: the player's pose every half second of simulated time, a camera path for --benchmark
+	const float recordInterval = 0.5f;
+	CameraPath recordedPath;
+	float recordStart = 0.0f;
+	auto produceFrame = [&](RenderSnapshot& snapshot) {
+		CPU_PROFILE_SCOPE("produceFrame");
+		double frameStart = glfwGetTime();
+		float frameSeconds = (float)(frameStart - lastFrameStart);
+		lastFrameStart = frameStart;
 
-		lightShader.Activate();
-		for (int i = 0; i < lights.size(); ++i) {
-			// Skip rendering the light mesh for the campfire light (index 3)
-			if (i == 3) continue;
-			
-			glm::mat4 lightModelMatrix = glm::translate(glm::mat4(1.0f), lights[i].position);
-			lightModelMatrix = glm::scale(lightModelMatrix, glm::vec3(1.0f)); // Increased scale
-			glUniformMatrix4fv(glGetUniformLocation(lightShader.ID, "model"), 1, GL_FALSE, glm::value_ptr(lightModelMatrix));
-			glUniform4fv(glGetUniformLocation(lightShader.ID, "lightColor"), 1, glm::value_ptr(lights[i].color));
-			lightMesh.Draw(lightShader, player.camera);
+		// At the end of a replay nothing is recorded or stepped; the snapshot of
+		// the last state is still built so the render side has a current one
+		InputState input;
+		bool stepped = true;
+		if (!inputReplay) {
+			input = inputDevice.sample(window, width, height);
+		}
+		else if (!inputReplay->next(frameSeconds, input)) {
+			reportReplay();
+			glfwSetWindowShouldClose(window, GLFW_TRUE);
+			stepped = false;
+		}
+		if (stepped) {
+			inputRecorder.write(frameSeconds, input);
+			stepGame(frameSeconds, input);
+		}
+		if (!options.recordCameraPath.empty()
+		    && (recordedPath.keyframes.empty() || time - recordStart >= recordedPath.duration() + recordInterval)) {
+			if (recordedPath.keyframes.empty()) recordStart = time;
+			recordedPath.add(time - recordStart, player.camera.Position, player.camera.Position + player.camera.Orientation * 10.0f);
 		}
+		buildSnapshot(snapshot, timestep.alpha());
+		snapshot.frame = producedFrames++;
+		snapshot.inputTime = frameStart;
+		snapshot.simMs = (float)((glfwGetTime() - frameStart) * 1000.0);
+	};
 
-        float animated = 0.3f + 0.7f * std::abs(std::sin(time * 0.5f));
-        float skyboxAlpha = glm::clamp(animated, 0.2f, 1.0f);
-        skybox.setAlpha(skyboxAlpha);
-        skybox.Draw(player.camera, width, height);
+	// Render side of a frame: draws a snapshot and presents it. Reports the
+	// frame rate, the cost of each side and the input-to-present latency.
+	double simMsTotal = 0.0, renderMsTotal = 0.0, latencyMsTotal = 0.0;
+	int pipelineSamples = 0;
+	double pipelineStart = glfwGetTime();
+	// --threaded: the handoff, for the time each side spent waiting on the other
+	SnapshotBuffer* pipelineBuffer = nullptr;
+	float producerWaitStart = 0.0f, consumerWaitStart = 0.0f;
+	auto presentFrame = [&](const RenderSnapshot& snapshot) {
+		double renderStart = glfwGetTime();
+		applySnapshot(snapshot);
+		renderFrame(dynamicResolution.get(), 0);
+		{
+			CPU_PROFILE_SCOPE("glfwSwapBuffers");
+			glfwSwapBuffers(window);
+		}
+		double presented = glfwGetTime();
+		simMsTotal += snapshot.simMs;
+		renderMsTotal += (presented - renderStart) * 1000.0;
+		latencyMsTotal += (presented - snapshot.inputTime) * 1000.0;
+		if (++pipelineSamples == 120) {
+			std::cout << "[pipeline] " << (options.threadedRendering ? "threaded" : "serial")
+			          << " frame=" << (presented - pipelineStart) * 1000.0 / pipelineSamples << "ms"
+			          << " sim=" << simMsTotal / pipelineSamples << "ms"
+			          << " render=" << renderMsTotal / pipelineSamples << "ms"
+			          << " latency=" << latencyMsTotal / pipelineSamples << "ms";
+			if (pipelineBuffer) {
+				float producerWait = pipelineBuffer->producerWaitMs(), consumerWait = pipelineBuffer->consumerWaitMs();
+				std::cout << " game-wait=" << (producerWait - producerWaitStart) / pipelineSamples << "ms"
+				          << " render-wait=" << (consumerWait - consumerWaitStart) / pipelineSamples << "ms";
+				producerWaitStart = producerWait;
+				consumerWaitStart = consumerWait;
+			}
+			std::cout << std::endl;
+			simMsTotal = renderMsTotal = latencyMsTotal = 0.0;
+			pipelineSamples = 0;
+			pipelineStart = presented;
+		}
+	};
 
-		glfwSwapBuffers(window);
-		glfwPollEvents();
+	if (options.threadedRendering) {
+		// The render thread owns the GL context from here on; this thread keeps
+		// the window events and the simulation, one frame ahead at most
+		SnapshotBuffer snapshots;
+		pipelineBuffer = &snapshots;
+		glfwMakeContextCurrent(nullptr);
+		std::thread renderThread([&]() {
+			CPU_PROFILE_THREAD_NAME("render");
+			glfwMakeContextCurrent(window);
+			while (const RenderSnapshot* snapshot = snapshots.acquire()) presentFrame(*snapshot);
+			glfwMakeContextCurrent(nullptr);
+		});
+		while (!glfwWindowShouldClose(window)) {
+			glfwPollEvents();
+			produceFrame(snapshots.writeSlot());
+			if (!snapshots.publish()) break;
+		}
+		snapshots.close();
+		renderThread.join();
+		pipelineBuffer = nullptr;
+		glfwMakeContextCurrent(window);
+	}
+	else {
+		RenderSnapshot snapshot;
+		while (!glfwWindowShouldClose(window)) {
+			glfwPollEvents();
+			produceFrame(snapshot);
+			presentFrame(snapshot);
+		}
 	}
 
+	if (gpuProfiler) gpuProfiler->report();
+	if (!options.cpuTracePath.empty()) CpuProfiler::WriteChromeTrace(options.cpuTracePath.c_str());
+	if (inputRecorder.isOpen()) {
+		inputRecorder.close();
+		std::cout << "Input: " << inputRecorder.frames << " frames saved to " << options.recordInputPath << std::endl;
+	}
+	if (!options.recordCameraPath.empty() && recordedPath.save(options.recordCameraPath.c_str()))
+		std::cout << "Camera path: " << recordedPath.keyframes.size() << " keyframes saved to " << options.recordCameraPath << std::endl;
+	glDeleteQueries(2, litPassQueries);
+	glDeleteQueries(2, shadedQueries);
 	shaderProgram.Delete();
+	clusteredShader.Delete();
 	lightShader.Delete();
 	skybox.Delete();
+	planarShader.Delete();
 	glfwDestroyWindow(window);
 	glfwTerminate();
 	return 0;
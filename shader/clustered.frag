@@ -0,0 +1,131 @@
+#version 330 core
+
+// Clustered variant of default.frag: same lighting model, but each fragment only
+// loops over the lights binned into its froxel by LightClusters on the CPU.
+
+layout(location = 0) out vec4 FragColor;
+// Screen-space motion (UV units), only stored when temporal upscaling is on
+layout(location = 1) out vec2 Velocity;
+
+in vec3 Normal;
+in vec2 texCoord;
+in vec3 crntPos;
+in vec4 currentClip;
+in vec4 previousClip;
+
+uniform sampler2D tex0;            // Diffuse texture
+uniform sampler2D tex1;            // Specular map (can be empty or white)
+uniform samplerCube cubemapSampler;
+
+uniform float textureTiling;
+uniform vec3 camPos;
+uniform float reflectivity;
+uniform float alphaCutoff;  // > 0 for cut-out textures (tree leaves)
+uniform float roughness;    // Blur of the environment reflection, 0 = mirror
+
+// Light data: 3 texels per light (position.xyz, type) (direction.xyz, radius) (color.rgb, shadow index)
+uniform samplerBuffer clusterLights;
+// (offset, count) into clusterIndices for every cluster
+uniform usamplerBuffer clusterGrid;
+// Directional light indices first (globalLightCount of them), then the cluster lists
+uniform usamplerBuffer clusterIndices;
+uniform int globalLightCount;
+
+uniform ivec3 gridSize;
+uniform vec2 screenSize;
+uniform float zNear;
+uniform float zFar;
+uniform mat4 view;
+
+#include "lighting.glsl"
+
+vec4 shadeLight(int index, vec3 norm, vec3 viewDir, vec4 texColor, vec4 specMap)
+{
+    vec4 posType = texelFetch(clusterLights, index * 3);
+    vec4 dirRadius = texelFetch(clusterLights, index * 3 + 1);
+    vec4 color = texelFetch(clusterLights, index * 3 + 2);
+    int type = int(posType.w);
+
+    vec3 lightDir;
+    float attenuation = 1.0;
+    float ambientStrength = useIbl != 0 ? 0.0 : 0.2;
+    float specularStrength = 0.5;
+    float intensity = 1.0;
+
+    if (type == 0)
+    {
+        lightDir = normalize(-dirRadius.xyz);
+        intensity = 0.3;
+    }
+    else
+    {
+        lightDir = normalize(posType.xyz - crntPos);
+        float dist = length(posType.xyz - crntPos);
+        attenuation = 1.0 / (1.0 + 0.2 * dist + 0.032 * dist * dist);
+    }
+
+    float diff = max(dot(norm, lightDir), 0.0);
+    vec3 halfwayDir = normalize(lightDir + viewDir);
+    float spec = pow(max(dot(norm, halfwayDir), 0.0), 16.0);
+
+    if (type == 2)
+    {
+        float spot = spotIntensity(lightDir, dirRadius.xyz);
+        diff *= spot;
+        spec *= spot;
+        attenuation *= spot;
+    }
+
+    float shadow = shadowFactor(int(color.w), type, posType.xyz, crntPos, norm);
+    diff *= shadow;
+    spec *= shadow;
+
+    vec3 ambient = ambientStrength * color.rgb * intensity * 2.0;
+    vec3 diffuse = diff * color.rgb * intensity * 2.0;
+    vec3 specular = specularStrength * spec * color.rgb * specMap.r * intensity * 2.0;
+
+    return vec4(ambient + diffuse + specular, 1.0) * texColor * attenuation;
+}
+
+void main()
+{
+    vec3 norm = normalize(Normal);
+    vec4 texColor = texture(tex0, texCoord * textureTiling);
+    if (texColor.a < alphaCutoff) discard;
+    vec4 specMap = texture(tex1, texCoord * textureTiling);
+    vec3 viewDir = normalize(camPos - crntPos);
+
+    // Find the froxel this fragment falls in (same slicing as LightClusters)
+    float depth = -(view * vec4(crntPos, 1.0)).z;
+    int slice = int(log(max(depth, zNear) / zNear) / log(zFar / zNear) * float(gridSize.z));
+    ivec2 tile = ivec2(gl_FragCoord.xy / screenSize * vec2(gridSize.xy));
+    ivec3 cluster = clamp(ivec3(tile, slice), ivec3(0), gridSize - 1);
+    int clusterIndex = cluster.x + gridSize.x * (cluster.y + gridSize.y * cluster.z);
+
+    vec4 finalColor = vec4(0.0);
+
+    for (int i = 0; i < globalLightCount; i++)
+    {
+        int index = int(texelFetch(clusterIndices, i).r);
+        finalColor += shadeLight(index, norm, viewDir, texColor, specMap);
+    }
+
+    uvec2 range = texelFetch(clusterGrid, clusterIndex).rg;
+    for (uint i = 0u; i < range.y; i++)
+    {
+        int index = int(texelFetch(clusterIndices, int(range.x + i)).r);
+        finalColor += shadeLight(index, norm, viewDir, texColor, specMap);
+    }
+
+    vec3 reflectedDir = reflect(-viewDir, norm);
+    vec3 reflection = texture(cubemapSampler, reflectedDir).rgb;
+    if (useIbl != 0)
+    {
+        finalColor.rgb += environmentIrradiance(norm) * texColor.rgb;
+        reflection = environmentReflection(reflectedDir, roughness);
+    }
+    finalColor.rgb = mix(finalColor.rgb, reflection, reflectivity);
+
+    FragColor = finalColor;
+    Velocity = (currentClip.xy / currentClip.w - previousClip.xy / previousClip.w) * 0.5;
+}
@@ -1,10 +1,14 @@
 #version 330 core
 
-out vec4 FragColor;
+layout(location = 0) out vec4 FragColor;
+// Screen-space motion (UV units), only stored when temporal upscaling is on
+layout(location = 1) out vec2 Velocity;
 
 in vec3 Normal;
 in vec2 texCoord;
 in vec3 crntPos;
+in vec4 currentClip;
+in vec4 previousClip;
 
 uniform sampler2D tex0;            // Diffuse texture
 uniform sampler2D tex1;            // Specular map (can be empty or white)
@@ -13,6 +17,8 @@ uniform samplerCube cubemapSampler;
 uniform float textureTiling;
 uniform vec3 camPos;
 uniform float reflectivity;        // <--- Ajouté : 0.0 = pas de reflet, 1.0 = miroir
+uniform float alphaCutoff;         // > 0 for cut-out textures (tree leaves)
+uniform float roughness;           // Blur of the environment reflection, 0 = mirror
 
 #define MAX_LIGHTS 10
 
@@ -21,15 +27,19 @@ struct Light {
     vec3 direction;
     vec4 color;
     int type;
+    int shadowIndex;   // First shadow view, -1 = no shadows
 };
 
 uniform Light lights[MAX_LIGHTS];
 uniform int lightCount;
 
+#include "lighting.glsl"
+
 void main()
 {
     vec3 norm = normalize(Normal);
     vec4 texColor = texture(tex0, texCoord * textureTiling);
+    if (texColor.a < alphaCutoff) discard;
     vec4 specMap = texture(tex1, texCoord * textureTiling);
     vec3 viewDir = normalize(camPos - crntPos);
 
@@ -42,7 +52,7 @@ void main()
         float attenuation = 1.0;
         float diff = 0.0;
         float spec = 0.0;
-        float ambientStrength = 0.2;
+        float ambientStrength = useIbl != 0 ? 0.0 : 0.2;
         float specularStrength = 0.5;
         float intensity = 1.0;
 
@@ -64,16 +74,16 @@ void main()
 
         if (light.type == 2)
         {
-            float theta = dot(lightDir, normalize(-light.direction));
-            float outer = 0.7;
-            float inner = 0.85;
-            float epsilon = inner - outer;
-            float spotIntensity = clamp((theta - outer) / epsilon, 0.0, 1.0);
-            diff *= spotIntensity;
-            spec *= spotIntensity;
-            attenuation *= spotIntensity;
+            float spot = spotIntensity(lightDir, light.direction);
+            diff *= spot;
+            spec *= spot;
+            attenuation *= spot;
         }
 
+        float shadow = shadowFactor(light.shadowIndex, light.type, light.position, crntPos, norm);
+        diff *= shadow;
+        spec *= shadow;
+
         vec3 ambient = ambientStrength * vec3(light.color) * intensity * 2.0;
         vec3 diffuse = diff * vec3(light.color) * intensity * 2.0;
         vec3 specular = specularStrength * spec * vec3(light.color) * specMap.r * intensity * 2.0;
@@ -84,9 +94,15 @@ void main()
     // --- REFLECTION ENVIRONMENT MAPPING ---
     vec3 reflectedDir = reflect(-viewDir, norm);
     vec3 reflection = texture(cubemapSampler, reflectedDir).rgb;
+    if (useIbl != 0)
+    {
+        finalColor.rgb += environmentIrradiance(norm) * texColor.rgb;
+        reflection = environmentReflection(reflectedDir, roughness);
+    }
 
     // Mélange avec la couleur calculée
     finalColor.rgb = mix(finalColor.rgb, reflection, reflectivity);
 
     FragColor = finalColor;
+    Velocity = (currentClip.xy / currentClip.w - previousClip.xy / previousClip.w) * 0.5;
 }
@@ -18,13 +18,23 @@ out vec3 Normal;
 out vec3 color;
 // Outputs the texture coordinates to the Fragment Shader
 out vec2 texCoord;
+// Unjittered clip positions this frame and last frame, for motion vectors
+out vec4 currentClip;
+out vec4 previousClip;
 
 
 
+// Same position in the depth pre-pass and the lit pass, required by GL_EQUAL
+invariant gl_Position;
+
 // Imports the camera matrix from the main function
 uniform mat4 camMatrix;
 // Imports the model matrix from the main function
 uniform mat4 model;
+// Temporal upscaling: camera matrices without jitter, and last frame's model matrix
+uniform mat4 unjitteredCamMatrix;
+uniform mat4 prevCamMatrix;
+uniform mat4 prevModel;
 
 
 void main()
@@ -40,4 +50,7 @@ void main()
 	
 	// Outputs the positions/coordinates of all vertices
 	gl_Position = camMatrix * vec4(crntPos, 1.0);
+
+	currentClip = unjitteredCamMatrix * vec4(crntPos, 1.0);
+	previousClip = prevCamMatrix * prevModel * vec4(aPos, 1.0);
 }
\ No newline at end of file
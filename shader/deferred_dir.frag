@@ -0,0 +1,77 @@
+#version 330 core
+
+// Deferred full-screen pass: directional lights plus the environment reflection.
+// Point and spot lights are added on top by deferred_light.frag.
+
+out vec4 FragColor;
+
+uniform sampler2D gAlbedoSpec;
+uniform sampler2D gNormal;
+uniform sampler2D gDepth;
+uniform samplerCube cubemapSampler;
+
+uniform mat4 invCamMatrix;
+uniform vec3 camPos;
+uniform vec2 viewportSize;   // Rendered area, smaller than the G-buffer under dynamic resolution
+
+#define MAX_DIR_LIGHTS 4
+uniform vec3 dirLightDirection[MAX_DIR_LIGHTS];
+uniform vec4 dirLightColor[MAX_DIR_LIGHTS];
+uniform int dirLightShadowIndex[MAX_DIR_LIGHTS];
+uniform int dirLightCount;
+
+#include "lighting.glsl"
+
+vec3 decodeOctahedral(vec2 e)
+{
+    e = e * 2.0 - 1.0;
+    vec3 n = vec3(e.xy, 1.0 - abs(e.x) - abs(e.y));
+    if (n.z < 0.0)
+        n.xy = (1.0 - abs(n.yx)) * vec2(n.x >= 0.0 ? 1.0 : -1.0, n.y >= 0.0 ? 1.0 : -1.0);
+    return normalize(n);
+}
+
+void main()
+{
+    ivec2 texel = ivec2(gl_FragCoord.xy);
+    float depth = texelFetch(gDepth, texel, 0).r;
+    // Nothing was drawn here, keep the clear color (the skybox is drawn later)
+    if (depth >= 1.0) discard;
+
+    vec4 albedoSpec = texelFetch(gAlbedoSpec, texel, 0);
+    vec4 normalRefl = texelFetch(gNormal, texel, 0);
+    vec3 norm = decodeOctahedral(normalRefl.rg);
+
+    vec2 ndc = (gl_FragCoord.xy / viewportSize) * 2.0 - 1.0;
+    vec4 world = invCamMatrix * vec4(ndc, depth * 2.0 - 1.0, 1.0);
+    vec3 crntPos = world.xyz / world.w;
+    vec3 viewDir = normalize(camPos - crntPos);
+
+    vec3 lighting = vec3(0.0);
+    for (int i = 0; i < dirLightCount; i++)
+    {
+        vec3 lightDir = normalize(-dirLightDirection[i]);
+        vec3 color = dirLightColor[i].rgb;
+        float intensity = 0.3;
+
+        float diff = max(dot(norm, lightDir), 0.0);
+        vec3 halfwayDir = normalize(lightDir + viewDir);
+        float spec = pow(max(dot(norm, halfwayDir), 0.0), 16.0);
+        float shadow = shadowFactor(dirLightShadowIndex[i], 0, vec3(0.0), crntPos, norm);
+        diff *= shadow;
+        spec *= shadow;
+
+        vec3 ambient = (useIbl != 0 ? 0.0 : 0.2) * color * intensity * 2.0;
+        vec3 diffuse = diff * color * intensity * 2.0;
+        vec3 specular = 0.5 * spec * color * albedoSpec.a * intensity * 2.0;
+        lighting += (ambient + diffuse + specular) * albedoSpec.rgb;
+    }
+
+    vec3 reflection = texture(cubemapSampler, reflect(-viewDir, norm)).rgb;
+    if (useIbl != 0)
+    {
+        lighting += environmentIrradiance(norm) * albedoSpec.rgb;
+        reflection = environmentReflection(reflect(-viewDir, norm), normalRefl.a);
+    }
+    FragColor = vec4(mix(lighting, reflection, normalRefl.b), 1.0);
+}
@@ -0,0 +1,75 @@
+#version 330 core
+
+// Deferred light-volume pass for one point or spot light, blended additively.
+// Only runs on pixels the stencil pass marked as inside the light's volume.
+
+out vec4 FragColor;
+
+uniform sampler2D gAlbedoSpec;
+uniform sampler2D gNormal;
+uniform sampler2D gDepth;
+
+uniform mat4 invCamMatrix;
+uniform vec3 camPos;
+uniform vec2 viewportSize;   // Rendered area, smaller than the G-buffer under dynamic resolution
+
+uniform vec3 lightPosition;
+uniform vec3 lightDirection;
+uniform vec4 lightColor;
+uniform int lightType;
+uniform int lightShadowIndex;
+
+#include "lighting.glsl"
+
+vec3 decodeOctahedral(vec2 e)
+{
+    e = e * 2.0 - 1.0;
+    vec3 n = vec3(e.xy, 1.0 - abs(e.x) - abs(e.y));
+    if (n.z < 0.0)
+        n.xy = (1.0 - abs(n.yx)) * vec2(n.x >= 0.0 ? 1.0 : -1.0, n.y >= 0.0 ? 1.0 : -1.0);
+    return normalize(n);
+}
+
+void main()
+{
+    ivec2 texel = ivec2(gl_FragCoord.xy);
+    float depth = texelFetch(gDepth, texel, 0).r;
+    if (depth >= 1.0) discard;
+
+    vec4 albedoSpec = texelFetch(gAlbedoSpec, texel, 0);
+    vec4 normalRefl = texelFetch(gNormal, texel, 0);
+    vec3 norm = decodeOctahedral(normalRefl.rg);
+
+    vec2 ndc = (gl_FragCoord.xy / viewportSize) * 2.0 - 1.0;
+    vec4 world = invCamMatrix * vec4(ndc, depth * 2.0 - 1.0, 1.0);
+    vec3 crntPos = world.xyz / world.w;
+    vec3 viewDir = normalize(camPos - crntPos);
+
+    vec3 lightDir = normalize(lightPosition - crntPos);
+    float dist = length(lightPosition - crntPos);
+    float attenuation = 1.0 / (1.0 + 0.2 * dist + 0.032 * dist * dist);
+
+    float diff = max(dot(norm, lightDir), 0.0);
+    vec3 halfwayDir = normalize(lightDir + viewDir);
+    float spec = pow(max(dot(norm, halfwayDir), 0.0), 16.0);
+
+    if (lightType == 2)
+    {
+        float spot = spotIntensity(lightDir, lightDirection);
+        diff *= spot;
+        spec *= spot;
+        attenuation *= spot;
+    }
+
+    float shadow = shadowFactor(lightShadowIndex, lightType, lightPosition, crntPos, norm);
+    diff *= shadow;
+    spec *= shadow;
+
+    vec3 ambient = (useIbl != 0 ? 0.0 : 0.2) * lightColor.rgb * 2.0;
+    vec3 diffuse = diff * lightColor.rgb * 2.0;
+    vec3 specular = 0.5 * spec * lightColor.rgb * albedoSpec.a * 2.0;
+
+    // Reflective surfaces let this much of the lighting through (see default.frag's mix)
+    vec3 lighting = (ambient + diffuse + specular) * albedoSpec.rgb * attenuation;
+    FragColor = vec4(lighting * (1.0 - normalRefl.b), 1.0);
+}
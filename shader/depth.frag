@@ -0,0 +1,16 @@
+#version 330 core
+
+// Depth pre-pass: no color output. Only alpha-tested models (alphaCutoff > 0)
+// read their diffuse texture, so cut-out leaves don't occlude what's behind them.
+
+in vec2 texCoord;
+
+uniform sampler2D tex0;
+uniform float textureTiling;
+uniform float alphaCutoff;
+
+void main()
+{
+    if (alphaCutoff > 0.0 && texture(tex0, texCoord * textureTiling).a < alphaCutoff)
+        discard;
+}
@@ -0,0 +1,12 @@
+#version 330 core
+
+// Full-screen triangle generated from gl_VertexID (draw 3 vertices, no buffers)
+
+out vec2 screenUV;
+
+void main()
+{
+    vec2 pos = vec2((gl_VertexID << 1) & 2, gl_VertexID & 2);
+    screenUV = pos;
+    gl_Position = vec4(pos * 2.0 - 1.0, 0.0, 1.0);
+}
@@ -0,0 +1,41 @@
+#version 330 core
+
+// Geometry pass of the deferred path: same inputs as default.frag, but writes
+// surface attributes to the G-buffer instead of lighting them.
+
+layout (location = 0) out vec4 gAlbedoSpec; // rgb = albedo, a = specular mask
+layout (location = 1) out vec4 gNormal;     // rg = octahedral normal, b = reflectivity, a = roughness (2 bits)
+layout (location = 2) out float gDepth;     // window-space depth
+
+in vec3 Normal;
+in vec2 texCoord;
+in vec3 crntPos;
+
+uniform sampler2D tex0;            // Diffuse texture
+uniform sampler2D tex1;            // Specular map (can be empty or white)
+
+uniform float textureTiling;
+uniform float reflectivity;
+uniform float roughness;
+uniform float alphaCutoff;  // > 0 for cut-out textures (tree leaves)
+
+// Maps a unit vector to the [0,1]^2 octahedral parameterization
+vec2 encodeOctahedral(vec3 n)
+{
+    n /= abs(n.x) + abs(n.y) + abs(n.z);
+    vec2 e = n.xy;
+    if (n.z < 0.0)
+        e = (1.0 - abs(e.yx)) * vec2(e.x >= 0.0 ? 1.0 : -1.0, e.y >= 0.0 ? 1.0 : -1.0);
+    return e * 0.5 + 0.5;
+}
+
+void main()
+{
+    vec4 texColor = texture(tex0, texCoord * textureTiling);
+    if (texColor.a < alphaCutoff) discard;
+    vec4 specMap = texture(tex1, texCoord * textureTiling);
+
+    gAlbedoSpec = vec4(texColor.rgb, specMap.r);
+    gNormal = vec4(encodeOctahedral(normalize(Normal)), reflectivity, roughness);
+    gDepth = gl_FragCoord.z;
+}
@@ -0,0 +1,78 @@
+// Lighting code shared by the lit shaders, pasted in by `#include "lighting.glsl"`
+// (get_shader_source in shaderClass.cpp). The including shader must declare
+// `uniform vec3 camPos` first.
+
+// Shadow atlas (ShadowAtlas): one tile per cascade / cube face / spot light
+#define MAX_SHADOW_VIEWS 16
+uniform sampler2DShadow shadowAtlas;
+uniform mat4 shadowMatrices[MAX_SHADOW_VIEWS];     // World -> atlas coordinates and depth
+uniform vec4 shadowTileBounds[MAX_SHADOW_VIEWS];   // Tile rectangle (min.xy, max.xy)
+uniform vec3 cascadeSplits;                        // Far view depth of each cascade
+uniform vec3 shadowViewDir;                        // Camera forward, for the cascade depth
+
+// 1 = lit, 0 = shadowed. firstView < 0: the light has no shadow maps.
+float shadowFactor(int firstView, int type, vec3 lightPos, vec3 pos, vec3 norm)
+{
+    if (firstView < 0) return 1.0;
+    int view = firstView;
+    if (type == 0)
+    {
+        float depth = dot(pos - camPos, shadowViewDir);
+        if (depth > cascadeSplits.z) return 1.0;
+        view += depth > cascadeSplits.y ? 2 : (depth > cascadeSplits.x ? 1 : 0);
+    }
+    else if (type == 1)
+    {
+        // Cube face order +X -X +Y -Y +Z -Z, picked by the major axis
+        vec3 d = pos - lightPos;
+        vec3 a = abs(d);
+        if (a.x >= a.y && a.x >= a.z) view += d.x > 0.0 ? 0 : 1;
+        else if (a.y >= a.z) view += d.y > 0.0 ? 2 : 3;
+        else view += d.z > 0.0 ? 4 : 5;
+    }
+
+    // Normal offset keeps lit surfaces from shadowing themselves
+    vec4 p = shadowMatrices[view] * vec4(pos + norm * 0.05, 1.0);
+    p.xyz /= p.w;
+    vec4 bounds = shadowTileBounds[view];
+    if (p.x < bounds.x || p.y < bounds.y || p.x > bounds.z || p.y > bounds.w || p.z > 1.0) return 1.0;
+    return texture(shadowAtlas, p.xyz);
+}
+
+// Spot cone, SPOT_OUTER_COS and SPOT_INNER_COS in Light.h (SetSpotConeUniforms)
+uniform float spotOuterCos;
+uniform float spotInnerCos;
+
+// 1 inside the inner cone, fading to 0 at the outer cone. lightDir points from
+// the fragment to the light, spotDir is the light's direction.
+float spotIntensity(vec3 lightDir, vec3 spotDir)
+{
+    float theta = dot(lightDir, normalize(-spotDir));
+    return clamp((theta - spotOuterCos) / (spotInnerCos - spotOuterCos), 0.0, 1.0);
+}
+
+// Image-based lighting (EnvironmentLighting), replaces the per-light ambient term when on
+uniform int useIbl;
+uniform vec3 irradianceSH[9];      // Irradiance / pi, cosine-convolved SH9
+uniform samplerCube prefilteredEnv; // Sky blurred per mip level, level = roughness * prefilteredMaxLod
+uniform float prefilteredMaxLod;
+
+// Diffuse light from the environment in direction n
+vec3 environmentIrradiance(vec3 n)
+{
+    return max(irradianceSH[0] * 0.282095
+             + irradianceSH[1] * 0.488603 * n.y
+             + irradianceSH[2] * 0.488603 * n.z
+             + irradianceSH[3] * 0.488603 * n.x
+             + irradianceSH[4] * 1.092548 * n.x * n.y
+             + irradianceSH[5] * 1.092548 * n.y * n.z
+             + irradianceSH[6] * 0.315392 * (3.0 * n.z * n.z - 1.0)
+             + irradianceSH[7] * 1.092548 * n.x * n.z
+             + irradianceSH[8] * 0.546274 * (n.x * n.x - n.y * n.y), vec3(0.0));
+}
+
+// The environment seen in direction dir, blurred for a surface roughness (0 = mirror)
+vec3 environmentReflection(vec3 dir, float surfaceRoughness)
+{
+    return textureLod(prefilteredEnv, dir, surfaceRoughness * prefilteredMaxLod).rgb;
+}
@@ -0,0 +1,19 @@
+#version 330 core
+
+// Occlusion buffer overlay: linearized depth, near = white, nothing = black
+
+in vec2 screenUV;
+out vec4 FragColor;
+
+uniform sampler2D depthBuffer;
+uniform float zNear;
+uniform float zFar;
+
+void main()
+{
+    float depth = texture(depthBuffer, screenUV).r;
+    float ndc = depth * 2.0 - 1.0;
+    float linear = (2.0 * zNear * zFar) / (zFar + zNear - ndc * (zFar - zNear));
+    float shade = depth >= 1.0 ? 0.0 : 1.0 - linear / zFar;
+    FragColor = vec4(vec3(shade), 1.0);
+}
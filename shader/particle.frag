@@ -1,17 +1,17 @@
 #version 330 core
 
 in vec2 TexCoords;
+in float Alpha;
 out vec4 FragColor;
 
 uniform sampler2D smokeTexture;
-uniform float alpha;
 
 void main() {
     // Sample texture
     vec4 color = texture(smokeTexture, TexCoords);
     
-    // Apply alpha from uniform
-    color.a *= alpha;
+    // Apply the particle's alpha
+    color.a *= Alpha;
     
     // Alpha test to avoid processing fully transparent fragments
     if (color.a < 0.01) discard;
@@ -1,20 +1,36 @@
 #version 330 core
 layout (location = 0) in vec2 aPos;
+// Per particle (instanced)
+layout (location = 1) in float aX;
+layout (location = 2) in float aY;
+layout (location = 3) in float aZ;
+layout (location = 4) in float aSize;
+layout (location = 5) in float aAlpha;
 
-uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
 uniform mat4 camMatrix;
+// Camera axes in world space, the billboard's plane
+uniform vec3 cameraRight;
+uniform vec3 cameraUp;
 
 out vec2 TexCoords;
+out float Alpha;
 
 void main() {
+    // Dead (GPU particles waiting to respawn): outside the clip volume
+    if (aAlpha <= 0.0) {
+        gl_Position = vec4(0.0, 0.0, 2.0, 1.0);
+        TexCoords = vec2(0.0);
+        Alpha = 0.0;
+        return;
+    }
+
     // Map quad coordinates to texture coordinates (0-1)
     TexCoords = aPos + 0.5;
-    
-    // Position in world space with model matrix for location/size
-    vec4 worldPos = model * vec4(aPos, 0.0, 1.0);
-    
+    Alpha = aAlpha;
+
+    // Quad corner in world space, facing the camera, aSize wide
+    vec3 worldPos = vec3(aX, aY, aZ) + (aPos.x * cameraRight + aPos.y * cameraUp) * aSize;
+
     // Project using combined camera matrix
-    gl_Position = camMatrix * worldPos;
+    gl_Position = camMatrix * vec4(worldPos, 1.0);
 }
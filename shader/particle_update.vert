@@ -0,0 +1,57 @@
+#version 330 core
+// One particle per vertex, advanced by dt and captured by transform feedback
+layout (location = 0) in vec3 aPosition;
+layout (location = 1) in vec3 aVelocity;
+layout (location = 2) in float aLife;
+
+uniform float dt;
+uniform float time;
+// Emitter (ParticleEmitter)
+uniform vec3 origin;
+uniform vec3 velocityMin;
+uniform vec3 velocityMax;
+uniform float lifetime;
+// Seconds between two spawns of the same slot, at least the lifetime
+uniform float period;
+
+out vec3 outPosition;
+out vec3 outVelocity;
+out float outLife;
+out float outAlpha;
+
+// Integer hash (Wang), the random numbers of a respawn
+uint hash(uint x) {
+    x = (x ^ 61u) ^ (x >> 16);
+    x *= 9u;
+    x = x ^ (x >> 4);
+    x *= 0x27d4eb2du;
+    x = x ^ (x >> 15);
+    return x;
+}
+
+float random01(inout uint state) {
+    state = hash(state);
+    return float(state) / 4294967295.0;
+}
+
+void main() {
+    vec3 position = aPosition;
+    vec3 velocity = aVelocity;
+    float life = aLife - dt;
+
+    if (life <= lifetime - period) {
+        // The slot's turn again: respawn at the emitter, moved by what is left of the step
+        life += period;
+        uint state = hash(uint(gl_VertexID) ^ hash(floatBitsToUint(time)));
+        velocity = mix(velocityMin, velocityMax, vec3(random01(state), random01(state), random01(state)));
+        position = origin + velocity * (lifetime - life);
+    } else if (life > 0.0) {
+        position += velocity * dt;
+    }
+
+    outPosition = position;
+    outVelocity = velocity;
+    outLife = life;
+    // Dead particles wait with alpha 0, particle.vert drops them
+    outAlpha = max(life, 0.0) / lifetime;
+}
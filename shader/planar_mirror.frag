@@ -0,0 +1,16 @@
+#version 330 core
+
+// The reflection was rendered for this very view, so it is read at the
+// fragment's own screen position (the texture covers the whole screen)
+
+out vec4 FragColor;
+
+uniform sampler2D reflectionTexture;
+uniform vec2 screenSize;   // Size of the target the mirror is drawn into
+
+void main()
+{
+    vec3 reflection = texture(reflectionTexture, gl_FragCoord.xy / screenSize).rgb;
+    // Silvered glass keeps most of the light
+    FragColor = vec4(reflection * 0.9, 1.0);
+}
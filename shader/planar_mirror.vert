@@ -0,0 +1,13 @@
+#version 330 core
+
+// Mirror quad of a planar reflection (PlanarReflection)
+
+layout (location = 0) in vec3 aPos;
+
+uniform mat4 camMatrix;
+uniform mat4 model;
+
+void main()
+{
+    gl_Position = camMatrix * model * vec4(aPos, 1.0);
+}
@@ -0,0 +1,64 @@
+#version 330 core
+
+// Reflection probe capture: the scene with Lambert-only lighting from a few
+// lights, no specular, shadows or reflections (default.frag's diffuse terms)
+
+out vec4 FragColor;
+
+in vec3 Normal;
+in vec2 texCoord;
+in vec3 crntPos;
+
+uniform sampler2D tex0;
+uniform float textureTiling;
+uniform float alphaCutoff;
+uniform vec3 camPos;                // Needed by lighting.glsl
+
+#define MAX_PROBE_LIGHTS 4
+
+struct Light {
+    vec3 position;
+    vec3 direction;
+    vec4 color;
+    int type;
+};
+
+uniform Light lights[MAX_PROBE_LIGHTS];
+uniform int lightCount;
+
+#include "lighting.glsl"
+
+void main()
+{
+    vec3 norm = normalize(Normal);
+    vec4 texColor = texture(tex0, texCoord * textureTiling);
+    if (texColor.a < alphaCutoff) discard;
+
+    vec3 lighting = vec3(0.0);
+    float ambientStrength = useIbl != 0 ? 0.0 : 0.2;
+    for (int i = 0; i < lightCount; i++)
+    {
+        Light light = lights[i];
+        vec3 lightDir;
+        float attenuation = 1.0;
+        float intensity = 1.0;
+        if (light.type == 0)
+        {
+            lightDir = normalize(-light.direction);
+            intensity = 0.3;
+        }
+        else
+        {
+            lightDir = normalize(light.position - crntPos);
+            float dist = length(light.position - crntPos);
+            attenuation = 1.0 / (1.0 + 0.2 * dist + 0.032 * dist * dist);
+        }
+        float diff = max(dot(norm, lightDir), 0.0);
+        if (light.type == 2)
+            attenuation *= spotIntensity(lightDir, light.direction);
+        lighting += (ambientStrength + diff) * vec3(light.color) * intensity * 2.0 * attenuation;
+    }
+    if (useIbl != 0) lighting += environmentIrradiance(norm);
+
+    FragColor = vec4(lighting * texColor.rgb, 1.0);
+}
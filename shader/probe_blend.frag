@@ -0,0 +1,14 @@
+#version 330 core
+
+// Copies a reflection probe capture onto its cube face; the constant blend
+// factor mixes it with the previous capture
+
+in vec2 screenUV;
+out vec4 FragColor;
+
+uniform sampler2D capture;
+
+void main()
+{
+    FragColor = vec4(texture(capture, screenUV).rgb, 1.0);
+}
@@ -0,0 +1,9 @@
+#version 330 core
+
+in vec3 barColor;
+out vec4 FragColor;
+
+void main()
+{
+    FragColor = vec4(barColor, 0.85);
+}
@@ -0,0 +1,16 @@
+#version 330 core
+
+// GPU profiler bar graph: colored rectangles in overlay pixels
+
+layout(location = 0) in vec2 aPos;
+layout(location = 1) in vec3 aColor;
+
+out vec3 barColor;
+
+uniform vec2 overlaySize;
+
+void main()
+{
+    barColor = aColor;
+    gl_Position = vec4(aPos / overlaySize * 2.0 - 1.0, 0.0, 1.0);
+}
@@ -0,0 +1,18 @@
+#version 330 core
+
+// Shadow caster pass: depth only, from the light's point of view.
+// Paired with depth.frag so cut-out leaves cast leaf-shaped shadows.
+
+layout (location = 0) in vec3 aPos;
+layout (location = 3) in vec2 aTex;
+
+out vec2 texCoord;
+
+uniform mat4 lightViewProj;
+uniform mat4 model;
+
+void main()
+{
+	texCoord = aTex;
+	gl_Position = lightViewProj * model * vec4(aPos, 1.0);
+}
@@ -0,0 +1,94 @@
+#version 330 core
+
+// Temporal upscale resolve, runs at native resolution. The jittered low
+// resolution frame is reconstructed with a small Gaussian filter, the history
+// is reprojected with the motion vectors (or the depth, for pixels drawn
+// without them), clipped to the current neighbourhood's color range and blended.
+
+in vec2 screenUV;
+out vec4 FragColor;
+
+uniform sampler2D currentColor;
+uniform sampler2D velocityBuffer;  // > 100 where nothing wrote a motion vector
+uniform sampler2D depthBuffer;
+uniform sampler2D history;
+
+uniform vec2 renderSize;    // Rendered part of the current frame, in texels
+uniform vec2 jitterPixels;  // This frame's projection offset, in render pixels
+uniform mat4 reprojection;  // Current NDC -> previous clip space, both unjittered
+uniform float feedback;     // History weight
+uniform bool historyValid;
+
+void main()
+{
+    // Output pixel in render pixel units. Render texel t holds the scene at t + 0.5 - jitter.
+    vec2 p = screenUV * renderSize;
+    ivec2 center = ivec2(floor(p + jitterPixels));
+    ivec2 maxTexel = ivec2(renderSize) - 1;
+
+    vec3 sum = vec3(0.0);
+    float weightSum = 0.0;
+    float closestWeight = 0.0;
+    vec3 m1 = vec3(0.0);
+    vec3 m2 = vec3(0.0);
+    vec3 lo = vec3(1e9);
+    vec3 hi = vec3(-1e9);
+    float closestDepth = 1.0;
+    ivec2 closestTexel = clamp(center, ivec2(0), maxTexel);
+
+    for (int y = -1; y <= 1; y++)
+    {
+        for (int x = -1; x <= 1; x++)
+        {
+            ivec2 t = clamp(center + ivec2(x, y), ivec2(0), maxTexel);
+            vec3 c = texelFetch(currentColor, t, 0).rgb;
+            vec2 d = vec2(t) + 0.5 - jitterPixels - p;
+            float w = exp(-2.29 * dot(d, d));
+            sum += c * w;
+            weightSum += w;
+            closestWeight = max(closestWeight, w);
+            m1 += c;
+            m2 += c * c;
+            lo = min(lo, c);
+            hi = max(hi, c);
+
+            // Motion of the nearest surface, so edges of moving objects don't smear
+            float z = texelFetch(depthBuffer, t, 0).r;
+            if (z < closestDepth)
+            {
+                closestDepth = z;
+                closestTexel = t;
+            }
+        }
+    }
+    vec3 current = sum / weightSum;
+
+    vec2 velocity = texelFetch(velocityBuffer, closestTexel, 0).rg;
+    vec2 previousUV;
+    if (velocity.x > 100.0)
+    {
+        vec4 previous = reprojection * vec4(screenUV * 2.0 - 1.0, closestDepth * 2.0 - 1.0, 1.0);
+        previousUV = previous.xy / previous.w * 0.5 + 0.5;
+    }
+    else
+    {
+        previousUV = screenUV - velocity;
+    }
+
+    if (!historyValid || any(lessThan(previousUV, vec2(0.0))) || any(greaterThan(previousUV, vec2(1.0))))
+    {
+        FragColor = vec4(current, 1.0);
+        return;
+    }
+
+    // Variance clipping: keep the history inside the current neighbourhood's range
+    vec3 mean = m1 / 9.0;
+    vec3 sigma = sqrt(max(m2 / 9.0 - mean * mean, 0.0));
+    vec3 boxLo = max(lo, mean - 1.25 * sigma);
+    vec3 boxHi = min(hi, mean + 1.25 * sigma);
+    vec3 previousColor = clamp(texture(history, previousUV).rgb, boxLo, boxHi);
+
+    // Output pixels far from any current sample lean on the history more
+    float alpha = clamp((1.0 - feedback) * 2.0 * closestWeight, 0.02, 1.0);
+    FragColor = vec4(mix(previousColor, current, alpha), 1.0);
+}
@@ -0,0 +1,32 @@
+#version 330 core
+
+// Dynamic resolution upscale: bilinear from the rendered part of the scene
+// texture, then an unsharp mask clamped to the 3x3 cross so edges don't ring.
+
+in vec2 screenUV;
+out vec4 FragColor;
+
+uniform sampler2D sceneColor;
+uniform vec2 renderSize;   // Rendered part of sceneColor, in texels
+uniform float sharpness;   // 0 = plain bilinear
+
+void main()
+{
+    vec2 texel = 1.0 / vec2(textureSize(sceneColor, 0));
+    // Keep every tap inside the rendered rectangle
+    vec2 minUV = 0.5 * texel;
+    vec2 maxUV = (renderSize - 0.5) * texel;
+    vec2 uv = clamp(screenUV * renderSize * texel, minUV, maxUV);
+
+    vec3 c = texture(sceneColor, uv).rgb;
+    vec3 n = texture(sceneColor, clamp(uv + vec2(0.0, texel.y), minUV, maxUV)).rgb;
+    vec3 s = texture(sceneColor, clamp(uv - vec2(0.0, texel.y), minUV, maxUV)).rgb;
+    vec3 e = texture(sceneColor, clamp(uv + vec2(texel.x, 0.0), minUV, maxUV)).rgb;
+    vec3 w = texture(sceneColor, clamp(uv - vec2(texel.x, 0.0), minUV, maxUV)).rgb;
+
+    vec3 blurred = (n + s + e + w) * 0.25;
+    vec3 sharpened = c + (c - blurred) * sharpness * 2.0;
+    vec3 lo = min(c, min(min(n, s), min(e, w)));
+    vec3 hi = max(c, max(max(n, s), max(e, w)));
+    FragColor = vec4(clamp(sharpened, lo, hi), 1.0);
+}
@@ -0,0 +1,206 @@
+// Benchmark.cpp - Deterministic flythrough runs and baseline comparison
+
+#include "Benchmark.h"
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <vector>
+#include "HeadlessRun.h"
+
+static const int WARMUP_FRAMES = 5;
+
+// Name and value of every metric, in file order
+static std::vector<std::pair<std::string, float>> Metrics(const BenchmarkSummary& summary)
+{
+    std::vector<std::pair<std::string, float>> metrics;
+    const FrameTimeSummary* series[3] = { &summary.frame, &summary.cpu, &summary.gpu };
+    const char* names[3] = { "frame", "cpu", "gpu" };
+    for (int s = 0; s < 3; ++s) {
+        std::string name = names[s];
+        metrics.push_back(std::make_pair(name + "_mean", series[s]->average));
+        metrics.push_back(std::make_pair(name + "_p50", series[s]->p50));
+        metrics.push_back(std::make_pair(name + "_p95", series[s]->p95));
+        metrics.push_back(std::make_pair(name + "_p99", series[s]->p99));
+        metrics.push_back(std::make_pair(name + "_max", series[s]->maximum));
+    }
+    metrics.push_back(std::make_pair(std::string("stutters"), (float)summary.stutters));
+    return metrics;
+}
+
+bool WriteBenchmarkSummary(const char* path, const BenchmarkSummary& summary)
+{
+    std::ofstream out(path);
+    if (!out) return false;
+    out << "# flythrough benchmark, times in ms\n";
+    out << "frames " << summary.frames << "\n";
+    for (const auto& metric : Metrics(summary)) out << metric.first << " " << metric.second << "\n";
+    return true;
+}
+
+bool ReadBenchmarkSummary(const char* path, BenchmarkSummary& summary)
+{
+    std::ifstream in(path);
+    if (!in) return false;
+    std::map<std::string, float> values;
+    std::string line;
+    while (std::getline(in, line)) {
+        if (line.empty() || line[0] == '#') continue;
+        std::istringstream fields(line);
+        std::string key;
+        float value;
+        if (fields >> key >> value) values[key] = value;
+    }
+    FrameTimeSummary* series[3] = { &summary.frame, &summary.cpu, &summary.gpu };
+    const char* names[3] = { "frame", "cpu", "gpu" };
+    for (int s = 0; s < 3; ++s) {
+        std::string name = names[s];
+        series[s]->average = values[name + "_mean"];
+        series[s]->p50 = values[name + "_p50"];
+        series[s]->p95 = values[name + "_p95"];
+        series[s]->p99 = values[name + "_p99"];
+        series[s]->maximum = values[name + "_max"];
+    }
+    summary.frames = (int)values["frames"];
+    summary.stutters = (int)values["stutters"];
+    return summary.frames > 0;
+}
+
+int CompareBenchmarks(const BenchmarkSummary& baseline, const BenchmarkSummary& current, float thresholdPercent)
+{
+    auto before = Metrics(baseline);
+    auto after = Metrics(current);
+    int regressions = 0;
+    std::cout << "[compare] metric        baseline   current    change" << std::endl;
+    for (size_t i = 0; i < before.size(); ++i) {
+        float a = before[i].second;
+        float b = after[i].second;
+        float change = a > 0.0f ? (b - a) / a * 100.0f : 0.0f;
+        // Stutters are counts: allow one more frame on top of the threshold
+        bool regressed = before[i].first == "stutters"
+            ? b > a * (1.0f + thresholdPercent / 100.0f) + 1.0f
+            : a > 0.0f && change > thresholdPercent;
+        if (regressed) regressions++;
+        std::cout << "[compare] " << std::left << std::setw(12) << before[i].first << std::right << std::fixed
+                  << std::setprecision(3) << std::setw(10) << a << std::setw(10) << b << std::setprecision(1)
+                  << std::setw(9) << change << "%" << (regressed ? "  REGRESSION" : "")
+                  << std::defaultfloat << std::setprecision(6) << std::endl;
+    }
+    if (current.frames != baseline.frames)
+        std::cout << "WARNING: frame counts differ (" << baseline.frames << " vs " << current.frames << ")" << std::endl;
+    std::cout << "[compare] " << regressions << " regression(s) above " << thresholdPercent << "%" << std::endl;
+    return regressions;
+}
+
+int RunBenchmark(const Options& options, int width, int height, Camera& camera, const CameraPath& path,
+                 const std::function<void(float)>& simulate,
+                 const std::function<void(DynamicResolution*, GLuint)>& renderFrame,
+                 DynamicResolution* upscaler)
+{
+    GLuint framebuffer, colorBuffer, depthBuffer;
+    glGenRenderbuffers(1, &colorBuffer);
+    glBindRenderbuffer(GL_RENDERBUFFER, colorBuffer);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+    glGenRenderbuffers(1, &depthBuffer);
+    glBindRenderbuffer(GL_RENDERBUFFER, depthBuffer);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, width, height);
+    glBindRenderbuffer(GL_RENDERBUFFER, 0);
+    glGenFramebuffers(1, &framebuffer);
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, colorBuffer);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, depthBuffer);
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+        std::cout << "ERROR: benchmark framebuffer is incomplete" << std::endl;
+        return 1;
+    }
+    GLuint queries[2];
+    glGenQueries(2, queries);
+
+    const float deltaTime = 1.0f / 60.0f;
+    int frames = options.benchmarkFrames > 0 ? options.benchmarkFrames : (int)std::ceil(path.duration() / deltaTime) + 1;
+    std::cout << "Benchmark: " << frames << " frames at " << width << "x" << height << ", "
+              << path.keyframes.size() << " keyframes over " << path.duration() << "s, seed " << options.randomSeed << std::endl;
+
+    for (int i = 0; i < WARMUP_FRAMES; ++i) {
+        simulate(0.0f);
+        path.apply(camera, 0.0f);
+        renderFrame(upscaler, framebuffer);
+        glFinish();
+    }
+
+    std::vector<float> frameMs, cpuMs, gpuMs;
+    for (int frame = 0; frame < frames; ++frame) {
+        auto start = std::chrono::steady_clock::now();
+        simulate(deltaTime);
+        path.apply(camera, frame * deltaTime);
+        glQueryCounter(queries[0], GL_TIMESTAMP);
+        renderFrame(upscaler, framebuffer);
+        glQueryCounter(queries[1], GL_TIMESTAMP);
+        auto submitted = std::chrono::steady_clock::now();
+        glFinish();
+        auto finished = std::chrono::steady_clock::now();
+
+        GLuint64 gpuStart = 0, gpuEnd = 0;
+        glGetQueryObjectui64v(queries[0], GL_QUERY_RESULT, &gpuStart);
+        glGetQueryObjectui64v(queries[1], GL_QUERY_RESULT, &gpuEnd);
+        frameMs.push_back(std::chrono::duration<float, std::milli>(finished - start).count());
+        cpuMs.push_back(std::chrono::duration<float, std::milli>(submitted - start).count());
+        gpuMs.push_back(gpuEnd > gpuStart ? (float)((gpuEnd - gpuStart) / 1.0e6) : 0.0f);
+    }
+
+    BenchmarkSummary summary;
+    summary.frames = frames;
+    summary.frame = SummarizeFrameTimes(frameMs);
+    summary.cpu = SummarizeFrameTimes(cpuMs);
+    summary.gpu = SummarizeFrameTimes(gpuMs);
+    for (float ms : frameMs)
+        if (ms > STUTTER_FACTOR * summary.frame.p50) summary.stutters++;
+
+    std::cout << "[benchmark] frame mean=" << summary.frame.average << "ms p50=" << summary.frame.p50
+              << "ms p95=" << summary.frame.p95 << "ms p99=" << summary.frame.p99 << "ms max=" << summary.frame.maximum
+              << "ms stutters=" << summary.stutters << std::endl;
+    std::cout << "[benchmark] cpu mean=" << summary.cpu.average << "ms p95=" << summary.cpu.p95
+              << "ms, gpu mean=" << summary.gpu.average << "ms p95=" << summary.gpu.p95 << "ms" << std::endl;
+
+    int result = 0;
+    const std::string& summaryPath = options.benchmarkPath;
+    std::ofstream csv(summaryPath + ".csv");
+    csv << "frame,frame_ms,cpu_ms,gpu_ms\n";
+    for (int frame = 0; frame < frames; ++frame)
+        csv << frame << "," << frameMs[frame] << "," << cpuMs[frame] << "," << gpuMs[frame] << "\n";
+    if (WriteBenchmarkSummary(summaryPath.c_str(), summary)) {
+        std::cout << "Benchmark summary written to " << summaryPath << " (per frame: " << summaryPath << ".csv)" << std::endl;
+    } else {
+        std::cout << "ERROR: could not write " << summaryPath << std::endl;
+        result = 1;
+    }
+
+    if (!options.capturePath.empty()) {
+        glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+        if (!WriteFramebufferPPM(options.capturePath.c_str(), width, height)) {
+            std::cout << "ERROR: could not write " << options.capturePath << std::endl;
+            result = 1;
+        }
+    }
+
+    if (!options.benchmarkBaseline.empty()) {
+        BenchmarkSummary baseline;
+        if (!ReadBenchmarkSummary(options.benchmarkBaseline.c_str(), baseline)) {
+            std::cout << "ERROR: could not read the baseline " << options.benchmarkBaseline << std::endl;
+            result = 1;
+        }
+        else if (CompareBenchmarks(baseline, summary, options.regressionThreshold) > 0) {
+            result = 1;
+        }
+    }
+
+    glDeleteQueries(2, queries);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glDeleteFramebuffers(1, &framebuffer);
+    glDeleteRenderbuffers(1, &colorBuffer);
+    glDeleteRenderbuffers(1, &depthBuffer);
+    return result;
+}
@@ -0,0 +1,45 @@
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+#include <functional>
+#include <string>
+#include <glad/glad.h>
+#include "Camera.h"
+#include "CameraPath.h"
+#include "DynamicResolution.h"
+#include "FrameStats.h"
+#include "Options.h"
+
+// Result of a flythrough run, all times in ms
+struct BenchmarkSummary {
+    int frames = 0;
+    FrameTimeSummary frame;  // Whole frame, simulation to glFinish
+    FrameTimeSummary cpu;    // Simulation and command submission
+    FrameTimeSummary gpu;    // GPU time of the frame (timestamp queries)
+    int stutters = 0;        // Frames longer than STUTTER_FACTOR x the median
+};
+
+// Frames slower than this multiple of the median frame time count as stutters
+const float STUTTER_FACTOR = 2.0f;
+
+// Flythrough benchmark (--benchmark <summary.txt>): the camera follows `path`
+// with a fixed 1/60 s step, the whole scene simulated as usual, for the path's
+// length (or options.benchmarkFrames). A few unmeasured frames at time 0 come
+// first, so shader and texture warm-up doesn't count. Writes the summary file,
+// one CSV row per frame next to it (summary path + ".csv"), the last frame to
+// options.capturePath if set, and compares with
+// options.benchmarkBaseline when given. Returns the process exit code: 1 when
+// a metric regressed.
+int RunBenchmark(const Options& options, int width, int height, Camera& camera, const CameraPath& path,
+                 const std::function<void(float)>& simulate,
+                 const std::function<void(DynamicResolution*, GLuint)>& renderFrame,
+                 DynamicResolution* upscaler);
+
+bool WriteBenchmarkSummary(const char* path, const BenchmarkSummary& summary);
+bool ReadBenchmarkSummary(const char* path, BenchmarkSummary& summary);
+
+// Prints every metric of `current` next to `baseline` and flags the ones more
+// than thresholdPercent slower. Returns the number of regressions.
+int CompareBenchmarks(const BenchmarkSummary& baseline, const BenchmarkSummary& current, float thresholdPercent);
+
+#endif
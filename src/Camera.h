@@ -10,6 +10,7 @@
 #include<glm/gtx/vector_angle.hpp>
 
 #include"shaderClass.h"
+#include"Input.h"
 
 class Camera
 {
@@ -19,9 +20,18 @@ public:
 	glm::vec3 Orientation = glm::vec3(0.0f, 0.0f, -1.0f);
 	glm::vec3 Up = glm::vec3(0.0f, 1.0f, 0.0f);
 	glm::mat4 cameraMatrix = glm::mat4(1.0f);
-
-	// Prevents the camera from jumping around when first clicking left click
-	bool firstClick = true;
+	// Separate view and projection matrices (cameraMatrix = projection * view)
+	glm::mat4 view = glm::mat4(1.0f);
+	glm::mat4 projection = glm::mat4(1.0f);
+	// Sub-pixel offset (NDC) added to the projection for temporal upscaling
+	glm::vec2 jitter = glm::vec2(0.0f);
+	// projection * view without the jitter, for motion vectors
+	glm::mat4 unjitteredMatrix = glm::mat4(1.0f);
+
+	// Projection parameters of the last updateMatrix call
+	float FOVdeg = 45.0f;
+	float nearPlane = 0.1f;
+	float farPlane = 100.0f;
 
 	// Stores the width and height of the window
 	int width;
@@ -37,8 +47,8 @@ public:
 	// Updates the camera matrix to the Vertex Shader
 	void updateMatrix(float FOVdeg, float nearPlane, float farPlane);
 	// Exports the camera matrix to a shader
-	void Matrix(Shader& shader, const char* uniform);
-	// Handles camera inputs
-	void Inputs(GLFWwindow* window);
+	void Matrix(Shader& shader, const char* uniform) const;
+	// Sprint speed and mouse look from this frame's input
+	void Inputs(const InputState& input);
 };
 #endif
\ No newline at end of file
@@ -0,0 +1,105 @@
+// CameraPath.cpp - Keyframed camera paths for repeatable runs
+
+#include "CameraPath.h"
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+CameraPath CameraPath::Flythrough()
+{
+    CameraPath path;
+    path.add(0.0f,  glm::vec3(-15.0f, 1.7f, 15.0f),  glm::vec3(0.0f, 2.0f, 0.0f));     // Player start
+    path.add(6.0f,  glm::vec3(-24.0f, 2.5f, -2.0f),  glm::vec3(-6.0f, 2.0f, -16.0f));  // Towards the trees
+    path.add(12.0f, glm::vec3(-2.0f, 2.0f, -28.0f),  glm::vec3(3.0f, 2.0f, -12.0f));   // Behind the tree rows
+    path.add(18.0f, glm::vec3(24.0f, 6.0f, -14.0f),  glm::vec3(5.0f, 3.0f, 0.0f));     // Round to the campfire side
+    path.add(24.0f, glm::vec3(22.0f, 7.0f, 12.0f),   glm::vec3(5.0f, 4.0f, 0.0f));     // The fire at full size
+    path.add(30.0f, glm::vec3(-10.0f, 8.0f, 24.0f),  glm::vec3(0.0f, 2.0f, 0.0f));     // Overview
+    return path;
+}
+
+bool CameraPath::load(const char* path)
+{
+    std::ifstream in(path);
+    if (!in) {
+        std::cout << "ERROR: cannot open camera path " << path << std::endl;
+        return false;
+    }
+    keyframes.clear();
+    std::string line;
+    int lineNumber = 0;
+    while (std::getline(in, line)) {
+        lineNumber++;
+        size_t comment = line.find('#');
+        if (comment != std::string::npos) line.erase(comment);
+        std::istringstream fields(line);
+        CameraKeyframe key;
+        if (!(fields >> key.time)) continue; // Blank line
+        if (!(fields >> key.position.x >> key.position.y >> key.position.z >> key.target.x >> key.target.y >> key.target.z)) {
+            std::cout << "ERROR: " << path << ":" << lineNumber << ": expected time px py pz tx ty tz" << std::endl;
+            return false;
+        }
+        keyframes.push_back(key);
+    }
+    std::stable_sort(keyframes.begin(), keyframes.end(),
+                     [](const CameraKeyframe& a, const CameraKeyframe& b) { return a.time < b.time; });
+    if (keyframes.empty()) {
+        std::cout << "ERROR: no keyframes in " << path << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool CameraPath::save(const char* path) const
+{
+    std::ofstream out(path);
+    if (!out) {
+        std::cout << "ERROR: cannot write camera path " << path << std::endl;
+        return false;
+    }
+    out << "# time position.xyz target.xyz\n";
+    for (const CameraKeyframe& key : keyframes) {
+        out << key.time << " " << key.position.x << " " << key.position.y << " " << key.position.z << " "
+            << key.target.x << " " << key.target.y << " " << key.target.z << "\n";
+    }
+    return true;
+}
+
+void CameraPath::add(float time, const glm::vec3& position, const glm::vec3& target)
+{
+    keyframes.push_back(CameraKeyframe{ time, position, target });
+}
+
+// Uniform Catmull-Rom between p1 and p2
+static glm::vec3 CatmullRom(const glm::vec3& p0, const glm::vec3& p1, const glm::vec3& p2, const glm::vec3& p3, float t)
+{
+    float t2 = t * t;
+    float t3 = t2 * t;
+    return 0.5f * (2.0f * p1 + (p2 - p0) * t + (2.0f * p0 - 5.0f * p1 + 4.0f * p2 - p3) * t2
+                   + (3.0f * p1 - p0 - 3.0f * p2 + p3) * t3);
+}
+
+void CameraPath::apply(Camera& camera, float seconds) const
+{
+    if (keyframes.empty()) return;
+    glm::vec3 position = keyframes.front().position;
+    glm::vec3 target = keyframes.front().target;
+    if (keyframes.size() > 1 && seconds > keyframes.front().time) {
+        // Segment [i, i + 1] containing `seconds`
+        size_t i = 0;
+        while (i + 2 < keyframes.size() && keyframes[i + 1].time <= seconds) ++i;
+        const CameraKeyframe& k1 = keyframes[i];
+        const CameraKeyframe& k2 = keyframes[i + 1];
+        // End keyframes are repeated for the outer control points
+        const CameraKeyframe& k0 = keyframes[i > 0 ? i - 1 : i];
+        const CameraKeyframe& k3 = keyframes[std::min(i + 2, keyframes.size() - 1)];
+        float span = k2.time - k1.time;
+        float t = span > 0.0f ? glm::clamp((seconds - k1.time) / span, 0.0f, 1.0f) : 1.0f;
+        position = CatmullRom(k0.position, k1.position, k2.position, k3.position, t);
+        target = CatmullRom(k0.target, k1.target, k2.target, k3.target, t);
+    }
+    camera.Position = position;
+    if (glm::length(target - position) > 1e-4f) camera.Orientation = glm::normalize(target - position);
+    camera.updateMatrix(45.0f, 0.1f, 100.0f);
+}
@@ -0,0 +1,38 @@
+#ifndef CAMERA_PATH_H
+#define CAMERA_PATH_H
+
+#include <vector>
+#include <glm/glm.hpp>
+#include "Camera.h"
+
+// Camera pose at a point in time: where the camera is and what it looks at
+struct CameraKeyframe {
+    float time;
+    glm::vec3 position;
+    glm::vec3 target;
+};
+
+// Keyframed camera path, interpolated with Catmull-Rom splines so the camera
+// passes through every keyframe without corners. Stored as text, one keyframe
+// per line: "time px py pz tx ty tz" ('#' starts a comment).
+class CameraPath {
+public:
+    std::vector<CameraKeyframe> keyframes; // Sorted by time
+
+    // Built-in tour: the tree rows, around the farmhouse, the campfire while it
+    // grows (5 s to 25 s), then an overview. 30 seconds long.
+    static CameraPath Flythrough();
+
+    bool load(const char* path);
+    bool save(const char* path) const;
+
+    // Appends a keyframe (recording); times must increase
+    void add(float time, const glm::vec3& position, const glm::vec3& target);
+
+    float duration() const { return keyframes.empty() ? 0.0f : keyframes.back().time; }
+
+    // Places the camera on the path, `seconds` from its start (clamped to the ends)
+    void apply(Camera& camera, float seconds) const;
+};
+
+#endif
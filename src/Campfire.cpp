@@ -1,4 +1,5 @@
 #include "Campfire.h"
+#include "CpuProfiler.h"
 #include <iostream>
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
@@ -101,6 +102,7 @@ void Campfire::SetScale(float newScale) {
 }
 
 void Campfire::Draw(Camera& camera) {
+    CPU_PROFILE_SCOPE("Campfire::Draw");
     // Enable blending for particles
     glDepthMask(GL_FALSE);
     glDisable(GL_CULL_FACE);
@@ -122,17 +124,16 @@ void Campfire::Draw(Camera& camera) {
     model = glm::translate(model, position);
     model = glm::scale(model, glm::vec3(scale));
     
-    // Calculate view matrix from camera
-    glm::mat4 view = glm::lookAt(camera.Position, camera.Position + camera.Orientation, camera.Up);
+    // Camera's view matrix (mirrored for planar reflections)
+    const glm::mat4& view = camera.view;
     glm::mat4 modelView = view * model;
     
     // Set modelview and projection matrices
     GLuint modelViewLocation = glGetUniformLocation(shader->ID, "ModelView");
     glUniformMatrix4fv(modelViewLocation, 1, GL_FALSE, glm::value_ptr(modelView));
     
-    // Use camera's projection matrix
-    camera.updateMatrix(45.0f, 0.1f, 100.0f);
-    glm::mat4 projection = glm::perspective(glm::radians(45.0f), (float)camera.width / camera.height, 0.1f, 100.0f);
+    // Use camera's projection matrix (jitter included)
+    const glm::mat4& projection = camera.projection;
     GLuint projectionLocation = glGetUniformLocation(shader->ID, "Projection");
     glUniformMatrix4fv(projectionLocation, 1, GL_FALSE, glm::value_ptr(projection));
     
@@ -14,6 +14,10 @@ public:
     // Methods to control dynamic scaling
     void SetScale(float newScale);
     float GetScale() const { return scale; }
+    // Sets the animation time directly (render snapshots carry it)
+    void SetTime(float newTime) { time = newTime; }
+    // Follows the scene node it sits on
+    void SetPosition(const glm::vec3& newPosition) { position = newPosition; }
     
 private:
     glm::vec3 position;
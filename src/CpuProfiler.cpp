@@ -0,0 +1,196 @@
+// CpuProfiler.cpp - Per-thread event buffers and Chrome trace export
+
+#include "CpuProfiler.h"
+#include <cstdio>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#ifdef CPU_PROFILER_ENABLED
+
+namespace CpuProfiler {
+
+std::atomic<bool> recording(false);
+
+namespace {
+
+struct Event {
+    const char* name;
+    uint64_t start, end;
+};
+
+// Up to CHUNK_EVENTS * MAX_CHUNKS events per thread, allocated a chunk at a time
+const size_t CHUNK_EVENTS = 16384;
+const size_t MAX_CHUNKS = 256;
+
+// Written only by its thread. The writer publishes an event by storing
+// `count` (release); a reader loads it (acquire) and reads that many events.
+struct ThreadBuffer {
+    std::atomic<Event*> chunks[MAX_CHUNKS];
+    std::atomic<size_t> count;
+    std::atomic<size_t> dropped;
+    int id;
+    std::string name;
+
+    explicit ThreadBuffer(int id) : count(0), dropped(0), id(id), name("thread " + std::to_string(id))
+    {
+        for (auto& chunk : chunks) chunk.store(nullptr, std::memory_order_relaxed);
+    }
+    ~ThreadBuffer()
+    {
+        for (auto& chunk : chunks) delete[] chunk.load(std::memory_order_relaxed);
+    }
+};
+
+// Buffers live until exit, so a trace can still be written after their thread ended
+std::mutex registryMutex;
+std::vector<std::unique_ptr<ThreadBuffer>> registry;
+// Tick and clock readings at Start(), to convert ticks to time
+uint64_t startTicks = 0;
+std::chrono::steady_clock::time_point startTime;
+
+thread_local ThreadBuffer* threadBuffer = nullptr;
+
+ThreadBuffer* CurrentBuffer()
+{
+    if (!threadBuffer) {
+        std::lock_guard<std::mutex> lock(registryMutex);
+        registry.emplace_back(new ThreadBuffer((int)registry.size()));
+        threadBuffer = registry.back().get();
+    }
+    return threadBuffer;
+}
+
+void WriteEscaped(FILE* file, const std::string& text)
+{
+    for (char c : text) {
+        if (c == '"' || c == '\\') std::fputc('\\', file);
+        std::fputc(c, file);
+    }
+}
+
+}
+
+void Record(const char* name, uint64_t start, uint64_t end)
+{
+    ThreadBuffer* buffer = CurrentBuffer();
+    size_t index = buffer->count.load(std::memory_order_relaxed);
+    size_t chunkIndex = index / CHUNK_EVENTS;
+    if (chunkIndex >= MAX_CHUNKS) {
+        buffer->dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    Event* chunk = buffer->chunks[chunkIndex].load(std::memory_order_relaxed);
+    if (!chunk) {
+        chunk = new Event[CHUNK_EVENTS];
+        buffer->chunks[chunkIndex].store(chunk, std::memory_order_release);
+    }
+    chunk[index % CHUNK_EVENTS] = Event{ name, start, end };
+    buffer->count.store(index + 1, std::memory_order_release);
+}
+
+void Start()
+{
+    startTime = std::chrono::steady_clock::now();
+    startTicks = Now();
+    recording.store(true);
+}
+
+void Stop()
+{
+    recording.store(false);
+}
+
+void SetThreadName(const std::string& name)
+{
+    ThreadBuffer* buffer = CurrentBuffer();
+    std::lock_guard<std::mutex> lock(registryMutex);
+    buffer->name = name;
+}
+
+size_t EventCount()
+{
+    std::lock_guard<std::mutex> lock(registryMutex);
+    size_t total = 0;
+    for (const auto& buffer : registry) total += buffer->count.load(std::memory_order_acquire);
+    return total;
+}
+
+size_t DroppedCount()
+{
+    std::lock_guard<std::mutex> lock(registryMutex);
+    size_t total = 0;
+    for (const auto& buffer : registry) total += buffer->dropped.load(std::memory_order_relaxed);
+    return total;
+}
+
+bool WriteChromeTrace(const char* path)
+{
+    FILE* file = std::fopen(path, "w");
+    if (!file) {
+        std::cout << "ERROR: cannot write CPU trace to " << path << std::endl;
+        return false;
+    }
+
+    // Ticks per microsecond over the whole recording
+    double elapsedUs = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - startTime).count();
+    uint64_t elapsedTicks = Now() - startTicks;
+    double usPerTick = elapsedTicks > 0 ? elapsedUs / elapsedTicks : 0.0;
+
+    std::lock_guard<std::mutex> lock(registryMutex);
+    // Complete ("X") events with microsecond timestamps, plus one thread_name record per thread
+    std::fprintf(file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+    bool first = true;
+    size_t written = 0;
+    for (const auto& buffer : registry) {
+        std::fprintf(file, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"",
+                     first ? "" : ",\n", buffer->id);
+        WriteEscaped(file, buffer->name);
+        std::fprintf(file, "\"}}");
+        first = false;
+
+        size_t count = buffer->count.load(std::memory_order_acquire);
+        for (size_t i = 0; i < count; ++i) {
+            const Event& event = buffer->chunks[i / CHUNK_EVENTS].load(std::memory_order_acquire)[i % CHUNK_EVENTS];
+            // Recorded before the last Start()
+            if (event.start < startTicks) continue;
+            std::fprintf(file, ",\n{\"name\":\"");
+            WriteEscaped(file, event.name);
+            std::fprintf(file, "\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f}",
+                         buffer->id, (event.start - startTicks) * usPerTick, (event.end - event.start) * usPerTick);
+            written++;
+        }
+    }
+    std::fprintf(file, "\n]}\n");
+    std::fclose(file);
+    std::cout << "CPU trace: " << written << " events written to " << path << std::endl;
+    return true;
+}
+
+}
+
+#else
+
+namespace CpuProfiler {
+
+void Start()
+{
+    std::cout << "WARNING: built without CPU_PROFILER, no trace is recorded" << std::endl;
+}
+
+void Stop() {}
+
+bool WriteChromeTrace(const char* path)
+{
+    std::cout << "ERROR: built without CPU_PROFILER, cannot write " << path << std::endl;
+    return false;
+}
+
+size_t EventCount() { return 0; }
+size_t DroppedCount() { return 0; }
+void SetThreadName(const std::string&) {}
+
+}
+
+#endif
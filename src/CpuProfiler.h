@@ -0,0 +1,84 @@
+#ifndef CPU_PROFILER_H
+#define CPU_PROFILER_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#elif defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+// Scoped CPU markers, exported as a Chrome trace (chrome://tracing, Perfetto).
+//
+//   CPU_PROFILE_SCOPE("Player::Update");
+//
+// records the time from that line to the end of the enclosing block on the
+// calling thread. Names must be string literals: only the pointer is stored.
+// Every thread appends to its own buffer, so recording takes no lock; the
+// buffers are read when the trace is written.
+//
+// Built with CPU_PROFILER_ENABLED (CMake option CPU_PROFILER, on by default);
+// without it the macros expand to nothing. Recording starts with Start(), so an
+// enabled build that isn't tracing pays one relaxed load per scope.
+namespace CpuProfiler {
+
+    // Begins recording; time 0 of the trace
+    void Start();
+    void Stop();
+    // Writes every recorded event as Chrome trace JSON, returns false on error
+    bool WriteChromeTrace(const char* path);
+    // Events recorded so far over all threads, and events lost to full buffers
+    size_t EventCount();
+    size_t DroppedCount();
+    // Name shown for the calling thread in the trace
+    void SetThreadName(const std::string& name);
+
+#ifdef CPU_PROFILER_ENABLED
+    extern std::atomic<bool> recording;
+
+    // Timestamp in ticks: the CPU time-stamp counter on x86 (about half the cost
+    // of steady_clock), converted to time when the trace is written; nanoseconds elsewhere
+    inline uint64_t Now()
+    {
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+        return __rdtsc();
+#else
+        return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+    }
+
+    // Appends a complete event to the calling thread's buffer
+    void Record(const char* name, uint64_t start, uint64_t end);
+
+    class Scope {
+    public:
+        explicit Scope(const char* name)
+            : name(name), start(recording.load(std::memory_order_relaxed) ? Now() : 0) {}
+        ~Scope() { if (start) Record(name, start, Now()); }
+
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+
+    private:
+        const char* name;
+        uint64_t start;
+    };
+#endif
+}
+
+#ifdef CPU_PROFILER_ENABLED
+#define CPU_PROFILE_CONCAT_(a, b) a##b
+#define CPU_PROFILE_CONCAT(a, b) CPU_PROFILE_CONCAT_(a, b)
+// The empty literal in front only compiles with a string literal name
+#define CPU_PROFILE_SCOPE(name) CpuProfiler::Scope CPU_PROFILE_CONCAT(cpuProfileScope, __LINE__)("" name)
+#define CPU_PROFILE_THREAD_NAME(name) CpuProfiler::SetThreadName(name)
+#else
+#define CPU_PROFILE_SCOPE(name) ((void)0)
+#define CPU_PROFILE_THREAD_NAME(name) ((void)0)
+#endif
+
+#endif
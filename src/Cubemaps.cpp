@@ -113,13 +113,14 @@ void Cubemaps::loadCubemap(const std::string facesCubemap[6])
 }
 
 
-void Cubemaps::Draw(Camera &camera, int screenWidth, int screenHeight)
+void Cubemaps::Draw(Camera &camera)
 {
     glDepthFunc(GL_LEQUAL); // Change depth function so depth test passes when values are equal to depth buffer's content
     skyboxShader.Activate();
-    // Calculate view matrix using Camera properties
-    glm::mat4 view = glm::mat4(glm::mat3(glm::lookAt(camera.Position, camera.Position + camera.Orientation, camera.Up))); // Remove translation from the view matrix
-    glm::mat4 projection = glm::perspective(glm::radians(45.0f), (float)screenWidth / (float)screenHeight, 0.1f, 100.0f);
+    // Camera's view matrix (mirrored for planar reflections) without the translation
+    glm::mat4 view = glm::mat4(glm::mat3(camera.view));
+    // Same projection as the scene, sub-pixel jitter (temporal upscaling) included
+    const glm::mat4& projection = camera.projection;
 
     glUniformMatrix4fv(glGetUniformLocation(skyboxShader.ID, "view"), 1, GL_FALSE, glm::value_ptr(view));
     glUniformMatrix4fv(glGetUniformLocation(skyboxShader.ID, "projection"), 1, GL_FALSE, glm::value_ptr(projection));
@@ -15,7 +15,8 @@
 class Cubemaps {
 public:
     Cubemaps(const std::string facesCubemap[6], const char* vertexPath, const char* fragmentPath);
-    void Draw(Camera& camera, int screenWidth, int screenHeight);
+    // With the camera's projection (its jitter included) and its view without the translation
+    void Draw(Camera& camera);
     unsigned int getCubemapID() const { return cubemapTexture; }
     void setAlpha(float alpha); // Set alpha uniform for skybox
     void Delete();
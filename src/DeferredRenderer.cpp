@@ -0,0 +1,290 @@
+// DeferredRenderer.cpp - G-buffer, directional pass and stencil-tested light volumes
+
+#include "DeferredRenderer.h"
+#include <cmath>
+#include <iostream>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+// Size of the dirLight arrays in shader/deferred_dir.frag
+static const int MAX_DIR_LIGHTS = 4;
+
+DeferredRenderer::DeferredRenderer(int width, int height)
+    : width(width), height(height),
+      gbufferShader("shader/default.vert", "shader/gbuffer.frag"),
+      directionalShader("shader/fullscreen.vert", "shader/deferred_dir.frag"),
+      volumeShader("shader/light.vert", "shader/deferred_light.frag"),
+      stencilShader("shader/light.vert", "shader/light.frag")
+{
+    SetSpotConeUniforms(volumeShader);
+    createTargets();
+    createSphere(8, 12);
+    glGenVertexArrays(1, &emptyVAO);
+}
+
+DeferredRenderer::~DeferredRenderer()
+{
+    glDeleteFramebuffers(1, &gbufferFBO);
+    glDeleteFramebuffers(1, &lightFBO);
+    GLuint textures[] = { albedoSpecTexture, normalTexture, depthTexture, depthStencilTexture, lightTexture };
+    glDeleteTextures(5, textures);
+    glDeleteVertexArrays(1, &emptyVAO);
+    glDeleteVertexArrays(1, &sphereVAO);
+    glDeleteBuffers(1, &sphereVBO);
+    glDeleteBuffers(1, &sphereEBO);
+    gbufferShader.Delete();
+    directionalShader.Delete();
+    volumeShader.Delete();
+    stencilShader.Delete();
+}
+
+static GLuint CreateTargetTexture(GLint internalFormat, GLenum format, GLenum type, int width, int height)
+{
+    GLuint texture;
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, width, height, 0, format, type, nullptr);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    return texture;
+}
+
+void DeferredRenderer::createTargets()
+{
+    albedoSpecTexture = CreateTargetTexture(GL_RGBA8, GL_RGBA, GL_UNSIGNED_BYTE, width, height);
+    normalTexture = CreateTargetTexture(GL_RGB10_A2, GL_RGBA, GL_UNSIGNED_INT_2_10_10_10_REV, width, height);
+    depthTexture = CreateTargetTexture(GL_R32F, GL_RED, GL_FLOAT, width, height);
+    depthStencilTexture = CreateTargetTexture(GL_DEPTH24_STENCIL8, GL_DEPTH_STENCIL, GL_UNSIGNED_INT_24_8, width, height);
+    lightTexture = CreateTargetTexture(GL_RGBA8, GL_RGBA, GL_UNSIGNED_BYTE, width, height);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    glGenFramebuffers(1, &gbufferFBO);
+    glBindFramebuffer(GL_FRAMEBUFFER, gbufferFBO);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, albedoSpecTexture, 0);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT1, GL_TEXTURE_2D, normalTexture, 0);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT2, GL_TEXTURE_2D, depthTexture, 0);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_TEXTURE_2D, depthStencilTexture, 0);
+    GLenum drawBuffers[] = { GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1, GL_COLOR_ATTACHMENT2 };
+    glDrawBuffers(3, drawBuffers);
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+        std::cout << "ERROR: G-buffer framebuffer is incomplete" << std::endl;
+
+    // The lighting target reuses the depth/stencil so the light volumes can be
+    // depth and stencil tested without ever sampling an attached texture
+    glGenFramebuffers(1, &lightFBO);
+    glBindFramebuffer(GL_FRAMEBUFFER, lightFBO);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, lightTexture, 0);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_TEXTURE_2D, depthStencilTexture, 0);
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+        std::cout << "ERROR: deferred lighting framebuffer is incomplete" << std::endl;
+
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+// Low-poly UV sphere, pushed out slightly so its faces fully enclose the unit sphere
+void DeferredRenderer::createSphere(int rings, int segments)
+{
+    const float pi = 3.14159265f;
+    float enclose = 1.0f / (std::cos(pi / segments) * std::cos(pi / (2 * rings)));
+
+    std::vector<glm::vec3> positions;
+    std::vector<GLuint> sphereIndices;
+    for (int r = 0; r <= rings; ++r) {
+        float phi = pi * r / rings;
+        for (int s = 0; s <= segments; ++s) {
+            float theta = 2.0f * pi * s / segments;
+            positions.push_back(enclose * glm::vec3(std::sin(phi) * std::cos(theta), std::cos(phi), std::sin(phi) * std::sin(theta)));
+        }
+    }
+    for (int r = 0; r < rings; ++r) {
+        for (int s = 0; s < segments; ++s) {
+            GLuint a = r * (segments + 1) + s;
+            GLuint b = a + segments + 1;
+            // Counter-clockwise seen from outside
+            sphereIndices.insert(sphereIndices.end(), { a, a + 1, b, b, a + 1, b + 1 });
+        }
+    }
+    sphereIndexCount = (GLsizei)sphereIndices.size();
+
+    glGenVertexArrays(1, &sphereVAO);
+    glGenBuffers(1, &sphereVBO);
+    glGenBuffers(1, &sphereEBO);
+    glBindVertexArray(sphereVAO);
+    glBindBuffer(GL_ARRAY_BUFFER, sphereVBO);
+    glBufferData(GL_ARRAY_BUFFER, positions.size() * sizeof(glm::vec3), positions.data(), GL_STATIC_DRAW);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, sphereEBO);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, sphereIndices.size() * sizeof(GLuint), sphereIndices.data(), GL_STATIC_DRAW);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(glm::vec3), (void*)0);
+    glEnableVertexAttribArray(0);
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void DeferredRenderer::beginGeometryPass(const glm::vec4& clearColor)
+{
+    glBindFramebuffer(GL_FRAMEBUFFER, gbufferFBO);
+    glDisable(GL_BLEND);
+    glEnable(GL_DEPTH_TEST);
+    glDepthMask(GL_TRUE);
+
+    GLfloat zero[] = { 0.0f, 0.0f, 0.0f, 0.0f };
+    GLfloat farDepth[] = { 1.0f, 0.0f, 0.0f, 0.0f };
+    glClearBufferfv(GL_COLOR, 0, zero);
+    glClearBufferfv(GL_COLOR, 1, zero);
+    glClearBufferfv(GL_COLOR, 2, farDepth);
+    glClearBufferfi(GL_DEPTH_STENCIL, 0, 1.0f, 0);
+
+    // Background color for pixels the lighting passes never touch
+    glBindFramebuffer(GL_FRAMEBUFFER, lightFBO);
+    glClearBufferfv(GL_COLOR, 0, glm::value_ptr(clearColor));
+    glBindFramebuffer(GL_FRAMEBUFFER, gbufferFBO);
+}
+
+void DeferredRenderer::bindGBufferTextures(Shader& shader, const Camera& camera)
+{
+    shader.Activate();
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, albedoSpecTexture);
+    glActiveTexture(GL_TEXTURE1);
+    glBindTexture(GL_TEXTURE_2D, normalTexture);
+    glActiveTexture(GL_TEXTURE2);
+    glBindTexture(GL_TEXTURE_2D, depthTexture);
+    glUniform1i(glGetUniformLocation(shader.ID, "gAlbedoSpec"), 0);
+    glUniform1i(glGetUniformLocation(shader.ID, "gNormal"), 1);
+    glUniform1i(glGetUniformLocation(shader.ID, "gDepth"), 2);
+
+    glm::mat4 invCamMatrix = glm::inverse(camera.cameraMatrix);
+    glUniformMatrix4fv(glGetUniformLocation(shader.ID, "invCamMatrix"), 1, GL_FALSE, glm::value_ptr(invCamMatrix));
+    glUniform3fv(glGetUniformLocation(shader.ID, "camPos"), 1, glm::value_ptr(camera.Position));
+
+    GLint viewport[4];
+    glGetIntegerv(GL_VIEWPORT, viewport);
+    glUniform2f(glGetUniformLocation(shader.ID, "viewportSize"), (float)viewport[2], (float)viewport[3]);
+}
+
+void DeferredRenderer::bindShadows(Shader& shader, const ShadowAtlas* shadows)
+{
+    if (shadows) {
+        shadows->bind(shader);
+    } else {
+        // The sampler2DShadow must not share a unit with the G-buffer samplers
+        shader.Activate();
+        glUniform1i(glGetUniformLocation(shader.ID, "shadowAtlas"), SHADOW_ATLAS_UNIT);
+    }
+}
+
+void DeferredRenderer::lightingPass(const std::vector<Light>& lights, const Camera& camera, GLuint cubemapID, GLuint targetFramebuffer,
+                                    const ShadowAtlas* shadows, const EnvironmentLighting* environment,
+                                    const ReflectionProbes* probes)
+{
+    GLboolean cullWasEnabled = glIsEnabled(GL_CULL_FACE);
+    GLboolean blendWasEnabled = glIsEnabled(GL_BLEND);
+
+    glBindFramebuffer(GL_FRAMEBUFFER, lightFBO);
+    glDepthMask(GL_FALSE);
+    glDisable(GL_DEPTH_TEST);
+    glDisable(GL_BLEND);
+    glDisable(GL_CULL_FACE);
+
+    // --- Directional lights and reflections, full screen ---
+    bindGBufferTextures(directionalShader, camera);
+    glActiveTexture(GL_TEXTURE3);
+    glBindTexture(GL_TEXTURE_CUBE_MAP, cubemapID);
+    glUniform1i(glGetUniformLocation(directionalShader.ID, "cubemapSampler"), 3);
+    bindShadows(directionalShader, shadows);
+    if (environment) environment->bind(directionalShader);
+    else {
+        // Off, but the samplerCube still needs a unit of its own
+        glUniform1i(glGetUniformLocation(directionalShader.ID, "useIbl"), 0);
+        glUniform1i(glGetUniformLocation(directionalShader.ID, "prefilteredEnv"), ENVIRONMENT_UNIT);
+    }
+    if (probes) probes->bindNearest(directionalShader, camera.Position);
+
+    int dirCount = 0;
+    for (const Light& light : lights) {
+        if (light.type != 0 || dirCount == MAX_DIR_LIGHTS) continue;
+        std::string number = std::to_string(dirCount++);
+        glUniform3fv(glGetUniformLocation(directionalShader.ID, ("dirLightDirection[" + number + "]").c_str()), 1, glm::value_ptr(light.direction));
+        glUniform4fv(glGetUniformLocation(directionalShader.ID, ("dirLightColor[" + number + "]").c_str()), 1, glm::value_ptr(light.color));
+        glUniform1i(glGetUniformLocation(directionalShader.ID, ("dirLightShadowIndex[" + number + "]").c_str()), shadows ? light.shadowIndex : -1);
+    }
+    glUniform1i(glGetUniformLocation(directionalShader.ID, "dirLightCount"), dirCount);
+
+    glBindVertexArray(emptyVAO);
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+
+    // --- Point and spot lights as stencil-marked volumes ---
+    bindGBufferTextures(volumeShader, camera);
+    bindShadows(volumeShader, shadows);
+    glUniform1i(glGetUniformLocation(volumeShader.ID, "useIbl"), environment ? 1 : 0);
+    glEnable(GL_STENCIL_TEST);
+    glBlendEquation(GL_FUNC_ADD);
+    glBlendFunc(GL_ONE, GL_ONE);
+    glBindVertexArray(sphereVAO);
+
+    lastVolumeCount = 0;
+    for (const Light& light : lights) {
+        if (light.type == 0) continue;
+        float radius = light.influenceRadius(influenceThreshold);
+        if (radius <= 0.0f) continue;
+
+        glm::mat4 model = glm::translate(glm::mat4(1.0f), light.position);
+        model = glm::scale(model, glm::vec3(radius));
+
+        // Stencil pass: back faces behind the scene increment, front faces behind
+        // it decrement, leaving non-zero only where the surface is inside the sphere
+        glDrawBuffer(GL_NONE);
+        glEnable(GL_DEPTH_TEST);
+        glDisable(GL_CULL_FACE);
+        glDisable(GL_BLEND);
+        glStencilFunc(GL_ALWAYS, 0, 0);
+        glStencilOpSeparate(GL_BACK, GL_KEEP, GL_INCR_WRAP, GL_KEEP);
+        glStencilOpSeparate(GL_FRONT, GL_KEEP, GL_DECR_WRAP, GL_KEEP);
+        stencilShader.Activate();
+        glUniformMatrix4fv(glGetUniformLocation(stencilShader.ID, "model"), 1, GL_FALSE, glm::value_ptr(model));
+        camera.Matrix(stencilShader, "camMatrix");
+        glDrawElements(GL_TRIANGLES, sphereIndexCount, GL_UNSIGNED_INT, 0);
+
+        // Light pass: shade the marked pixels once (back faces only, so it still
+        // works with the camera inside the volume) and reset the stencil to zero
+        glDrawBuffer(GL_COLOR_ATTACHMENT0);
+        glDisable(GL_DEPTH_TEST);
+        glEnable(GL_CULL_FACE);
+        glCullFace(GL_FRONT);
+        glEnable(GL_BLEND);
+        glStencilFunc(GL_NOTEQUAL, 0, 0xFF);
+        glStencilOp(GL_KEEP, GL_ZERO, GL_ZERO);
+        volumeShader.Activate();
+        glUniformMatrix4fv(glGetUniformLocation(volumeShader.ID, "model"), 1, GL_FALSE, glm::value_ptr(model));
+        camera.Matrix(volumeShader, "camMatrix");
+        glUniform3fv(glGetUniformLocation(volumeShader.ID, "lightPosition"), 1, glm::value_ptr(light.position));
+        glUniform3fv(glGetUniformLocation(volumeShader.ID, "lightDirection"), 1, glm::value_ptr(light.direction));
+        glUniform4fv(glGetUniformLocation(volumeShader.ID, "lightColor"), 1, glm::value_ptr(light.color));
+        glUniform1i(glGetUniformLocation(volumeShader.ID, "lightType"), light.type);
+        glUniform1i(glGetUniformLocation(volumeShader.ID, "lightShadowIndex"), shadows ? light.shadowIndex : -1);
+        glDrawElements(GL_TRIANGLES, sphereIndexCount, GL_UNSIGNED_INT, 0);
+        glCullFace(GL_BACK);
+
+        lastVolumeCount++;
+    }
+    glBindVertexArray(0);
+    glDisable(GL_STENCIL_TEST);
+
+    // Hand color and depth over to the forward passes (only the viewport was rendered)
+    GLint viewport[4];
+    glGetIntegerv(GL_VIEWPORT, viewport);
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, lightFBO);
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, targetFramebuffer);
+    glBlitFramebuffer(0, 0, viewport[2], viewport[3], 0, 0, viewport[2], viewport[3], GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT, GL_NEAREST);
+    glBindFramebuffer(GL_FRAMEBUFFER, targetFramebuffer);
+
+    // Restore the state the forward passes expect
+    glEnable(GL_DEPTH_TEST);
+    glDepthMask(GL_TRUE);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    if (blendWasEnabled) glEnable(GL_BLEND); else glDisable(GL_BLEND);
+    if (cullWasEnabled) glEnable(GL_CULL_FACE); else glDisable(GL_CULL_FACE);
+    glActiveTexture(GL_TEXTURE0);
+}
@@ -0,0 +1,69 @@
+#ifndef DEFERRED_RENDERER_H
+#define DEFERRED_RENDERER_H
+
+#include <vector>
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include "shaderClass.h"
+#include "Camera.h"
+#include "Light.h"
+#include "ShadowAtlas.h"
+#include "EnvironmentLighting.h"
+#include "ReflectionProbes.h"
+
+// Alternate deferred pipeline for the opaque scene:
+//  1. geometry pass into a compact G-buffer (albedo + specular mask, octahedral
+//     normal + reflectivity + roughness, depth)
+//  2. one full-screen pass for the directional lights and reflections
+//  3. one stencil-marked sphere volume per point/spot light, blended additively
+// The result (color and depth) is then copied to the target framebuffer so the
+// particles, campfire, mirrors and skybox can still be drawn forward on top.
+class DeferredRenderer {
+public:
+    // Lights contributing less than this are treated as out of range
+    float influenceThreshold = 0.05f;
+
+    DeferredRenderer(int width, int height);
+    ~DeferredRenderer();
+
+    // Binds the G-buffer; draw the opaque scene with geometryShader() afterwards
+    void beginGeometryPass(const glm::vec4& clearColor);
+    Shader& geometryShader() { return gbufferShader; }
+
+    // Lights the G-buffer and copies color + depth into targetFramebuffer.
+    // Lights with a shadowIndex read their shadows from `shadows`; with an
+    // `environment` it replaces the ambient term and blurs the reflections.
+    // With `probes`, the probe nearest to the camera is reflected instead of cubemapID.
+    void lightingPass(const std::vector<Light>& lights, const Camera& camera, GLuint cubemapID, GLuint targetFramebuffer,
+                      const ShadowAtlas* shadows = nullptr, const EnvironmentLighting* environment = nullptr,
+                      const ReflectionProbes* probes = nullptr);
+
+    // Light volumes drawn by the last lightingPass
+    int lastVolumeCount = 0;
+
+private:
+    int width, height;
+
+    GLuint gbufferFBO;
+    GLuint albedoSpecTexture, normalTexture, depthTexture;
+    GLuint depthStencilTexture;
+    // Lighting accumulates here; shares the G-buffer's depth/stencil attachment
+    GLuint lightFBO;
+    GLuint lightTexture;
+
+    Shader gbufferShader;
+    Shader directionalShader;
+    Shader volumeShader;
+    Shader stencilShader;
+
+    GLuint emptyVAO; // For the full-screen triangle
+    GLuint sphereVAO, sphereVBO, sphereEBO;
+    GLsizei sphereIndexCount;
+
+    void createTargets();
+    void createSphere(int rings, int segments);
+    void bindGBufferTextures(Shader& shader, const Camera& camera);
+    void bindShadows(Shader& shader, const ShadowAtlas* shadows);
+};
+
+#endif
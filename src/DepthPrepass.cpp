@@ -0,0 +1,81 @@
+// DepthPrepass.cpp - Depth-only pre-pass and its automatic on/off selection
+
+#include "DepthPrepass.h"
+#include <iostream>
+
+// Frames measured per trial mode, and frames to keep the winner before retesting
+static const int TRIAL_SAMPLES = 60;
+static const int SETTLED_SAMPLES = 1200;
+
+DepthPrepass::DepthPrepass(Mode mode)
+    : currentMode(mode), useThisFrame(mode == On),
+      shader("shader/default.vert", "shader/depth.frag")
+{
+    if (currentMode == Auto) startTrial();
+}
+
+DepthPrepass::~DepthPrepass()
+{
+    shader.Delete();
+}
+
+void DepthPrepass::beginDepthPass()
+{
+    glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+    glDepthMask(GL_TRUE);
+    glDepthFunc(GL_LESS);
+}
+
+void DepthPrepass::beginShadingPass()
+{
+    glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+    glDepthMask(GL_FALSE);
+    glDepthFunc(GL_EQUAL);
+}
+
+void DepthPrepass::end()
+{
+    glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+    glDepthMask(GL_TRUE);
+    glDepthFunc(GL_LESS);
+}
+
+void DepthPrepass::startTrial()
+{
+    phase = TrialOff;
+    phaseSamples = 0;
+    phaseMsTotal = 0.0f;
+    useThisFrame = false;
+}
+
+void DepthPrepass::addSample(bool usedPrepass, float gpuMs)
+{
+    if (currentMode != Auto) return;
+
+    if (phase == Settled) {
+        if (++phaseSamples >= SETTLED_SAMPLES) startTrial();
+        return;
+    }
+
+    // Query results arrive a frame late; drop the ones from the other mode
+    if (usedPrepass != (phase == TrialOn)) return;
+
+    phaseMsTotal += gpuMs;
+    if (++phaseSamples < TRIAL_SAMPLES) return;
+
+    float average = phaseMsTotal / phaseSamples;
+    phaseSamples = 0;
+    phaseMsTotal = 0.0f;
+    if (phase == TrialOff) {
+        lastOffMs = average;
+        phase = TrialOn;
+        useThisFrame = true;
+        return;
+    }
+
+    lastOnMs = average;
+    phase = Settled;
+    useThisFrame = lastOnMs < lastOffMs;
+    std::cout << "[prepass] auto: off=" << lastOffMs << "ms on=" << lastOnMs
+              << "ms -> " << (useThisFrame ? "on" : "off") << std::endl;
+}
@@ -0,0 +1,55 @@
+#ifndef DEPTH_PREPASS_H
+#define DEPTH_PREPASS_H
+
+#include <glad/glad.h>
+#include "shaderClass.h"
+
+// Optional depth-only pre-pass for the opaque scene. The scene is first drawn
+// with shader/depth.frag (no color writes), then the lit pass runs with
+// GL_EQUAL and depth writes off, so the lighting loop only runs once per pixel.
+//
+// In Auto mode the pre-pass is switched on and off for a few frames at a time,
+// and the cheaper one (by GPU time of pre-pass + lit pass) is kept until the
+// next trial.
+class DepthPrepass {
+public:
+    enum Mode { Off, On, Auto };
+
+    explicit DepthPrepass(Mode mode);
+    ~DepthPrepass();
+
+    Mode mode() const { return currentMode; }
+    // Whether this frame should draw the pre-pass
+    bool active() const { return useThisFrame; }
+
+    Shader& depthShader() { return shader; }
+
+    // Depth only: color writes off, GL_LESS with depth writes
+    void beginDepthPass();
+    // Lit pass over the pre-pass depth: GL_EQUAL, depth writes off
+    void beginShadingPass();
+    // Restores the default GL_LESS / depth write / color write state
+    void end();
+
+    // Feeds the GPU time of one frame's opaque pass (pre-pass included) to the Auto selector
+    void addSample(bool usedPrepass, float gpuMs);
+
+    // Last Auto trial averages (ms), -1 before the first one finishes
+    float lastOffMs = -1.0f;
+    float lastOnMs = -1.0f;
+
+private:
+    Mode currentMode;
+    bool useThisFrame;
+    Shader shader;
+
+    // Auto selection state
+    enum Phase { TrialOff, TrialOn, Settled };
+    Phase phase = TrialOff;
+    int phaseSamples = 0;
+    float phaseMsTotal = 0.0f;
+
+    void startTrial();
+};
+
+#endif
@@ -0,0 +1,262 @@
+// DynamicResolution.cpp - Offscreen scene target, PID-driven render scale and upscale passes
+
+#include "DynamicResolution.h"
+#include <algorithm>
+#include <iostream>
+#include <glm/gtc/type_ptr.hpp>
+
+// Render sizes are multiples of this, so tiny controller corrections don't resize every frame
+static const int SIZE_STEP = 8;
+// Cleared into the velocity buffer: "no motion vector, reproject from depth"
+static const float NO_VELOCITY = 1000.0f;
+
+// Element of the Halton low-discrepancy sequence, in [0, 1)
+static float Halton(int index, int base)
+{
+    float f = 1.0f, result = 0.0f;
+    for (int i = index; i > 0; i /= base) {
+        f /= base;
+        result += f * (i % base);
+    }
+    return result;
+}
+
+static GLuint CreateTexture(GLenum internalFormat, int width, int height, GLenum format, GLenum type, GLenum filter)
+{
+    GLuint texture;
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, width, height, 0, format, type, nullptr);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, filter);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, filter);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    return texture;
+}
+
+DynamicResolution::DynamicResolution(int width, int height, Upscaler upscaler)
+    : mode(upscaler), width(width), height(height), currentWidth(width), currentHeight(height),
+      upscaleShader("shader/fullscreen.vert", "shader/upscale.frag"),
+      resolveShader("shader/fullscreen.vert", "shader/taa_resolve.frag")
+{
+    // Allocated at native size once; lower scales just use the bottom-left part
+    colorTexture = CreateTexture(GL_RGBA8, width, height, GL_RGBA, GL_UNSIGNED_BYTE, GL_LINEAR);
+    // A texture rather than a renderbuffer so the resolve can find the closest surface
+    depthTexture = CreateTexture(GL_DEPTH24_STENCIL8, width, height, GL_DEPTH_STENCIL, GL_UNSIGNED_INT_24_8, GL_NEAREST);
+
+    glGenFramebuffers(1, &framebuffer);
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, colorTexture, 0);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_TEXTURE_2D, depthTexture, 0);
+    if (mode == Temporal) {
+        velocityTexture = CreateTexture(GL_RG16F, width, height, GL_RG, GL_FLOAT, GL_NEAREST);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT1, GL_TEXTURE_2D, velocityTexture, 0);
+    }
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+        std::cout << "ERROR: dynamic resolution framebuffer is incomplete" << std::endl;
+
+    if (mode == Temporal) {
+        glGenFramebuffers(2, historyFramebuffers);
+        for (int i = 0; i < 2; ++i) {
+            historyTextures[i] = CreateTexture(GL_RGBA16F, width, height, GL_RGBA, GL_FLOAT, GL_LINEAR);
+            glBindFramebuffer(GL_FRAMEBUFFER, historyFramebuffers[i]);
+            glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, historyTextures[i], 0);
+            if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+                std::cout << "ERROR: temporal history framebuffer is incomplete" << std::endl;
+        }
+    }
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+    glGenVertexArrays(1, &emptyVAO);
+    for (int i = 0; i < QUERY_FRAMES; ++i) glGenQueries(2, queries[i]);
+}
+
+DynamicResolution::~DynamicResolution()
+{
+    for (int i = 0; i < QUERY_FRAMES; ++i) glDeleteQueries(2, queries[i]);
+    glDeleteFramebuffers(1, &framebuffer);
+    glDeleteTextures(1, &colorTexture);
+    glDeleteTextures(1, &depthTexture);
+    if (mode == Temporal) {
+        glDeleteTextures(1, &velocityTexture);
+        glDeleteFramebuffers(2, historyFramebuffers);
+        glDeleteTextures(2, historyTextures);
+    }
+    glDeleteVertexArrays(1, &emptyVAO);
+    upscaleShader.Delete();
+    resolveShader.Delete();
+}
+
+void DynamicResolution::beginFrame(const glm::vec4& clearColor, Camera& camera)
+{
+    glQueryCounter(queries[frameIndex % QUERY_FRAMES][0], GL_TIMESTAMP);
+
+    // A fixed scale needs no controller
+    if (targetMs <= 0.0f) setAreaScale(maxScale * maxScale);
+
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+    glViewport(0, 0, currentWidth, currentHeight);
+    glClearColor(clearColor.r, clearColor.g, clearColor.b, clearColor.a);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
+
+    if (mode == Temporal) {
+        GLenum both[2] = { GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1 };
+        glDrawBuffers(2, both);
+        const float noVelocity[4] = { NO_VELOCITY, NO_VELOCITY, 0.0f, 0.0f };
+        glClearBufferfv(GL_COLOR, 1, noVelocity);
+        glDrawBuffer(GL_COLOR_ATTACHMENT0);
+
+        // Sub-pixel offset of this frame, in render pixels (-0.5..0.5)
+        jitterIndex = (jitterIndex % JITTER_PHASES) + 1;
+        jitterPixels = glm::vec2(Halton(jitterIndex, 2), Halton(jitterIndex, 3)) - 0.5f;
+        camera.jitter = 2.0f * jitterPixels / glm::vec2((float)currentWidth, (float)currentHeight);
+    } else {
+        camera.jitter = glm::vec2(0.0f);
+    }
+    camera.updateMatrix(camera.FOVdeg, camera.nearPlane, camera.farPlane);
+    currentViewProj = camera.unjitteredMatrix;
+}
+
+void DynamicResolution::beginMotionVectors(Shader& shader)
+{
+    if (mode != Temporal) return;
+    shader.Activate();
+    glUniformMatrix4fv(glGetUniformLocation(shader.ID, "unjitteredCamMatrix"), 1, GL_FALSE, glm::value_ptr(currentViewProj));
+    const glm::mat4& previous = historyValid ? previousViewProj : currentViewProj;
+    glUniformMatrix4fv(glGetUniformLocation(shader.ID, "prevCamMatrix"), 1, GL_FALSE, glm::value_ptr(previous));
+    GLenum both[2] = { GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1 };
+    glDrawBuffers(2, both);
+    // Blending would mix motion vectors of transparent surfaces
+    glDisablei(GL_BLEND, 1);
+}
+
+void DynamicResolution::endMotionVectors()
+{
+    if (mode != Temporal) return;
+    glDrawBuffer(GL_COLOR_ATTACHMENT0);
+}
+
+void DynamicResolution::endFrame(GLuint targetFramebuffer)
+{
+    GLboolean depthWasEnabled = glIsEnabled(GL_DEPTH_TEST);
+    GLboolean blendWasEnabled = glIsEnabled(GL_BLEND);
+    glDisable(GL_DEPTH_TEST);
+    glDisable(GL_BLEND);
+
+    if (mode == Temporal) {
+        resolveTemporal();
+        glBindFramebuffer(GL_FRAMEBUFFER, targetFramebuffer);
+        glViewport(0, 0, width, height);
+        // The history is already at native size, this only sharpens it
+        drawUpscale(historyTextures[historyIndex], width, height);
+    } else {
+        glBindFramebuffer(GL_FRAMEBUFFER, targetFramebuffer);
+        glViewport(0, 0, width, height);
+        drawUpscale(colorTexture, currentWidth, currentHeight);
+    }
+
+    if (depthWasEnabled) glEnable(GL_DEPTH_TEST);
+    if (blendWasEnabled) glEnable(GL_BLEND);
+
+    glQueryCounter(queries[frameIndex % QUERY_FRAMES][1], GL_TIMESTAMP);
+
+    // Oldest frame in flight; skip it if the GPU hasn't got there yet
+    int oldest = (frameIndex + 1) % QUERY_FRAMES;
+    GLuint available = 0;
+    if (frameIndex >= QUERY_FRAMES - 1) glGetQueryObjectuiv(queries[oldest][1], GL_QUERY_RESULT_AVAILABLE, &available);
+    if (available) {
+        GLuint64 start = 0, end = 0;
+        glGetQueryObjectui64v(queries[oldest][0], GL_QUERY_RESULT, &start);
+        glGetQueryObjectui64v(queries[oldest][1], GL_QUERY_RESULT, &end);
+        updateController((end - start) / 1.0e6f);
+    }
+    frameIndex++;
+}
+
+void DynamicResolution::resolveTemporal()
+{
+    int next = 1 - historyIndex;
+    glBindFramebuffer(GL_FRAMEBUFFER, historyFramebuffers[next]);
+    glViewport(0, 0, width, height);
+
+    resolveShader.Activate();
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, colorTexture);
+    glActiveTexture(GL_TEXTURE1);
+    glBindTexture(GL_TEXTURE_2D, velocityTexture);
+    glActiveTexture(GL_TEXTURE2);
+    glBindTexture(GL_TEXTURE_2D, depthTexture);
+    glActiveTexture(GL_TEXTURE3);
+    glBindTexture(GL_TEXTURE_2D, historyTextures[historyIndex]);
+    glUniform1i(glGetUniformLocation(resolveShader.ID, "currentColor"), 0);
+    glUniform1i(glGetUniformLocation(resolveShader.ID, "velocityBuffer"), 1);
+    glUniform1i(glGetUniformLocation(resolveShader.ID, "depthBuffer"), 2);
+    glUniform1i(glGetUniformLocation(resolveShader.ID, "history"), 3);
+    glUniform2f(glGetUniformLocation(resolveShader.ID, "renderSize"), (float)currentWidth, (float)currentHeight);
+    glUniform2f(glGetUniformLocation(resolveShader.ID, "jitterPixels"), jitterPixels.x, jitterPixels.y);
+    glm::mat4 reprojection = previousViewProj * glm::inverse(currentViewProj);
+    glUniformMatrix4fv(glGetUniformLocation(resolveShader.ID, "reprojection"), 1, GL_FALSE, glm::value_ptr(reprojection));
+    glUniform1f(glGetUniformLocation(resolveShader.ID, "feedback"), historyFeedback);
+    glUniform1i(glGetUniformLocation(resolveShader.ID, "historyValid"), historyValid);
+    glBindVertexArray(emptyVAO);
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+    glBindVertexArray(0);
+
+    // Leave unit 0 active for the next pass
+    glActiveTexture(GL_TEXTURE0);
+    historyIndex = next;
+    previousViewProj = currentViewProj;
+    historyValid = true;
+}
+
+void DynamicResolution::drawUpscale(GLuint texture, int sourceWidth, int sourceHeight)
+{
+    upscaleShader.Activate();
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glUniform1i(glGetUniformLocation(upscaleShader.ID, "sceneColor"), 0);
+    glUniform2f(glGetUniformLocation(upscaleShader.ID, "renderSize"), (float)sourceWidth, (float)sourceHeight);
+    glUniform1f(glGetUniformLocation(upscaleShader.ID, "sharpness"), sharpness);
+    glBindVertexArray(emptyVAO);
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+    glBindVertexArray(0);
+}
+
+void DynamicResolution::updateController(float gpuMs)
+{
+    lastGpuMs = gpuMs;
+    if (targetMs <= 0.0f) return;
+
+    // Positive when over budget
+    float error = (gpuMs - targetMs) / targetMs;
+    float derivative = hasPreviousError ? error - previousError : 0.0f;
+    previousError = error;
+    hasPreviousError = true;
+
+    // GPU cost is roughly proportional to the pixel count, so steer the area
+    float minArea = minScale * minScale;
+    float maxArea = maxScale * maxScale;
+    float newIntegral = integral + error;
+    float area = maxArea - (kp * error + ki * newIntegral + kd * derivative);
+    // Anti-windup: don't integrate further while pinned at a bound
+    bool saturated = (area > maxArea && error < 0.0f) || (area < minArea && error > 0.0f);
+    if (!saturated) integral = newIntegral;
+    setAreaScale(area);
+}
+
+void DynamicResolution::setAreaScale(float area)
+{
+    areaScale = glm::clamp(area, minScale * minScale, maxScale * maxScale);
+
+    float linear = std::sqrt(areaScale);
+    int newWidth = std::max(SIZE_STEP, (int)(width * linear / SIZE_STEP + 0.5f) * SIZE_STEP);
+    int newHeight = std::max(SIZE_STEP, (int)(height * linear / SIZE_STEP + 0.5f) * SIZE_STEP);
+    newWidth = std::min(newWidth, width);
+    newHeight = std::min(newHeight, height);
+    if (newWidth != currentWidth || newHeight != currentHeight) {
+        currentWidth = newWidth;
+        currentHeight = newHeight;
+        resizeCount++;
+    }
+}
@@ -0,0 +1,114 @@
+#ifndef DYNAMIC_RESOLUTION_H
+#define DYNAMIC_RESOLUTION_H
+
+#include <cmath>
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include "shaderClass.h"
+#include "Camera.h"
+
+// Dynamic resolution scaling: the 3D scene is drawn into the bottom-left part
+// of an offscreen framebuffer, then upscaled to the native backbuffer, either
+//  - Spatial: bilinear with a light sharpening filter, or
+//  - Temporal: the projection is jittered every frame (Halton 2,3) and the
+//    frames are accumulated at native resolution with motion vectors and
+//    neighbourhood clipping (shader/taa_resolve.frag), then sharpened.
+//
+// The GPU time of every frame is measured with GL_TIMESTAMP queries (so they
+// can wrap the other GL_TIME_ELAPSED queries) and a PID controller adjusts the
+// rendered pixel count to keep it at targetMs. Results are read a few frames
+// late, so the controller never stalls the pipeline. With targetMs <= 0 the
+// scale stays at maxScale.
+class DynamicResolution {
+public:
+    enum Upscaler { Spatial, Temporal };
+
+    // Frames of timestamp queries in flight
+    static const int QUERY_FRAMES = 3;
+    // Length of the jitter sequence
+    static const int JITTER_PHASES = 16;
+
+    // GPU frame time the controller aims for (<= 0: fixed scale)
+    float targetMs = 16.6f;
+    // Bounds of the per-axis resolution scale
+    float minScale = 0.5f;
+    float maxScale = 1.0f;
+    // PID gains, on the frame time error relative to targetMs; the output
+    // changes the rendered pixel count (scale squared)
+    float kp = 0.1f;
+    float ki = 0.05f;
+    float kd = 0.02f;
+    // 0 = plain bilinear upscale, 1 = strongest sharpening
+    float sharpness = 0.3f;
+    // Temporal: weight of the history in the resolve (higher = smoother, more ghosting)
+    float historyFeedback = 0.9f;
+
+    DynamicResolution(int width, int height, Upscaler upscaler = Spatial);
+    ~DynamicResolution();
+
+    Upscaler upscaler() const { return mode; }
+
+    // Binds the offscreen framebuffer, sets the viewport to the current render
+    // size and clears it. Applies this frame's jitter to the camera (and updates
+    // its matrices). Starts the frame's GPU timer.
+    void beginFrame(const glm::vec4& clearColor, Camera& camera);
+    // Upscales into targetFramebuffer at native size (viewport restored to it),
+    // stops the GPU timer and feeds the oldest finished frame to the controller
+    void endFrame(GLuint targetFramebuffer);
+
+    // Temporal: the forward lit pass also writes motion vectors (second color
+    // output of default.frag / clustered.frag). Pixels drawn outside these
+    // calls are reprojected from the depth buffer instead.
+    void beginMotionVectors(Shader& shader);
+    void endMotionVectors();
+
+    // Where the scene is drawn between beginFrame and endFrame
+    GLuint sceneFramebuffer() const { return framebuffer; }
+    int renderWidth() const { return currentWidth; }
+    int renderHeight() const { return currentHeight; }
+    float scale() const { return std::sqrt(areaScale); }
+
+    // Stats
+    float lastGpuMs = 0.0f;     // Last measured GPU frame time
+    int resizeCount = 0;        // Render size changes so far
+
+private:
+    Upscaler mode;
+    int width, height;
+    int currentWidth, currentHeight;
+    // Fraction of the native pixel count that gets rendered
+    float areaScale = 1.0f;
+
+    GLuint framebuffer;
+    GLuint colorTexture;
+    GLuint velocityTexture = 0;     // Temporal only
+    GLuint depthTexture;
+    GLuint emptyVAO; // For the full-screen triangle
+    Shader upscaleShader;
+
+    // Temporal history, ping-ponged at native resolution
+    GLuint historyTextures[2] = { 0, 0 };
+    GLuint historyFramebuffers[2] = { 0, 0 };
+    int historyIndex = 0;
+    bool historyValid = false;
+    Shader resolveShader;
+    int jitterIndex = 0;
+    glm::vec2 jitterPixels = glm::vec2(0.0f);
+    glm::mat4 currentViewProj = glm::mat4(1.0f);
+    glm::mat4 previousViewProj = glm::mat4(1.0f);
+
+    GLuint queries[QUERY_FRAMES][2]; // Start and end timestamps
+    int frameIndex = 0;
+
+    // Controller state
+    float integral = 0.0f;
+    float previousError = 0.0f;
+    bool hasPreviousError = false;
+
+    void updateController(float gpuMs);
+    void setAreaScale(float area);
+    void resolveTemporal();
+    void drawUpscale(GLuint texture, int sourceWidth, int sourceHeight);
+};
+
+#endif
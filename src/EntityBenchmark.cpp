@@ -0,0 +1,166 @@
+// EntityBenchmark.cpp - Object-per-model against structure-of-arrays scene traversal
+
+#include "EntityBenchmark.h"
+#include "EntityStore.h"
+#include "Collider.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <random>
+#include <string>
+#include <glm/gtc/matrix_transform.hpp>
+
+static const int BENCHMARK_FRAMES = 30;
+static const int MESH_COUNT = 4;
+
+namespace {
+
+// A scene object as main.cpp kept them: its own transform, matrix rebuilt with
+// chained glm calls, bounds from the model's box, allocated on its own
+struct SceneObject {
+    std::string name;
+    glm::vec3 position;
+    float yawDegrees;
+    glm::vec3 scale;
+    glm::mat4 matrix;
+    const glm::vec3* meshMin;
+    const glm::vec3* meshMax;
+    glm::vec3 worldMin, worldMax;
+    Collider collider;
+};
+
+double Milliseconds(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+}
+
+int RunEntityBenchmark(int count)
+{
+    count = std::max(count, 1);
+    std::mt19937 random(1);
+    std::uniform_real_distribution<float> field(-200.0f, 200.0f), unit(0.0f, 1.0f);
+
+    glm::vec3 meshMin[MESH_COUNT], meshMax[MESH_COUNT];
+    for (int m = 0; m < MESH_COUNT; ++m) {
+        meshMin[m] = glm::vec3(-1.0f - m, 0.0f, -1.0f - m);
+        meshMax[m] = glm::vec3(1.0f + m, 2.0f + m, 1.0f + m);
+    }
+
+    // Same objects in both layouts
+    EntityStore store;
+    store.reserve(count);
+    for (int m = 0; m < MESH_COUNT; ++m) {
+        store.meshBoundsMin.push_back(meshMin[m]);
+        store.meshBoundsMax.push_back(meshMax[m]);
+    }
+    std::vector<std::unique_ptr<SceneObject>> objects;
+    std::vector<std::unique_ptr<char[]>> clutter; // Other allocations between the objects, as in a real heap
+    for (int i = 0; i < count; ++i) {
+        glm::vec3 position(field(random), 0.0f, field(random));
+        float yaw = unit(random) * 360.0f;
+        glm::vec3 scale(1.0f + unit(random) * 2.0f);
+        int mesh = i % MESH_COUNT;
+        store.create((uint32_t)mesh, position, glm::angleAxis(glm::radians(yaw), glm::vec3(0.0f, 1.0f, 0.0f)), scale, 0);
+
+        std::unique_ptr<SceneObject> object(new SceneObject());
+        object->name = "object " + std::to_string(i) + " of the benchmark scene";
+        object->position = position;
+        object->yawDegrees = yaw;
+        object->scale = scale;
+        object->meshMin = &meshMin[mesh];
+        object->meshMax = &meshMax[mesh];
+        objects.push_back(std::move(object));
+        clutter.emplace_back(new char[64 + (i % 7) * 32]);
+    }
+
+    // Looking over the field from one side, about a third of it in view
+    glm::mat4 viewProjection = glm::perspective(glm::radians(45.0f), 1.0f, 0.1f, 300.0f)
+                             * glm::lookAt(glm::vec3(0.0f, 20.0f, 200.0f), glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+    Frustum frustum(viewProjection);
+
+    ThreadPool serialPool(0);
+    ThreadPool pool;
+    std::cout << "Entity benchmark: " << count << " objects, " << BENCHMARK_FRAMES << " frames, "
+              << pool.threadCount() << " threads" << std::endl;
+
+    // Object per model: every frame each object rebuilds its matrix and bounds, then is tested and listed
+    std::vector<std::vector<SceneObject*>> drawLists(MESH_COUNT);
+    size_t objectVisible = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (int frame = 0; frame < BENCHMARK_FRAMES; ++frame) {
+        for (auto& list : drawLists) list.clear();
+        for (auto& object : objects) {
+            glm::mat4 matrix = glm::mat4(1.0f);
+            matrix = glm::translate(matrix, object->position);
+            matrix = glm::rotate(matrix, glm::radians(object->yawDegrees), glm::vec3(0.0f, 1.0f, 0.0f));
+            matrix = glm::scale(matrix, object->scale);
+            object->matrix = matrix;
+            object->worldMin = glm::vec3(std::numeric_limits<float>::max());
+            object->worldMax = glm::vec3(-std::numeric_limits<float>::max());
+            for (int c = 0; c < 8; ++c) {
+                glm::vec3 corner((c & 1) ? object->meshMax->x : object->meshMin->x,
+                                 (c & 2) ? object->meshMax->y : object->meshMin->y,
+                                 (c & 4) ? object->meshMax->z : object->meshMin->z);
+                glm::vec3 world = glm::vec3(matrix * glm::vec4(corner, 1.0f));
+                object->worldMin = glm::min(object->worldMin, world);
+                object->worldMax = glm::max(object->worldMax, world);
+            }
+            if (frustum.intersects(object->worldMin, object->worldMax))
+                drawLists[(object->meshMin - meshMin)].push_back(object.get());
+        }
+    }
+    double objectMs = Milliseconds(start) / BENCHMARK_FRAMES;
+    for (auto& list : drawLists) objectVisible += list.size();
+
+    // Entity store: the three systems, with every `movingEvery`th entity Dirty each frame (0 = nothing moving)
+    DrawPackets packets;
+    auto runStore = [&](ThreadPool& threads, size_t movingEvery, double& updateMs, double& cullMs, double& packetMs) {
+        updateMs = cullMs = packetMs = 0.0;
+        for (int frame = 0; frame < BENCHMARK_FRAMES; ++frame) {
+            for (size_t i = 0; movingEvery && i < store.size(); i += movingEvery)
+                store.flags[i] |= EntityStore::Dirty;
+            auto t0 = std::chrono::steady_clock::now();
+            UpdateEntityTransforms(store, threads);
+            updateMs += Milliseconds(t0);
+            auto t1 = std::chrono::steady_clock::now();
+            CullEntities(store, viewProjection, packets, threads);
+            cullMs += Milliseconds(t1);
+            auto t2 = std::chrono::steady_clock::now();
+            BuildDrawPackets(store, packets);
+            packetMs += Milliseconds(t2);
+        }
+        updateMs /= BENCHMARK_FRAMES;
+        cullMs /= BENCHMARK_FRAMES;
+        packetMs /= BENCHMARK_FRAMES;
+    };
+    auto report = [&](const char* name, double total, double updateMs, double cullMs, double packetMs) {
+        std::cout << "[entities] " << std::left << std::setw(22) << name << std::right << std::fixed << std::setprecision(3)
+                  << std::setw(9) << total << "ms";
+        if (updateMs >= 0.0) {
+            std::cout << "  (update " << updateMs << ", cull " << cullMs << ", packets " << packetMs << ")"
+                      << "  " << std::setprecision(1) << objectMs / total << "x";
+        }
+        std::cout << std::defaultfloat << std::setprecision(6) << std::endl;
+    };
+
+    report("object per model", objectMs, -1.0, 0.0, 0.0);
+    double updateMs, cullMs, packetMs;
+    runStore(serialPool, 1, updateMs, cullMs, packetMs);
+    report("soa, 1 thread", updateMs + cullMs + packetMs, updateMs, cullMs, packetMs);
+    runStore(pool, 1, updateMs, cullMs, packetMs);
+    report("soa, all threads", updateMs + cullMs + packetMs, updateMs, cullMs, packetMs);
+    runStore(pool, 100, updateMs, cullMs, packetMs);
+    report("soa, 1% moving", updateMs + cullMs + packetMs, updateMs, cullMs, packetMs);
+    runStore(pool, 0, updateMs, cullMs, packetMs);
+    report("soa, nothing moving", updateMs + cullMs + packetMs, updateMs, cullMs, packetMs);
+
+    // Both layouts should keep the same objects (up to rounding at the frustum edges)
+    std::cout << "[entities] visible: " << objectVisible << " objects, " << packets.entities.size() << " entities" << std::endl;
+    return 0;
+}
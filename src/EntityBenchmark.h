@@ -0,0 +1,9 @@
+#ifndef ENTITY_BENCHMARK_H
+#define ENTITY_BENCHMARK_H
+
+// Times transform update, frustum culling and draw list building for `count`
+// objects, stored one heap object per model (as main.cpp used to) and in the
+// EntityStore (one thread, all threads, 1% and nothing moving). No GL needed.
+int RunEntityBenchmark(int count);
+
+#endif
@@ -0,0 +1,205 @@
+// EntityStore.cpp - Structure-of-arrays scene objects and the systems over them
+
+#include "EntityStore.h"
+#include "CpuProfiler.h"
+#include "OcclusionCuller.h"
+#include <cmath>
+#include <iostream>
+#include <glm/gtc/matrix_transform.hpp>
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#include <xmmintrin.h>
+#define ENTITY_STORE_SSE
+#endif
+
+// Entities per parallelFor chunk: enough work to be worth a task
+static const size_t ENTITY_CHUNK = 2048;
+
+const uint32_t EntityStore::NO_ENTITY;
+const uint32_t EntityStore::NO_MESH;
+
+uint32_t EntityStore::create(uint32_t mesh, const glm::vec3& position, const glm::quat& rotation, const glm::vec3& scale,
+                             uint32_t entityFlags, uint32_t parent)
+{
+    if (parent != NO_ENTITY && parent >= size()) {
+        std::cout << "ERROR: entity " << size() << " created before its parent " << parent << ", made a root" << std::endl;
+        parent = NO_ENTITY;
+    }
+    positions.push_back(position);
+    rotations.push_back(rotation);
+    scales.push_back(scale);
+    parents.push_back(parent);
+    localMatrices.push_back(glm::mat4(1.0f));
+    worldMatrices.push_back(glm::mat4(1.0f));
+    boundsMin.push_back(position);
+    boundsMax.push_back(position);
+    meshes.push_back(mesh);
+    flags.push_back(entityFlags | Dirty);
+    return (uint32_t)meshes.size() - 1;
+}
+
+void EntityStore::reserve(size_t count)
+{
+    positions.reserve(count);
+    rotations.reserve(count);
+    scales.reserve(count);
+    parents.reserve(count);
+    localMatrices.reserve(count);
+    worldMatrices.reserve(count);
+    boundsMin.reserve(count);
+    boundsMax.reserve(count);
+    meshes.reserve(count);
+    flags.reserve(count);
+}
+
+void EntityStore::setTransform(uint32_t entity, const glm::vec3& position, const glm::quat& rotation, const glm::vec3& scale)
+{
+    positions[entity] = position;
+    rotations[entity] = rotation;
+    scales[entity] = scale;
+    flags[entity] |= Dirty;
+}
+
+// out = a * b for column-major 4x4 matrices; out must not alias a or b
+static void MultiplyMatrices(const glm::mat4& a, const glm::mat4& b, glm::mat4& out)
+{
+#ifdef ENTITY_STORE_SSE
+    // Column c of the product is a's columns weighted by b's column c
+    const __m128 a0 = _mm_loadu_ps(&a[0][0]);
+    const __m128 a1 = _mm_loadu_ps(&a[1][0]);
+    const __m128 a2 = _mm_loadu_ps(&a[2][0]);
+    const __m128 a3 = _mm_loadu_ps(&a[3][0]);
+    for (int c = 0; c < 4; ++c) {
+        const float* column = &b[c][0];
+        __m128 result = _mm_mul_ps(a0, _mm_set1_ps(column[0]));
+        result = _mm_add_ps(result, _mm_mul_ps(a1, _mm_set1_ps(column[1])));
+        result = _mm_add_ps(result, _mm_mul_ps(a2, _mm_set1_ps(column[2])));
+        result = _mm_add_ps(result, _mm_mul_ps(a3, _mm_set1_ps(column[3])));
+        _mm_storeu_ps(&out[c][0], result);
+    }
+#else
+    out = a * b;
+#endif
+}
+
+void UpdateEntityTransforms(EntityStore& store, ThreadPool& pool)
+{
+    CPU_PROFILE_SCOPE("UpdateEntityTransforms");
+    // Local matrices of the entities that changed themselves
+    pool.parallelFor(store.size(), [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            if (!(store.flags[i] & EntityStore::Dirty)) continue;
+            // T * R * S, written out: the rotation columns times the scale
+            glm::mat3 rotation = glm::mat3_cast(store.rotations[i]);
+            const glm::vec3& s = store.scales[i];
+            glm::mat4& local = store.localMatrices[i];
+            local[0] = glm::vec4(rotation[0] * s.x, 0.0f);
+            local[1] = glm::vec4(rotation[1] * s.y, 0.0f);
+            local[2] = glm::vec4(rotation[2] * s.z, 0.0f);
+            local[3] = glm::vec4(store.positions[i], 1.0f);
+        }
+    }, ENTITY_CHUNK);
+
+    // World matrices in one linear pass: parents come first, so a parent has
+    // its new matrix (and Moved flag) before any of its children is reached
+    for (uint32_t i : store.moved) store.flags[i] &= ~EntityStore::Moved;
+    store.moved.clear();
+    for (size_t i = 0; i < store.size(); ++i) {
+        uint32_t parent = store.parents[i];
+        bool parentMoved = parent != EntityStore::NO_ENTITY && (store.flags[parent] & EntityStore::Moved);
+        if (!(store.flags[i] & EntityStore::Dirty) && !parentMoved) continue;
+        if (parent == EntityStore::NO_ENTITY) store.worldMatrices[i] = store.localMatrices[i];
+        else MultiplyMatrices(store.worldMatrices[parent], store.localMatrices[i], store.worldMatrices[i]);
+        store.flags[i] = (store.flags[i] & ~EntityStore::Dirty) | EntityStore::Moved;
+        store.moved.push_back((uint32_t)i);
+    }
+
+    // Bounds of the moved entities only
+    pool.parallelFor(store.moved.size(), [&](size_t begin, size_t end) {
+        for (size_t m = begin; m < end; ++m) {
+            uint32_t i = store.moved[m];
+            const glm::mat4& world = store.worldMatrices[i];
+            uint32_t mesh = store.meshes[i];
+            if (mesh >= store.meshCount()) {
+                // Transform-only node: a point
+                store.boundsMin[i] = store.boundsMax[i] = glm::vec3(world[3]);
+                continue;
+            }
+            // World box of the mesh box: transformed center, extents through |M| (Arvo)
+            glm::vec3 center = (store.meshBoundsMin[mesh] + store.meshBoundsMax[mesh]) * 0.5f;
+            glm::vec3 extent = (store.meshBoundsMax[mesh] - store.meshBoundsMin[mesh]) * 0.5f;
+            glm::vec3 worldCenter = glm::vec3(world * glm::vec4(center, 1.0f));
+            glm::vec3 worldExtent = glm::abs(glm::vec3(world[0])) * extent.x
+                                  + glm::abs(glm::vec3(world[1])) * extent.y
+                                  + glm::abs(glm::vec3(world[2])) * extent.z;
+            store.boundsMin[i] = worldCenter - worldExtent;
+            store.boundsMax[i] = worldCenter + worldExtent;
+        }
+    }, ENTITY_CHUNK);
+}
+
+Frustum::Frustum(const glm::mat4& m)
+{
+    // Gribb/Hartmann: rows of the matrix combined with the w row
+    glm::vec4 row[4];
+    for (int r = 0; r < 4; ++r) row[r] = glm::vec4(m[0][r], m[1][r], m[2][r], m[3][r]);
+    planes[0] = row[3] + row[0];
+    planes[1] = row[3] - row[0];
+    planes[2] = row[3] + row[1];
+    planes[3] = row[3] - row[1];
+    planes[4] = row[3] + row[2];
+    planes[5] = row[3] - row[2];
+}
+
+bool Frustum::intersects(const glm::vec3& boxMin, const glm::vec3& boxMax) const
+{
+    for (const glm::vec4& plane : planes) {
+        // Corner furthest along the plane normal
+        glm::vec3 corner(plane.x >= 0.0f ? boxMax.x : boxMin.x,
+                         plane.y >= 0.0f ? boxMax.y : boxMin.y,
+                         plane.z >= 0.0f ? boxMax.z : boxMin.z);
+        if (glm::dot(glm::vec3(plane), corner) + plane.w < 0.0f) return false;
+    }
+    return true;
+}
+
+void CullEntities(const EntityStore& store, const glm::mat4& viewProjection, DrawPackets& packets, ThreadPool& pool)
+{
+    CPU_PROFILE_SCOPE("CullEntities");
+    Frustum frustum(viewProjection);
+    packets.visible.resize(store.size());
+    pool.parallelFor(store.size(), [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i)
+            packets.visible[i] = frustum.intersects(store.boundsMin[i], store.boundsMax[i]) ? 1 : 0;
+    }, ENTITY_CHUNK);
+}
+
+void BuildDrawPackets(const EntityStore& store, DrawPackets& packets, OcclusionCuller* occlusion)
+{
+    CPU_PROFILE_SCOPE("BuildDrawPackets");
+    // Counting sort by mesh: count, prefix sum, scatter
+    size_t meshCount = store.meshCount();
+    packets.offsets.assign(meshCount + 1, 0);
+    packets.frustumCulled = 0;
+    packets.occlusionCulled = 0;
+    for (size_t i = 0; i < store.size(); ++i) {
+        if (store.meshes[i] >= meshCount) {
+            packets.visible[i] = 0; // Transform-only node, nothing to draw
+            continue;
+        }
+        if (!packets.visible[i]) {
+            packets.frustumCulled++;
+            continue;
+        }
+        if (occlusion && !occlusion->isVisible(store.boundsMin[i], store.boundsMax[i])) {
+            packets.visible[i] = 0;
+            packets.occlusionCulled++;
+            continue;
+        }
+        packets.offsets[store.meshes[i] + 1]++;
+    }
+    for (size_t m = 0; m < meshCount; ++m) packets.offsets[m + 1] += packets.offsets[m];
+    packets.entities.resize(packets.offsets[meshCount]);
+    std::vector<uint32_t> next(packets.offsets.begin(), packets.offsets.end() - 1);
+    for (size_t i = 0; i < store.size(); ++i)
+        if (packets.visible[i]) packets.entities[next[store.meshes[i]]++] = (uint32_t)i;
+}
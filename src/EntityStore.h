@@ -0,0 +1,91 @@
+#ifndef ENTITY_STORE_H
+#define ENTITY_STORE_H
+
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+#include "ThreadPool.h"
+
+class OcclusionCuller;
+
+// Scene objects as structure-of-arrays: entity i is index i of every array.
+// The systems below walk the arrays front to back, in chunks on the
+// ThreadPool, touching only the arrays they need.
+//
+// Entities form a transform hierarchy: the transform of an entity is relative
+// to its parent, and parents always come before their children, so one pass
+// in index order sees every parent's world matrix before its children.
+class EntityStore {
+public:
+    enum Flags : uint32_t {
+        CastsShadow = 1 << 0,
+        Occluder    = 1 << 1,
+        Dirty       = 1 << 2, // Local transform changed, world matrix and bounds are stale
+        Moved       = 1 << 3, // World matrix changed in the last UpdateEntityTransforms
+    };
+
+    // Local transform (relative to the parent)
+    std::vector<glm::vec3> positions;
+    std::vector<glm::quat> rotations;
+    std::vector<glm::vec3> scales;
+    std::vector<uint32_t> parents;  // NO_ENTITY for roots
+    // Derived by UpdateEntityTransforms
+    std::vector<glm::mat4> localMatrices;
+    std::vector<glm::mat4> worldMatrices;
+    std::vector<glm::vec3> boundsMin, boundsMax;
+    // Render data: index of the mesh (a Scene asset), NO_MESH for transform-only nodes, and Flags
+    std::vector<uint32_t> meshes;
+    std::vector<uint32_t> flags;
+    // Entities whose world matrix and bounds changed in the last update, in index order
+    std::vector<uint32_t> moved;
+
+    // Model-space bounds of every mesh, indexed by mesh
+    std::vector<glm::vec3> meshBoundsMin, meshBoundsMax;
+
+    static const uint32_t NO_ENTITY = 0xFFFFFFFFu;
+    static const uint32_t NO_MESH = 0xFFFFFFFFu;
+
+    // The parent must already exist (it gets a lower index)
+    uint32_t create(uint32_t mesh, const glm::vec3& position, const glm::quat& rotation, const glm::vec3& scale,
+                    uint32_t entityFlags, uint32_t parent = NO_ENTITY);
+    void reserve(size_t count);
+    size_t size() const { return meshes.size(); }
+    size_t meshCount() const { return meshBoundsMin.size(); }
+
+    void setTransform(uint32_t entity, const glm::vec3& position, const glm::quat& rotation, const glm::vec3& scale);
+};
+
+// View frustum planes (inward normals), from a projection * view matrix
+struct Frustum {
+    glm::vec4 planes[6];
+
+    explicit Frustum(const glm::mat4& viewProjection);
+    // False when the box is entirely outside one plane
+    bool intersects(const glm::vec3& boxMin, const glm::vec3& boxMax) const;
+};
+
+// Visible entities grouped by mesh: the entities of mesh m are
+// entities[offsets[m]] to entities[offsets[m + 1] - 1], in entity order
+struct DrawPackets {
+    std::vector<uint32_t> entities;
+    std::vector<uint32_t> offsets;
+    // Scratch: 1 per entity that passed the frustum test
+    std::vector<uint8_t> visible;
+    // Stats of the last build
+    size_t frustumCulled = 0;
+    size_t occlusionCulled = 0;
+};
+
+// Recomputes the world matrix and bounds of the Dirty entities and of
+// everything below them, and lists them in store.moved
+void UpdateEntityTransforms(EntityStore& store, ThreadPool& pool);
+
+// Frustum test of every entity's world bounds
+void CullEntities(const EntityStore& store, const glm::mat4& viewProjection, DrawPackets& packets, ThreadPool& pool);
+
+// Gathers the entities that passed CullEntities, by mesh. Survivors are
+// tested against the occlusion buffer too, when one is given.
+void BuildDrawPackets(const EntityStore& store, DrawPackets& packets, OcclusionCuller* occlusion = nullptr);
+
+#endif
@@ -0,0 +1,378 @@
+// EnvironmentLighting.cpp - SH9 irradiance and prefiltered cubemap of a skybox, cached on disk
+
+#include "EnvironmentLighting.h"
+#include "CpuProfiler.h"
+#include "stb_image.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#include <xmmintrin.h>
+#define ENVIRONMENT_SSE
+#endif
+
+static const char IBL_MAGIC[8] = { 'I', 'B', 'L', 'C', 'A', 'C', 'H', 'E' };
+static const uint32_t IBL_VERSION = 1;
+// Face size the glossy levels are convolved from: every output texel weighs all of its texels
+static const int FILTER_SOURCE_SIZE = 32;
+// Lobe weights below this are left out of the convolution
+static const float LOBE_CUTOFF = 1e-3f;
+
+const int EnvironmentLighting::BASE_SIZE;
+const int EnvironmentLighting::LEVELS;
+
+namespace {
+
+struct CacheHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t baseSize;
+    uint32_t levels;
+    uint32_t reserved;
+    uint64_t sourceHash;  // FNV-1a of the face files
+};
+
+// Direction through the center of texel (x, y) of a face, rows top to bottom (GL cube map layout)
+glm::vec3 TexelDirection(int face, int x, int y, int size)
+{
+    float s = 2.0f * (x + 0.5f) / size - 1.0f;
+    float t = 2.0f * (y + 0.5f) / size - 1.0f;
+    switch (face) {
+    case 0:  return glm::vec3(1.0f, -t, -s);
+    case 1:  return glm::vec3(-1.0f, -t, s);
+    case 2:  return glm::vec3(s, 1.0f, t);
+    case 3:  return glm::vec3(s, -1.0f, -t);
+    case 4:  return glm::vec3(s, -t, 1.0f);
+    default: return glm::vec3(-s, -t, -1.0f);
+    }
+}
+
+// Solid angle of texel (x, y): the face is 2x2 at distance 1
+float TexelSolidAngle(int x, int y, int size)
+{
+    float s = 2.0f * (x + 0.5f) / size - 1.0f;
+    float t = 2.0f * (y + 0.5f) / size - 1.0f;
+    float d = 1.0f + s * s + t * t;
+    return 4.0f / ((float)size * size * d * std::sqrt(d));
+}
+
+// Box filter of an RGB face to `size` (sizes need not divide)
+void Downsample(const float* source, int sourceSize, float* target, int size)
+{
+    for (int y = 0; y < size; ++y) {
+        int y0 = y * sourceSize / size, y1 = std::max((y + 1) * sourceSize / size, y0 + 1);
+        for (int x = 0; x < size; ++x) {
+            int x0 = x * sourceSize / size, x1 = std::max((x + 1) * sourceSize / size, x0 + 1);
+            float sum[3] = { 0.0f, 0.0f, 0.0f };
+            for (int sy = y0; sy < y1; ++sy) {
+                const float* row = source + ((size_t)sy * sourceSize + x0) * 3;
+                for (int sx = 0; sx < x1 - x0; ++sx) {
+                    sum[0] += row[sx * 3];
+                    sum[1] += row[sx * 3 + 1];
+                    sum[2] += row[sx * 3 + 2];
+                }
+            }
+            float scale = 1.0f / ((y1 - y0) * (x1 - x0));
+            for (int c = 0; c < 3; ++c) target[((size_t)y * size + x) * 3 + c] = sum[c] * scale;
+        }
+    }
+}
+
+uint64_t HashFile(const std::string& path, uint64_t hash, bool& ok)
+{
+    std::ifstream in(path, std::ios::binary);
+    if (!in) {
+        ok = false;
+        return hash;
+    }
+    char buffer[65536];
+    while (in.read(buffer, sizeof(buffer)) || in.gcount() > 0) {
+        for (std::streamsize i = 0; i < in.gcount(); ++i) {
+            hash ^= (unsigned char)buffer[i];
+            hash *= 1099511628211ull;
+        }
+    }
+    return hash;
+}
+
+// The cube flattened for the convolution: unit directions, solid angles and colors, one array each
+struct CubeSamples {
+    std::vector<float> x, y, z, solidAngle, r, g, b;
+};
+
+// cosines[j] = dot(n, direction j); count is a multiple of 4
+void Cosines(const CubeSamples& cube, const glm::vec3& n, float* cosines)
+{
+    size_t count = cube.x.size();
+#ifdef ENVIRONMENT_SSE
+    __m128 nx = _mm_set1_ps(n.x), ny = _mm_set1_ps(n.y), nz = _mm_set1_ps(n.z);
+    for (size_t j = 0; j < count; j += 4) {
+        __m128 d = _mm_mul_ps(nx, _mm_loadu_ps(&cube.x[j]));
+        d = _mm_add_ps(d, _mm_mul_ps(ny, _mm_loadu_ps(&cube.y[j])));
+        d = _mm_add_ps(d, _mm_mul_ps(nz, _mm_loadu_ps(&cube.z[j])));
+        _mm_storeu_ps(cosines + j, d);
+    }
+#else
+    for (size_t j = 0; j < count; ++j) cosines[j] = n.x * cube.x[j] + n.y * cube.y[j] + n.z * cube.z[j];
+#endif
+}
+
+double Milliseconds(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+}
+
+EnvironmentLighting::~EnvironmentLighting()
+{
+    if (texture) glDeleteTextures(1, &texture);
+}
+
+std::string EnvironmentCachePath(const std::string faces[6])
+{
+    size_t slash = faces[0].find_last_of("/\\");
+    return (slash == std::string::npos ? std::string() : faces[0].substr(0, slash + 1)) + "environment.ibl";
+}
+
+bool EnvironmentLighting::load(const std::string faces[6], ThreadPool& pool, bool force)
+{
+    CPU_PROFILE_SCOPE("EnvironmentLighting::load");
+    auto start = std::chrono::steady_clock::now();
+    uint64_t hash = 14695981039346656037ull;
+    bool found = true;
+    for (int f = 0; f < 6; ++f) hash = HashFile(faces[f], hash, found);
+    if (!found) {
+        std::cout << "ERROR: cannot read the skybox faces of " << faces[0] << std::endl;
+        return false;
+    }
+    std::string cachePath = EnvironmentCachePath(faces);
+    fromCache = !force && readCache(cachePath, hash);
+    if (fromCache) {
+        computeMs = (float)Milliseconds(start);
+        return true;
+    }
+
+    // Decode and shrink the faces to the base level, one task per face
+    int sourceSizes[6] = {};
+    pool.parallelFor(6, [&](size_t begin, size_t end) {
+        for (size_t f = begin; f < end; ++f) {
+            int width, height, channels;
+            unsigned char* pixels = stbi_load(faces[f].c_str(), &width, &height, &channels, 3);
+            if (!pixels || width != height) {
+                if (pixels) stbi_image_free(pixels);
+                continue;
+            }
+            std::vector<float> linear((size_t)width * height * 3);
+            for (size_t i = 0; i < linear.size(); ++i) linear[i] = pixels[i] / 255.0f;
+            stbi_image_free(pixels);
+            levels[0][f].resize((size_t)BASE_SIZE * BASE_SIZE * 3);
+            Downsample(linear.data(), width, levels[0][f].data(), BASE_SIZE);
+            sourceSizes[f] = width;
+        }
+    });
+    for (int f = 0; f < 6; ++f) {
+        if (sourceSizes[f] == 0) {
+            std::cout << "ERROR: skybox face " << faces[f] << " is missing or not square" << std::endl;
+            return false;
+        }
+    }
+
+    // SH9 projection of the base level: sum of radiance * basis * solid angle,
+    // one partial sum per face row so the result doesn't depend on the threads
+    std::vector<glm::vec3> rowSums((size_t)6 * BASE_SIZE * 9, glm::vec3(0.0f));
+    pool.parallelFor(6 * BASE_SIZE, [&](size_t begin, size_t end) {
+        for (size_t row = begin; row < end; ++row) {
+            int face = (int)(row / BASE_SIZE), y = (int)(row % BASE_SIZE);
+            glm::vec3* sums = &rowSums[row * 9];
+            const float* texels = &levels[0][face][(size_t)y * BASE_SIZE * 3];
+            for (int x = 0; x < BASE_SIZE; ++x) {
+                glm::vec3 n = glm::normalize(TexelDirection(face, x, y, BASE_SIZE));
+                glm::vec3 radiance = glm::vec3(texels[x * 3], texels[x * 3 + 1], texels[x * 3 + 2])
+                                   * TexelSolidAngle(x, y, BASE_SIZE);
+                sums[0] += radiance * 0.282095f;
+                sums[1] += radiance * (0.488603f * n.y);
+                sums[2] += radiance * (0.488603f * n.z);
+                sums[3] += radiance * (0.488603f * n.x);
+                sums[4] += radiance * (1.092548f * n.x * n.y);
+                sums[5] += radiance * (1.092548f * n.y * n.z);
+                sums[6] += radiance * (0.315392f * (3.0f * n.z * n.z - 1.0f));
+                sums[7] += radiance * (1.092548f * n.x * n.z);
+                sums[8] += radiance * (0.546274f * (n.x * n.x - n.y * n.y));
+            }
+        }
+    }, 16);
+    // Cosine lobe convolution per band (pi, 2pi/3, pi/4), then / pi for the Lambert BRDF
+    const float band[9] = { 1.0f, 2.0f / 3.0f, 2.0f / 3.0f, 2.0f / 3.0f, 0.25f, 0.25f, 0.25f, 0.25f, 0.25f };
+    for (int i = 0; i < 9; ++i) {
+        sh[i] = glm::vec3(0.0f);
+        for (size_t row = 0; row < (size_t)6 * BASE_SIZE; ++row) sh[i] += rowSums[row * 9 + i];
+        sh[i] *= band[i];
+    }
+
+    // Glossy levels: the sky convolved with a Phong lobe cos^p, p from the
+    // roughness of the level (Blinn-Phong equivalent of GGX alpha = roughness^2)
+    CubeSamples cube;
+    for (int f = 0; f < 6; ++f) {
+        std::vector<float> small((size_t)FILTER_SOURCE_SIZE * FILTER_SOURCE_SIZE * 3);
+        Downsample(levels[0][f].data(), BASE_SIZE, small.data(), FILTER_SOURCE_SIZE);
+        for (int y = 0; y < FILTER_SOURCE_SIZE; ++y) {
+            for (int x = 0; x < FILTER_SOURCE_SIZE; ++x) {
+                glm::vec3 d = glm::normalize(TexelDirection(f, x, y, FILTER_SOURCE_SIZE));
+                const float* texel = &small[((size_t)y * FILTER_SOURCE_SIZE + x) * 3];
+                cube.x.push_back(d.x);
+                cube.y.push_back(d.y);
+                cube.z.push_back(d.z);
+                cube.solidAngle.push_back(TexelSolidAngle(x, y, FILTER_SOURCE_SIZE));
+                cube.r.push_back(texel[0]);
+                cube.g.push_back(texel[1]);
+                cube.b.push_back(texel[2]);
+            }
+        }
+    }
+    for (int level = 1; level < LEVELS; ++level) {
+        int size = BASE_SIZE >> level;
+        float roughness = (float)level / (LEVELS - 1);
+        float alpha = roughness * roughness;
+        float power = std::max(2.0f / (alpha * alpha) - 2.0f, 1.0f);
+        float minCosine = std::pow(LOBE_CUTOFF, 1.0f / power);
+        for (int f = 0; f < 6; ++f) levels[level][f].resize((size_t)size * size * 3);
+        pool.parallelFor((size_t)6 * size, [&](size_t begin, size_t end) {
+            std::vector<float> cosines(cube.x.size());
+            for (size_t row = begin; row < end; ++row) {
+                int face = (int)(row / size), y = (int)(row % size);
+                for (int x = 0; x < size; ++x) {
+                    // Reflection direction = normal = view (the usual split-sum simplification)
+                    Cosines(cube, glm::normalize(TexelDirection(face, x, y, size)), cosines.data());
+                    glm::vec3 sum(0.0f);
+                    float weightSum = 0.0f;
+                    for (size_t j = 0; j < cosines.size(); ++j) {
+                        if (cosines[j] <= minCosine) continue;
+                        float weight = cube.solidAngle[j] * std::pow(cosines[j], power);
+                        sum += weight * glm::vec3(cube.r[j], cube.g[j], cube.b[j]);
+                        weightSum += weight;
+                    }
+                    sum /= std::max(weightSum, 1e-12f);
+                    float* out = &levels[level][face][((size_t)y * size + x) * 3];
+                    out[0] = sum.r;
+                    out[1] = sum.g;
+                    out[2] = sum.b;
+                }
+            }
+        });
+    }
+
+    writeCache(cachePath, hash);
+    computeMs = (float)Milliseconds(start);
+    return true;
+}
+
+bool EnvironmentLighting::readCache(const std::string& path, uint64_t sourceHash)
+{
+    std::ifstream in(path, std::ios::binary);
+    if (!in) return false;
+    CacheHeader header;
+    if (!in.read(reinterpret_cast<char*>(&header), sizeof(header))) return false;
+    if (std::memcmp(header.magic, IBL_MAGIC, sizeof(IBL_MAGIC)) != 0 || header.version != IBL_VERSION
+        || header.baseSize != (uint32_t)BASE_SIZE || header.levels != (uint32_t)LEVELS || header.sourceHash != sourceHash)
+        return false;
+    in.read(reinterpret_cast<char*>(sh), sizeof(sh));
+    for (int level = 0; level < LEVELS; ++level) {
+        int size = BASE_SIZE >> level;
+        for (int f = 0; f < 6; ++f) {
+            levels[level][f].resize((size_t)size * size * 3);
+            in.read(reinterpret_cast<char*>(levels[level][f].data()), levels[level][f].size() * sizeof(float));
+        }
+    }
+    return (bool)in;
+}
+
+void EnvironmentLighting::writeCache(const std::string& path, uint64_t sourceHash) const
+{
+    std::ofstream out(path, std::ios::binary);
+    CacheHeader header = {};
+    std::memcpy(header.magic, IBL_MAGIC, sizeof(IBL_MAGIC));
+    header.version = IBL_VERSION;
+    header.baseSize = BASE_SIZE;
+    header.levels = LEVELS;
+    header.sourceHash = sourceHash;
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    out.write(reinterpret_cast<const char*>(sh), sizeof(sh));
+    for (int level = 0; level < LEVELS; ++level)
+        for (int f = 0; f < 6; ++f)
+            out.write(reinterpret_cast<const char*>(levels[level][f].data()), levels[level][f].size() * sizeof(float));
+    if (!out) std::cout << "WARNING: could not write the environment cache " << path << std::endl;
+}
+
+void EnvironmentLighting::upload()
+{
+    if (!texture) glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_CUBE_MAP, texture);
+    for (int level = 0; level < LEVELS; ++level) {
+        int size = BASE_SIZE >> level;
+        for (int f = 0; f < 6; ++f)
+            glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + f, level, GL_RGB16F, size, size, 0, GL_RGB, GL_FLOAT,
+                         levels[level][f].data());
+    }
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_BASE_LEVEL, 0);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAX_LEVEL, LEVELS - 1);
+    // The blurry levels are only a few texels wide: filter across the face edges
+    glEnable(GL_TEXTURE_CUBE_MAP_SEAMLESS);
+    glBindTexture(GL_TEXTURE_CUBE_MAP, 0);
+}
+
+void EnvironmentLighting::bind(Shader& shader) const
+{
+    shader.Activate();
+    glUniform1i(glGetUniformLocation(shader.ID, "useIbl"), 1);
+    glUniform3fv(glGetUniformLocation(shader.ID, "irradianceSH"), 9, &sh[0].x);
+    glActiveTexture(GL_TEXTURE0 + ENVIRONMENT_UNIT);
+    glBindTexture(GL_TEXTURE_CUBE_MAP, texture);
+    glUniform1i(glGetUniformLocation(shader.ID, "prefilteredEnv"), ENVIRONMENT_UNIT);
+    glUniform1f(glGetUniformLocation(shader.ID, "prefilteredMaxLod"), (float)(LEVELS - 1));
+    glActiveTexture(GL_TEXTURE0);
+}
+
+int BakeEnvironments(ThreadPool& pool)
+{
+    struct Skybox {
+        const char* name;
+        std::string faces[6];
+    };
+    const Skybox skyboxes[] = {
+        { "day", { "assets/cubesmaps/day/right.jpg", "assets/cubesmaps/day/left.jpg", "assets/cubesmaps/day/top.jpg",
+                   "assets/cubesmaps/day/bottom.jpg", "assets/cubesmaps/day/front.jpg", "assets/cubesmaps/day/back.jpg" } },
+        { "night", { "assets/cubesmaps/night/right.jpg", "assets/cubesmaps/night/left.jpg", "assets/cubesmaps/night/top.jpg",
+                     "assets/cubesmaps/night/bottom.jpg", "assets/cubesmaps/night/front.jpg", "assets/cubesmaps/night/back.jpg" } },
+        { "Brudslojan", { "assets/cubesmaps/Brudslojan/posx.jpg", "assets/cubesmaps/Brudslojan/negx.jpg",
+                          "assets/cubesmaps/Brudslojan/posy.jpg", "assets/cubesmaps/Brudslojan/negy.jpg",
+                          "assets/cubesmaps/Brudslojan/posz.jpg", "assets/cubesmaps/Brudslojan/negz.jpg" } },
+    };
+    std::cout << "Baking image-based lighting (" << pool.threadCount() << " threads)" << std::endl;
+    int failures = 0;
+    for (const Skybox& skybox : skyboxes) {
+        EnvironmentLighting environment;
+        if (!environment.load(skybox.faces, pool, true)) {
+            failures++;
+            continue;
+        }
+        // Cached load for comparison
+        EnvironmentLighting cached;
+        cached.load(skybox.faces, pool);
+        const glm::vec3& ambient = environment.irradiance()[0];
+        std::cout << "[ibl] " << std::left << std::setw(11) << skybox.name << std::right << std::fixed << std::setprecision(1)
+                  << " bake " << std::setw(7) << environment.computeMs << "ms, cached " << std::setw(5) << cached.computeMs
+                  << "ms" << std::setprecision(3) << "  sh0=(" << ambient.r << ", " << ambient.g << ", " << ambient.b << ")  -> "
+                  << EnvironmentCachePath(skybox.faces) << std::defaultfloat << std::setprecision(6) << std::endl;
+    }
+    return failures ? 1 : 0;
+}
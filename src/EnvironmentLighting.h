@@ -0,0 +1,61 @@
+#ifndef ENVIRONMENT_LIGHTING_H
+#define ENVIRONMENT_LIGHTING_H
+
+#include <glad/glad.h>
+#include <string>
+#include <vector>
+#include <glm/glm.hpp>
+#include "ThreadPool.h"
+#include "shaderClass.h"
+
+// Texture unit of the prefiltered environment in the lit shaders
+const GLuint ENVIRONMENT_UNIT = 8;
+
+// Image-based lighting precomputed from a skybox on the CPU: the diffuse
+// irradiance as 9 spherical harmonics coefficients, and a cubemap whose mip
+// levels are the sky blurred for increasing roughness (level 0 sharp, the last
+// level a cosine lobe). Both are cached in a file next to the faces and only
+// recomputed when the face images change.
+class EnvironmentLighting {
+public:
+    static const int BASE_SIZE = 128;  // Face size of mip level 0
+    static const int LEVELS = 4;       // Roughness 0, 1/3, 2/3, 1
+
+    EnvironmentLighting() = default;
+    ~EnvironmentLighting();
+    EnvironmentLighting(const EnvironmentLighting&) = delete;
+    EnvironmentLighting& operator=(const EnvironmentLighting&) = delete;
+
+    // Faces in GL order (+X, -X, +Y, -Y, +Z, -Z). Reads the cache when it
+    // matches the faces, otherwise computes and writes it (force = always).
+    bool load(const std::string faces[6], ThreadPool& pool, bool force = false);
+
+    // GL side: uploads the prefiltered cubemap (needs a context)
+    void upload();
+    // Sets useIbl, irradianceSH, prefilteredEnv (on ENVIRONMENT_UNIT) and
+    // prefilteredMaxLod on a lit shader
+    void bind(Shader& shader) const;
+
+    const glm::vec3* irradiance() const { return sh; }
+    GLuint textureID() const { return texture; }
+    float computeMs = 0.0f;   // Time of the last load, cache read included
+    bool fromCache = false;
+
+private:
+    // Irradiance / pi, convolved with the cosine lobe: shade with albedo * sum(sh[i] * Y_i(n))
+    glm::vec3 sh[9];
+    // levels[l][face] is (BASE_SIZE >> l)^2 RGB texels, rows top to bottom
+    std::vector<float> levels[LEVELS][6];
+    GLuint texture = 0;
+
+    bool readCache(const std::string& path, uint64_t sourceHash);
+    void writeCache(const std::string& path, uint64_t sourceHash) const;
+};
+
+// Cache file of a skybox: environment.ibl in the directory of its first face
+std::string EnvironmentCachePath(const std::string faces[6]);
+
+// Bakes the day, night and Brudslojan skyboxes and reports the times (no GL needed)
+int BakeEnvironments(ThreadPool& pool);
+
+#endif
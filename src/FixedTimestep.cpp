@@ -0,0 +1,28 @@
+#include "FixedTimestep.h"
+#include <algorithm>
+
+FixedTimestep::FixedTimestep(float tickRate, int maxTicksPerFrame)
+    : tickSeconds(1.0f / std::max(tickRate, 1.0f)), maxTicksPerFrame(std::max(maxTicksPerFrame, 1))
+{
+}
+
+int FixedTimestep::advance(float frameSeconds)
+{
+    accumulator += std::max(frameSeconds, 0.0f);
+
+    int ticks = (int)(accumulator / tickSeconds);
+    if (ticks > maxTicksPerFrame) {
+        // Keep the fractional part so interpolation stays smooth after a hitch
+        float excess = (ticks - maxTicksPerFrame) * tickSeconds;
+        droppedSeconds += excess;
+        accumulator -= excess;
+        ticks = maxTicksPerFrame;
+    }
+    accumulator -= ticks * tickSeconds;
+    // Float error can leave the accumulator a hair outside [0, step)
+    accumulator = std::min(std::max(accumulator, 0.0f), tickSeconds);
+
+    tickCount += ticks;
+    lastTicks = ticks;
+    return ticks;
+}
@@ -0,0 +1,35 @@
+#ifndef FIXED_TIMESTEP_H
+#define FIXED_TIMESTEP_H
+
+// Fixed-step simulation scheduler. Real frame time goes into an accumulator
+// and comes out as whole ticks of 1 / tickRate seconds; the remainder is the
+// interpolation factor between the last two simulated states.
+//
+// Spiral-of-death guard: at most maxTicksPerFrame ticks run per frame. When
+// the simulation falls further behind, the extra time is dropped (the game
+// slows down) instead of piling up ever longer catch-up frames.
+class FixedTimestep {
+public:
+    explicit FixedTimestep(float tickRate = 60.0f, int maxTicksPerFrame = 5);
+
+    // Adds a frame's real time, returns the number of ticks to simulate
+    int advance(float frameSeconds);
+
+    // Length of one tick, in seconds
+    float step() const { return tickSeconds; }
+    // Fraction of a tick left in the accumulator (0..1): render at
+    // mix(previous state, current state, alpha())
+    float alpha() const { return accumulator / tickSeconds; }
+
+    // Stats
+    long long tickCount = 0;        // Ticks simulated so far
+    float droppedSeconds = 0.0f;    // Time thrown away by the guard
+    int lastTicks = 0;              // Ticks of the last advance
+
+private:
+    float tickSeconds;
+    int maxTicksPerFrame;
+    float accumulator = 0.0f;
+};
+
+#endif
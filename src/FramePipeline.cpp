@@ -0,0 +1,55 @@
+// FramePipeline.cpp - Triple-buffered render snapshots between the game and render threads
+
+#include "FramePipeline.h"
+#include <chrono>
+#include <utility>
+
+static float MillisecondsSince(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+bool SnapshotBuffer::publish()
+{
+    auto start = std::chrono::steady_clock::now();
+    std::unique_lock<std::mutex> lock(mutex);
+    changed.wait(lock, [this] { return !hasReady || closed; });
+    producerWaitTotal += MillisecondsSince(start);
+    if (closed) return false;
+    std::swap(writeIndex, readyIndex);
+    hasReady = true;
+    changed.notify_all();
+    return true;
+}
+
+const RenderSnapshot* SnapshotBuffer::acquire()
+{
+    auto start = std::chrono::steady_clock::now();
+    std::unique_lock<std::mutex> lock(mutex);
+    changed.wait(lock, [this] { return hasReady || closed; });
+    consumerWaitTotal += MillisecondsSince(start);
+    if (closed) return nullptr;
+    std::swap(readIndex, readyIndex);
+    hasReady = false;
+    changed.notify_all();
+    return &slots[readIndex];
+}
+
+void SnapshotBuffer::close()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    closed = true;
+    changed.notify_all();
+}
+
+float SnapshotBuffer::producerWaitMs()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return producerWaitTotal;
+}
+
+float SnapshotBuffer::consumerWaitMs()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return consumerWaitTotal;
+}
@@ -0,0 +1,76 @@
+#ifndef FRAME_PIPELINE_H
+#define FRAME_PIPELINE_H
+
+#include <condition_variable>
+#include <mutex>
+#include <vector>
+#include <glm/glm.hpp>
+#include "Light.h"
+
+// Everything the renderer needs from the simulation for one frame. Built by
+// the game thread, read-only for the render thread.
+struct RenderSnapshot {
+    long long frame = 0;
+    // glfwGetTime() when the input of this frame was sampled, for the latency stats
+    double inputTime = 0.0;
+    // CPU time the game thread spent producing this snapshot
+    float simMs = 0.0f;
+    // FixedTimestep stats when it was built
+    long long tickCount = 0;
+    float droppedSeconds = 0.0f;
+
+    // Interpolated simulation time, drives the animations
+    float time = 0.0f;
+    glm::vec3 cameraPosition = glm::vec3(0.0f);
+    glm::vec3 cameraOrientation = glm::vec3(0.0f, 0.0f, -1.0f);
+    // Animated light array (positions and colors at `time`)
+    std::vector<Light> lights;
+    // Campfire particle emitter state
+    float campfireScale = 1.0f;
+    glm::vec3 campfirePosition = glm::vec3(0.0f);
+    // Entities moved since the previous snapshot, with their new world matrices
+    // and bounds. Snapshots are never dropped, so applying each in order keeps
+    // the render thread's copy of the transforms current.
+    std::vector<uint32_t> movedEntities;
+    std::vector<glm::mat4> movedMatrices;
+    std::vector<glm::vec3> movedBoundsMin, movedBoundsMax;
+};
+
+// Triple-buffered handoff between the game thread (producer) and the render
+// thread (consumer). The producer fills writeSlot() while the consumer reads
+// the slot it acquired last; the third slot holds the newest published
+// snapshot. publish() waits while the previous snapshot is still unread, so
+// the game thread runs at most one frame ahead of the renderer (bounded
+// latency) and no frame is ever dropped.
+class SnapshotBuffer {
+public:
+    // Slot the producer fills next; never the one being rendered
+    RenderSnapshot& writeSlot() { return slots[writeIndex]; }
+    // Hands writeSlot() over to the consumer. Returns false once closed.
+    bool publish();
+
+    // Consumer: waits for a snapshot newer than the last one. The result stays
+    // valid until the next acquire. nullptr once closed.
+    const RenderSnapshot* acquire();
+
+    // Wakes both sides up for shutdown
+    void close();
+
+    // Stats, safe to read from either thread
+    float producerWaitMs();         // Time the game thread spent blocked in publish, total
+    float consumerWaitMs();         // Time the render thread spent blocked in acquire, total
+
+private:
+    float producerWaitTotal = 0.0f;
+    float consumerWaitTotal = 0.0f;
+    RenderSnapshot slots[3];
+    int writeIndex = 0;
+    int readyIndex = 1;
+    int readIndex = 2;
+    bool hasReady = false;
+    bool closed = false;
+    std::mutex mutex;
+    std::condition_variable changed;
+};
+
+#endif
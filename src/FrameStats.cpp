@@ -0,0 +1,28 @@
+#include "FrameStats.h"
+#include <algorithm>
+#include <cmath>
+
+float Percentile(const std::vector<float>& sorted, float percent)
+{
+    if (sorted.empty()) return 0.0f;
+    int rank = (int)std::ceil(percent / 100.0f * sorted.size()) - 1;
+    rank = std::min(std::max(rank, 0), (int)sorted.size() - 1);
+    return sorted[rank];
+}
+
+FrameTimeSummary SummarizeFrameTimes(std::vector<float> frameMs)
+{
+    FrameTimeSummary summary;
+    if (frameMs.empty()) return summary;
+    std::sort(frameMs.begin(), frameMs.end());
+    double total = 0.0;
+    for (float ms : frameMs) total += ms;
+    summary.count = (int)frameMs.size();
+    summary.average = (float)(total / frameMs.size());
+    summary.minimum = frameMs.front();
+    summary.maximum = frameMs.back();
+    summary.p50 = Percentile(frameMs, 50.0f);
+    summary.p95 = Percentile(frameMs, 95.0f);
+    summary.p99 = Percentile(frameMs, 99.0f);
+    return summary;
+}
@@ -0,0 +1,22 @@
+#ifndef FRAME_STATS_H
+#define FRAME_STATS_H
+
+#include <vector>
+
+// Summary of a series of frame times, in ms
+struct FrameTimeSummary {
+    int count = 0;
+    float average = 0.0f;
+    float minimum = 0.0f;
+    float maximum = 0.0f;
+    float p50 = 0.0f;
+    float p95 = 0.0f;
+    float p99 = 0.0f;
+};
+
+FrameTimeSummary SummarizeFrameTimes(std::vector<float> frameMs);
+
+// Nearest-rank percentile (0..100) of already sorted values
+float Percentile(const std::vector<float>& sorted, float percent);
+
+#endif
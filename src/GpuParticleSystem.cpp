@@ -0,0 +1,127 @@
+// GpuParticleSystem.cpp - Transform feedback particle simulation, ping-ponged between two buffers
+
+#include "GpuParticleSystem.h"
+#include "CpuProfiler.h"
+#include <algorithm>
+#include <iostream>
+#include <random>
+#include <vector>
+
+static const char* const UPDATE_VARYINGS[] = { "outPosition", "outVelocity", "outLife", "outAlpha" };
+
+GpuParticleSystem::GpuParticleSystem(Shader* shader, GLuint textureID, size_t capacity, float rate,
+                                     const ParticleEmitter& config)
+    : emitter(config), shader(shader), textureID(textureID), updateShader("shader/particle_update.vert", UPDATE_VARYINGS, 4),
+      slots(std::max(capacity, (size_t)1))
+{
+    period = std::max(slots / std::max(rate, 1e-6f), emitter.lifetime);
+
+    float quad[] = {
+        -0.5f, -0.5f,
+         0.5f, -0.5f,
+        -0.5f,  0.5f,
+         0.5f,  0.5f
+    };
+    glGenBuffers(1, &quadVBO);
+    glBindBuffer(GL_ARRAY_BUFFER, quadVBO);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(quad), quad, GL_STATIC_DRAW);
+
+    // Steady state: slot i was spawned (i + 0.5) / slots of a period ago
+    std::vector<float> state(slots * FLOATS_PER_PARTICLE);
+    std::mt19937 random(1);
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+    for (size_t i = 0; i < slots; ++i) {
+        float age = period * (i + 0.5f) / slots;
+        glm::vec3 velocity = emitter.velocityMin + (emitter.velocityMax - emitter.velocityMin)
+                           * glm::vec3(unit(random), unit(random), unit(random));
+        glm::vec3 position = emitter.origin + velocity * std::min(age, emitter.lifetime);
+        float life = emitter.lifetime - age;
+        float* p = &state[i * FLOATS_PER_PARTICLE];
+        p[0] = position.x; p[1] = position.y; p[2] = position.z;
+        p[3] = velocity.x; p[4] = velocity.y; p[5] = velocity.z;
+        p[6] = life;
+        p[7] = std::max(life, 0.0f) / emitter.lifetime;
+    }
+
+    const GLsizei stride = FLOATS_PER_PARTICLE * sizeof(float);
+    glGenBuffers(2, stateVBO);
+    glGenVertexArrays(2, updateVAO);
+    glGenVertexArrays(2, drawVAO);
+    for (int b = 0; b < 2; ++b) {
+        glBindBuffer(GL_ARRAY_BUFFER, stateVBO[b]);
+        glBufferData(GL_ARRAY_BUFFER, state.size() * sizeof(float), b == 0 ? state.data() : nullptr, GL_DYNAMIC_COPY);
+
+        // Update: position, velocity and life as vertex attributes
+        glBindVertexArray(updateVAO[b]);
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, stride, (void*)0);
+        glEnableVertexAttribArray(1);
+        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, stride, (void*)(3 * sizeof(float)));
+        glEnableVertexAttribArray(2);
+        glVertexAttribPointer(2, 1, GL_FLOAT, GL_FALSE, stride, (void*)(6 * sizeof(float)));
+
+        // Draw: particle.vert's inputs, x, y, z and alpha per instance; the size is
+        // a constant attribute (set in draw)
+        glBindVertexArray(drawVAO[b]);
+        glBindBuffer(GL_ARRAY_BUFFER, quadVBO);
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(float), (void*)0);
+        glBindBuffer(GL_ARRAY_BUFFER, stateVBO[b]);
+        const GLuint locations[4] = { 1, 2, 3, 5 };
+        const size_t offsets[4] = { 0, 1, 2, 7 };
+        for (int a = 0; a < 4; ++a) {
+            glEnableVertexAttribArray(locations[a]);
+            glVertexAttribPointer(locations[a], 1, GL_FLOAT, GL_FALSE, stride, (void*)(offsets[a] * sizeof(float)));
+            glVertexAttribDivisor(locations[a], 1);
+        }
+    }
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    std::cout << "GpuParticleSystem created with " << slots << " slots, a spawn every " << period << "s per slot" << std::endl;
+}
+
+GpuParticleSystem::~GpuParticleSystem()
+{
+    glDeleteVertexArrays(2, updateVAO);
+    glDeleteVertexArrays(2, drawVAO);
+    glDeleteBuffers(2, stateVBO);
+    glDeleteBuffers(1, &quadVBO);
+    updateShader.Delete();
+}
+
+void GpuParticleSystem::update(float dt)
+{
+    CPU_PROFILE_SCOPE("GpuParticleSystem::update");
+    time += dt;
+    int next = 1 - current;
+
+    updateShader.Activate();
+    glUniform1f(glGetUniformLocation(updateShader.ID, "dt"), dt);
+    glUniform1f(glGetUniformLocation(updateShader.ID, "time"), time);
+    glUniform3fv(glGetUniformLocation(updateShader.ID, "origin"), 1, &emitter.origin[0]);
+    glUniform3fv(glGetUniformLocation(updateShader.ID, "velocityMin"), 1, &emitter.velocityMin[0]);
+    glUniform3fv(glGetUniformLocation(updateShader.ID, "velocityMax"), 1, &emitter.velocityMax[0]);
+    glUniform1f(glGetUniformLocation(updateShader.ID, "lifetime"), emitter.lifetime);
+    glUniform1f(glGetUniformLocation(updateShader.ID, "period"), std::max(period, emitter.lifetime));
+
+    // Read the current buffer, write the other; nothing reaches the rasterizer
+    glEnable(GL_RASTERIZER_DISCARD);
+    glBindVertexArray(updateVAO[current]);
+    glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, stateVBO[next]);
+    glBeginTransformFeedback(GL_POINTS);
+    glDrawArrays(GL_POINTS, 0, (GLsizei)slots);
+    glEndTransformFeedback();
+    glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, 0);
+    glBindVertexArray(0);
+    glDisable(GL_RASTERIZER_DISCARD);
+    current = next;
+}
+
+void GpuParticleSystem::draw(Camera& camera)
+{
+    CPU_PROFILE_SCOPE("GpuParticleSystem::draw");
+    // Every slot is drawn; the dead ones are dropped in particle.vert
+    glVertexAttrib1f(4, emitter.size);
+    DrawParticleBillboards(*shader, textureID, drawVAO[current], (GLsizei)slots, camera);
+}
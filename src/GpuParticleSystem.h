@@ -0,0 +1,58 @@
+#ifndef GPU_PARTICLE_SYSTEM_H
+#define GPU_PARTICLE_SYSTEM_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include "ParticleSystem.h"
+
+// Particle system simulated on the GPU with transform feedback (core GL 3.3).
+//
+// The particles live in two buffers. Each update, particle_update.vert reads
+// one and writes the other (ping-pong), with the rasterizer off. Emission,
+// aging and killing happen in that shader: the system is a fixed pool of
+// `capacity` slots, and a slot respawns at the emitter once per `period`
+// seconds (capacity / rate). A dead slot waits with alpha 0 until then. The
+// CPU only sets a few uniforms and issues one draw per update.
+//
+// Draw uses the same quad, shaders and blending as ParticleSystem, reading the
+// particles straight from the buffer that was written last.
+class GpuParticleSystem {
+public:
+    // Interleaved per particle: position, velocity, life (seconds left, negative
+    // while waiting to respawn), alpha
+    static const int FLOATS_PER_PARTICLE = 8;
+
+    ParticleEmitter emitter;
+
+    // rate is in particles per second; it can't exceed capacity / lifetime.
+    // The slots start in the steady state of `config`, as if it had been
+    // emitting for one period.
+    GpuParticleSystem(Shader* shader, GLuint textureID, size_t capacity, float rate,
+                      const ParticleEmitter& config = ParticleEmitter());
+    ~GpuParticleSystem();
+    GpuParticleSystem(const GpuParticleSystem&) = delete;
+    GpuParticleSystem& operator=(const GpuParticleSystem&) = delete;
+
+    void update(float dt);
+    void draw(Camera& camera);
+
+    size_t capacity() const { return slots; }
+    // The buffer written by the last update (FLOATS_PER_PARTICLE per slot)
+    GLuint stateBuffer() const { return stateVBO[current]; }
+
+private:
+    Shader* shader;
+    GLuint textureID;
+    Shader updateShader;
+    size_t slots;
+    float period;
+    float time = 0.0f;          // Seeds the random velocities
+
+    GLuint quadVBO;
+    GLuint stateVBO[2];
+    GLuint updateVAO[2];        // Reads stateVBO[i] as vertices
+    GLuint drawVAO[2];          // The quad, instanced over stateVBO[i]
+    int current = 0;            // The buffer written last
+};
+
+#endif
@@ -0,0 +1,244 @@
+// GpuProfiler.cpp - Non-blocking timestamp queries per named pass
+
+#include "GpuProfiler.h"
+#include "FrameStats.h"
+#include <algorithm>
+#include <iomanip>
+#include <iostream>
+
+// Bar colors of the top-level scopes, in order of first appearance
+static const int PALETTE_SIZE = 8;
+static const float PALETTE[PALETTE_SIZE][3] = {
+    { 0.90f, 0.30f, 0.25f }, { 0.30f, 0.75f, 0.35f }, { 0.30f, 0.50f, 0.95f }, { 0.95f, 0.80f, 0.25f },
+    { 0.75f, 0.40f, 0.90f }, { 0.25f, 0.85f, 0.85f }, { 0.95f, 0.55f, 0.20f }, { 0.90f, 0.45f, 0.65f },
+};
+static const char* PALETTE_NAMES[PALETTE_SIZE] = { "red", "green", "blue", "yellow", "purple", "cyan", "orange", "pink" };
+
+GpuProfiler::GpuProfiler()
+    : graphShader("shader/profiler_graph.vert", "shader/profiler_graph.frag")
+{
+    // Scope 0 is the whole frame, every pass is below it
+    ScopeInfo frame;
+    frame.path = "frame";
+    frame.depth = 0;
+    frame.parent = -1;
+    scopes.push_back(frame);
+
+    glGenVertexArrays(1, &graphVAO);
+    glGenBuffers(1, &graphVBO);
+    glBindVertexArray(graphVAO);
+    glBindBuffer(GL_ARRAY_BUFFER, graphVBO);
+    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)0);
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)(2 * sizeof(float)));
+    glEnableVertexAttribArray(1);
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+GpuProfiler::~GpuProfiler()
+{
+    for (FrameSlot& slot : slots)
+        if (!slot.queries.empty()) glDeleteQueries((GLsizei)slot.queries.size(), slot.queries.data());
+    glDeleteVertexArrays(1, &graphVAO);
+    glDeleteBuffers(1, &graphVBO);
+    graphShader.Delete();
+}
+
+int GpuProfiler::findScope(const char* name, int parent)
+{
+    std::string path = parent <= 0 ? std::string(name) : scopes[parent].path + "/" + name;
+    for (size_t i = 1; i < scopes.size(); ++i)
+        if (scopes[i].parent == parent && scopes[i].path == path) return (int)i;
+    ScopeInfo scope;
+    scope.path = path;
+    scope.depth = scopes[parent].depth + 1;
+    scope.parent = parent;
+    scopes.push_back(scope);
+    return (int)scopes.size() - 1;
+}
+
+GLuint GpuProfiler::nextQuery(FrameSlot& slot)
+{
+    if (slot.usedQueries == (int)slot.queries.size()) {
+        GLuint query;
+        glGenQueries(1, &query);
+        slot.queries.push_back(query);
+    }
+    return slot.queries[slot.usedQueries++];
+}
+
+void GpuProfiler::beginFrame()
+{
+    if (inFrame) endFrame();
+    currentSlot = (int)(frameIndex % FRAMES_IN_FLIGHT);
+    FrameSlot& slot = slots[currentSlot];
+    if (slot.pending) {
+        // Queries complete in order, so the frame's last one decides
+        GLint available = 0;
+        glGetQueryObjectiv(slot.markers.front().end, GL_QUERY_RESULT_AVAILABLE, &available);
+        if (available) collect(slot);
+        else droppedFrames++;
+        slot.pending = false;
+    }
+    slot.usedQueries = 0;
+    slot.markers.clear();
+    slot.frame = frameIndex;
+    inFrame = true;
+
+    Marker frame = { 0, nextQuery(slot), 0 };
+    glQueryCounter(frame.start, GL_TIMESTAMP);
+    slot.markers.push_back(frame);
+    stack.assign(1, 0);
+}
+
+void GpuProfiler::endFrame()
+{
+    if (!inFrame) return;
+    while (!stack.empty()) pop();
+    slots[currentSlot].pending = true;
+    inFrame = false;
+    frameIndex++;
+}
+
+void GpuProfiler::push(const char* name)
+{
+    if (!inFrame) return;
+    FrameSlot& slot = slots[currentSlot];
+    Marker marker = { findScope(name, slot.markers[stack.back()].scope), nextQuery(slot), 0 };
+    glQueryCounter(marker.start, GL_TIMESTAMP);
+    stack.push_back((int)slot.markers.size());
+    slot.markers.push_back(marker);
+}
+
+void GpuProfiler::pop()
+{
+    if (!inFrame || stack.empty()) return;
+    FrameSlot& slot = slots[currentSlot];
+    Marker& marker = slot.markers[stack.back()];
+    marker.end = nextQuery(slot);
+    glQueryCounter(marker.end, GL_TIMESTAMP);
+    stack.pop_back();
+}
+
+void GpuProfiler::collect(FrameSlot& slot)
+{
+    // A scope can run several times per frame (one per light, per view...): its time is the sum
+    std::vector<float> frameMs(scopes.size(), -1.0f);
+    for (const Marker& marker : slot.markers) {
+        GLuint64 start = 0, end = 0;
+        glGetQueryObjectui64v(marker.start, GL_QUERY_RESULT, &start);
+        glGetQueryObjectui64v(marker.end, GL_QUERY_RESULT, &end);
+        float ms = end > start ? (float)((end - start) / 1.0e6) : 0.0f;
+        frameMs[marker.scope] = std::max(frameMs[marker.scope], 0.0f) + ms;
+    }
+
+    GraphColumn column;
+    column.total = frameMs[0];
+    for (size_t i = 0; i < scopes.size(); ++i) {
+        if (frameMs[i] < 0.0f) continue;
+        ScopeInfo& scope = scopes[i];
+        if ((int)scope.history.size() < HISTORY_FRAMES) scope.history.push_back(frameMs[i]);
+        else scope.history[scope.next] = frameMs[i];
+        scope.next = (scope.next + 1) % HISTORY_FRAMES;
+        if (scope.depth == 1) column.passes.push_back(std::make_pair((int)i, frameMs[i]));
+        if (csv.is_open())
+            csv << slot.frame << "," << scope.path << "," << scope.depth << "," << frameMs[i] << "\n";
+    }
+    graphColumns.push_back(column);
+    if ((int)graphColumns.size() > GRAPH_FRAMES) graphColumns.pop_front();
+    completed++;
+}
+
+bool GpuProfiler::openCsv(const char* path)
+{
+    csv.open(path);
+    if (!csv.is_open()) {
+        std::cout << "ERROR: cannot write GPU profile to " << path << std::endl;
+        return false;
+    }
+    csv << "frame,scope,depth,ms\n";
+    return true;
+}
+
+void GpuProfiler::report() const
+{
+    std::cout << "[gpu] " << completed << " frames, " << droppedFrames << " dropped (ms: avg p50 p95 min max)" << std::endl;
+    int color = 0;
+    for (const ScopeInfo& scope : scopes) {
+        if (scope.history.empty()) continue;
+        FrameTimeSummary summary = SummarizeFrameTimes(scope.history);
+        std::cout << "[gpu] " << std::string(scope.depth * 2, ' ') << std::left << std::setw(24 - scope.depth * 2)
+                  << scope.path.substr(scope.path.find_last_of('/') + 1) << std::right << std::fixed << std::setprecision(3)
+                  << std::setw(9) << summary.average << std::setw(9) << summary.p50 << std::setw(9) << summary.p95
+                  << std::setw(9) << summary.minimum << std::setw(9) << summary.maximum;
+        if (scope.depth == 1) std::cout << "  " << PALETTE_NAMES[color++ % PALETTE_SIZE];
+        std::cout << std::defaultfloat << std::setprecision(6) << std::endl;
+    }
+}
+
+void GpuProfiler::drawGraph(int viewportWidth, int viewportHeight)
+{
+    // Quarter of the screen height, a third of its width, bottom right
+    int graphWidth = viewportWidth / 3;
+    int graphHeight = viewportHeight / 4;
+    float column = (float)graphWidth / GRAPH_FRAMES;
+    // Grows to fit the slowest recent frame
+    float scaleMs = graphScaleMs;
+    for (const GraphColumn& frame : graphColumns) scaleMs = std::max(scaleMs, frame.total);
+    float pixelsPerMs = graphHeight / scaleMs;
+
+    std::vector<float> vertices;
+    auto quad = [&](float x0, float y0, float x1, float y1, const float* color) {
+        const float corners[6][2] = { { x0, y0 }, { x1, y0 }, { x1, y1 }, { x0, y0 }, { x1, y1 }, { x0, y1 } };
+        for (const auto& corner : corners) {
+            vertices.insert(vertices.end(), { corner[0], corner[1], color[0], color[1], color[2] });
+        }
+    };
+    const float background[3] = { 0.05f, 0.05f, 0.05f };
+    const float untracked[3] = { 0.45f, 0.45f, 0.45f };
+    const float budget[3] = { 1.0f, 1.0f, 1.0f };
+    quad(0.0f, 0.0f, (float)graphWidth, (float)graphHeight, background);
+
+    // Palette slot of each top-level scope, in scope order like the report
+    std::vector<int> colorOf(scopes.size(), 0);
+    int color = 0;
+    for (size_t i = 0; i < scopes.size(); ++i)
+        if (scopes[i].depth == 1) colorOf[i] = color++ % PALETTE_SIZE;
+
+    float x = graphWidth - column * graphColumns.size();
+    for (const GraphColumn& frame : graphColumns) {
+        float y = 0.0f;
+        for (const auto& pass : frame.passes) {
+            float top = std::min(y + pass.second * pixelsPerMs, (float)graphHeight);
+            quad(x, y, x + column, top, PALETTE[colorOf[pass.first]]);
+            y = top;
+        }
+        // Frame time not covered by any scope
+        float top = std::min(frame.total * pixelsPerMs, (float)graphHeight);
+        if (top > y) quad(x, y, x + column, top, untracked);
+        x += column;
+    }
+    // 16.7 ms line
+    float line = 1000.0f / 60.0f * pixelsPerMs;
+    quad(0.0f, line, (float)graphWidth, line + 1.0f, budget);
+
+    GLboolean blendWasEnabled = glIsEnabled(GL_BLEND);
+    glViewport(viewportWidth - graphWidth, 0, graphWidth, graphHeight);
+    glDisable(GL_DEPTH_TEST);
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+    graphShader.Activate();
+    glUniform2f(glGetUniformLocation(graphShader.ID, "overlaySize"), (float)graphWidth, (float)graphHeight);
+    glBindVertexArray(graphVAO);
+    glBindBuffer(GL_ARRAY_BUFFER, graphVBO);
+    glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(float), vertices.data(), GL_STREAM_DRAW);
+    glDrawArrays(GL_TRIANGLES, 0, (GLsizei)(vertices.size() / 5));
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    if (!blendWasEnabled) glDisable(GL_BLEND);
+    glEnable(GL_DEPTH_TEST);
+    glViewport(0, 0, viewportWidth, viewportHeight);
+}
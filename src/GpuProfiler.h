@@ -0,0 +1,106 @@
+#ifndef GPU_PROFILER_H
+#define GPU_PROFILER_H
+
+#include <deque>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <glad/glad.h>
+#include "shaderClass.h"
+
+// GPU time per named pass. Scopes nest (a scope's name is its path, e.g.
+// "opaque/trees") and are measured with pairs of GL_TIMESTAMP queries, which
+// unlike GL_TIME_ELAPSED can nest and overlap the other timer queries.
+// Queries of FRAMES_IN_FLIGHT frames are in flight; a frame is read back when
+// its slot comes round again, and dropped if the GPU still isn't done with it,
+// so the profiler never stalls.
+//
+// Keeps the last HISTORY_FRAMES samples of every scope for the report
+// (average, min/max, percentiles), optionally writes every frame to a CSV
+// file and draws the top-level scopes of recent frames as a stacked bar graph.
+class GpuProfiler {
+public:
+    static const int FRAMES_IN_FLIGHT = 3;
+    static const int HISTORY_FRAMES = 240;
+    static const int GRAPH_FRAMES = 120;
+
+    // Height of the bar graph in ms, unless a recent frame took longer
+    float graphScaleMs = 33.3f;
+
+    GpuProfiler();
+    ~GpuProfiler();
+
+    GpuProfiler(const GpuProfiler&) = delete;
+    GpuProfiler& operator=(const GpuProfiler&) = delete;
+
+    void beginFrame();
+    void endFrame();
+
+    void push(const char* name);
+    void pop();
+
+    // RAII scope; does nothing with a null profiler
+    class Scope {
+    public:
+        Scope(GpuProfiler* profiler, const char* name) : profiler(profiler) { if (profiler) profiler->push(name); }
+        ~Scope() { if (profiler) profiler->pop(); }
+    private:
+        GpuProfiler* profiler;
+    };
+
+    // Writes "frame,scope,depth,ms" rows for every frame read back from now on
+    bool openCsv(const char* path);
+    // Table of every scope over the last HISTORY_FRAMES frames
+    void report() const;
+    // Bar graph in the bottom-right corner, one column per frame
+    void drawGraph(int viewportWidth, int viewportHeight);
+
+    long long completedFrames() const { return completed; }
+    int droppedFrames = 0; // Read back too late, skipped
+
+private:
+    struct ScopeInfo {
+        std::string path;
+        int depth;
+        int parent;
+        std::vector<float> history;   // Ring buffer of the last HISTORY_FRAMES samples
+        int next = 0;
+    };
+    std::vector<ScopeInfo> scopes;
+
+    struct Marker {
+        int scope;
+        GLuint start, end;
+    };
+    struct FrameSlot {
+        std::vector<GLuint> queries;  // Pool, grows as needed
+        std::vector<Marker> markers;
+        int usedQueries = 0;
+        long long frame = -1;
+        bool pending = false;
+    };
+    FrameSlot slots[FRAMES_IN_FLIGHT];
+    int currentSlot = 0;
+    long long frameIndex = 0;
+    long long completed = 0;
+    std::vector<int> stack;          // Open scopes, indices into the slot's markers
+    bool inFrame = false;
+
+    // Frame time and top-level scope times of recent frames, for the graph
+    struct GraphColumn {
+        float total;
+        std::vector<std::pair<int, float>> passes;
+    };
+    std::deque<GraphColumn> graphColumns;
+
+    std::ofstream csv;
+
+    Shader graphShader;
+    GLuint graphVAO, graphVBO;
+
+    int findScope(const char* name, int parent);
+    GLuint nextQuery(FrameSlot& slot);
+    void collect(FrameSlot& slot);
+};
+
+#endif
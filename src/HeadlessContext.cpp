@@ -0,0 +1,112 @@
+// HeadlessContext.cpp - Windowless OpenGL context through EGL
+
+#include "HeadlessContext.h"
+#include <glad/glad.h>
+#include <iostream>
+
+#ifdef HAVE_EGL
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#include <cstring>
+
+bool HeadlessContext::supported() { return true; }
+
+static bool HasExtension(const char* extensions, const char* name)
+{
+    return extensions && std::strstr(extensions, name) != nullptr;
+}
+
+bool HeadlessContext::create()
+{
+    EGLDisplay eglDisplay = EGL_NO_DISPLAY;
+    bool surfaceless = false;
+
+    // Surfaceless platform first: needs no X server, no GPU device node
+    const char* clientExtensions = eglQueryString(EGL_NO_DISPLAY, EGL_EXTENSIONS);
+    if (HasExtension(clientExtensions, "EGL_MESA_platform_surfaceless")) {
+        auto getPlatformDisplay = (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+        if (getPlatformDisplay) {
+            eglDisplay = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+            surfaceless = eglDisplay != EGL_NO_DISPLAY && eglInitialize(eglDisplay, nullptr, nullptr);
+            if (!surfaceless) eglDisplay = EGL_NO_DISPLAY;
+        }
+    }
+    if (eglDisplay == EGL_NO_DISPLAY) {
+        eglDisplay = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+        if (eglDisplay == EGL_NO_DISPLAY || !eglInitialize(eglDisplay, nullptr, nullptr)) {
+            std::cout << "ERROR: no EGL display available" << std::endl;
+            return false;
+        }
+    }
+    display = eglDisplay;
+
+    if (!eglBindAPI(EGL_OPENGL_API)) {
+        std::cout << "ERROR: EGL has no desktop OpenGL support" << std::endl;
+        return false;
+    }
+
+    EGLConfig config = nullptr;
+    if (!surfaceless) {
+        const EGLint configAttributes[] = {
+            EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+            EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+            EGL_RED_SIZE, 8, EGL_GREEN_SIZE, 8, EGL_BLUE_SIZE, 8,
+            EGL_NONE
+        };
+        EGLint configCount = 0;
+        if (!eglChooseConfig(eglDisplay, configAttributes, &config, 1, &configCount) || configCount == 0) {
+            std::cout << "ERROR: no EGL pbuffer config" << std::endl;
+            return false;
+        }
+        const EGLint pbufferAttributes[] = { EGL_WIDTH, 1, EGL_HEIGHT, 1, EGL_NONE };
+        surface = eglCreatePbufferSurface(eglDisplay, config, pbufferAttributes);
+    }
+
+    const EGLint contextAttributes[] = {
+        EGL_CONTEXT_MAJOR_VERSION, 3,
+        EGL_CONTEXT_MINOR_VERSION, 3,
+        EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+        EGL_NONE
+    };
+    context = eglCreateContext(eglDisplay, config, EGL_NO_CONTEXT, contextAttributes);
+    if (context == EGL_NO_CONTEXT) {
+        context = nullptr;
+        std::cout << "ERROR: could not create an OpenGL 3.3 core context through EGL" << std::endl;
+        return false;
+    }
+    EGLSurface eglSurface = surface ? (EGLSurface)surface : EGL_NO_SURFACE;
+    if (!eglMakeCurrent(eglDisplay, eglSurface, eglSurface, (EGLContext)context)) {
+        std::cout << "ERROR: could not make the EGL context current" << std::endl;
+        return false;
+    }
+    if (!gladLoadGLLoader((GLADloadproc)eglGetProcAddress)) {
+        std::cout << "Failed to initialize GLAD" << std::endl;
+        return false;
+    }
+    std::cout << "Headless context: " << (surfaceless ? "EGL surfaceless" : "EGL pbuffer") << ", "
+              << glGetString(GL_RENDERER) << std::endl;
+    return true;
+}
+
+HeadlessContext::~HeadlessContext()
+{
+    if (!display) return;
+    eglMakeCurrent((EGLDisplay)display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+    if (context) eglDestroyContext((EGLDisplay)display, (EGLContext)context);
+    if (surface) eglDestroySurface((EGLDisplay)display, (EGLSurface)surface);
+    eglTerminate((EGLDisplay)display);
+}
+
+#else
+
+bool HeadlessContext::supported() { return false; }
+
+bool HeadlessContext::create()
+{
+    std::cout << "ERROR: built without EGL, headless mode is not available" << std::endl;
+    return false;
+}
+
+HeadlessContext::~HeadlessContext() {}
+
+#endif
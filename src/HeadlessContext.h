@@ -0,0 +1,30 @@
+#ifndef HEADLESS_CONTEXT_H
+#define HEADLESS_CONTEXT_H
+
+// OpenGL 3.3 core context with no window and no display server, through EGL:
+// the Mesa surfaceless platform when available (GPU-less machines with a
+// software driver), otherwise the default display with a 1x1 pbuffer. The
+// caller renders into its own framebuffer objects.
+//
+// Only built with EGL (HAVE_EGL, see CMakeLists.txt); create() fails otherwise.
+class HeadlessContext {
+public:
+    HeadlessContext() = default;
+    ~HeadlessContext();
+
+    HeadlessContext(const HeadlessContext&) = delete;
+    HeadlessContext& operator=(const HeadlessContext&) = delete;
+
+    // Creates the context, makes it current and loads GLAD
+    bool create();
+
+    static bool supported();
+
+private:
+    // EGLDisplay / EGLContext / EGLSurface, kept opaque so users don't need the EGL headers
+    void* display = nullptr;
+    void* context = nullptr;
+    void* surface = nullptr;
+};
+
+#endif
@@ -0,0 +1,89 @@
+// HeadlessRun.cpp - Fixed-length offscreen runs with frame-time statistics
+
+#include "HeadlessRun.h"
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <vector>
+#include "FrameStats.h"
+#include "UpscaleComparison.h"
+
+bool WriteFramebufferPPM(const char* path, int width, int height)
+{
+    std::vector<unsigned char> pixels((size_t)width * height * 3);
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glReadPixels(0, 0, width, height, GL_RGB, GL_UNSIGNED_BYTE, pixels.data());
+    FILE* file = std::fopen(path, "wb");
+    if (!file) return false;
+    std::fprintf(file, "P6\n%d %d\n255\n", width, height);
+    // OpenGL rows go bottom-up, PPM rows top-down
+    for (int y = height - 1; y >= 0; --y) std::fwrite(&pixels[(size_t)y * width * 3], 1, (size_t)width * 3, file);
+    std::fclose(file);
+    return true;
+}
+
+int RunHeadless(const Options& options, int width, int height, Camera& camera,
+                const std::function<void(float)>& simulate,
+                const std::function<void(DynamicResolution*, GLuint)>& renderScene,
+                DynamicResolution* upscaler)
+{
+    // Stands in for the window's default framebuffer
+    GLuint framebuffer, colorBuffer, depthBuffer;
+    glGenRenderbuffers(1, &colorBuffer);
+    glBindRenderbuffer(GL_RENDERBUFFER, colorBuffer);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+    glGenRenderbuffers(1, &depthBuffer);
+    glBindRenderbuffer(GL_RENDERBUFFER, depthBuffer);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, width, height);
+    glBindRenderbuffer(GL_RENDERBUFFER, 0);
+    glGenFramebuffers(1, &framebuffer);
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, colorBuffer);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, depthBuffer);
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+        std::cout << "ERROR: headless framebuffer is incomplete" << std::endl;
+        return 1;
+    }
+
+    std::cout << "Headless run: " << options.headlessFrames << " frames at " << width << "x" << height
+              << (options.staticCamera ? ", static camera" : ", orbit camera path") << std::endl;
+
+    const float deltaTime = 1.0f / 60.0f;
+    std::vector<float> frameMs;
+    frameMs.reserve(options.headlessFrames);
+    for (int frame = 0; frame < options.headlessFrames; ++frame) {
+        auto start = std::chrono::steady_clock::now();
+        simulate(deltaTime);
+        if (!options.staticCamera) OrbitCameraPath(camera, frame * deltaTime);
+        renderScene(upscaler, framebuffer);
+        glFinish();
+        frameMs.push_back(std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count());
+    }
+
+    FrameTimeSummary summary = SummarizeFrameTimes(frameMs);
+    std::cout << "[headless] frames=" << summary.count
+              << " avg=" << summary.average << "ms"
+              << " min=" << summary.minimum << "ms"
+              << " p50=" << summary.p50 << "ms"
+              << " p95=" << summary.p95 << "ms"
+              << " p99=" << summary.p99 << "ms"
+              << " max=" << summary.maximum << "ms"
+              << " fps=" << (summary.average > 0.0f ? 1000.0f / summary.average : 0.0f) << std::endl;
+
+    int result = 0;
+    if (!options.capturePath.empty()) {
+        glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+        if (WriteFramebufferPPM(options.capturePath.c_str(), width, height)) {
+            std::cout << "Saved the last frame to " << options.capturePath << std::endl;
+        } else {
+            std::cout << "ERROR: could not write " << options.capturePath << std::endl;
+            result = 1;
+        }
+    }
+
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glDeleteFramebuffers(1, &framebuffer);
+    glDeleteRenderbuffers(1, &colorBuffer);
+    glDeleteRenderbuffers(1, &depthBuffer);
+    return result;
+}
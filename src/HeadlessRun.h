@@ -0,0 +1,24 @@
+#ifndef HEADLESS_RUN_H
+#define HEADLESS_RUN_H
+
+#include <functional>
+#include <glad/glad.h>
+#include "Camera.h"
+#include "Options.h"
+#include "DynamicResolution.h"
+
+// Headless benchmark (--headless <frames>): renders options.headlessFrames
+// frames into an offscreen framebuffer of width x height with a fixed 1/60 s
+// time step, the camera on OrbitCameraPath unless options.staticCamera. Each
+// frame is finished (glFinish) before the next, so the frame times include the
+// GPU. Prints frame-time statistics, optionally saves the last frame
+// (options.capturePath, binary PPM), and returns the process exit code.
+int RunHeadless(const Options& options, int width, int height, Camera& camera,
+                const std::function<void(float)>& simulate,
+                const std::function<void(DynamicResolution*, GLuint)>& renderScene,
+                DynamicResolution* upscaler);
+
+// Writes the color buffer of the bound read framebuffer as a binary PPM
+bool WriteFramebufferPPM(const char* path, int width, int height);
+
+#endif
@@ -0,0 +1,111 @@
+// Input.cpp - Device sampling and binary input recordings
+
+#include "Input.h"
+#include <cstring>
+#include <iostream>
+
+static const char INPUT_MAGIC[8] = { 'I', 'N', 'P', 'U', 'T', 'R', 'E', 'C' };
+static const uint32_t INPUT_VERSION = 1;
+// seconds, buttons, lookX, lookY
+static const uint32_t INPUT_FRAME_BYTES = 4 + 1 + 4 + 4;
+
+InputState InputDevice::sample(GLFWwindow* window, int width, int height)
+{
+    InputState input;
+    const struct { int key; InputState::Button button; } keys[] = {
+        { GLFW_KEY_W, InputState::Forward }, { GLFW_KEY_S, InputState::Back },
+        { GLFW_KEY_A, InputState::Left }, { GLFW_KEY_D, InputState::Right },
+        { GLFW_KEY_SPACE, InputState::Jump }, { GLFW_KEY_LEFT_SHIFT, InputState::Sprint },
+    };
+    for (const auto& key : keys)
+        if (glfwGetKey(window, key.key) == GLFW_PRESS) input.buttons |= key.button;
+
+    if (glfwGetMouseButton(window, GLFW_MOUSE_BUTTON_LEFT) == GLFW_PRESS) {
+        input.buttons |= InputState::Look;
+        // Hides mouse cursor
+        glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_HIDDEN);
+        // Prevents camera from jumping on the first click
+        if (firstClick) {
+            glfwSetCursorPos(window, (width / 2), (height / 2));
+            firstClick = false;
+        }
+        double mouseX, mouseY;
+        glfwGetCursorPos(window, &mouseX, &mouseY);
+        input.lookX = (float)(mouseX - (width / 2)) / width;
+        input.lookY = (float)(mouseY - (height / 2)) / height;
+        // Sets mouse cursor to the middle of the screen so that it doesn't end up roaming around
+        glfwSetCursorPos(window, (width / 2), (height / 2));
+    }
+    else {
+        // Unhides cursor since camera is not looking around anymore
+        glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_NORMAL);
+        // Makes sure the next time the camera looks around it doesn't jump
+        firstClick = true;
+    }
+    return input;
+}
+
+bool InputRecorder::open(const char* path)
+{
+    out.open(path, std::ios::binary);
+    if (!out) {
+        std::cout << "ERROR: cannot write input recording " << path << std::endl;
+        return false;
+    }
+    out.write(INPUT_MAGIC, sizeof(INPUT_MAGIC));
+    out.write((const char*)&INPUT_VERSION, sizeof(INPUT_VERSION));
+    out.write((const char*)&INPUT_FRAME_BYTES, sizeof(INPUT_FRAME_BYTES));
+    return true;
+}
+
+void InputRecorder::write(float frameSeconds, const InputState& input)
+{
+    if (!out.is_open()) return;
+    out.write((const char*)&frameSeconds, sizeof(frameSeconds));
+    out.write((const char*)&input.buttons, sizeof(input.buttons));
+    out.write((const char*)&input.lookX, sizeof(input.lookX));
+    out.write((const char*)&input.lookY, sizeof(input.lookY));
+    frames++;
+}
+
+void InputRecorder::close()
+{
+    if (out.is_open()) out.close();
+}
+
+bool InputReplay::load(const char* path)
+{
+    std::ifstream in(path, std::ios::binary);
+    if (!in) {
+        std::cout << "ERROR: cannot open input recording " << path << std::endl;
+        return false;
+    }
+    char magic[sizeof(INPUT_MAGIC)];
+    uint32_t version = 0, frameBytes = 0;
+    in.read(magic, sizeof(magic));
+    in.read((char*)&version, sizeof(version));
+    in.read((char*)&frameBytes, sizeof(frameBytes));
+    if (!in || std::memcmp(magic, INPUT_MAGIC, sizeof(magic)) != 0 || version != INPUT_VERSION || frameBytes != INPUT_FRAME_BYTES) {
+        std::cout << "ERROR: " << path << " is not a version " << INPUT_VERSION << " input recording" << std::endl;
+        return false;
+    }
+    frames.clear();
+    position = 0;
+    Frame frame;
+    while (in.read((char*)&frame.seconds, sizeof(frame.seconds))
+           && in.read((char*)&frame.input.buttons, sizeof(frame.input.buttons))
+           && in.read((char*)&frame.input.lookX, sizeof(frame.input.lookX))
+           && in.read((char*)&frame.input.lookY, sizeof(frame.input.lookY))) {
+        frames.push_back(frame);
+    }
+    return true;
+}
+
+bool InputReplay::next(float& frameSeconds, InputState& input)
+{
+    if (finished()) return false;
+    frameSeconds = frames[position].seconds;
+    input = frames[position].input;
+    position++;
+    return true;
+}
@@ -0,0 +1,72 @@
+#ifndef INPUT_H
+#define INPUT_H
+
+#include <cstdint>
+#include <fstream>
+#include <vector>
+#include <GLFW/glfw3.h>
+
+// Player input of one frame. Player and Camera only read this struct, so the
+// same code runs on live devices, on a replayed recording or without a window.
+struct InputState {
+    enum Button : uint8_t {
+        Forward = 1 << 0,   // W
+        Back    = 1 << 1,   // S
+        Left    = 1 << 2,   // A
+        Right   = 1 << 3,   // D
+        Jump    = 1 << 4,   // Space
+        Sprint  = 1 << 5,   // Left shift
+        Look    = 1 << 6,   // Left mouse button held: mouse look
+    };
+    uint8_t buttons = 0;
+    // Mouse movement this frame while looking, as a fraction of the window size
+    float lookX = 0.0f;
+    float lookY = 0.0f;
+
+    bool down(Button button) const { return (buttons & button) != 0; }
+};
+
+// Reads the keyboard and mouse once per frame. Owns the cursor handling of
+// mouse look: hidden and re-centered while the left button is held.
+class InputDevice {
+public:
+    InputState sample(GLFWwindow* window, int width, int height);
+
+private:
+    // Prevents the camera from jumping around when first clicking left click
+    bool firstClick = true;
+};
+
+// Binary input log: a header, then per frame the real frame time (so replays
+// advance the fixed timestep identically) and the InputState.
+class InputRecorder {
+public:
+    bool open(const char* path);
+    void write(float frameSeconds, const InputState& input);
+    void close();
+    bool isOpen() const { return out.is_open(); }
+    long long frames = 0;
+
+private:
+    std::ofstream out;
+};
+
+class InputReplay {
+public:
+    struct Frame {
+        float seconds;
+        InputState input;
+    };
+
+    bool load(const char* path);
+    // Next recorded frame; false once the recording is over
+    bool next(float& frameSeconds, InputState& input);
+    bool finished() const { return position >= frames.size(); }
+    size_t frameCount() const { return frames.size(); }
+
+private:
+    std::vector<Frame> frames;
+    size_t position = 0;
+};
+
+#endif
@@ -1,5 +1,7 @@
 #include "Light.h"
 #include <glm/gtc/type_ptr.hpp>
+#include <algorithm>
+#include <cmath>
 
 Light::Light(int type, const glm::vec3& pos, const glm::vec3& dir, const glm::vec4& color, Model* mesh)
     : type(type), position(pos), direction(dir), color(color), mesh(mesh) {}
@@ -12,6 +14,27 @@ void Light::sendToShader( Shader& shader, int index) const {
     glUniform3fv(glGetUniformLocation(shader.ID, ("lights[" + number + "].direction").c_str()), 1, glm::value_ptr(direction));
     glUniform4fv(glGetUniformLocation(shader.ID, ("lights[" + number + "].color").c_str()), 1, glm::value_ptr(color));
     glUniform1i(glGetUniformLocation(shader.ID, ("lights[" + number + "].type").c_str()), type);
+    glUniform1i(glGetUniformLocation(shader.ID, ("lights[" + number + "].shadowIndex").c_str()), shadowIndex);
+}
+
+float Light::peakContribution() const {
+    // Matches default.frag: (ambient 0.2 + diffuse 1.0 + specular 0.5) * color * 2.0,
+    // with directional lights scaled down to 0.3
+    float peak = 1.7f * 2.0f * std::max(color.r, std::max(color.g, color.b));
+    return type == 0 ? peak * 0.3f : peak;
+}
+
+float Light::influenceRadius(float threshold) const {
+    if (type == 0) return -1.0f;
+
+    float peak = peakContribution();
+    if (peak <= threshold) return 0.0f;
+
+    // Solve peak / (c + l*d + q*d^2) = threshold for d
+    float a = LIGHT_ATTENUATION_QUADRATIC;
+    float b = LIGHT_ATTENUATION_LINEAR;
+    float c = LIGHT_ATTENUATION_CONSTANT - peak / threshold;
+    return (-b + std::sqrt(b * b - 4.0f * a * c)) / (2.0f * a);
 }
 
 void Light::drawMesh( Shader& shader, Camera& camera,const glm::mat4& modelMatrix) const {
@@ -20,3 +43,9 @@ void Light::drawMesh( Shader& shader, Camera& camera,const glm::mat4& modelMatri
         mesh->Draw(shader, camera, modelMatrix);
     }
 }
+
+void SetSpotConeUniforms(Shader& shader) {
+    shader.Activate();
+    glUniform1f(glGetUniformLocation(shader.ID, "spotOuterCos"), SPOT_OUTER_COS);
+    glUniform1f(glGetUniformLocation(shader.ID, "spotInnerCos"), SPOT_INNER_COS);
+}
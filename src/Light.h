@@ -4,17 +4,46 @@
 #include "model.h"
 #include "shaderClass.h"
 
+// Attenuation constants used by the lit shaders (1 / (c + l*d + q*d^2)).
+// Keep in sync with shader/default.frag.
+const float LIGHT_ATTENUATION_CONSTANT = 1.0f;
+const float LIGHT_ATTENUATION_LINEAR = 0.2f;
+const float LIGHT_ATTENUATION_QUADRATIC = 0.032f;
+
+// Size of the lights[] uniform array (MAX_LIGHTS in shader/default.frag)
+const int MAX_SHADER_LIGHTS = 10;
+
+// Cosines of the spot light cone: full light inside the inner cone, none
+// outside the outer one. The shadow frustum and the light culling use the outer
+// cone; the shaders get both from SetSpotConeUniforms (spotIntensity in
+// shader/lighting.glsl).
+const float SPOT_OUTER_COS = 0.7f;
+const float SPOT_INNER_COS = 0.85f;
+
 class Light {
 public:
     glm::vec3 position;
     glm::vec3 direction;
     glm::vec4 color;
     int type; // 0 = Directional, 1 = Point, 2 = Spot
+    // First view of the light in the ShadowAtlas, -1 = casts no shadows
+    int shadowIndex = -1;
 
     Model* mesh; // Mesh associé à la lumière (peut être nullptr)
 
     Light(int type, const glm::vec3& pos, const glm::vec3& dir, const glm::vec4& color, Model* mesh = nullptr);
 
     void sendToShader( Shader& shader, int index) const;
+
+    // Brightest contribution the light can add to a fragment before attenuation
+    float peakContribution() const;
+
+    // Distance past which the light contributes less than `threshold` to any
+    // fragment. Directional lights have no limit and return a negative value.
+    float influenceRadius(float threshold) const;
     void drawMesh( Shader& shader,Camera& camera, const glm::mat4& modelMatrix) const;
 };
+
+// Sets spotOuterCos and spotInnerCos in a shader that includes lighting.glsl.
+// Uniforms keep their value, so once after the shader is built is enough.
+void SetSpotConeUniforms(Shader& shader);
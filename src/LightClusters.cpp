@@ -0,0 +1,247 @@
+// LightClusters.cpp - CPU light binning for clustered forward shading
+// Clusters are froxels: 16x9 screen tiles times 24 exponential depth slices.
+
+#include "LightClusters.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <glm/gtc/type_ptr.hpp>
+
+LightClusters::LightClusters(ThreadPool& pool) : pool(pool)
+{
+    glGenBuffers(1, &lightBuffer);
+    glGenBuffers(1, &gridBuffer);
+    glGenBuffers(1, &indexBuffer);
+    glGenTextures(1, &lightTexture);
+    glGenTextures(1, &gridTexture);
+    glGenTextures(1, &indexTexture);
+
+    // Allocate something so the textures are valid before the first update
+    glm::vec4 emptyLight(0.0f);
+    GLuint emptyIndex[2] = { 0, 0 };
+    glBindBuffer(GL_TEXTURE_BUFFER, lightBuffer);
+    glBufferData(GL_TEXTURE_BUFFER, sizeof(emptyLight), &emptyLight, GL_STREAM_DRAW);
+    glBindBuffer(GL_TEXTURE_BUFFER, gridBuffer);
+    glBufferData(GL_TEXTURE_BUFFER, sizeof(emptyIndex), emptyIndex, GL_STREAM_DRAW);
+    glBindBuffer(GL_TEXTURE_BUFFER, indexBuffer);
+    glBufferData(GL_TEXTURE_BUFFER, sizeof(emptyIndex), emptyIndex, GL_STREAM_DRAW);
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
+
+    // The texture keeps pointing at the buffer even when its storage is reallocated
+    glBindTexture(GL_TEXTURE_BUFFER, lightTexture);
+    glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, lightBuffer);
+    glBindTexture(GL_TEXTURE_BUFFER, gridTexture);
+    glTexBuffer(GL_TEXTURE_BUFFER, GL_RG32UI, gridBuffer);
+    glBindTexture(GL_TEXTURE_BUFFER, indexTexture);
+    glTexBuffer(GL_TEXTURE_BUFFER, GL_R32UI, indexBuffer);
+    glBindTexture(GL_TEXTURE_BUFFER, 0);
+
+    minX.resize(CLUSTER_COUNT); minY.resize(CLUSTER_COUNT); minZ.resize(CLUSTER_COUNT);
+    maxX.resize(CLUSTER_COUNT); maxY.resize(CLUSTER_COUNT); maxZ.resize(CLUSTER_COUNT);
+    clusterCounts.resize(CLUSTER_COUNT);
+    clusterSlots.resize((size_t)CLUSTER_COUNT * MAX_LIGHTS_PER_CLUSTER);
+    grid.resize(CLUSTER_COUNT * 2);
+}
+
+LightClusters::~LightClusters()
+{
+    glDeleteTextures(1, &lightTexture);
+    glDeleteTextures(1, &gridTexture);
+    glDeleteTextures(1, &indexTexture);
+    glDeleteBuffers(1, &lightBuffer);
+    glDeleteBuffers(1, &gridBuffer);
+    glDeleteBuffers(1, &indexBuffer);
+}
+
+// Rebuilds the view-space AABB of every cluster (only when the projection changes)
+void LightClusters::buildClusterBounds(const Camera& camera)
+{
+    float aspect = (float)camera.width / camera.height;
+    boundsFov = camera.FOVdeg;
+    boundsAspect = aspect;
+    boundsNear = camera.nearPlane;
+    boundsFar = camera.farPlane;
+    nearPlane = camera.nearPlane;
+    farPlane = camera.farPlane;
+
+    float tanY = std::tan(glm::radians(camera.FOVdeg) * 0.5f);
+    float tanX = tanY * aspect;
+
+    for (int k = 0; k < GRID_Z; ++k) {
+        float dNear = nearPlane * std::pow(farPlane / nearPlane, (float)k / GRID_Z);
+        float dFar = nearPlane * std::pow(farPlane / nearPlane, (float)(k + 1) / GRID_Z);
+        for (int j = 0; j < GRID_Y; ++j) {
+            float y0 = -1.0f + 2.0f * j / GRID_Y;
+            float y1 = -1.0f + 2.0f * (j + 1) / GRID_Y;
+            for (int i = 0; i < GRID_X; ++i) {
+                float x0 = -1.0f + 2.0f * i / GRID_X;
+                float x1 = -1.0f + 2.0f * (i + 1) / GRID_X;
+                int c = i + GRID_X * (j + GRID_Y * k);
+                // The frustum slice widens with depth, so the extremes are at the near or far face
+                minX[c] = std::min(x0 * tanX * dNear, x0 * tanX * dFar);
+                maxX[c] = std::max(x1 * tanX * dNear, x1 * tanX * dFar);
+                minY[c] = std::min(y0 * tanY * dNear, y0 * tanY * dFar);
+                maxY[c] = std::max(y1 * tanY * dNear, y1 * tanY * dFar);
+                minZ[c] = -dFar;
+                maxZ[c] = -dNear;
+            }
+        }
+    }
+}
+
+int LightClusters::sliceForDepth(float depth) const
+{
+    if (depth <= nearPlane) return 0;
+    int slice = (int)(std::log(depth / nearPlane) / std::log(farPlane / nearPlane) * GRID_Z);
+    return std::min(std::max(slice, 0), GRID_Z - 1);
+}
+
+void LightClusters::update(const std::vector<Light>& lights, const Camera& camera)
+{
+    auto start = std::chrono::high_resolution_clock::now();
+
+    float aspect = (float)camera.width / camera.height;
+    if (camera.FOVdeg != boundsFov || aspect != boundsAspect ||
+        camera.nearPlane != boundsNear || camera.farPlane != boundsFar) {
+        buildClusterBounds(camera);
+    }
+    viewMatrix = camera.view;
+
+    float tanY = std::tan(glm::radians(camera.FOVdeg) * 0.5f);
+    float tanX = tanY * aspect;
+
+    // Pack every light as three texels: (position, type) (direction, radius) (color, shadow index)
+    lightData.resize(std::max<size_t>(lights.size() * 3, 1));
+    indices.clear();
+    bounds.clear();
+    for (size_t l = 0; l < lights.size(); ++l) {
+        const Light& light = lights[l];
+        float radius = light.influenceRadius(influenceThreshold);
+        lightData[l * 3 + 0] = glm::vec4(light.position, (float)light.type);
+        lightData[l * 3 + 1] = glm::vec4(light.direction, radius);
+        lightData[l * 3 + 2] = glm::vec4(glm::vec3(light.color), (float)light.shadowIndex);
+
+        // Directional lights reach every cluster: keep them in a separate global list
+        if (light.type == 0) {
+            indices.push_back((GLuint)l);
+            continue;
+        }
+        if (radius <= 0.0f) continue;
+
+        glm::vec3 center = glm::vec3(viewMatrix * glm::vec4(light.position, 1.0f));
+        float dMin = -center.z - radius;
+        float dMax = -center.z + radius;
+        if (dMax < nearPlane || dMin > farPlane) continue;
+        dMin = std::max(dMin, nearPlane);
+        dMax = std::min(dMax, farPlane);
+
+        // Conservative NDC extent of the sphere's bounding box over its depth range
+        float ndcMinX = std::min((center.x - radius) / (dMin * tanX), (center.x - radius) / (dMax * tanX));
+        float ndcMaxX = std::max((center.x + radius) / (dMin * tanX), (center.x + radius) / (dMax * tanX));
+        float ndcMinY = std::min((center.y - radius) / (dMin * tanY), (center.y - radius) / (dMax * tanY));
+        float ndcMaxY = std::max((center.y + radius) / (dMin * tanY), (center.y + radius) / (dMax * tanY));
+        if (ndcMaxX < -1.0f || ndcMinX > 1.0f || ndcMaxY < -1.0f || ndcMinY > 1.0f) continue;
+
+        LightBounds lb;
+        lb.index = (GLuint)l;
+        lb.center = center;
+        lb.radius = radius;
+        lb.x0 = std::max(0, (int)std::floor((ndcMinX + 1.0f) * 0.5f * GRID_X));
+        lb.x1 = std::min(GRID_X - 1, (int)std::floor((ndcMaxX + 1.0f) * 0.5f * GRID_X));
+        lb.y0 = std::max(0, (int)std::floor((ndcMinY + 1.0f) * 0.5f * GRID_Y));
+        lb.y1 = std::min(GRID_Y - 1, (int)std::floor((ndcMaxY + 1.0f) * 0.5f * GRID_Y));
+        lb.z0 = sliceForDepth(dMin);
+        lb.z1 = sliceForDepth(dMax);
+        bounds.push_back(lb);
+    }
+    globalLightCount = (int)indices.size();
+
+    // Each task owns whole depth slices, so no two threads touch the same cluster
+    std::fill(clusterCounts.begin(), clusterCounts.end(), 0u);
+    pool.parallelFor(GRID_Z, [this](size_t first, size_t last) { binSlices(first, last); });
+
+    // Compact the fixed-size slots into one index list
+    for (int c = 0; c < CLUSTER_COUNT; ++c) {
+        grid[c * 2 + 0] = (GLuint)indices.size();
+        grid[c * 2 + 1] = clusterCounts[c];
+        const GLuint* slots = &clusterSlots[(size_t)c * MAX_LIGHTS_PER_CLUSTER];
+        indices.insert(indices.end(), slots, slots + clusterCounts[c]);
+    }
+    lastIndexCount = indices.size();
+
+    upload();
+
+    auto end = std::chrono::high_resolution_clock::now();
+    lastBuildMs = std::chrono::duration<float, std::milli>(end - start).count();
+}
+
+void LightClusters::binSlices(size_t firstSlice, size_t lastSlice)
+{
+    float hit[GRID_X];
+    for (const LightBounds& lb : bounds) {
+        int z0 = std::max(lb.z0, (int)firstSlice);
+        int z1 = std::min(lb.z1, (int)lastSlice - 1);
+        float r2 = lb.radius * lb.radius;
+        for (int k = z0; k <= z1; ++k) {
+            for (int j = lb.y0; j <= lb.y1; ++j) {
+                int row = GRID_X * (j + GRID_Y * k);
+                // Sphere vs AABB distance for the whole row first (vectorizes), then append hits
+                for (int i = lb.x0; i <= lb.x1; ++i) {
+                    int c = row + i;
+                    float dx = std::max(std::max(minX[c] - lb.center.x, 0.0f), lb.center.x - maxX[c]);
+                    float dy = std::max(std::max(minY[c] - lb.center.y, 0.0f), lb.center.y - maxY[c]);
+                    float dz = std::max(std::max(minZ[c] - lb.center.z, 0.0f), lb.center.z - maxZ[c]);
+                    hit[i] = dx * dx + dy * dy + dz * dz;
+                }
+                for (int i = lb.x0; i <= lb.x1; ++i) {
+                    int c = row + i;
+                    if (hit[i] <= r2 && clusterCounts[c] < (GLuint)MAX_LIGHTS_PER_CLUSTER) {
+                        clusterSlots[(size_t)c * MAX_LIGHTS_PER_CLUSTER + clusterCounts[c]++] = lb.index;
+                    }
+                }
+            }
+        }
+    }
+}
+
+void LightClusters::upload()
+{
+    // Orphan and refill every buffer so the driver does not wait on last frame's reads
+    glBindBuffer(GL_TEXTURE_BUFFER, lightBuffer);
+    glBufferData(GL_TEXTURE_BUFFER, lightData.size() * sizeof(glm::vec4), nullptr, GL_STREAM_DRAW);
+    glBufferSubData(GL_TEXTURE_BUFFER, 0, lightData.size() * sizeof(glm::vec4), lightData.data());
+
+    glBindBuffer(GL_TEXTURE_BUFFER, gridBuffer);
+    glBufferData(GL_TEXTURE_BUFFER, grid.size() * sizeof(GLuint), nullptr, GL_STREAM_DRAW);
+    glBufferSubData(GL_TEXTURE_BUFFER, 0, grid.size() * sizeof(GLuint), grid.data());
+
+    if (indices.empty()) indices.push_back(0);
+    glBindBuffer(GL_TEXTURE_BUFFER, indexBuffer);
+    glBufferData(GL_TEXTURE_BUFFER, indices.size() * sizeof(GLuint), nullptr, GL_STREAM_DRAW);
+    glBufferSubData(GL_TEXTURE_BUFFER, 0, indices.size() * sizeof(GLuint), indices.data());
+
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
+}
+
+void LightClusters::bind(Shader& shader, GLuint firstUnit, int viewportWidth, int viewportHeight) const
+{
+    shader.Activate();
+
+    glActiveTexture(GL_TEXTURE0 + firstUnit);
+    glBindTexture(GL_TEXTURE_BUFFER, lightTexture);
+    glActiveTexture(GL_TEXTURE0 + firstUnit + 1);
+    glBindTexture(GL_TEXTURE_BUFFER, gridTexture);
+    glActiveTexture(GL_TEXTURE0 + firstUnit + 2);
+    glBindTexture(GL_TEXTURE_BUFFER, indexTexture);
+    glActiveTexture(GL_TEXTURE0);
+
+    glUniform1i(glGetUniformLocation(shader.ID, "clusterLights"), firstUnit);
+    glUniform1i(glGetUniformLocation(shader.ID, "clusterGrid"), firstUnit + 1);
+    glUniform1i(glGetUniformLocation(shader.ID, "clusterIndices"), firstUnit + 2);
+    glUniform1i(glGetUniformLocation(shader.ID, "globalLightCount"), globalLightCount);
+    glUniform3i(glGetUniformLocation(shader.ID, "gridSize"), GRID_X, GRID_Y, GRID_Z);
+    glUniform2f(glGetUniformLocation(shader.ID, "screenSize"), (float)viewportWidth, (float)viewportHeight);
+    glUniform1f(glGetUniformLocation(shader.ID, "zNear"), nearPlane);
+    glUniform1f(glGetUniformLocation(shader.ID, "zFar"), farPlane);
+    glUniformMatrix4fv(glGetUniformLocation(shader.ID, "view"), 1, GL_FALSE, glm::value_ptr(viewMatrix));
+}
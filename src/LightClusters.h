@@ -0,0 +1,82 @@
+#ifndef LIGHT_CLUSTERS_H
+#define LIGHT_CLUSTERS_H
+
+#include <vector>
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include "Light.h"
+#include "Camera.h"
+#include "shaderClass.h"
+#include "ThreadPool.h"
+
+// Clustered forward lighting: bins point and spot lights into a view-space
+// froxel grid on the CPU and uploads compact per-cluster light lists as buffer
+// textures, so shader/clustered.frag only loops over the lights that can reach
+// the cluster a fragment falls in.
+class LightClusters {
+public:
+    static const int GRID_X = 16;
+    static const int GRID_Y = 9;
+    static const int GRID_Z = 24;
+    static const int CLUSTER_COUNT = GRID_X * GRID_Y * GRID_Z;
+    // Hard cap per cluster; extra lights in a crowded cluster are dropped
+    static const int MAX_LIGHTS_PER_CLUSTER = 256;
+
+    // Lights contributing less than this are treated as out of range
+    float influenceThreshold = 0.05f;
+
+    LightClusters(ThreadPool& pool);
+    ~LightClusters();
+
+    // Bins the lights for the camera's current view and uploads the result
+    void update(const std::vector<Light>& lights, const Camera& camera);
+    // Binds the three buffer textures starting at firstUnit and sets the
+    // uniforms clustered.frag needs
+    void bind(Shader& shader, GLuint firstUnit, int viewportWidth, int viewportHeight) const;
+
+    // Stats of the last update
+    float lastBuildMs = 0.0f;
+    size_t lastIndexCount = 0;
+
+private:
+    ThreadPool& pool;
+
+    GLuint lightBuffer, lightTexture;
+    GLuint gridBuffer, gridTexture;
+    GLuint indexBuffer, indexTexture;
+
+    // Projection the cluster bounds were built for
+    float boundsFov = -1.0f, boundsAspect = -1.0f, boundsNear = -1.0f, boundsFar = -1.0f;
+    float nearPlane = 0.1f, farPlane = 100.0f;
+    glm::mat4 viewMatrix = glm::mat4(1.0f);
+
+    // View-space AABB of every cluster, stored as separate arrays so the
+    // sphere test over a row of clusters is a straight vectorizable loop
+    std::vector<float> minX, minY, minZ, maxX, maxY, maxZ;
+
+    // Per-light data prepared before the parallel binning pass
+    struct LightBounds {
+        GLuint index;
+        glm::vec3 center; // view space
+        float radius;
+        int x0, x1, y0, y1, z0, z1;
+    };
+    std::vector<LightBounds> bounds;
+
+    // Scratch: fixed-size slot per cluster, filled in parallel over z slices
+    std::vector<GLuint> clusterCounts;
+    std::vector<GLuint> clusterSlots;
+
+    // Data uploaded to the GPU
+    std::vector<glm::vec4> lightData;
+    std::vector<GLuint> grid;    // (offset, count) per cluster
+    std::vector<GLuint> indices; // global lights first, then per-cluster lists
+    int globalLightCount = 0;
+
+    void buildClusterBounds(const Camera& camera);
+    int sliceForDepth(float depth) const;
+    void binSlices(size_t firstSlice, size_t lastSlice);
+    void upload();
+};
+
+#endif
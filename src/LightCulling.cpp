@@ -0,0 +1,78 @@
+// LightCulling.cpp - Per-object light selection for the forward lit shader
+
+#include "LightCulling.h"
+#include <algorithm>
+#include <cmath>
+
+void LightCuller::prepare(const std::vector<Light>& sceneLights)
+{
+    lights = &sceneLights;
+    radii.resize(sceneLights.size());
+    peaks.resize(sceneLights.size());
+    for (size_t i = 0; i < sceneLights.size(); ++i) {
+        radii[i] = sceneLights[i].influenceRadius(influenceThreshold);
+        peaks[i] = sceneLights[i].peakContribution();
+    }
+    objectCount = 0;
+    selectedCount = 0;
+}
+
+const std::vector<int>& LightCuller::select(const glm::vec3& worldMin, const glm::vec3& worldMax)
+{
+    candidates.clear();
+    selection.clear();
+    if (!lights) return selection;
+
+    glm::vec3 boxCenter = (worldMin + worldMax) * 0.5f;
+    float boxRadius = glm::length(worldMax - worldMin) * 0.5f;
+
+    for (size_t i = 0; i < lights->size(); ++i) {
+        const Light& light = (*lights)[i];
+        if (light.type == 0) {
+            // Directional lights reach everything
+            candidates.push_back({ (int)i, peaks[i] });
+            continue;
+        }
+
+        // Closest point of the box to the light
+        glm::vec3 closest = glm::clamp(light.position, worldMin, worldMax);
+        float dist = glm::length(closest - light.position);
+        if (dist > radii[i]) continue;
+
+        if (light.type == 2) {
+            // Cone vs bounding sphere of the box
+            glm::vec3 dir = glm::normalize(light.direction);
+            glm::vec3 v = boxCenter - light.position;
+            float alongAxis = glm::dot(v, dir);
+            float sinOuter = std::sqrt(1.0f - SPOT_OUTER_COS * SPOT_OUTER_COS);
+            float fromCone = SPOT_OUTER_COS * std::sqrt(std::max(glm::dot(v, v) - alongAxis * alongAxis, 0.0f)) - alongAxis * sinOuter;
+            if (fromCone > boxRadius || alongAxis < -boxRadius) continue;
+        }
+
+        float attenuation = LIGHT_ATTENUATION_CONSTANT + LIGHT_ATTENUATION_LINEAR * dist +
+                            LIGHT_ATTENUATION_QUADRATIC * dist * dist;
+        candidates.push_back({ (int)i, peaks[i] / attenuation });
+    }
+
+    // Keep the strongest lights only
+    size_t count = std::min(candidates.size(), (size_t)std::min(maxLightsPerObject, MAX_SHADER_LIGHTS));
+    std::partial_sort(candidates.begin(), candidates.begin() + count, candidates.end(),
+                      [](const Candidate& a, const Candidate& b) { return a.contribution > b.contribution; });
+    for (size_t i = 0; i < count; ++i) {
+        selection.push_back(candidates[i].index);
+    }
+
+    objectCount++;
+    selectedCount += (int)count;
+    return selection;
+}
+
+void LightCuller::apply(Shader& shader, const glm::vec3& worldMin, const glm::vec3& worldMax)
+{
+    const std::vector<int>& selected = select(worldMin, worldMax);
+    shader.Activate();
+    glUniform1i(glGetUniformLocation(shader.ID, "lightCount"), (int)selected.size());
+    for (size_t i = 0; i < selected.size(); ++i) {
+        (*lights)[selected[i]].sendToShader(shader, (int)i);
+    }
+}
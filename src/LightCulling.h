@@ -0,0 +1,45 @@
+#ifndef LIGHT_CULLING_H
+#define LIGHT_CULLING_H
+
+#include <vector>
+#include <glm/glm.hpp>
+#include "Light.h"
+#include "shaderClass.h"
+
+// Per-object light lists for the forward path: tests every object's world AABB
+// against the lights' influence volumes and uploads only the most important
+// MAX_SHADER_LIGHTS to the lights[] uniform array before the object is drawn.
+class LightCuller {
+public:
+    // Lights contributing less than this are treated as out of range
+    float influenceThreshold = 0.05f;
+    // How many lights a single object may receive (<= MAX_SHADER_LIGHTS)
+    int maxLightsPerObject = MAX_SHADER_LIGHTS;
+
+    // Caches the influence radius of every light, call once per frame
+    void prepare(const std::vector<Light>& lights);
+
+    // Returns the indices of the lights reaching the box, strongest first
+    const std::vector<int>& select(const glm::vec3& worldMin, const glm::vec3& worldMax);
+
+    // select() followed by the lights[] / lightCount uniform upload
+    void apply(Shader& shader, const glm::vec3& worldMin, const glm::vec3& worldMax);
+
+    // Stats since the last prepare()
+    int objectCount = 0;
+    int selectedCount = 0;
+
+private:
+    const std::vector<Light>* lights = nullptr;
+    std::vector<float> radii;
+    std::vector<float> peaks;
+
+    struct Candidate {
+        int index;
+        float contribution;
+    };
+    std::vector<Candidate> candidates;
+    std::vector<int> selection;
+};
+
+#endif
@@ -0,0 +1,328 @@
+// OcclusionCuller.cpp - Software occluder rasterizer and HiZ box tests
+
+#include "OcclusionCuller.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+
+OcclusionCuller::OcclusionCuller(ThreadPool& pool, int width, int height) : pool(pool)
+{
+    tilesX = (std::max(width, 1) + TILE_SIZE - 1) / TILE_SIZE;
+    tilesY = (std::max(height, 1) + TILE_SIZE - 1) / TILE_SIZE;
+    bufferWidth = tilesX * TILE_SIZE;
+    bufferHeight = tilesY * TILE_SIZE;
+
+    // Levels stop at one texel per tile so every tile builds its own pyramid
+    for (int size = TILE_SIZE, level = 0; size >= 1; size /= 2, ++level) {
+        levels.push_back(std::vector<float>((size_t)(bufferWidth >> level) * (bufferHeight >> level), 1.0f));
+    }
+}
+
+bool OcclusionCuller::addStaticModel(const Model& model, const glm::mat4& modelMatrix, const std::string& name)
+{
+    // Cut-out geometry (leaves) has holes, it can't hide anything reliably
+    if (model.GetAlphaCutoff() > 0.0f) return false;
+
+    glm::vec3 worldMin, worldMax;
+    model.getWorldBounds(modelMatrix, worldMin, worldMax);
+    glm::vec3 size = worldMax - worldMin;
+    float extents[3] = { size.x, size.y, size.z };
+    std::sort(extents, extents + 3);
+    if (extents[1] < minOccluderSize) return false;
+
+    struct Triangle {
+        glm::vec3 v0, v1, v2;
+        float area;
+    };
+    std::vector<Triangle> modelTriangles;
+    for (const Mesh& mesh : model.meshes) {
+        for (size_t i = 0; i + 2 < mesh.indices.size(); i += 3) {
+            Triangle tri;
+            tri.v0 = glm::vec3(modelMatrix * glm::vec4(mesh.vertices[mesh.indices[i]].position, 1.0f));
+            tri.v1 = glm::vec3(modelMatrix * glm::vec4(mesh.vertices[mesh.indices[i + 1]].position, 1.0f));
+            tri.v2 = glm::vec3(modelMatrix * glm::vec4(mesh.vertices[mesh.indices[i + 2]].position, 1.0f));
+            tri.area = 0.5f * glm::length(glm::cross(tri.v1 - tri.v0, tri.v2 - tri.v0));
+            modelTriangles.push_back(tri);
+        }
+    }
+    if (modelTriangles.empty()) return false;
+
+    // Thin, open shapes (posts, railings) have little surface for their size
+    float surfaceArea = 0.0f;
+    for (const Triangle& tri : modelTriangles) surfaceArea += tri.area;
+    float boxArea = 2.0f * (size.x * size.y + size.y * size.z + size.x * size.z);
+    float fill = surfaceArea / boxArea;
+    if (fill < minOccluderFill) return false;
+
+    // Simplify by keeping the biggest triangles: a subset of the real surface
+    // can only hide less than the full mesh, never more
+    size_t kept = std::min(modelTriangles.size(), (size_t)maxOccluderTriangles);
+    std::partial_sort(modelTriangles.begin(), modelTriangles.begin() + kept, modelTriangles.end(),
+                      [](const Triangle& a, const Triangle& b) { return a.area > b.area; });
+
+    std::vector<glm::vec3> positions;
+    std::vector<unsigned int> indices;
+    for (size_t i = 0; i < kept; ++i) {
+        positions.push_back(modelTriangles[i].v0);
+        positions.push_back(modelTriangles[i].v1);
+        positions.push_back(modelTriangles[i].v2);
+        indices.push_back((unsigned int)(i * 3));
+        indices.push_back((unsigned int)(i * 3 + 1));
+        indices.push_back((unsigned int)(i * 3 + 2));
+    }
+    addOccluder(positions, indices);
+
+    std::cout << "[occlusion] occluder " << name << ": " << kept << "/" << modelTriangles.size()
+              << " triangles" << std::endl;
+    return true;
+}
+
+void OcclusionCuller::addOccluder(const std::vector<glm::vec3>& positions, const std::vector<unsigned int>& indices)
+{
+    for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+        occluderVertices.push_back(positions[indices[i]]);
+        occluderVertices.push_back(positions[indices[i + 1]]);
+        occluderVertices.push_back(positions[indices[i + 2]]);
+    }
+    occluderTriangles = (int)(occluderVertices.size() / 3);
+}
+
+void OcclusionCuller::update(const glm::mat4& viewProjection)
+{
+    auto start = std::chrono::high_resolution_clock::now();
+
+    viewProj = viewProjection;
+    setupTriangles();
+
+    // Each tile clears, rasterizes every overlapping triangle and builds its
+    // part of the pyramid; tiles never touch each other's texels
+    pool.parallelFor((size_t)(tilesX * tilesY), [this](size_t begin, size_t end) {
+        for (size_t tile = begin; tile < end; ++tile) {
+            rasterizeTile((int)tile);
+            buildTileLevels((int)tile);
+        }
+    });
+
+    auto stop = std::chrono::high_resolution_clock::now();
+    lastRasterMs = std::chrono::duration<float, std::milli>(stop - start).count();
+    rasterizedTriangles = (int)triangles.size();
+    testedCount = 0;
+    occludedCount = 0;
+    offscreenCount = 0;
+}
+
+// Transforms the occluders to clip space, clips them against the near plane
+// and converts them to screen-space triangles
+void OcclusionCuller::setupTriangles()
+{
+    triangles.clear();
+    for (size_t i = 0; i + 2 < occluderVertices.size(); i += 3) {
+        glm::vec4 clip[3];
+        float distance[3]; // To the near plane (z >= -w is in front)
+        int inFront = 0;
+        for (int k = 0; k < 3; ++k) {
+            clip[k] = viewProj * glm::vec4(occluderVertices[i + k], 1.0f);
+            distance[k] = clip[k].z + clip[k].w;
+            if (distance[k] >= 0.0f) inFront++;
+        }
+        if (inFront == 0) continue;
+        if (inFront == 3) {
+            addScreenTriangle(clip[0], clip[1], clip[2]);
+            continue;
+        }
+
+        // Sutherland-Hodgman against the near plane: 3 or 4 vertices remain
+        glm::vec4 polygon[4];
+        int count = 0;
+        for (int k = 0; k < 3; ++k) {
+            int next = (k + 1) % 3;
+            if (distance[k] >= 0.0f) polygon[count++] = clip[k];
+            if ((distance[k] >= 0.0f) != (distance[next] >= 0.0f)) {
+                float t = distance[k] / (distance[k] - distance[next]);
+                polygon[count++] = clip[k] + (clip[next] - clip[k]) * t;
+            }
+        }
+        for (int k = 1; k + 1 < count; ++k) {
+            addScreenTriangle(polygon[0], polygon[k], polygon[k + 1]);
+        }
+    }
+}
+
+void OcclusionCuller::addScreenTriangle(const glm::vec4& c0, const glm::vec4& c1, const glm::vec4& c2)
+{
+    const glm::vec4* clip[3] = { &c0, &c1, &c2 };
+    glm::vec3 screen[3];
+    for (int k = 0; k < 3; ++k) {
+        float w = std::max(clip[k]->w, 1e-6f);
+        glm::vec3 ndc = glm::vec3(*clip[k]) / w;
+        screen[k] = glm::vec3((ndc.x * 0.5f + 0.5f) * bufferWidth,
+                              (ndc.y * 0.5f + 0.5f) * bufferHeight,
+                              ndc.z * 0.5f + 0.5f);
+    }
+
+    ScreenTriangle tri;
+    tri.v0 = screen[0];
+    tri.v1 = screen[1];
+    tri.v2 = screen[2];
+    tri.minX = std::min(std::min(screen[0].x, screen[1].x), screen[2].x);
+    tri.minY = std::min(std::min(screen[0].y, screen[1].y), screen[2].y);
+    tri.maxX = std::max(std::max(screen[0].x, screen[1].x), screen[2].x);
+    tri.maxY = std::max(std::max(screen[0].y, screen[1].y), screen[2].y);
+    if (tri.maxX < 0.0f || tri.maxY < 0.0f || tri.minX > bufferWidth || tri.minY > bufferHeight) return;
+    triangles.push_back(tri);
+}
+
+void OcclusionCuller::rasterizeTile(int tile)
+{
+    int x0 = (tile % tilesX) * TILE_SIZE;
+    int y0 = (tile / tilesX) * TILE_SIZE;
+    int x1 = x0 + TILE_SIZE;
+    int y1 = y0 + TILE_SIZE;
+
+    std::vector<float>& depth = levels[0];
+    for (int y = y0; y < y1; ++y) {
+        std::fill(depth.begin() + (size_t)y * bufferWidth + x0, depth.begin() + (size_t)y * bufferWidth + x1, 1.0f);
+    }
+
+    for (const ScreenTriangle& tri : triangles) {
+        if (tri.maxX < x0 || tri.minX > x1 || tri.maxY < y0 || tri.minY > y1) continue;
+        rasterizeTriangle(tri, x0, y0, x1, y1);
+    }
+}
+
+// Fills the pixels of [x0, x1) x [y0, y1) whose centers are inside the triangle
+void OcclusionCuller::rasterizeTriangle(const ScreenTriangle& tri, int x0, int y0, int x1, int y1)
+{
+    glm::vec3 a = tri.v0, b = tri.v1, c = tri.v2;
+    float area = (b.x - a.x) * (c.y - a.y) - (b.y - a.y) * (c.x - a.x);
+    // Occluders are rasterized double-sided: make the winding counter-clockwise
+    if (area < 0.0f) {
+        std::swap(b, c);
+        area = -area;
+    }
+    if (area < 1e-6f) return;
+
+    // Edge functions E(x, y) = A x + B y + C, positive inside
+    const glm::vec3* edgeFrom[3] = { &a, &b, &c };
+    const glm::vec3* edgeTo[3] = { &b, &c, &a };
+    float edgeA[3], edgeB[3], edgeC[3];
+    for (int e = 0; e < 3; ++e) {
+        edgeA[e] = -(edgeTo[e]->y - edgeFrom[e]->y);
+        edgeB[e] = edgeTo[e]->x - edgeFrom[e]->x;
+        edgeC[e] = -(edgeA[e] * edgeFrom[e]->x + edgeB[e] * edgeFrom[e]->y);
+    }
+
+    // Depth is linear in screen space
+    float dzdx = ((b.z - a.z) * (c.y - a.y) - (c.z - a.z) * (b.y - a.y)) / area;
+    float dzdy = ((c.z - a.z) * (b.x - a.x) - (b.z - a.z) * (c.x - a.x)) / area;
+
+    int yStart = std::max(y0, (int)std::ceil(tri.minY - 0.5f));
+    int yEnd = std::min(y1 - 1, (int)std::floor(tri.maxY - 0.5f));
+    for (int y = yStart; y <= yEnd; ++y) {
+        float py = y + 0.5f;
+
+        // Span of pixel centers inside all three edges on this row
+        float lo = tri.minX, hi = tri.maxX;
+        bool empty = false;
+        for (int e = 0; e < 3; ++e) {
+            float k = edgeB[e] * py + edgeC[e];
+            if (edgeA[e] > 0.0f) lo = std::max(lo, -k / edgeA[e]);
+            else if (edgeA[e] < 0.0f) hi = std::min(hi, -k / edgeA[e]);
+            else if (k < 0.0f) empty = true;
+        }
+        if (empty) continue;
+        int xs = std::max(x0, (int)std::ceil(lo - 0.5f));
+        int xe = std::min(x1 - 1, (int)std::floor(hi - 0.5f));
+
+        // Plain min over a contiguous span, which the compiler vectorizes
+        float* row = &levels[0][(size_t)y * bufferWidth];
+        float rowDepth = a.z + dzdx * (0.5f - a.x) + dzdy * (py - a.y);
+        for (int x = xs; x <= xe; ++x) {
+            row[x] = std::min(row[x], rowDepth + dzdx * (float)x);
+        }
+    }
+}
+
+// Max-reduces the tile down through every pyramid level
+void OcclusionCuller::buildTileLevels(int tile)
+{
+    int tx = tile % tilesX;
+    int ty = tile / tilesX;
+    for (size_t level = 1; level < levels.size(); ++level) {
+        int size = TILE_SIZE >> level;
+        int srcWidth = bufferWidth >> (level - 1);
+        int dstWidth = bufferWidth >> level;
+        const std::vector<float>& src = levels[level - 1];
+        std::vector<float>& dst = levels[level];
+        for (int y = ty * size; y < (ty + 1) * size; ++y) {
+            const float* row0 = &src[(size_t)(2 * y) * srcWidth];
+            const float* row1 = row0 + srcWidth;
+            float* out = &dst[(size_t)y * dstWidth];
+            for (int x = tx * size; x < (tx + 1) * size; ++x) {
+                out[x] = std::max(std::max(row0[2 * x], row0[2 * x + 1]), std::max(row1[2 * x], row1[2 * x + 1]));
+            }
+        }
+    }
+}
+
+bool OcclusionCuller::isVisible(const glm::vec3& worldMin, const glm::vec3& worldMax)
+{
+    testedCount++;
+
+    glm::vec4 clipCorners[8];
+    int behind = 0;
+    for (int i = 0; i < 8; ++i) {
+        glm::vec3 corner((i & 1) ? worldMax.x : worldMin.x,
+                         (i & 2) ? worldMax.y : worldMin.y,
+                         (i & 4) ? worldMax.z : worldMin.z);
+        clipCorners[i] = viewProj * glm::vec4(corner, 1.0f);
+        if (clipCorners[i].z < -clipCorners[i].w) behind++;
+    }
+    if (behind == 8) {
+        offscreenCount++;
+        return false;
+    }
+    // Box crosses the near plane: the camera is (almost) inside it
+    if (behind > 0) return true;
+
+    float minX = 1e30f, minY = 1e30f, maxX = -1e30f, maxY = -1e30f, minZ = 1.0f;
+    for (int i = 0; i < 8; ++i) {
+        const glm::vec4& clip = clipCorners[i];
+        glm::vec3 ndc = glm::vec3(clip) / clip.w;
+        float x = (ndc.x * 0.5f + 0.5f) * bufferWidth;
+        float y = (ndc.y * 0.5f + 0.5f) * bufferHeight;
+        minX = std::min(minX, x);
+        maxX = std::max(maxX, x);
+        minY = std::min(minY, y);
+        maxY = std::max(maxY, y);
+        minZ = std::min(minZ, ndc.z * 0.5f + 0.5f);
+    }
+
+    if (maxX < 0.0f || maxY < 0.0f || minX >= bufferWidth || minY >= bufferHeight) {
+        offscreenCount++;
+        return false;
+    }
+
+    int x0 = std::max(0, (int)std::floor(minX));
+    int y0 = std::max(0, (int)std::floor(minY));
+    int x1 = std::min(bufferWidth - 1, (int)std::floor(maxX));
+    int y1 = std::min(bufferHeight - 1, (int)std::floor(maxY));
+
+    // Coarsest level where the rectangle is still a handful of texels
+    size_t level = 0;
+    while (level + 1 < levels.size() && ((x1 >> level) - (x0 >> level) > 3 || (y1 >> level) - (y0 >> level) > 3)) {
+        level++;
+    }
+
+    const std::vector<float>& depth = levels[level];
+    int levelWidth = bufferWidth >> level;
+    for (int y = y0 >> level; y <= (y1 >> level); ++y) {
+        for (int x = x0 >> level; x <= (x1 >> level); ++x) {
+            // Something of the box may be in front of the farthest occluder here
+            if (minZ <= depth[(size_t)y * levelWidth + x]) return true;
+        }
+    }
+    occludedCount++;
+    return false;
+}
@@ -0,0 +1,81 @@
+#ifndef OCCLUSION_CULLER_H
+#define OCCLUSION_CULLER_H
+
+#include <string>
+#include <vector>
+#include <glm/glm.hpp>
+#include "model.h"
+#include "ThreadPool.h"
+
+// CPU occlusion culling: a few large static meshes are rasterized into a small
+// depth buffer every frame, then object bounding boxes are tested against a
+// max-depth pyramid (HiZ) of that buffer before they are drawn.
+//
+// Everything runs on the CPU (no GL calls), split into square tiles that are
+// rasterized in parallel on the shared ThreadPool.
+class OcclusionCuller {
+public:
+    static const int TILE_SIZE = 64;
+
+    // Occluder selection: opaque models at least this big along two axes (world units)...
+    float minOccluderSize = 3.0f;
+    // ...whose surface area is at least this fraction of their bounding box's...
+    float minOccluderFill = 0.3f;
+    // ...and this many triangles at most; larger meshes keep only their biggest triangles
+    int maxOccluderTriangles = 512;
+
+    // Buffer size is rounded up to whole tiles
+    OcclusionCuller(ThreadPool& pool, int width = 256, int height = 256);
+
+    // Picks the model as an occluder if it's large, static and opaque.
+    // Returns true when it was added.
+    bool addStaticModel(const Model& model, const glm::mat4& modelMatrix, const std::string& name);
+    // Adds world-space triangles as an occluder unconditionally
+    void addOccluder(const std::vector<glm::vec3>& positions, const std::vector<unsigned int>& indices);
+
+    // Rasterizes the occluders for this frame's camera (projection * view)
+    void update(const glm::mat4& viewProjection);
+
+    // False if the box is hidden behind the occluders or entirely off screen
+    bool isVisible(const glm::vec3& worldMin, const glm::vec3& worldMax);
+
+    int width() const { return bufferWidth; }
+    int height() const { return bufferHeight; }
+    // Full resolution depth in [0,1] (1 = nothing rasterized), rows bottom to top
+    const std::vector<float>& depthBuffer() const { return levels[0]; }
+
+    // Stats: last update, and tests since the last update
+    float lastRasterMs = 0.0f;
+    int occluderTriangles = 0;
+    int rasterizedTriangles = 0;
+    int testedCount = 0;
+    int occludedCount = 0;
+    int offscreenCount = 0;
+
+private:
+    ThreadPool& pool;
+    int bufferWidth, bufferHeight;
+    int tilesX, tilesY;
+    glm::mat4 viewProj = glm::mat4(1.0f);
+
+    // All occluder triangles, world space, three vertices each
+    std::vector<glm::vec3> occluderVertices;
+
+    // Screen-space triangles of the current frame (after near clipping)
+    struct ScreenTriangle {
+        glm::vec3 v0, v1, v2;   // x, y in pixels, z = depth in [0,1]
+        float minX, minY, maxX, maxY;
+    };
+    std::vector<ScreenTriangle> triangles;
+
+    // levels[0] = full resolution, every next level halves it and keeps the max depth
+    std::vector<std::vector<float>> levels;
+
+    void setupTriangles();
+    void addScreenTriangle(const glm::vec4& c0, const glm::vec4& c1, const glm::vec4& c2);
+    void rasterizeTile(int tile);
+    void rasterizeTriangle(const ScreenTriangle& tri, int x0, int y0, int x1, int y1);
+    void buildTileLevels(int tile);
+};
+
+#endif
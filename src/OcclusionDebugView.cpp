@@ -0,0 +1,50 @@
+// OcclusionDebugView.cpp - Overlay of the software occlusion buffer
+
+#include "OcclusionDebugView.h"
+
+OcclusionDebugView::OcclusionDebugView(int width, int height)
+    : width(width), height(height), shader("shader/fullscreen.vert", "shader/occlusion_debug.frag")
+{
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_R32F, width, height, 0, GL_RED, GL_FLOAT, nullptr);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    glGenVertexArrays(1, &emptyVAO);
+}
+
+OcclusionDebugView::~OcclusionDebugView()
+{
+    glDeleteTextures(1, &texture);
+    glDeleteVertexArrays(1, &emptyVAO);
+    shader.Delete();
+}
+
+void OcclusionDebugView::draw(const OcclusionCuller& culler, const Camera& camera, int viewportWidth, int viewportHeight)
+{
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, width, height, GL_RED, GL_FLOAT, culler.depthBuffer().data());
+
+    shader.Activate();
+    glUniform1i(glGetUniformLocation(shader.ID, "depthBuffer"), 0);
+    glUniform1f(glGetUniformLocation(shader.ID, "zNear"), camera.nearPlane);
+    glUniform1f(glGetUniformLocation(shader.ID, "zFar"), camera.farPlane);
+
+    // A third of the screen, keeping the buffer's aspect ratio
+    int overlayHeight = viewportHeight / 3;
+    int overlayWidth = overlayHeight * width / height;
+    glViewport(0, 0, overlayWidth, overlayHeight);
+    glDisable(GL_DEPTH_TEST);
+    glDisable(GL_BLEND);
+    glBindVertexArray(emptyVAO);
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+    glBindVertexArray(0);
+    glEnable(GL_BLEND);
+    glEnable(GL_DEPTH_TEST);
+    glViewport(0, 0, viewportWidth, viewportHeight);
+}
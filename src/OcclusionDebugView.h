@@ -0,0 +1,25 @@
+#ifndef OCCLUSION_DEBUG_VIEW_H
+#define OCCLUSION_DEBUG_VIEW_H
+
+#include <glad/glad.h>
+#include "shaderClass.h"
+#include "Camera.h"
+#include "OcclusionCuller.h"
+
+// Shows the occlusion culler's depth buffer as a grayscale overlay in the
+// bottom-left corner of the screen (near = white, empty = black)
+class OcclusionDebugView {
+public:
+    OcclusionDebugView(int width, int height);
+    ~OcclusionDebugView();
+
+    void draw(const OcclusionCuller& culler, const Camera& camera, int viewportWidth, int viewportHeight);
+
+private:
+    int width, height;
+    GLuint texture;
+    GLuint emptyVAO; // For the full-screen triangle
+    Shader shader;
+};
+
+#endif
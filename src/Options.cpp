@@ -0,0 +1,184 @@
+#include "Options.h"
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+static void PrintUsage(const char* program)
+{
+    std::cout << "Usage: " << program << " [options]\n"
+              << "  --clustered        clustered forward lighting\n"
+              << "  --deferred         deferred shading for the opaque scene\n"
+              << "  --no-light-lists   forward path shades the first 10 lights for every object\n"
+              << "  --prepass <mode>   depth pre-pass before the lit pass: off, on or auto\n"
+              << "  --occlusion        CPU occlusion culling against the large static meshes\n"
+              << "  --occlusion-debug  same, and show the occlusion buffer\n"
+              << "  --shadows          cached shadow maps for the scene lights\n"
+              << "  --ibl              ambient light and blurred reflections from the skybox (precomputed, cached)\n"
+              << "  --probes           reflections of the scene from the scene's probes, one cube face per frame\n"
+              << "  --planar-reflections <divisor>  reflect mirrors render the scene at 1/divisor resolution (2 or 4)\n"
+              << "  --planar-interval <frames>      re-render a still planar reflection every n frames (default 4)\n"
+              << "  --drs <ms>         dynamic resolution aiming for this GPU frame time\n"
+              << "  --drs-bounds <min> <max>  resolution scale range (default 0.5 1)\n"
+              << "  --drs-pid <kp> <ki> <kd>  resolution controller gains (default 0.1 0.05 0.02)\n"
+              << "  --drs-sharpness <s>       upscale sharpening, 0 to 1 (default 0.3)\n"
+              << "  --taa              temporal upscaling (fixed scale unless --drs is given)\n"
+              << "  --taa-scale <s>    render scale of --taa without --drs (default 0.8)\n"
+              << "  --upscale-compare <frames>  compare native, spatial and temporal upscaling on a fixed path\n"
+              << "  --tick-rate <hz>   simulation ticks per second (default 60)\n"
+              << "  --max-ticks <n>    most simulation ticks per frame before time is dropped (default 5)\n"
+              << "  --threaded         run the simulation and the renderer on separate threads\n"
+              << "  --resolution <w> <h>  output size (default 1200 1200)\n"
+              << "  --headless <frames>   render offscreen without a window, print frame times and exit\n"
+              << "  --static-camera       headless: keep the start pose instead of the orbit path\n"
+              << "  --capture <file.ppm>  headless: save the last frame\n"
+              << "  --gpu-profile         GPU time per pass, reported every 240 frames\n"
+              << "  --gpu-profile-csv <file.csv>  same, and write every frame's times to a file\n"
+              << "  --gpu-profile-overlay         same, and graph the recent frames on screen\n"
+              << "  --cpu-trace <file.json>       record CPU scopes, written as a Chrome trace on exit\n"
+              << "  --benchmark <summary.txt>     fixed-step flythrough, writes frame-time statistics\n"
+              << "  --camera-path <file>          benchmark camera path (default: built-in flythrough)\n"
+              << "  --benchmark-frames <n>        benchmark length (default: the whole path)\n"
+              << "  --baseline <summary.txt>      compare the benchmark with a stored summary\n"
+              << "  --regression-threshold <pct>  slowdown that counts as a regression (default 10)\n"
+              << "  --benchmark-compare <baseline.txt> <current.txt>  compare two summaries and exit\n"
+              << "  --record-camera <file>        save the player's camera path on exit\n"
+              << "  --record-input <file>         record the keyboard and mouse input of every frame\n"
+              << "  --replay-input <file>         replay recorded input (windowed, or with --headless)\n"
+              << "  --scene <file>                scene to load, .scene text or compiled (default assets/scenes/farm.scene)\n"
+              << "  --compile-scene <in.scene> <out.sceneb>  compile a text scene to the mapped binary form and exit\n"
+              << "  --entity-benchmark <n>        time transform update, culling and draw lists for n objects and exit\n"
+              << "  --particle-benchmark <n>      time the particle update with n live particles and exit\n"
+              << "  --bake-ibl         recompute the image-based lighting of every skybox and exit\n"
+              << "  --seed <n>         seed of the scene's random numbers (default 1)\n"
+              << "  --lights <n>       add n animated point/spot lights\n"
+              << "  --smoke <n>        campfire smoke with n live particles\n"
+              << "  --smoke-gpu        simulate the smoke on the GPU (transform feedback)\n"
+              << "  --gpu-particle-benchmark <n>  time GPU and CPU particle updates from 10k up to n particles and exit\n";
+}
+
+bool ParseOptions(int argc, char** argv, Options& options)
+{
+    for (int i = 1; i < argc; ++i) {
+        const char* arg = argv[i];
+        if (std::strcmp(arg, "--clustered") == 0) {
+            options.clusteredLighting = true;
+        } else if (std::strcmp(arg, "--deferred") == 0) {
+            options.deferredShading = true;
+        } else if (std::strcmp(arg, "--no-light-lists") == 0) {
+            options.perObjectLights = false;
+        } else if (std::strcmp(arg, "--prepass") == 0 && i + 1 < argc) {
+            const char* mode = argv[++i];
+            if (std::strcmp(mode, "off") == 0) options.depthPrepass = 0;
+            else if (std::strcmp(mode, "on") == 0) options.depthPrepass = 1;
+            else if (std::strcmp(mode, "auto") == 0) options.depthPrepass = 2;
+            else {
+                std::cout << "ERROR: unknown pre-pass mode: " << mode << std::endl;
+                PrintUsage(argv[0]);
+                return false;
+            }
+        } else if (std::strcmp(arg, "--occlusion") == 0) {
+            options.occlusionCulling = true;
+        } else if (std::strcmp(arg, "--occlusion-debug") == 0) {
+            options.occlusionCulling = true;
+            options.occlusionDebug = true;
+        } else if (std::strcmp(arg, "--shadows") == 0) {
+            options.shadows = true;
+        } else if (std::strcmp(arg, "--ibl") == 0) {
+            options.imageBasedLighting = true;
+        } else if (std::strcmp(arg, "--probes") == 0) {
+            options.reflectionProbes = true;
+        } else if (std::strcmp(arg, "--planar-reflections") == 0 && i + 1 < argc) {
+            options.planarDivisor = std::max(std::atoi(argv[++i]), 1);
+        } else if (std::strcmp(arg, "--planar-interval") == 0 && i + 1 < argc) {
+            options.planarInterval = std::max(std::atoi(argv[++i]), 1);
+        } else if (std::strcmp(arg, "--drs") == 0 && i + 1 < argc) {
+            options.drsTargetMs = (float)std::atof(argv[++i]);
+        } else if (std::strcmp(arg, "--drs-bounds") == 0 && i + 2 < argc) {
+            options.drsMinScale = (float)std::atof(argv[++i]);
+            options.drsMaxScale = (float)std::atof(argv[++i]);
+        } else if (std::strcmp(arg, "--drs-pid") == 0 && i + 3 < argc) {
+            options.drsKp = (float)std::atof(argv[++i]);
+            options.drsKi = (float)std::atof(argv[++i]);
+            options.drsKd = (float)std::atof(argv[++i]);
+        } else if (std::strcmp(arg, "--drs-sharpness") == 0 && i + 1 < argc) {
+            options.drsSharpness = (float)std::atof(argv[++i]);
+        } else if (std::strcmp(arg, "--taa") == 0) {
+            options.temporalUpscaling = true;
+        } else if (std::strcmp(arg, "--taa-scale") == 0 && i + 1 < argc) {
+            options.upscaleScale = (float)std::atof(argv[++i]);
+        } else if (std::strcmp(arg, "--upscale-compare") == 0 && i + 1 < argc) {
+            options.upscaleCompareFrames = std::atoi(argv[++i]);
+        } else if (std::strcmp(arg, "--tick-rate") == 0 && i + 1 < argc) {
+            options.tickRate = (float)std::atof(argv[++i]);
+        } else if (std::strcmp(arg, "--max-ticks") == 0 && i + 1 < argc) {
+            options.maxTicksPerFrame = std::atoi(argv[++i]);
+        } else if (std::strcmp(arg, "--threaded") == 0) {
+            options.threadedRendering = true;
+        } else if (std::strcmp(arg, "--resolution") == 0 && i + 2 < argc) {
+            options.width = std::atoi(argv[++i]);
+            options.height = std::atoi(argv[++i]);
+        } else if (std::strcmp(arg, "--headless") == 0 && i + 1 < argc) {
+            options.headlessFrames = std::atoi(argv[++i]);
+        } else if (std::strcmp(arg, "--static-camera") == 0) {
+            options.staticCamera = true;
+        } else if (std::strcmp(arg, "--capture") == 0 && i + 1 < argc) {
+            options.capturePath = argv[++i];
+        } else if (std::strcmp(arg, "--gpu-profile") == 0) {
+            options.gpuProfile = true;
+        } else if (std::strcmp(arg, "--gpu-profile-csv") == 0 && i + 1 < argc) {
+            options.gpuProfile = true;
+            options.gpuProfileCsv = argv[++i];
+        } else if (std::strcmp(arg, "--gpu-profile-overlay") == 0) {
+            options.gpuProfile = true;
+            options.gpuProfileOverlay = true;
+        } else if (std::strcmp(arg, "--cpu-trace") == 0 && i + 1 < argc) {
+            options.cpuTracePath = argv[++i];
+        } else if (std::strcmp(arg, "--benchmark") == 0 && i + 1 < argc) {
+            options.benchmarkPath = argv[++i];
+        } else if (std::strcmp(arg, "--camera-path") == 0 && i + 1 < argc) {
+            options.cameraPathFile = argv[++i];
+        } else if (std::strcmp(arg, "--benchmark-frames") == 0 && i + 1 < argc) {
+            options.benchmarkFrames = std::atoi(argv[++i]);
+        } else if (std::strcmp(arg, "--baseline") == 0 && i + 1 < argc) {
+            options.benchmarkBaseline = argv[++i];
+        } else if (std::strcmp(arg, "--regression-threshold") == 0 && i + 1 < argc) {
+            options.regressionThreshold = (float)std::atof(argv[++i]);
+        } else if (std::strcmp(arg, "--benchmark-compare") == 0 && i + 2 < argc) {
+            options.compareBaselinePath = argv[++i];
+            options.compareCurrentPath = argv[++i];
+        } else if (std::strcmp(arg, "--record-camera") == 0 && i + 1 < argc) {
+            options.recordCameraPath = argv[++i];
+        } else if (std::strcmp(arg, "--record-input") == 0 && i + 1 < argc) {
+            options.recordInputPath = argv[++i];
+        } else if (std::strcmp(arg, "--replay-input") == 0 && i + 1 < argc) {
+            options.replayInputPath = argv[++i];
+        } else if (std::strcmp(arg, "--scene") == 0 && i + 1 < argc) {
+            options.scenePath = argv[++i];
+        } else if (std::strcmp(arg, "--compile-scene") == 0 && i + 2 < argc) {
+            options.compileSceneInput = argv[++i];
+            options.compileSceneOutput = argv[++i];
+        } else if (std::strcmp(arg, "--entity-benchmark") == 0 && i + 1 < argc) {
+            options.entityBenchmarkCount = std::atoi(argv[++i]);
+        } else if (std::strcmp(arg, "--particle-benchmark") == 0 && i + 1 < argc) {
+            options.particleBenchmarkCount = std::atoi(argv[++i]);
+        } else if (std::strcmp(arg, "--bake-ibl") == 0) {
+            options.bakeEnvironments = true;
+        } else if (std::strcmp(arg, "--seed") == 0 && i + 1 < argc) {
+            options.randomSeed = (unsigned int)std::strtoul(argv[++i], nullptr, 10);
+        } else if (std::strcmp(arg, "--lights") == 0 && i + 1 < argc) {
+            options.stressLights = std::atoi(argv[++i]);
+        } else if (std::strcmp(arg, "--smoke") == 0 && i + 1 < argc) {
+            options.smokeParticles = std::max(std::atoi(argv[++i]), 0);
+        } else if (std::strcmp(arg, "--smoke-gpu") == 0) {
+            options.gpuSmoke = true;
+        } else if (std::strcmp(arg, "--gpu-particle-benchmark") == 0 && i + 1 < argc) {
+            options.gpuParticleBenchmarkMax = std::atoi(argv[++i]);
+        } else {
+            std::cout << "ERROR: unknown option or missing value: " << arg << std::endl;
+            PrintUsage(argv[0]);
+            return false;
+        }
+    }
+    return true;
+}
@@ -0,0 +1,116 @@
+#ifndef OPTIONS_H
+#define OPTIONS_H
+
+#include <string>
+
+// Runtime switches for the renderer, parsed from the command line
+struct Options {
+    // Use clustered forward shading (shader/clustered.frag) for the lit pass
+    bool clusteredLighting = false;
+    // Deferred shading for the opaque scene (overrides clusteredLighting)
+    bool deferredShading = false;
+    // Forward path: upload a per-object top-N light list instead of the first N lights
+    bool perObjectLights = true;
+    // Depth pre-pass for the opaque scene: 0 = off, 1 = on, 2 = auto (DepthPrepass::Mode)
+    int depthPrepass = 0;
+    // Skip objects hidden behind the big static meshes (CPU occlusion buffer)
+    bool occlusionCulling = false;
+    // Show the occlusion buffer in a corner of the screen (implies occlusionCulling)
+    bool occlusionDebug = false;
+    // Shadow maps for the scene lights, cached in one atlas (ShadowAtlas)
+    bool shadows = false;
+    // Ambient and blurred reflections from the skybox, precomputed and cached (EnvironmentLighting)
+    bool imageBasedLighting = false;
+    // Reflections of the scene captured at the scene's probes, amortized over frames (ReflectionProbes)
+    bool reflectionProbes = false;
+    // Planar reflections in the reflect mirrors at 1/divisor of the resolution (0 = off, PlanarReflection)
+    int planarDivisor = 0;
+    // Frames a planar reflection is kept while the camera stands still
+    int planarInterval = 4;
+    // Dynamic resolution: GPU frame time to aim for in ms (0 = off, native resolution)
+    float drsTargetMs = 0.0f;
+    // Per-axis resolution scale bounds
+    float drsMinScale = 0.5f;
+    float drsMaxScale = 1.0f;
+    // PID gains of the resolution controller
+    float drsKp = 0.1f;
+    float drsKi = 0.05f;
+    float drsKd = 0.02f;
+    // Upscale sharpening, 0 to 1
+    float drsSharpness = 0.3f;
+    // Temporal upscaling (jittered frames accumulated at native resolution) instead of spatial
+    bool temporalUpscaling = false;
+    // Per-axis render scale of --taa when the resolution isn't driven by --drs
+    float upscaleScale = 0.8f;
+    // Renders this many frames of a fixed camera path with native, spatial and temporal
+    // upscaling, prints the PSNR and GPU time of each and exits (0 = off)
+    int upscaleCompareFrames = 0;
+    // Simulation ticks per second, and the most ticks one frame may catch up
+    float tickRate = 60.0f;
+    int maxTicksPerFrame = 5;
+    // Simulation on the main thread, GL submission on a render thread, handing over snapshots
+    bool threadedRendering = false;
+    // Output size (the window, or the offscreen target when headless)
+    int width = 1200;
+    int height = 1200;
+    // Renders this many frames without a window (EGL), prints frame-time stats and exits (0 = off)
+    int headlessFrames = 0;
+    // Headless: keep the player's start pose instead of following the orbit path
+    bool staticCamera = false;
+    // Headless: save the last frame to this PPM file
+    std::string capturePath;
+    // GPU timer queries around every pass, with a periodic report
+    bool gpuProfile = false;
+    // Profiler: write every frame's scope times to this CSV file
+    std::string gpuProfileCsv;
+    // Profiler: stacked bar graph of the recent frames in a corner of the screen
+    bool gpuProfileOverlay = false;
+    // Records the CPU profiler scopes and writes them as a Chrome trace on exit
+    std::string cpuTracePath;
+    // Flythrough benchmark: write the summary to this file (empty = off)
+    std::string benchmarkPath;
+    // Benchmark camera path file (empty = the built-in flythrough), see CameraPath
+    std::string cameraPathFile;
+    // Benchmark length in frames (0 = the whole path)
+    int benchmarkFrames = 0;
+    // Summary to compare the benchmark with; regressions make the exit code 1
+    std::string benchmarkBaseline;
+    // Percentage a metric may get slower before it counts as a regression
+    float regressionThreshold = 10.0f;
+    // Compare these two summaries and exit (empty = off)
+    std::string compareBaselinePath;
+    std::string compareCurrentPath;
+    // Save the player's camera as a path file on exit
+    std::string recordCameraPath;
+    // Write the player input of every frame to this file (see Input.h)
+    std::string recordInputPath;
+    // Play a recorded input file instead of the keyboard and mouse
+    std::string replayInputPath;
+    // Scene description, text (.scene) or compiled (.sceneb), see Scene.h
+    std::string scenePath = "assets/scenes/farm.scene";
+    // Compile this text scene to the binary form and exit (empty = off)
+    std::string compileSceneInput;
+    std::string compileSceneOutput;
+    // Time the scene traversal of this many objects, per-object against the entity store, and exit (0 = off)
+    int entityBenchmarkCount = 0;
+    // Time the update of this many live particles, vector with erase against the particle store, and exit (0 = off)
+    int particleBenchmarkCount = 0;
+    // Recompute the image-based lighting cache of every skybox and exit
+    bool bakeEnvironments = false;
+    // Seed of the scene's random numbers
+    unsigned int randomSeed = 1;
+    // Adds this many animated point/spot lights to the scene (stress test)
+    int stressLights = 0;
+    // Campfire smoke with this many live particles (0 = off)
+    int smokeParticles = 0;
+    // Simulate the smoke on the GPU (transform feedback) instead of the CPU
+    bool gpuSmoke = false;
+    // GPU particle scaling benchmark, from 10,000 particles up to this many, then exit (0 = off)
+    int gpuParticleBenchmarkMax = 0;
+};
+
+// Parses argv into options. Prints usage and returns false for an unknown
+// flag, a missing value or a bad pre-pass mode
+bool ParseOptions(int argc, char** argv, Options& options);
+
+#endif
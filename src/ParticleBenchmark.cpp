@@ -0,0 +1,217 @@
+// ParticleBenchmark.cpp - Array-of-structs with erase against structure-of-arrays with swap-and-pop
+
+#include "ParticleBenchmark.h"
+#include "Particle.h"
+#include "ParticleSystem.h"
+#include "GpuParticleSystem.h"
+#include "ParticleKernels.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <vector>
+
+static const int BENCHMARK_FRAMES = 30;
+static const float FRAME_SECONDS = 1.0f / 60.0f;
+
+namespace {
+
+double Milliseconds(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+// The update as ParticleSystem had it: every dead particle is erased where it is
+void UpdateErase(std::vector<Particle>& particles, float dt)
+{
+    for (auto it = particles.begin(); it != particles.end();) {
+        it->life -= dt;
+        if (it->life <= 0.0f) {
+            it = particles.erase(it);
+        } else {
+            it->position += it->velocity * dt;
+            it->alpha = it->life / 1.5f;
+            ++it;
+        }
+    }
+}
+
+// Same random particles for both layouts
+struct Emitter {
+    std::mt19937 random;
+    std::uniform_real_distribution<float> spread{-0.5f, 0.5f}, rise{1.0f, 2.0f}, age{0.0f, 1.0f};
+
+    explicit Emitter(unsigned int seed) : random(seed) {}
+    glm::vec3 velocity() { return glm::vec3(spread(random), rise(random), spread(random)); }
+};
+
+// Average update time over `frames` frames with `count` live particles. The
+// ages start spread over the lifetime, so about the same number die every
+// frame; the dead are replaced after each (untimed).
+template <class Spawn, class LiveCount, class Update>
+double TimeSteadyState(int count, int frames, Spawn spawn, LiveCount liveCount, Update update)
+{
+    Emitter emitter(1);
+    for (int i = 0; i < count; ++i)
+        spawn(glm::vec3(0.0f), emitter.velocity(), PARTICLE_LIFETIME * (1.0f - emitter.age(emitter.random)));
+    double ms = 0.0;
+    for (int frame = 0; frame < frames; ++frame) {
+        auto start = std::chrono::steady_clock::now();
+        update();
+        ms += Milliseconds(start);
+        while (liveCount() < (size_t)count) spawn(glm::vec3(0.0f), emitter.velocity(), PARTICLE_LIFETIME);
+    }
+    return ms / frames;
+}
+
+// The particles the kernels start from, the same in every store
+void FillStore(ParticleStore& store, int count)
+{
+    store.clear();
+    Emitter emitter(1);
+    for (int i = 0; i < count; ++i) {
+        glm::vec3 position(emitter.spread(emitter.random), emitter.age(emitter.random), emitter.spread(emitter.random));
+        store.spawn(position, emitter.velocity(), PARTICLE_LIFETIME * (1.0f - emitter.age(emitter.random)), 0.5f);
+    }
+}
+
+// Index of the first particle whose state or dead bit differs, or -1
+long long FirstDifference(const ParticleStore& a, const ParticleStore& b, const uint16_t* masksA, const uint16_t* masksB)
+{
+    const float* arraysA[] = { a.positionX, a.positionY, a.positionZ, a.life, a.alpha };
+    const float* arraysB[] = { b.positionX, b.positionY, b.positionZ, b.life, b.alpha };
+    for (size_t i = 0; i < a.liveCount(); ++i) {
+        for (int k = 0; k < 5; ++k)
+            if (std::memcmp(&arraysA[k][i], &arraysB[k][i], sizeof(float)) != 0) return (long long)i;
+        if (((masksA[i / 16] ^ masksB[i / 16]) >> (i % 16)) & 1u) return (long long)i;
+    }
+    return -1;
+}
+
+double TimeStoreUpdate(int count, int frames)
+{
+    ParticleStore store((size_t)count);
+    return TimeSteadyState(count, frames,
+                           [&](const glm::vec3& p, const glm::vec3& v, float life) { store.spawn(p, v, life, 0.5f); },
+                           [&]() { return store.liveCount(); },
+                           [&]() { UpdateParticles(store, FRAME_SECONDS); });
+}
+
+}
+
+int RunParticleBenchmark(int count)
+{
+    count = std::max(count, 1);
+    // The vector erases about count * dt / lifetime particles a frame, each
+    // moving the rest of the vector: a few frames are enough past 100k
+    int eraseFrames = count > 100000 ? 2 : BENCHMARK_FRAMES;
+    std::cout << "Particle benchmark: " << count << " live particles, " << BENCHMARK_FRAMES << " frames ("
+              << eraseFrames << " for the vector), dt " << FRAME_SECONDS << "s" << std::endl;
+
+    std::vector<Particle> vector;
+    vector.reserve(count);
+    double eraseMs = TimeSteadyState(count, eraseFrames,
+                                     [&](const glm::vec3& p, const glm::vec3& v, float life) { vector.emplace_back(p, v, life, 0.5f); },
+                                     [&]() { return vector.size(); },
+                                     [&]() { UpdateErase(vector, FRAME_SECONDS); });
+    double storeMs = TimeStoreUpdate(count, BENCHMARK_FRAMES);
+
+    auto report = [&](const char* name, double ms) {
+        std::cout << "[particles] " << std::left << std::setw(22) << name << std::right << std::fixed << std::setprecision(3)
+                  << std::setw(11) << ms << "ms  " << std::setprecision(2) << std::setw(8) << ms * 1.0e6 / count << "ns/particle"
+                  << std::defaultfloat << std::setprecision(6) << std::endl;
+    };
+    report("vector, erase", eraseMs);
+    report("soa, swap and pop", storeMs);
+    std::cout << "[particles] speedup " << std::fixed << std::setprecision(1) << eraseMs / storeMs << "x"
+              << std::defaultfloat << std::setprecision(6) << std::endl;
+
+    // The integration kernel alone by instruction set, and checked bit for bit
+    // against the scalar reference over a few steps (lives run out on the way)
+    const int CHECK_STEPS = 100;
+    ParticleStore reference((size_t)count), store((size_t)count);
+    std::vector<uint16_t> referenceMasks(reference.deadMasks.size());
+    FillStore(reference, count);
+    for (int step = 0; step < CHECK_STEPS; ++step)
+        IntegrateParticles(SimdIsa::Scalar, reference, FRAME_SECONDS, PARTICLE_LIFETIME, referenceMasks.data());
+    std::cout << "[particles] UpdateParticles runs the " << SimdIsaName(DetectSimdIsa()) << " kernel" << std::endl;
+    const SimdIsa isas[] = { SimdIsa::Scalar, SimdIsa::SSE2, SimdIsa::AVX2, SimdIsa::AVX512 };
+    double scalarNs = 0.0;
+    for (SimdIsa isa : isas) {
+        if (!SimdIsaSupported(isa)) {
+            std::cout << "[particles] kernel " << std::left << std::setw(7) << SimdIsaName(isa) << std::right
+                      << " not supported by this CPU or build" << std::endl;
+            continue;
+        }
+        FillStore(store, count);
+        auto start = std::chrono::steady_clock::now();
+        for (int frame = 0; frame < BENCHMARK_FRAMES; ++frame)
+            IntegrateParticles(isa, store, FRAME_SECONDS, PARTICLE_LIFETIME, store.deadMasks.data());
+        double ns = Milliseconds(start) * 1.0e6 / BENCHMARK_FRAMES;
+        if (isa == SimdIsa::Scalar) scalarNs = ns;
+
+        FillStore(store, count);
+        for (int step = 0; step < CHECK_STEPS; ++step)
+            IntegrateParticles(isa, store, FRAME_SECONDS, PARTICLE_LIFETIME, store.deadMasks.data());
+        long long difference = FirstDifference(reference, store, referenceMasks.data(), store.deadMasks.data());
+
+        std::cout << "[particles] kernel " << std::left << std::setw(7) << SimdIsaName(isa) << std::right << std::fixed
+                  << std::setprecision(3) << std::setw(9) << ns / 1.0e6 << "ms  " << std::setprecision(2) << std::setw(6)
+                  << count / ns << " particles/ns  " << std::setprecision(1) << scalarNs / ns << "x  ";
+        if (difference < 0) std::cout << "bit-exact";
+        else std::cout << "DIFFERS from scalar at particle " << difference;
+        std::cout << std::defaultfloat << std::setprecision(6) << std::endl;
+    }
+    return 0;
+}
+
+int RunGpuParticleBenchmark(int maxCount)
+{
+    std::cout << "GPU particle benchmark: " << glGetString(GL_RENDERER) << ", " << BENCHMARK_FRAMES
+              << " updates per size, dt " << FRAME_SECONDS << "s" << std::endl;
+    // Draws need a complete framebuffer even with the rasterizer off, and a
+    // surfaceless context has none
+    GLuint colorBuffer, framebuffer;
+    glGenRenderbuffers(1, &colorBuffer);
+    glBindRenderbuffer(GL_RENDERBUFFER, colorBuffer);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, 1, 1);
+    glGenFramebuffers(1, &framebuffer);
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, colorBuffer);
+    for (long long count = 10000; count <= std::max(maxCount, 10000); count *= 10) {
+        double gpuMs = 0.0;
+        size_t live = 0;
+        {
+            GpuParticleSystem system(nullptr, 0, (size_t)count, count / PARTICLE_LIFETIME);
+            for (int warmup = 0; warmup < 3; ++warmup) system.update(FRAME_SECONDS);
+            glFinish();
+
+            // Wall time to completion: software drivers report no GPU time for transform feedback alone
+            auto start = std::chrono::steady_clock::now();
+            for (int frame = 0; frame < BENCHMARK_FRAMES; ++frame) system.update(FRAME_SECONDS);
+            glFinish();
+            gpuMs = Milliseconds(start) / BENCHMARK_FRAMES;
+
+            // Every slot should be alive in the steady state (one spawn per lifetime)
+            std::vector<float> state(system.capacity() * GpuParticleSystem::FLOATS_PER_PARTICLE);
+            glBindBuffer(GL_ARRAY_BUFFER, system.stateBuffer());
+            glGetBufferSubData(GL_ARRAY_BUFFER, 0, state.size() * sizeof(float), state.data());
+            glBindBuffer(GL_ARRAY_BUFFER, 0);
+            for (size_t i = 0; i < system.capacity(); ++i)
+                if (state[i * GpuParticleSystem::FLOATS_PER_PARTICLE + 7] > 0.0f) live++;
+        }
+        double cpuMs = TimeStoreUpdate((int)count, BENCHMARK_FRAMES);
+
+        std::cout << "[gpu particles] " << std::setw(9) << count << std::fixed << std::setprecision(3)
+                  << "  gpu " << std::setw(10) << gpuMs << "ms (" << std::setprecision(2) << gpuMs * 1.0e6 / count << "ns/particle)"
+                  << std::setprecision(3)
+                  << "  cpu store " << std::setw(10) << cpuMs << "ms (" << std::setprecision(2) << cpuMs * 1.0e6 / count << "ns/particle)"
+                  << "  live " << live << std::defaultfloat << std::setprecision(6) << std::endl;
+    }
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glDeleteFramebuffers(1, &framebuffer);
+    glDeleteRenderbuffers(1, &colorBuffer);
+    return 0;
+}
@@ -0,0 +1,14 @@
+#ifndef PARTICLE_BENCHMARK_H
+#define PARTICLE_BENCHMARK_H
+
+// Times the particle update with `count` live particles in a steady state
+// (as many emitted as died each frame), stored as a vector of Particle erased
+// in place (as ParticleSystem used to) and in the ParticleStore. No GL needed.
+int RunParticleBenchmark(int count);
+
+// Times the transform feedback update (GpuParticleSystem) against the CPU
+// update of the ParticleStore, from 10,000 particles up to maxCount by powers
+// of ten. Needs a current GL context.
+int RunGpuParticleBenchmark(int maxCount);
+
+#endif
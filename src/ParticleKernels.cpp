@@ -0,0 +1,206 @@
+// ParticleKernels.cpp - Scalar, SSE2, AVX2 and AVX-512 particle integration, dispatched on CPUID
+//
+// Built with -ffp-contract=off (CMakeLists.txt): a multiply and an add must stay
+// two roundings in every variant, or the results drift from the scalar reference.
+
+#include "ParticleKernels.h"
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define PARTICLE_KERNELS_X86
+#include <immintrin.h>
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#define TARGET_SSE2
+#define TARGET_AVX2
+#define TARGET_AVX512
+#else
+#include <cpuid.h>
+// Compiled for these sets whatever the build's -march; only called when CPUID has them
+#define TARGET_SSE2 __attribute__((target("sse2")))
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#define TARGET_AVX512 __attribute__((target("avx512f")))
+#endif
+#endif
+
+namespace {
+
+// The arrays a kernel reads and writes, and the padded count (a multiple of 16)
+struct KernelArrays {
+    float* positionX;
+    float* positionY;
+    float* positionZ;
+    const float* velocityX;
+    const float* velocityY;
+    const float* velocityZ;
+    float* life;
+    float* alpha;
+    size_t count;
+};
+
+// Reference: one particle at a time, the operations every variant reproduces
+void IntegrateScalar(const KernelArrays& a, float dt, float lifetime, uint16_t* deadMasks)
+{
+    for (size_t i = 0; i < a.count; i += 16) {
+        unsigned mask = 0;
+        for (size_t j = 0; j < 16; ++j) {
+            size_t k = i + j;
+            float life = a.life[k] - dt;
+            a.life[k] = life;
+            a.positionX[k] = a.positionX[k] + a.velocityX[k] * dt;
+            a.positionY[k] = a.positionY[k] + a.velocityY[k] * dt;
+            a.positionZ[k] = a.positionZ[k] + a.velocityZ[k] * dt;
+            a.alpha[k] = life / lifetime;
+            if (life <= 0.0f) mask |= 1u << j;
+        }
+        deadMasks[i / 16] = (uint16_t)mask;
+    }
+}
+
+#ifdef PARTICLE_KERNELS_X86
+
+TARGET_SSE2 void IntegrateSSE2(const KernelArrays& a, float dt, float lifetime, uint16_t* deadMasks)
+{
+    const __m128 step = _mm_set1_ps(dt);
+    const __m128 span = _mm_set1_ps(lifetime);
+    const __m128 zero = _mm_setzero_ps();
+    for (size_t i = 0; i < a.count; i += 16) {
+        unsigned mask = 0;
+        for (size_t j = 0; j < 16; j += 4) {
+            size_t k = i + j;
+            __m128 life = _mm_sub_ps(_mm_load_ps(a.life + k), step);
+            _mm_store_ps(a.life + k, life);
+            _mm_store_ps(a.positionX + k, _mm_add_ps(_mm_load_ps(a.positionX + k), _mm_mul_ps(_mm_load_ps(a.velocityX + k), step)));
+            _mm_store_ps(a.positionY + k, _mm_add_ps(_mm_load_ps(a.positionY + k), _mm_mul_ps(_mm_load_ps(a.velocityY + k), step)));
+            _mm_store_ps(a.positionZ + k, _mm_add_ps(_mm_load_ps(a.positionZ + k), _mm_mul_ps(_mm_load_ps(a.velocityZ + k), step)));
+            _mm_store_ps(a.alpha + k, _mm_div_ps(life, span));
+            mask |= (unsigned)_mm_movemask_ps(_mm_cmple_ps(life, zero)) << j;
+        }
+        deadMasks[i / 16] = (uint16_t)mask;
+    }
+}
+
+TARGET_AVX2 void IntegrateAVX2(const KernelArrays& a, float dt, float lifetime, uint16_t* deadMasks)
+{
+    const __m256 step = _mm256_set1_ps(dt);
+    const __m256 span = _mm256_set1_ps(lifetime);
+    const __m256 zero = _mm256_setzero_ps();
+    for (size_t i = 0; i < a.count; i += 16) {
+        unsigned mask = 0;
+        for (size_t j = 0; j < 16; j += 8) {
+            size_t k = i + j;
+            __m256 life = _mm256_sub_ps(_mm256_load_ps(a.life + k), step);
+            _mm256_store_ps(a.life + k, life);
+            _mm256_store_ps(a.positionX + k, _mm256_add_ps(_mm256_load_ps(a.positionX + k), _mm256_mul_ps(_mm256_load_ps(a.velocityX + k), step)));
+            _mm256_store_ps(a.positionY + k, _mm256_add_ps(_mm256_load_ps(a.positionY + k), _mm256_mul_ps(_mm256_load_ps(a.velocityY + k), step)));
+            _mm256_store_ps(a.positionZ + k, _mm256_add_ps(_mm256_load_ps(a.positionZ + k), _mm256_mul_ps(_mm256_load_ps(a.velocityZ + k), step)));
+            _mm256_store_ps(a.alpha + k, _mm256_div_ps(life, span));
+            mask |= (unsigned)_mm256_movemask_ps(_mm256_cmp_ps(life, zero, _CMP_LE_OQ)) << j;
+        }
+        deadMasks[i / 16] = (uint16_t)mask;
+    }
+}
+
+TARGET_AVX512 void IntegrateAVX512(const KernelArrays& a, float dt, float lifetime, uint16_t* deadMasks)
+{
+    const __m512 step = _mm512_set1_ps(dt);
+    const __m512 span = _mm512_set1_ps(lifetime);
+    const __m512 zero = _mm512_setzero_ps();
+    for (size_t i = 0; i < a.count; i += 16) {
+        __m512 life = _mm512_sub_ps(_mm512_load_ps(a.life + i), step);
+        _mm512_store_ps(a.life + i, life);
+        _mm512_store_ps(a.positionX + i, _mm512_add_ps(_mm512_load_ps(a.positionX + i), _mm512_mul_ps(_mm512_load_ps(a.velocityX + i), step)));
+        _mm512_store_ps(a.positionY + i, _mm512_add_ps(_mm512_load_ps(a.positionY + i), _mm512_mul_ps(_mm512_load_ps(a.velocityY + i), step)));
+        _mm512_store_ps(a.positionZ + i, _mm512_add_ps(_mm512_load_ps(a.positionZ + i), _mm512_mul_ps(_mm512_load_ps(a.velocityZ + i), step)));
+        _mm512_store_ps(a.alpha + i, _mm512_div_ps(life, span));
+        deadMasks[i / 16] = (uint16_t)_mm512_cmp_ps_mask(life, zero, _CMP_LE_OQ);
+    }
+}
+
+void Cpuid(unsigned leaf, unsigned subleaf, unsigned registers[4])
+{
+#if defined(_MSC_VER) && !defined(__clang__)
+    int r[4];
+    __cpuidex(r, (int)leaf, (int)subleaf);
+    for (int i = 0; i < 4; ++i) registers[i] = (unsigned)r[i];
+#else
+    __cpuid_count(leaf, subleaf, registers[0], registers[1], registers[2], registers[3]);
+#endif
+}
+
+// XCR0: which register files the OS saves on a context switch
+unsigned long long ReadXcr0()
+{
+#if defined(_MSC_VER) && !defined(__clang__)
+    return _xgetbv(0);
+#else
+    unsigned eax, edx;
+    __asm__ volatile("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+    return ((unsigned long long)edx << 32) | eax;
+#endif
+}
+
+SimdIsa QueryCpu()
+{
+    unsigned r[4];
+    Cpuid(0, 0, r);
+    unsigned maxLeaf = r[0];
+    Cpuid(1, 0, r);
+    if (!(r[3] & (1u << 26))) return SimdIsa::Scalar;          // EDX: SSE2
+    bool osSaves = (r[2] & (1u << 27)) != 0;                    // ECX: OSXSAVE
+    if (!osSaves || maxLeaf < 7) return SimdIsa::SSE2;
+    unsigned long long xcr0 = ReadXcr0();
+    if ((xcr0 & 0x6) != 0x6) return SimdIsa::SSE2;              // XMM and YMM state
+    Cpuid(7, 0, r);
+    bool avx2 = (r[1] & (1u << 5)) != 0;                        // EBX: AVX2
+    bool avx512 = (r[1] & (1u << 16)) != 0;                     // EBX: AVX512F
+    if (avx512 && (xcr0 & 0xE6) == 0xE6) return SimdIsa::AVX512; // Plus opmask and ZMM state
+    return avx2 ? SimdIsa::AVX2 : SimdIsa::SSE2;
+}
+
+#else
+
+SimdIsa QueryCpu()
+{
+    return SimdIsa::Scalar;
+}
+
+#endif
+
+}
+
+const char* SimdIsaName(SimdIsa isa)
+{
+    switch (isa) {
+    case SimdIsa::SSE2: return "sse2";
+    case SimdIsa::AVX2: return "avx2";
+    case SimdIsa::AVX512: return "avx512";
+    default: return "scalar";
+    }
+}
+
+SimdIsa DetectSimdIsa()
+{
+    static const SimdIsa detected = QueryCpu();
+    return detected;
+}
+
+bool SimdIsaSupported(SimdIsa isa)
+{
+    return (int)isa <= (int)DetectSimdIsa();
+}
+
+void IntegrateParticles(SimdIsa isa, ParticleStore& particles, float dt, float lifetime, uint16_t* deadMasks)
+{
+    KernelArrays arrays = { particles.positionX, particles.positionY, particles.positionZ,
+                            particles.velocityX, particles.velocityY, particles.velocityZ,
+                            particles.life, particles.alpha, (particles.liveCount() + 15) / 16 * 16 };
+    if (!SimdIsaSupported(isa)) isa = DetectSimdIsa();
+    switch (isa) {
+#ifdef PARTICLE_KERNELS_X86
+    case SimdIsa::SSE2: IntegrateSSE2(arrays, dt, lifetime, deadMasks); break;
+    case SimdIsa::AVX2: IntegrateAVX2(arrays, dt, lifetime, deadMasks); break;
+    case SimdIsa::AVX512: IntegrateAVX512(arrays, dt, lifetime, deadMasks); break;
+#endif
+    default: IntegrateScalar(arrays, dt, lifetime, deadMasks); break;
+    }
+}
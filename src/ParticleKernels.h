@@ -0,0 +1,30 @@
+#ifndef PARTICLE_KERNELS_H
+#define PARTICLE_KERNELS_H
+
+#include <cstdint>
+#include "ParticleStore.h"
+
+// Vectorized particle integration over the ParticleStore arrays, 16 particles
+// per step: SSE2 (4 x 4 lanes), AVX2 (2 x 8) or AVX-512 (1 x 16), picked at
+// run time from CPUID. Every variant rounds exactly like the scalar reference
+// (the same operations, no fused multiply-add), so their results are bit for
+// bit the same.
+enum class SimdIsa {
+    Scalar,
+    SSE2,
+    AVX2,
+    AVX512,
+};
+
+const char* SimdIsaName(SimdIsa isa);
+// The widest set both the CPU (CPUID, with the OS saving its registers) and this build support
+SimdIsa DetectSimdIsa();
+bool SimdIsaSupported(SimdIsa isa);
+
+// For every particle up to liveCount() (rounded up to 16, into the arrays'
+// padding): life -= dt, position += velocity * dt, alpha = life / lifetime.
+// Bit j of deadMasks[k] is set when particle 16k + j has life <= 0; the caller
+// kills them. deadMasks holds (liveCount() + 15) / 16 words.
+void IntegrateParticles(SimdIsa isa, ParticleStore& particles, float dt, float lifetime, uint16_t* deadMasks);
+
+#endif
@@ -0,0 +1,47 @@
+// ParticleStore.cpp - Fixed-capacity structure-of-arrays particle storage
+
+#include "ParticleStore.h"
+#include <cstdint>
+
+ParticleStore::ParticleStore(size_t capacity)
+    : deadMasks((capacity + ARRAY_PADDING - 1) / ARRAY_PADDING), maxCount(capacity)
+{
+    size_t stride = (capacity + ARRAY_PADDING - 1) / ARRAY_PADDING * ARRAY_PADDING;
+    size_t bytes = stride * sizeof(float) * ARRAY_COUNT;
+    storage.reset(new unsigned char[bytes + ALIGNMENT]());
+    uintptr_t address = reinterpret_cast<uintptr_t>(storage.get());
+    float* base = reinterpret_cast<float*>((address + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT);
+
+    float** arrays[ARRAY_COUNT] = { &positionX, &positionY, &positionZ, &velocityX, &velocityY, &velocityZ, &life, &size, &alpha };
+    for (int a = 0; a < ARRAY_COUNT; ++a) *arrays[a] = base + a * stride;
+}
+
+bool ParticleStore::spawn(const glm::vec3& position, const glm::vec3& velocity, float lifetime, float particleSize)
+{
+    if (count == maxCount) return false;
+    size_t i = count++;
+    positionX[i] = position.x;
+    positionY[i] = position.y;
+    positionZ[i] = position.z;
+    velocityX[i] = velocity.x;
+    velocityY[i] = velocity.y;
+    velocityZ[i] = velocity.z;
+    life[i] = lifetime;
+    size[i] = particleSize;
+    alpha[i] = 1.0f;
+    return true;
+}
+
+void ParticleStore::kill(size_t i)
+{
+    size_t last = --count;
+    positionX[i] = positionX[last];
+    positionY[i] = positionY[last];
+    positionZ[i] = positionZ[last];
+    velocityX[i] = velocityX[last];
+    velocityY[i] = velocityY[last];
+    velocityZ[i] = velocityZ[last];
+    life[i] = life[last];
+    size[i] = size[last];
+    alpha[i] = alpha[last];
+}
@@ -0,0 +1,55 @@
+#ifndef PARTICLE_STORE_H
+#define PARTICLE_STORE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include <glm/glm.hpp>
+
+// Particles as structure-of-arrays with a fixed capacity: particle i is index i
+// of every array. Live particles are packed at the front, so killing one moves
+// the last particle into its slot (the order is not kept). Every array starts
+// on a 64-byte boundary and is padded to a multiple of 16 floats, so loops can
+// run over whole SIMD registers past liveCount().
+class ParticleStore {
+public:
+    static const size_t ALIGNMENT = 64;  // Bytes, a cache line and an AVX-512 register
+    static const size_t ARRAY_PADDING = ALIGNMENT / sizeof(float);
+
+    float* positionX;
+    float* positionY;
+    float* positionZ;
+    float* velocityX;
+    float* velocityY;
+    float* velocityZ;
+    float* life;      // Seconds left
+    float* size;
+    float* alpha;
+    // Scratch of UpdateParticles: one bit per particle, 16 per word (ParticleKernels.h)
+    std::vector<uint16_t> deadMasks;
+
+    explicit ParticleStore(size_t capacity);
+    ParticleStore(const ParticleStore&) = delete;
+    ParticleStore& operator=(const ParticleStore&) = delete;
+
+    // False (and nothing added) when the store is full
+    bool spawn(const glm::vec3& position, const glm::vec3& velocity, float lifetime, float particleSize);
+    // O(1): the last particle takes index i
+    void kill(size_t i);
+    void clear() { count = 0; }
+
+    size_t liveCount() const { return count; }
+    size_t capacity() const { return maxCount; }
+    bool empty() const { return count == 0; }
+    bool full() const { return count == maxCount; }
+    glm::vec3 position(size_t i) const { return glm::vec3(positionX[i], positionY[i], positionZ[i]); }
+
+private:
+    static const int ARRAY_COUNT = 9;
+    std::unique_ptr<unsigned char[]> storage;
+    size_t maxCount;
+    size_t count = 0;
+};
+
+#endif
@@ -1,14 +1,16 @@
 // ParticleSystem.cpp - Implementation of a simple billboard particle system for OpenGL
 // Each ParticleSystem manages a set of particles, emits, updates, and draws them as camera-facing quads
+// (instanced: particle.vert turns each instance into a billboard)
 
 #include "ParticleSystem.h"
+#include "CpuProfiler.h"
+#include "ParticleKernels.h"
 #include <cstdlib>
-#include <glm/gtc/matrix_transform.hpp>
 #include <iostream>
 
 // Constructor: initializes OpenGL buffers and quad geometry for rendering particles
-ParticleSystem::ParticleSystem(Shader* shader, GLuint textureID)
-    : shader(shader), textureID(textureID)
+ParticleSystem::ParticleSystem(Shader* shader, GLuint textureID, size_t capacity)
+    : particles(capacity), shader(shader), textureID(textureID)
 {
     float quad[] = {
         -0.5f, -0.5f,
@@ -19,13 +21,24 @@ ParticleSystem::ParticleSystem(Shader* shader, GLuint textureID)
 
     glGenVertexArrays(1, &VAO);
     glGenBuffers(1, &VBO);
+    glGenBuffers(1, &instanceVBO);
 
     glBindVertexArray(VAO);
     glBindBuffer(GL_ARRAY_BUFFER, VBO);
     glBufferData(GL_ARRAY_BUFFER, sizeof(quad), quad, GL_STATIC_DRAW);
     glEnableVertexAttribArray(0);
     glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(float), (void*)0);
-    
+
+    // Per-instance attributes 1 to 5, each a block of `capacity` floats
+    glBindBuffer(GL_ARRAY_BUFFER, instanceVBO);
+    glBufferData(GL_ARRAY_BUFFER, INSTANCE_ARRAYS * capacity * sizeof(float), nullptr, GL_STREAM_DRAW);
+    for (GLuint a = 0; a < INSTANCE_ARRAYS; ++a) {
+        glEnableVertexAttribArray(1 + a);
+        glVertexAttribPointer(1 + a, 1, GL_FLOAT, GL_FALSE, sizeof(float), (void*)(a * capacity * sizeof(float)));
+        glVertexAttribDivisor(1 + a, 1);
+    }
+    glBindVertexArray(0);
+
     std::cout << "ParticleSystem created with texture ID: " << textureID << std::endl;
 }
 
@@ -33,41 +46,50 @@ ParticleSystem::ParticleSystem(Shader* shader, GLuint textureID)
 ParticleSystem::~ParticleSystem() {
     glDeleteVertexArrays(1, &VAO);
     glDeleteBuffers(1, &VBO);
+    glDeleteBuffers(1, &instanceVBO);
 }
 
-// Emit a new particle at the given origin with random velocity
-void ParticleSystem::emit(glm::vec3 origin) {
-    glm::vec3 velocity(
-        (rand() % 100 - 50) / 100.0f, // random X velocity
-        (rand() % 100) / 100.0f + 1.0f, // random upward Y velocity
-        (rand() % 100 - 50) / 100.0f  // random Z velocity
-    );
-    particles.emplace_back(origin, velocity, 1.5f, 0.5f); // life, size
+// Emit a new particle at the emitter's origin with random velocity
+void ParticleSystem::emit() {
+    glm::vec3 random((rand() % 100) / 100.0f, (rand() % 100) / 100.0f, (rand() % 100) / 100.0f);
+    glm::vec3 velocity = emitter.velocityMin + (emitter.velocityMax - emitter.velocityMin) * random;
+    particles.spawn(emitter.origin, velocity, emitter.lifetime, emitter.size);
 }
 
-// Update all particles: move, fade, and remove dead ones
-void ParticleSystem::update(float dt) {
-    for (auto it = particles.begin(); it != particles.end();) {
-        it->life -= dt; // decrease life
-        if (it->life <= 0.0f) {
-            it = particles.erase(it); // remove dead particle
-        } else {
-            it->position += it->velocity * dt; // move
-            it->alpha = it->life / 1.5f; // fade out
-            ++it;
+// Move, fade, and remove dead particles
+void UpdateParticles(ParticleStore& particles, float dt, float lifetime) {
+    size_t count = particles.liveCount();
+    if (count == 0) return;
+    // Every particle moved and faded, the dead ones flagged
+    IntegrateParticles(DetectSimdIsa(), particles, dt, lifetime, particles.deadMasks.data());
+
+    // Kill from the back: the particle that moves into a freed slot comes from
+    // further back, so it has been checked already
+    size_t words = (count + 15) / 16;
+    unsigned tail = (unsigned)(count % 16);
+    for (size_t word = words; word-- > 0;) {
+        unsigned mask = particles.deadMasks[word];
+        if (word == words - 1 && tail) mask &= (1u << tail) - 1; // Padding lanes
+        for (int bit = 15; mask && bit >= 0; --bit) {
+            if (mask & (1u << bit)) {
+                particles.kill(word * 16 + bit);
+                mask &= ~(1u << bit);
+            }
         }
     }
 }
 
-// Draw all particles as camera-facing billboards
-void ParticleSystem::draw(Camera& camera) {
-    if (particles.empty()) {
-        return; // Don't bother drawing if there are no particles
-    }
+void ParticleSystem::update(float dt) {
+    CPU_PROFILE_SCOPE("ParticleSystem::update");
+    UpdateParticles(particles, dt, emitter.lifetime);
+}
 
-    shader->Activate();
-    glBindVertexArray(VAO);
+void DrawParticleBillboards(Shader& shader, GLuint textureID, GLuint vao, GLsizei count, Camera& camera) {
+    shader.Activate();
+    glBindVertexArray(vao);
+    glActiveTexture(GL_TEXTURE0);
     glBindTexture(GL_TEXTURE_2D, textureID);
+    glUniform1i(glGetUniformLocation(shader.ID, "smokeTexture"), 0);
 
     // Properly set up blending for particle transparency
     glEnable(GL_BLEND);
@@ -77,40 +99,39 @@ void ParticleSystem::draw(Camera& camera) {
     glDepthMask(GL_FALSE);
 
     // Set camera uniforms
-    glUniform3f(glGetUniformLocation(shader->ID, "camPos"), camera.Position.x, camera.Position.y, camera.Position.z);
-    camera.Matrix(*shader, "camMatrix");
+    camera.Matrix(shader, "camMatrix");
 
-    // Billboard calculation - ensure particles always face the camera
+    // Billboard axes, the vertex shader spans each quad on them
     glm::vec3 cameraRight = glm::normalize(glm::cross(camera.Orientation, camera.Up));
-    glm::vec3 cameraUp = glm::normalize(glm::cross(camera.Orientation, -cameraRight));
-
-    int drawnCount = 0;
-    for (const auto& p : particles) {
-        // Create billboard model matrix
-        glm::mat4 model = glm::mat4(1.0f);
-        model = glm::translate(model, p.position);
-        
-        // Make the model face the camera (billboard)
-        model[0][0] = cameraRight.x; model[1][0] = cameraRight.y; model[2][0] = cameraRight.z;
-        model[0][1] = cameraUp.x;    model[1][1] = cameraUp.y;    model[2][1] = cameraUp.z;
-        model[0][2] = camera.Orientation.x; model[1][2] = camera.Orientation.y; model[2][2] = camera.Orientation.z;
-        
-        // Scale the particle
-        model = glm::scale(model, glm::vec3(p.size * 20.0f));  // Increased from 10.0f to 20.0f
-
-        glUniformMatrix4fv(glGetUniformLocation(shader->ID, "model"), 1, GL_FALSE, &model[0][0]);
-        glUniform1f(glGetUniformLocation(shader->ID, "alpha"), p.alpha);
-
-        glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
-        drawnCount++;
-    }
+    glm::vec3 cameraUp = glm::normalize(glm::cross(cameraRight, camera.Orientation));
+    glUniform3fv(glGetUniformLocation(shader.ID, "cameraRight"), 1, &cameraRight[0]);
+    glUniform3fv(glGetUniformLocation(shader.ID, "cameraUp"), 1, &cameraUp[0]);
 
-  
-    if (rand() % 1000 == 0) {
-        std::cout << "Drew " << drawnCount << " particles" << std::endl;
-    }
+    glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, count);
 
     // Restore depth writing
     glDepthMask(GL_TRUE);
     glDisable(GL_BLEND);
+    glBindVertexArray(0);
+}
+
+// Draw all particles as camera-facing billboards
+void ParticleSystem::draw(Camera& camera) {
+    CPU_PROFILE_SCOPE("ParticleSystem::draw");
+    if (particles.empty()) {
+        return; // Don't bother drawing if there are no particles
+    }
+
+    // Stream the live particles: orphan last frame's storage (the GPU may still
+    // be reading it) and copy each array into its block
+    size_t count = particles.liveCount();
+    size_t capacity = particles.capacity();
+    const float* arrays[INSTANCE_ARRAYS] = { particles.positionX, particles.positionY, particles.positionZ, particles.size, particles.alpha };
+    glBindBuffer(GL_ARRAY_BUFFER, instanceVBO);
+    glBufferData(GL_ARRAY_BUFFER, INSTANCE_ARRAYS * capacity * sizeof(float), nullptr, GL_STREAM_DRAW);
+    for (GLuint a = 0; a < INSTANCE_ARRAYS; ++a)
+        glBufferSubData(GL_ARRAY_BUFFER, a * capacity * sizeof(float), count * sizeof(float), arrays[a]);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    DrawParticleBillboards(*shader, textureID, VAO, (GLsizei)count, camera);
 }
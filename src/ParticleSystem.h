@@ -5,23 +5,54 @@
 #include <glad/glad.h>
 #include <glm/glm.hpp>
 #include "shaderClass.h"
-#include "Particle.h"
+#include "ParticleStore.h"
 #include "Camera.h"
 
+// Seconds a particle lives by default; its alpha fades from 1 to 0 over it
+const float PARTICLE_LIFETIME = 1.5f;
+
+// Where and how new particles start, the same for the CPU (ParticleSystem)
+// and GPU (GpuParticleSystem) paths. Velocities are uniform in the box.
+struct ParticleEmitter {
+    glm::vec3 origin = glm::vec3(0.0f);
+    glm::vec3 velocityMin = glm::vec3(-0.5f, 1.0f, -0.5f);
+    glm::vec3 velocityMax = glm::vec3(0.5f, 2.0f, 0.5f);
+    float lifetime = PARTICLE_LIFETIME;
+    float size = 0.5f;                 // Width of the quad, world units
+};
+
+// Ages, moves and fades every particle by dt and kills the ones out of life.
+// The survivors keep being packed at the front of the store. The arithmetic
+// runs in the widest SIMD kernel the CPU has (ParticleKernels.h).
+void UpdateParticles(ParticleStore& particles, float dt, float lifetime = PARTICLE_LIFETIME);
+
+// Draws `count` instances of vao (the quad at attribute 0, the particles at
+// attributes 1 to 5 as in particle.vert) as alpha-blended camera-facing quads
+void DrawParticleBillboards(Shader& shader, GLuint textureID, GLuint vao, GLsizei count, Camera& camera);
+
 class ParticleSystem {
 public:
-    std::vector<Particle> particles;
-    unsigned int VAO, VBO;
+    static const size_t DEFAULT_CAPACITY = 10000;
+    static const GLuint INSTANCE_ARRAYS = 5;
+
+    ParticleEmitter emitter;
+    ParticleStore particles;
+    // VBO holds the quad; instanceVBO is refilled every draw with the live
+    // particles, one block per ParticleStore array (x, y, z, size, alpha)
+    unsigned int VAO, VBO, instanceVBO;
     Shader* shader;
     GLuint textureID;
 
-    ParticleSystem(Shader* shader, GLuint textureID);
+    // Emitting into a full system drops the new particle
+    ParticleSystem(Shader* shader, GLuint textureID, size_t capacity = DEFAULT_CAPACITY);
     ~ParticleSystem();
 
     void update(float dt);
-    void draw(Camera& camera); // Changed to take Camera&
+    // All live particles as camera-facing quads, `size` wide, in one instanced draw call
+    void draw(Camera& camera);
 
-    void emit(glm::vec3 origin);
+    // One particle at emitter.origin
+    void emit();
 };
 
 #endif
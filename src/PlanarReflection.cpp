@@ -0,0 +1,192 @@
+// PlanarReflection.cpp - Mirrored-camera render of a flat mirror, oblique near plane
+
+#include "PlanarReflection.h"
+#include "CpuProfiler.h"
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <glm/gtc/matrix_inverse.hpp>
+
+PlanarReflection::PlanarReflection(const glm::mat4& mirrorMatrix, int divisor, int interval)
+    : matrix(mirrorMatrix), divisor(std::max(divisor, 1)), interval(std::max(interval, 1))
+{
+    planePoint = glm::vec3(matrix[3]);
+    // The quad's triangles are counter-clockwise seen from local -Y
+    planeNormal = glm::normalize(glm::inverseTranspose(glm::mat3(matrix)) * glm::vec3(0.0f, -1.0f, 0.0f));
+    const glm::vec2 local[4] = { glm::vec2(-1, -1), glm::vec2(1, -1), glm::vec2(1, 1), glm::vec2(-1, 1) };
+    for (int i = 0; i < 4; ++i) corners[i] = glm::vec3(matrix * glm::vec4(local[i].x, 0.0f, local[i].y, 1.0f));
+}
+
+PlanarReflection::~PlanarReflection()
+{
+    glDeleteTextures(1, &colorTexture);
+    glDeleteRenderbuffers(1, &depthBuffer);
+    glDeleteFramebuffers(1, &fbo);
+}
+
+void PlanarReflection::resize(int width, int height)
+{
+    textureWidth = width;
+    textureHeight = height;
+    if (!colorTexture) {
+        glGenTextures(1, &colorTexture);
+        glGenRenderbuffers(1, &depthBuffer);
+        glGenFramebuffers(1, &fbo);
+    }
+    glBindTexture(GL_TEXTURE_2D, colorTexture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    // Bilinear, it is magnified onto the mirror
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glBindRenderbuffer(GL_RENDERBUFFER, depthBuffer);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width, height);
+    glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+    GLint previousFramebuffer = 0;
+    glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &previousFramebuffer);
+    glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, colorTexture, 0);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, depthBuffer);
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+        std::cout << "ERROR: planar reflection framebuffer is incomplete" << std::endl;
+    glBindFramebuffer(GL_FRAMEBUFFER, previousFramebuffer);
+}
+
+bool PlanarReflection::screenRect(const glm::mat4& viewProjection, glm::vec2& rectMin, glm::vec2& rectMax) const
+{
+    glm::vec4 clip[4];
+    bool behind = false;
+    for (int i = 0; i < 4; ++i) {
+        clip[i] = viewProjection * glm::vec4(corners[i], 1.0f);
+        behind = behind || clip[i].w <= 1e-5f;
+    }
+    // Off screen if all corners are outside the same clip plane
+    for (int axis = 0; axis < 3; ++axis) {
+        bool allBelow = true, allAbove = true;
+        for (int i = 0; i < 4; ++i) {
+            allBelow = allBelow && clip[i][axis] < -clip[i].w;
+            allAbove = allAbove && clip[i][axis] > clip[i].w;
+        }
+        if (allBelow || allAbove) return false;
+    }
+    // Corners behind the camera don't project; keep the whole screen
+    if (behind) {
+        rectMin = glm::vec2(-1.0f);
+        rectMax = glm::vec2(1.0f);
+        return true;
+    }
+    rectMin = glm::vec2(1.0f);
+    rectMax = glm::vec2(-1.0f);
+    for (int i = 0; i < 4; ++i) {
+        glm::vec2 ndc = glm::vec2(clip[i]) / clip[i].w;
+        rectMin = glm::min(rectMin, ndc);
+        rectMax = glm::max(rectMax, ndc);
+    }
+    rectMin = glm::max(rectMin, glm::vec2(-1.0f));
+    rectMax = glm::min(rectMax, glm::vec2(1.0f));
+    return rectMin.x < rectMax.x && rectMin.y < rectMax.y;
+}
+
+void PlanarReflection::update(const Camera& camera, int screenWidth, int screenHeight, const DrawScene& drawScene)
+{
+    CPU_PROFILE_SCOPE("PlanarReflection::update");
+    seen = false;
+    glm::vec2 rectMin, rectMax;
+    if (glm::dot(camera.Position - planePoint, planeNormal) <= 0.0f || !screenRect(camera.cameraMatrix, rectMin, rectMax)) {
+        culledFrames++;
+        return;
+    }
+    seen = true;
+
+    int width = std::max(screenWidth / divisor, 1);
+    int height = std::max(screenHeight / divisor, 1);
+    if (width != textureWidth || height != textureHeight) {
+        resize(width, height);
+        valid = false;
+    }
+    glm::vec3 direction = glm::normalize(camera.Orientation);
+    bool still = valid && glm::length(camera.Position - lastPosition) < moveThreshold
+              && 1.0f - glm::dot(direction, lastDirection) < turnThreshold;
+    framesSinceRender++;
+    if (still && framesSinceRender < interval) {
+        reusedFrames++;
+        return;
+    }
+
+    // Mirror about the plane: x' = x - 2 (n.x - d) n
+    glm::vec3 n = planeNormal;
+    float d = glm::dot(n, planePoint);
+    glm::mat4 reflection(1.0f);
+    for (int column = 0; column < 3; ++column)
+        for (int row = 0; row < 3; ++row)
+            reflection[column][row] -= 2.0f * n[column] * n[row];
+    reflection[3] = glm::vec4(2.0f * d * n, 1.0f);
+
+    Camera mirrored(camera.width, camera.height, glm::vec3(reflection * glm::vec4(camera.Position, 1.0f)));
+    mirrored.Orientation = glm::reflect(camera.Orientation, n);
+    mirrored.Up = glm::reflect(camera.Up, n);
+    mirrored.FOVdeg = camera.FOVdeg;
+    mirrored.nearPlane = camera.nearPlane;
+    mirrored.farPlane = camera.farPlane;
+    mirrored.jitter = camera.jitter;
+    mirrored.view = camera.view * reflection;
+
+    // Oblique near plane (Lengyel): replace the near plane by the mirror plane,
+    // given in the mirrored view space with the camera on its negative side
+    glm::mat4 projection = camera.projection;
+    glm::vec4 plane = glm::transpose(glm::inverse(mirrored.view)) * glm::vec4(n, -d);
+    glm::vec4 q((glm::sign(plane.x) + projection[2][0]) / projection[0][0],
+                (glm::sign(plane.y) + projection[2][1]) / projection[1][1],
+                -1.0f,
+                (1.0f + projection[2][2]) / projection[3][2]);
+    glm::vec4 c = plane * (2.0f / glm::dot(plane, q));
+    projection[0][2] = c.x;
+    projection[1][2] = c.y;
+    projection[2][2] = c.z + 1.0f;
+    projection[3][2] = c.w;
+    mirrored.projection = projection;
+    mirrored.cameraMatrix = projection * mirrored.view;
+    mirrored.unjitteredMatrix = mirrored.cameraMatrix;
+
+    // The mirror covers the same rectangle in both views: crop the frustum to it
+    glm::vec2 size = rectMax - rectMin;
+    glm::mat4 crop(1.0f);
+    crop[0][0] = 2.0f / size.x;
+    crop[1][1] = 2.0f / size.y;
+    crop[3][0] = -(rectMax.x + rectMin.x) / size.x;
+    crop[3][1] = -(rectMax.y + rectMin.y) / size.y;
+
+    GLint viewport[4];
+    glGetIntegerv(GL_VIEWPORT, viewport);
+    GLint previousFramebuffer = 0;
+    glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &previousFramebuffer);
+
+    glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+    glViewport(0, 0, textureWidth, textureHeight);
+    // Texels of the rectangle, one more on each side for the bilinear taps
+    int x0 = std::max((int)std::floor((rectMin.x * 0.5f + 0.5f) * textureWidth) - 1, 0);
+    int y0 = std::max((int)std::floor((rectMin.y * 0.5f + 0.5f) * textureHeight) - 1, 0);
+    int x1 = std::min((int)std::ceil((rectMax.x * 0.5f + 0.5f) * textureWidth) + 1, textureWidth);
+    int y1 = std::min((int)std::ceil((rectMax.y * 0.5f + 0.5f) * textureHeight) + 1, textureHeight);
+    glEnable(GL_SCISSOR_TEST);
+    glScissor(x0, y0, x1 - x0, y1 - y0);
+    glClearColor(0.07f, 0.13f, 0.17f, 1.0f);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    // The mirrored view turns the triangles around
+    glFrontFace(GL_CW);
+    drawScene(mirrored, crop * mirrored.cameraMatrix);
+    glFrontFace(GL_CCW);
+    glDisable(GL_SCISSOR_TEST);
+
+    glBindFramebuffer(GL_FRAMEBUFFER, previousFramebuffer);
+    glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+
+    valid = true;
+    framesSinceRender = 0;
+    lastPosition = camera.Position;
+    lastDirection = direction;
+    renderedFrames++;
+}
@@ -0,0 +1,70 @@
+#ifndef PLANAR_REFLECTION_H
+#define PLANAR_REFLECTION_H
+
+#include <functional>
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include "Camera.h"
+
+// Reflection of the scene in one flat mirror, rendered from the camera
+// mirrored about the mirror's plane. The mirror then reads it in screen space.
+//
+//  - The near plane of the mirrored camera is the mirror plane (oblique
+//    clipping), so nothing behind the mirror shows up in it.
+//  - The scene is culled, and the render scissored, to the mirror's rectangle
+//    on screen.
+//  - The texture is 1/divisor of the screen on each axis. While the camera
+//    stands still it is only re-rendered every `interval` frames.
+//  - Nothing is rendered when the mirror is off screen or seen from the back.
+//
+// The mirror is a unit quad in its model's XZ plane (the mirror mesh in
+// main.cpp); it faces the side its triangles are counter-clockwise from.
+class PlanarReflection {
+public:
+    // Camera movement below these keeps the last render
+    float moveThreshold = 0.001f;      // World units
+    float turnThreshold = 1e-6f;       // 1 - cos(angle) between the view directions
+
+    PlanarReflection(const glm::mat4& mirrorMatrix, int divisor, int interval);
+    ~PlanarReflection();
+    PlanarReflection(const PlanarReflection&) = delete;
+    PlanarReflection& operator=(const PlanarReflection&) = delete;
+
+    // Draws the scene for the mirrored camera; cullMatrix is its view-projection
+    // cropped to the mirror's rectangle, for frustum culling
+    typedef std::function<void(Camera& mirrored, const glm::mat4& cullMatrix)> DrawScene;
+
+    // Decides whether the mirror is seen and re-renders its texture if needed.
+    // screenWidth x screenHeight is the size the mirror is drawn at.
+    void update(const Camera& camera, int screenWidth, int screenHeight, const DrawScene& drawScene);
+
+    // False when the last update found the mirror off screen or facing away
+    bool visible() const { return seen; }
+    GLuint textureID() const { return colorTexture; }
+
+    // Since the start, by outcome of update
+    int renderedFrames = 0;
+    int reusedFrames = 0;
+    int culledFrames = 0;
+
+private:
+    glm::mat4 matrix;
+    glm::vec3 planePoint, planeNormal;
+    glm::vec3 corners[4];
+    int divisor;
+    int interval;
+
+    GLuint colorTexture = 0, depthBuffer = 0, fbo = 0;
+    int textureWidth = 0, textureHeight = 0;
+
+    bool seen = false;
+    bool valid = false;              // The texture holds a render for lastPosition/lastDirection
+    int framesSinceRender = 0;
+    glm::vec3 lastPosition, lastDirection;
+
+    void resize(int width, int height);
+    // Screen rectangle of the mirror in NDC; false if it is off screen
+    bool screenRect(const glm::mat4& viewProjection, glm::vec2& rectMin, glm::vec2& rectMax) const;
+};
+
+#endif
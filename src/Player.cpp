@@ -1,4 +1,5 @@
 #include "Player.h"
+#include "CpuProfiler.h"
 
 Player::Player(int width, int height, glm::vec3 startPos)
     : camera(width, height, startPos), speed(30.0f),
@@ -7,6 +8,7 @@ Player::Player(int width, int height, glm::vec3 startPos)
 {
     // Set player at ground level initially
     camera.Position.y = groundLevel + 1.7f; // Eye level height
+    previousPosition = camera.Position;
     
     // Define a collider around the player (smaller box)
     glm::vec3 halfSize(0.3f, 0.85f, 0.3f); // Player capsule dimensions
@@ -14,13 +16,16 @@ Player::Player(int width, int height, glm::vec3 startPos)
     collider.max = camera.Position + halfSize;
 }
 
-void Player::Update(GLFWwindow* window, const std::vector<Collider>& worldColliders, float deltaTime)
+void Player::Update(const InputState& input, const std::vector<Collider>& worldColliders, float deltaTime)
 {
+    CPU_PROFILE_SCOPE("Player::Update");
+    previousPosition = camera.Position;
+
     // Apply gravity and check if grounded
     ApplyGravity(deltaTime);
     
     // Handle jumping
-    if (glfwGetKey(window, GLFW_KEY_SPACE) == GLFW_PRESS && isGrounded)
+    if (input.down(InputState::Jump) && isGrounded)
     {
         verticalVelocity = jumpForce;
         isGrounded = false;
@@ -29,28 +34,28 @@ void Player::Update(GLFWwindow* window, const std::vector<Collider>& worldCollid
     glm::vec3 moveDir(0.0f);
 
     // Horizontal movement (XZ plane)
-    if (glfwGetKey(window, GLFW_KEY_W) == GLFW_PRESS)
+    if (input.down(InputState::Forward))
     {
         glm::vec3 forward = camera.Orientation;
         forward.y = 0.0f; // Project onto XZ plane
         if (glm::length(forward) > 0.0f)
             moveDir += glm::normalize(forward);
     }
-    if (glfwGetKey(window, GLFW_KEY_S) == GLFW_PRESS)
+    if (input.down(InputState::Back))
     {
         glm::vec3 backward = -camera.Orientation;
         backward.y = 0.0f; // Project onto XZ plane
         if (glm::length(backward) > 0.0f)
             moveDir += glm::normalize(backward);
     }
-    if (glfwGetKey(window, GLFW_KEY_A) == GLFW_PRESS)
+    if (input.down(InputState::Left))
     {
         glm::vec3 left = -glm::normalize(glm::cross(camera.Orientation, camera.Up));
         left.y = 0.0f; // Project onto XZ plane
         if (glm::length(left) > 0.0f)
             moveDir += glm::normalize(left);
     }
-    if (glfwGetKey(window, GLFW_KEY_D) == GLFW_PRESS)
+    if (input.down(InputState::Right))
     {
         glm::vec3 right = glm::normalize(glm::cross(camera.Orientation, camera.Up));
         right.y = 0.0f; // Project onto XZ plane
@@ -98,7 +103,6 @@ void Player::Update(GLFWwindow* window, const std::vector<Collider>& worldCollid
     collider.min = camera.Position - halfSize;
     collider.max = camera.Position + halfSize;
 
-    camera.Inputs(window);
     camera.updateMatrix(45.0f, 0.1f, 100.0f);
 }
 
@@ -6,6 +6,7 @@
 #include <glm/glm.hpp>
 #include "Camera.h"
 #include "Collider.h"
+#include "Input.h"
 #include <vector>
 
 class Player
@@ -22,9 +23,16 @@ public:
     bool isGrounded;
     float groundLevel; // Y-coordinate of the ground
 
+    // Eye position before the last Update, for render interpolation
+    glm::vec3 previousPosition;
+
     Player(int width, int height, glm::vec3 startPos);
 
-    void Update(GLFWwindow* window, const std::vector<Collider>& worldColliders, float deltaTime);
+    // One simulation tick: movement keys, gravity and collisions. Mouse look is
+    // per rendered frame (camera.Inputs), not part of the tick.
+    void Update(const InputState& input, const std::vector<Collider>& worldColliders, float deltaTime);
+    // Eye position `alpha` of the way from the previous tick to the current one
+    glm::vec3 InterpolatedPosition(float alpha) const { return glm::mix(previousPosition, camera.Position, alpha); }
 
 private:
     bool CheckCollision(glm::vec3 newPosition, const std::vector<Collider>& worldColliders);
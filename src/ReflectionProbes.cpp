@@ -0,0 +1,253 @@
+// ReflectionProbes.cpp - Scene cubemaps captured one face per frame
+
+#include "ReflectionProbes.h"
+#include "CpuProfiler.h"
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <glm/gtc/type_ptr.hpp>
+
+const int ReflectionProbes::FACE_SIZE;
+const int ReflectionProbes::MIP_LEVELS;
+const int ReflectionProbes::STEPS;
+const int ReflectionProbes::MAX_PROBE_LIGHTS;
+
+// Texture unit of the cubemapSampler in the lit shaders
+static const GLuint CUBEMAP_UNIT = 3;
+
+// View direction and up vector of each face, GL order (+X, -X, +Y, -Y, +Z, -Z)
+static const glm::vec3 FACE_DIRECTIONS[6] = {
+    glm::vec3(1, 0, 0), glm::vec3(-1, 0, 0), glm::vec3(0, 1, 0),
+    glm::vec3(0, -1, 0), glm::vec3(0, 0, 1), glm::vec3(0, 0, -1)
+};
+static const glm::vec3 FACE_UPS[6] = {
+    glm::vec3(0, -1, 0), glm::vec3(0, -1, 0), glm::vec3(0, 0, 1),
+    glm::vec3(0, 0, -1), glm::vec3(0, -1, 0), glm::vec3(0, -1, 0)
+};
+
+ReflectionProbes::ReflectionProbes(const std::vector<SceneProbe>& sceneProbes)
+    : captureShader("shader/default.vert", "shader/probe.frag"),
+      blendShader("shader/fullscreen.vert", "shader/probe_blend.frag")
+{
+    SetSpotConeUniforms(captureShader);
+    for (const SceneProbe& sceneProbe : sceneProbes) {
+        Probe probe;
+        probe.position = sceneProbe.position;
+        probe.range = sceneProbe.range;
+        glGenTextures(1, &probe.texture);
+        glBindTexture(GL_TEXTURE_CUBE_MAP, probe.texture);
+        for (int level = 0; level < MIP_LEVELS; ++level) {
+            int size = FACE_SIZE >> level;
+            for (int f = 0; f < 6; ++f)
+                glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + f, level, GL_RGBA8, size, size, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+        }
+        glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+        glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_BASE_LEVEL, 0);
+        glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAX_LEVEL, MIP_LEVELS - 1);
+        probes.push_back(probe);
+    }
+    glBindTexture(GL_TEXTURE_CUBE_MAP, 0);
+    // Rough reflections read the small levels: filter across the face edges
+    glEnable(GL_TEXTURE_CUBE_MAP_SEAMLESS);
+
+    // Scratch target a face is rendered into before it is blended over the probe
+    glGenTextures(1, &scratchTexture);
+    glBindTexture(GL_TEXTURE_2D, scratchTexture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, FACE_SIZE, FACE_SIZE, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glGenRenderbuffers(1, &scratchDepth);
+    glBindRenderbuffer(GL_RENDERBUFFER, scratchDepth);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, FACE_SIZE, FACE_SIZE);
+    glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+    glGenFramebuffers(1, &scratchFBO);
+    glBindFramebuffer(GL_FRAMEBUFFER, scratchFBO);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, scratchTexture, 0);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, scratchDepth);
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+        std::cout << "ERROR: reflection probe capture framebuffer is incomplete" << std::endl;
+    // Face attachments change per step
+    glGenFramebuffers(1, &faceFBO);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+    glGenVertexArrays(1, &emptyVAO);
+    glGenQueries(2, queries);
+}
+
+ReflectionProbes::~ReflectionProbes()
+{
+    for (Probe& probe : probes) glDeleteTextures(1, &probe.texture);
+    glDeleteTextures(1, &scratchTexture);
+    glDeleteRenderbuffers(1, &scratchDepth);
+    glDeleteFramebuffers(1, &scratchFBO);
+    glDeleteFramebuffers(1, &faceFBO);
+    glDeleteVertexArrays(1, &emptyVAO);
+    glDeleteQueries(2, queries);
+    captureShader.Delete();
+    blendShader.Delete();
+}
+
+void ReflectionProbes::update(const Scene& scene, const EntityStore& entities, const std::vector<Light>& lights, const EnvironmentLighting* environment,
+                              ThreadPool& pool, const DrawExtras& drawExtras)
+{
+    CPU_PROFILE_SCOPE("ReflectionProbes::update");
+    lastDrawCalls = lastSkipped = 0;
+    if (probes.empty()) return;
+
+    GLuint available = 0;
+    if (frameIndex > 0) glGetQueryObjectuiv(queries[(frameIndex + 1) % 2], GL_QUERY_RESULT_AVAILABLE, &available);
+    if (available) {
+        GLuint64 elapsedNs = 0;
+        glGetQueryObjectui64v(queries[(frameIndex + 1) % 2], GL_QUERY_RESULT, &elapsedNs);
+        lastGpuMs = elapsedNs / 1.0e6f;
+    }
+
+    glBeginQuery(GL_TIME_ELAPSED, queries[frameIndex % 2]);
+    step %= (int)probes.size() * STEPS;
+    runStep(probes[step / STEPS], step % STEPS, blend, scene, entities, lights, environment, pool, drawExtras);
+    step++;
+    glEndQuery(GL_TIME_ELAPSED);
+    frameIndex++;
+}
+
+void ReflectionProbes::captureAll(const Scene& scene, const EntityStore& entities, const std::vector<Light>& lights, const EnvironmentLighting* environment,
+                                  ThreadPool& pool, const DrawExtras& drawExtras)
+{
+    for (Probe& probe : probes)
+        for (int s = 0; s < STEPS; ++s) runStep(probe, s, 1.0f, scene, entities, lights, environment, pool, drawExtras);
+}
+
+void ReflectionProbes::runStep(Probe& probe, int probeStep, float weight, const Scene& scene, const EntityStore& entities, const std::vector<Light>& lights,
+                               const EnvironmentLighting* environment, ThreadPool& pool, const DrawExtras& drawExtras)
+{
+    if (probeStep < 6) {
+        renderFace(probe, probeStep, weight, scene, entities, lights, environment, pool, drawExtras);
+        return;
+    }
+    glBindTexture(GL_TEXTURE_CUBE_MAP, probe.texture);
+    glGenerateMipmap(GL_TEXTURE_CUBE_MAP);
+    glBindTexture(GL_TEXTURE_CUBE_MAP, 0);
+}
+
+void ReflectionProbes::renderFace(Probe& probe, int face, float weight, const Scene& scene, const EntityStore& entities, const std::vector<Light>& lights,
+                                  const EnvironmentLighting* environment, ThreadPool& pool, const DrawExtras& drawExtras)
+{
+    GLint viewport[4];
+    glGetIntegerv(GL_VIEWPORT, viewport);
+    GLint previousFramebuffer = 0;
+    glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &previousFramebuffer);
+
+    Camera camera(FACE_SIZE, FACE_SIZE, probe.position);
+    camera.Orientation = FACE_DIRECTIONS[face];
+    camera.Up = FACE_UPS[face];
+    camera.updateMatrix(90.0f, 0.1f, probe.range);
+
+    glBindFramebuffer(GL_FRAMEBUFFER, scratchFBO);
+    glViewport(0, 0, FACE_SIZE, FACE_SIZE);
+    glClearColor(0.07f, 0.13f, 0.17f, 1.0f);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+    // The strongest lights at the probe, by their contribution there
+    std::vector<std::pair<float, size_t>> ranked;
+    for (size_t i = 0; i < lights.size(); ++i) {
+        float strength = lights[i].peakContribution();
+        if (lights[i].type != 0) {
+            float d = glm::length(lights[i].position - probe.position);
+            strength /= LIGHT_ATTENUATION_CONSTANT + LIGHT_ATTENUATION_LINEAR * d + LIGHT_ATTENUATION_QUADRATIC * d * d;
+        }
+        ranked.push_back(std::make_pair(strength, i));
+    }
+    int lightCount = std::min((int)ranked.size(), MAX_PROBE_LIGHTS);
+    std::partial_sort(ranked.begin(), ranked.begin() + lightCount, ranked.end(),
+                      [](const std::pair<float, size_t>& a, const std::pair<float, size_t>& b) { return a.first > b.first; });
+
+    captureShader.Activate();
+    glUniform1i(glGetUniformLocation(captureShader.ID, "lightCount"), lightCount);
+    for (int i = 0; i < lightCount; ++i) lights[ranked[i].second].sendToShader(captureShader, i);
+    if (environment) environment->bind(captureShader);
+    else glUniform1i(glGetUniformLocation(captureShader.ID, "useIbl"), 0);
+
+    // Reduced detail: culled to the face, and objects under minObjectTexels left out
+    CullEntities(entities, camera.cameraMatrix, packets, pool);
+    BuildDrawPackets(entities, packets);
+    float texelsPerUnit = FACE_SIZE * 0.5f; // tan(45 degrees) = 1
+    for (uint32_t mesh = 0; mesh < (uint32_t)scene.assets.size(); ++mesh) {
+        Model& model = *scene.assets[mesh].model;
+        for (uint32_t p = packets.offsets[mesh]; p < packets.offsets[mesh + 1]; ++p) {
+            uint32_t entity = packets.entities[p];
+            glm::vec3 center = 0.5f * (entities.boundsMin[entity] + entities.boundsMax[entity]);
+            float radius = 0.5f * glm::length(entities.boundsMax[entity] - entities.boundsMin[entity]);
+            float distance = std::max(glm::length(center - probe.position) - radius, 0.1f);
+            if (radius / distance * texelsPerUnit < minObjectTexels) {
+                lastSkipped++;
+                continue;
+            }
+            model.Draw(captureShader, camera, entities.worldMatrices[entity]);
+            lastDrawCalls++;
+        }
+    }
+    drawExtras(camera);
+
+    // Old face * (1 - weight) + new face * weight
+    glBindFramebuffer(GL_FRAMEBUFFER, faceFBO);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_CUBE_MAP_POSITIVE_X + face, probe.texture, 0);
+    GLboolean depthWasEnabled = glIsEnabled(GL_DEPTH_TEST);
+    glDisable(GL_DEPTH_TEST);
+    glEnable(GL_BLEND);
+    glBlendColor(0.0f, 0.0f, 0.0f, weight);
+    glBlendFunc(GL_CONSTANT_ALPHA, GL_ONE_MINUS_CONSTANT_ALPHA);
+    blendShader.Activate();
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, scratchTexture);
+    glUniform1i(glGetUniformLocation(blendShader.ID, "capture"), 0);
+    glBindVertexArray(emptyVAO);
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+    glBindVertexArray(0);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    if (depthWasEnabled) glEnable(GL_DEPTH_TEST);
+
+    glBindFramebuffer(GL_FRAMEBUFFER, previousFramebuffer);
+    glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+}
+
+const ReflectionProbes::Probe& ReflectionProbes::nearest(const glm::vec3& point) const
+{
+    size_t best = 0;
+    float bestDistance = glm::length(probes[0].position - point);
+    for (size_t i = 1; i < probes.size(); ++i) {
+        float distance = glm::length(probes[i].position - point);
+        if (distance < bestDistance) {
+            best = i;
+            bestDistance = distance;
+        }
+    }
+    return probes[best];
+}
+
+GLuint ReflectionProbes::nearestTexture(const glm::vec3& point) const
+{
+    return probes.empty() ? 0 : nearest(point).texture;
+}
+
+void ReflectionProbes::bindNearest(Shader& shader, const glm::vec3& point) const
+{
+    if (probes.empty()) return;
+    GLuint texture = nearest(point).texture;
+    shader.Activate();
+    glActiveTexture(GL_TEXTURE0 + CUBEMAP_UNIT);
+    glBindTexture(GL_TEXTURE_CUBE_MAP, texture);
+    glUniform1i(glGetUniformLocation(shader.ID, "cubemapSampler"), CUBEMAP_UNIT);
+    glActiveTexture(GL_TEXTURE0 + ENVIRONMENT_UNIT);
+    glBindTexture(GL_TEXTURE_CUBE_MAP, texture);
+    glUniform1i(glGetUniformLocation(shader.ID, "prefilteredEnv"), ENVIRONMENT_UNIT);
+    glUniform1f(glGetUniformLocation(shader.ID, "prefilteredMaxLod"), (float)(MIP_LEVELS - 1));
+    glActiveTexture(GL_TEXTURE0);
+}
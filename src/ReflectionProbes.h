@@ -0,0 +1,91 @@
+#ifndef REFLECTION_PROBES_H
+#define REFLECTION_PROBES_H
+
+#include <functional>
+#include <vector>
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include "Camera.h"
+#include "EnvironmentLighting.h"
+#include "EntityStore.h"
+#include "Light.h"
+#include "Scene.h"
+#include "shaderClass.h"
+
+// Dynamic reflection probes: cubemaps of the scene seen from fixed points,
+// read by the reflective models and the mirrors instead of the skybox.
+//
+// The capture is spread over frames. Each update renders one face of one probe
+// (culled to the face, small objects skipped, Lambert-only shading with the few
+// strongest lights, no shadows) into a scratch target and blends it over the
+// old face, so changes fade in instead of popping. After the six faces, one more
+// step rebuilds the mip chain that rough reflections read. The probes take
+// turns: with n probes each one is refreshed every n * STEPS frames.
+class ReflectionProbes {
+public:
+    static const int FACE_SIZE = 128;
+    static const int MIP_LEVELS = 4;       // 128 down to 16
+    static const int STEPS = 7;            // Six faces, then the mip chain
+    static const int MAX_PROBE_LIGHTS = 4; // Strongest lights at the probe
+
+    // Weight of a new capture over the old one
+    float blend = 0.5f;
+    // Objects smaller than this on the face (in texels) are left out
+    float minObjectTexels = 1.0f;
+
+    explicit ReflectionProbes(const std::vector<SceneProbe>& probes);
+    ~ReflectionProbes();
+    ReflectionProbes(const ReflectionProbes&) = delete;
+    ReflectionProbes& operator=(const ReflectionProbes&) = delete;
+
+    // Draws what isn't an entity (skybox, campfire) with the face's camera
+    typedef std::function<void(Camera&)> DrawExtras;
+
+    // Renders this frame's step. The models come from scene, their transforms
+    // from entities (the render thread's copy). environment may be null (no IBL).
+    void update(const Scene& scene, const EntityStore& entities, const std::vector<Light>& lights, const EnvironmentLighting* environment,
+                ThreadPool& pool, const DrawExtras& drawExtras);
+    // Every step of every probe at once, without blending (at load time)
+    void captureAll(const Scene& scene, const EntityStore& entities, const std::vector<Light>& lights, const EnvironmentLighting* environment,
+                    ThreadPool& pool, const DrawExtras& drawExtras);
+
+    // Binds the probe nearest to `point` as the lit shaders' cubemapSampler (unit 3)
+    // and prefilteredEnv (ENVIRONMENT_UNIT), and sets prefilteredMaxLod to its mips
+    void bindNearest(Shader& shader, const glm::vec3& point) const;
+    GLuint nearestTexture(const glm::vec3& point) const;
+
+    size_t size() const { return probes.size(); }
+
+    // Cost of the last update
+    float lastGpuMs = 0.0f;       // GPU time, one frame late
+    int lastDrawCalls = 0;
+    int lastSkipped = 0;          // Entities in the face frustum but too small
+
+private:
+    struct Probe {
+        glm::vec3 position;
+        float range;              // Far plane of the faces
+        GLuint texture;
+    };
+    std::vector<Probe> probes;
+    int step = 0;                 // Over all probes: probe = step / STEPS
+
+    Shader captureShader;
+    Shader blendShader;
+    GLuint scratchTexture, scratchDepth, scratchFBO;
+    GLuint faceFBO;
+    GLuint emptyVAO;
+    DrawPackets packets;
+
+    GLuint queries[2];
+    int frameIndex = 0;
+
+    // One face or the mip chain; weight 1 replaces the old face
+    void runStep(Probe& probe, int probeStep, float weight, const Scene& scene, const EntityStore& entities, const std::vector<Light>& lights,
+                 const EnvironmentLighting* environment, ThreadPool& pool, const DrawExtras& drawExtras);
+    void renderFace(Probe& probe, int face, float weight, const Scene& scene, const EntityStore& entities, const std::vector<Light>& lights,
+                    const EnvironmentLighting* environment, ThreadPool& pool, const DrawExtras& drawExtras);
+    const Probe& nearest(const glm::vec3& point) const;
+};
+
+#endif
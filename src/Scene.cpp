@@ -0,0 +1,629 @@
+// Scene.cpp - Scene text parser, compiled (memory-mapped) form and loader
+
+#include "Scene.h"
+#include "CpuProfiler.h"
+#include "Texture.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <map>
+#include <sstream>
+#include <glm/gtc/matrix_transform.hpp>
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+static const char SCENE_MAGIC[8] = { 'S', 'C', 'E', 'N', 'E', 'B', 'I', 'N' };
+// Sections start on this boundary, so the glm types in them are aligned when mapped
+static const uint32_t SCENE_ALIGNMENT = 16;
+
+static_assert(sizeof(SceneAsset) == 28, "SceneAsset is part of the file format");
+static_assert(sizeof(SceneInstance) == 16, "SceneInstance is part of the file format");
+static_assert(sizeof(SceneTransform) == 40, "SceneTransform is part of the file format");
+static_assert(sizeof(SceneLight) == 56, "SceneLight is part of the file format");
+static_assert(sizeof(SceneCollider) == 36, "SceneCollider is part of the file format");
+static_assert(sizeof(SceneMirror) == 72, "SceneMirror is part of the file format");
+static_assert(sizeof(SceneProbe) == 16, "SceneProbe is part of the file format");
+
+// Text scene as read, before it is laid out like the compiled file
+namespace {
+
+struct TextInstance {
+    SceneInstance instance;
+    SceneTransform transform;
+    uint32_t collider;   // ColliderInstanceBounds, ColliderInstancePart or ColliderBox (= none)
+    uint32_t part;
+};
+
+struct TextScene {
+    SceneHeader header;
+    std::vector<SceneAsset> assets;
+    std::vector<TextInstance> instances;
+    std::vector<SceneLight> lights;
+    std::vector<SceneCollider> colliders;
+    std::vector<SceneMirror> mirrors;
+    std::vector<SceneProbe> probes;
+    std::vector<char> strings;
+    std::map<std::string, uint32_t> instanceNames;
+
+    uint32_t addString(const std::string& text)
+    {
+        if (text.empty()) return 0;
+        uint32_t offset = (uint32_t)strings.size();
+        strings.insert(strings.end(), text.begin(), text.end());
+        strings.push_back('\0');
+        return offset;
+    }
+};
+
+// Translation, rotation (degrees, applied y then x then z) and scale
+SceneTransform MakeTransform(const glm::vec3& position, const glm::vec3& degrees, const glm::vec3& scale)
+{
+    SceneTransform transform;
+    transform.position = position;
+    transform.rotation = glm::angleAxis(glm::radians(degrees.y), glm::vec3(0.0f, 1.0f, 0.0f))
+                       * glm::angleAxis(glm::radians(degrees.x), glm::vec3(1.0f, 0.0f, 0.0f))
+                       * glm::angleAxis(glm::radians(degrees.z), glm::vec3(0.0f, 0.0f, 1.0f));
+    transform.scale = scale;
+    return transform;
+}
+
+glm::mat4 TransformMatrix(const SceneTransform& transform)
+{
+    return glm::scale(glm::translate(glm::mat4(1.0f), transform.position) * glm::mat4_cast(transform.rotation), transform.scale);
+}
+
+uint32_t Align(uint32_t offset)
+{
+    return (offset + SCENE_ALIGNMENT - 1) / SCENE_ALIGNMENT * SCENE_ALIGNMENT;
+}
+
+}
+
+SceneFile::~SceneFile()
+{
+    close();
+}
+
+void SceneFile::close()
+{
+#ifndef _WIN32
+    if (mapping) munmap(mapping, size);
+#endif
+    mapping = nullptr;
+    bytes.clear();
+    data = nullptr;
+    size = 0;
+}
+
+bool SceneFile::open(const char* path)
+{
+    close();
+    char magic[sizeof(SCENE_MAGIC)] = {};
+    {
+        std::ifstream in(path, std::ios::binary);
+        if (!in) {
+            std::cout << "ERROR: cannot open scene " << path << std::endl;
+            return false;
+        }
+        in.read(magic, sizeof(magic));
+    }
+    if (std::memcmp(magic, SCENE_MAGIC, sizeof(magic)) != 0) return parseText(path);
+
+#ifndef _WIN32
+    int fd = ::open(path, O_RDONLY);
+    struct stat info;
+    if (fd >= 0 && fstat(fd, &info) == 0 && info.st_size >= (off_t)sizeof(SceneHeader)) {
+        void* address = mmap(nullptr, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (address != MAP_FAILED) {
+            mapping = address;
+            data = (const char*)address;
+            size = (size_t)info.st_size;
+        }
+    }
+    if (fd >= 0) ::close(fd);
+#endif
+    if (!mapping) {
+        // No mmap: one read of the whole file, still no parsing
+        std::ifstream in(path, std::ios::binary | std::ios::ate);
+        bytes.resize((size_t)std::max<std::streamoff>(in.tellg(), 0));
+        in.seekg(0);
+        in.read(bytes.data(), bytes.size());
+        data = bytes.data();
+        size = bytes.size();
+    }
+    if (!validate(path)) {
+        close();
+        return false;
+    }
+    return true;
+}
+
+bool SceneFile::parseText(const char* path)
+{
+    std::ifstream in(path);
+    TextScene scene;
+    std::memset(&scene.header, 0, sizeof(scene.header));
+    scene.header.spawn = glm::vec3(0.0f, 1.7f, 0.0f);
+    scene.strings.push_back('\0'); // Offset 0 is the empty string
+    std::vector<std::string> assetNames;
+    std::string campfireName;
+
+    std::string line;
+    int lineNumber = 0;
+    while (std::getline(in, line)) {
+        lineNumber++;
+        // '#' inside a quoted path is not a comment
+        bool quoted = false;
+        for (size_t i = 0; i < line.size(); ++i) {
+            if (line[i] == '"') quoted = !quoted;
+            else if (line[i] == '#' && !quoted) { line.erase(i); break; }
+        }
+        std::istringstream fields(line);
+        std::string keyword;
+        if (!(fields >> keyword)) continue; // Blank line
+
+        auto fail = [&](const char* expected) {
+            std::cout << "ERROR: " << path << ":" << lineNumber << ": expected " << expected << std::endl;
+            return false;
+        };
+        glm::vec3 position, rotation, scale;
+        auto readVec3 = [&](glm::vec3& v) { return (bool)(fields >> v.x >> v.y >> v.z); };
+        // Instance index of a name declared above
+        auto readParent = [&](uint32_t& parent) {
+            std::string name;
+            if (!(fields >> name)) return false;
+            auto found = scene.instanceNames.find(name);
+            if (found == scene.instanceNames.end()) return false;
+            parent = found->second;
+            return true;
+        };
+        auto addName = [&](const std::string& name, SceneInstance& instance) {
+            if (!scene.instanceNames.insert(std::make_pair(name, (uint32_t)scene.instances.size())).second) return false;
+            instance.name = scene.addString(name);
+            return true;
+        };
+
+        if (keyword == "spawn") {
+            if (!readVec3(scene.header.spawn)) return fail("spawn px py pz");
+        }
+        else if (keyword == "campfire") {
+            if (!(fields >> campfireName)) return fail("campfire <node>");
+        }
+        else if (keyword == "model") {
+            std::string name, file, option;
+            if (!(fields >> name >> std::quoted(file))) return fail("model <name> <path>");
+            SceneAsset asset = {};
+            asset.name = scene.addString(name);
+            asset.path = scene.addString(file);
+            asset.tiling = 1.0f;
+            while (fields >> option) {
+                std::string texture;
+                if (option == "tiling" && fields >> asset.tiling) continue;
+                if (option == "alpha" && fields >> asset.alphaCutoff) continue;
+                if (option == "reflectivity" && fields >> asset.reflectivity) continue;
+                if (option == "roughness" && fields >> asset.roughness) continue;
+                if (option == "texture" && fields >> std::quoted(texture)) {
+                    asset.texture = scene.addString(texture);
+                    continue;
+                }
+                return fail("tiling, alpha, reflectivity, roughness or texture");
+            }
+            assetNames.push_back(name);
+            scene.assets.push_back(asset);
+        }
+        else if (keyword == "instance") {
+            std::string name, option;
+            if (!(fields >> name) || !readVec3(position) || !readVec3(rotation) || !readVec3(scale))
+                return fail("instance <model> px py pz rx ry rz sx sy sz");
+            auto found = std::find(assetNames.begin(), assetNames.end(), name);
+            if (found == assetNames.end()) return fail("the name of a model declared above");
+            TextInstance instance = {};
+            instance.instance.asset = (uint32_t)(found - assetNames.begin());
+            instance.instance.flags = SceneCastsShadow | SceneOccluder;
+            instance.instance.parent = SCENE_NONE;
+            instance.transform = MakeTransform(position, rotation, scale);
+            instance.collider = ColliderBox;
+            while (fields >> option) {
+                std::string kind, part, id;
+                if (option == "name") {
+                    if (!(fields >> id) || !addName(id, instance.instance)) return fail("a new name");
+                }
+                else if (option == "parent") {
+                    if (!readParent(instance.instance.parent)) return fail("the name of an instance or node declared above");
+                }
+                else if (option == "noshadow") instance.instance.flags &= ~SceneCastsShadow;
+                else if (option == "nooccluder") instance.instance.flags &= ~SceneOccluder;
+                else if (option == "collider" && fields >> kind && kind == "bounds") instance.collider = ColliderInstanceBounds;
+                else if (kind == "part" && fields >> part) {
+                    instance.collider = ColliderInstancePart;
+                    instance.part = scene.addString(part);
+                }
+                else return fail("name, parent, noshadow, nooccluder, collider bounds or collider part <material>");
+            }
+            scene.instances.push_back(instance);
+        }
+        else if (keyword == "node") {
+            std::string name, option;
+            if (!(fields >> name) || !readVec3(position) || !readVec3(rotation) || !readVec3(scale))
+                return fail("node <id> px py pz rx ry rz sx sy sz");
+            TextInstance node = {};
+            node.instance.asset = SCENE_NONE;
+            node.instance.parent = SCENE_NONE;
+            node.transform = MakeTransform(position, rotation, scale);
+            node.collider = ColliderBox;
+            if (!addName(name, node.instance)) return fail("a new name");
+            while (fields >> option) {
+                if (option != "parent" || !readParent(node.instance.parent))
+                    return fail("parent <the name of an instance or node declared above>");
+            }
+            scene.instances.push_back(node);
+        }
+        else if (keyword == "light") {
+            std::string type, option;
+            SceneLight light = {};
+            if (!(fields >> type) || !readVec3(light.position) || !readVec3(light.direction)
+                || !(fields >> light.color.r >> light.color.g >> light.color.b >> light.color.a))
+                return fail("light <type> px py pz dx dy dz r g b a");
+            if (type == "directional") light.type = 0;
+            else if (type == "point") light.type = 1;
+            else if (type == "spot") light.type = 2;
+            else return fail("directional, point or spot");
+            light.proxy = 1;
+            light.parent = SCENE_NONE;
+            while (fields >> option) {
+                if (option == "pulse") light.animation = LightPulse;
+                else if (option == "wave") light.animation = LightWave;
+                else if (option == "flicker") light.animation = LightFlicker;
+                else if (option == "noproxy") light.proxy = 0;
+                else if (option == "parent") {
+                    if (!readParent(light.parent)) return fail("the name of an instance or node declared above");
+                }
+                else return fail("pulse, wave, flicker, noproxy or parent");
+            }
+            scene.lights.push_back(light);
+        }
+        else if (keyword == "collider") {
+            std::string kind;
+            SceneCollider collider = {};
+            fields >> kind;
+            if (kind == "cylinder" && readVec3(collider.a) && fields >> collider.b.x >> collider.b.y) collider.kind = ColliderCylinder;
+            else if (kind == "box" && readVec3(collider.a) && readVec3(collider.b)) collider.kind = ColliderBox;
+            else return fail("collider cylinder px py pz radius height, or collider box min.xyz max.xyz");
+            scene.colliders.push_back(collider);
+        }
+        else if (keyword == "mirror") {
+            std::string kind;
+            SceneMirror mirror = {};
+            mirror.refractionIndex = 1.52f; // Glass
+            if (!(fields >> kind) || !readVec3(position) || !readVec3(rotation) || !readVec3(scale))
+                return fail("mirror <kind> px py pz rx ry rz sx sy sz");
+            if (kind == "reflect") mirror.kind = MirrorReflect;
+            else if (kind == "refract") mirror.kind = MirrorRefract;
+            else return fail("reflect or refract");
+            float index;
+            if (fields >> index) mirror.refractionIndex = index;
+            mirror.matrix = TransformMatrix(MakeTransform(position, rotation, scale));
+            scene.mirrors.push_back(mirror);
+        }
+        else if (keyword == "probe") {
+            SceneProbe probe = {};
+            probe.range = 40.0f;
+            if (!readVec3(probe.position)) return fail("probe px py pz [range r]");
+            std::string option;
+            while (fields >> option) {
+                if (option == "range" && fields >> probe.range && probe.range > 0.1f) continue;
+                return fail("range r, above 0.1");
+            }
+            scene.probes.push_back(probe);
+        }
+        else {
+            std::cout << "ERROR: " << path << ":" << lineNumber << ": unknown record '" << keyword << "'" << std::endl;
+            return false;
+        }
+    }
+
+    scene.header.campfire = SCENE_NONE;
+    if (!campfireName.empty()) {
+        auto found = scene.instanceNames.find(campfireName);
+        if (found == scene.instanceNames.end()) {
+            std::cout << "ERROR: " << path << ": campfire on unknown node '" << campfireName << "'" << std::endl;
+            return false;
+        }
+        scene.header.campfire = found->second;
+    }
+    // Instances stay in declaration order, which puts parents before children
+    for (uint32_t i = 0; i < (uint32_t)scene.instances.size(); ++i) {
+        const TextInstance& instance = scene.instances[i];
+        if (instance.collider != ColliderBox) {
+            SceneCollider collider = {};
+            collider.kind = instance.collider;
+            collider.instance = i;
+            collider.part = instance.part;
+            scene.colliders.push_back(collider);
+        }
+    }
+
+    // Same layout as the compiled file
+    SceneHeader& header = scene.header;
+    std::memcpy(header.magic, SCENE_MAGIC, sizeof(SCENE_MAGIC));
+    header.version = SCENE_VERSION;
+    uint32_t offset = Align(sizeof(SceneHeader));
+    auto place = [&](SceneSection section, uint32_t count, size_t elementSize) {
+        header.sections[section].offset = offset;
+        header.sections[section].count = count;
+        offset = Align(offset + (uint32_t)(count * elementSize));
+    };
+    place(SceneAssets, (uint32_t)scene.assets.size(), sizeof(SceneAsset));
+    place(SceneInstances, (uint32_t)scene.instances.size(), sizeof(SceneInstance));
+    place(SceneTransforms, (uint32_t)scene.instances.size(), sizeof(SceneTransform));
+    place(SceneLights, (uint32_t)scene.lights.size(), sizeof(SceneLight));
+    place(SceneColliders, (uint32_t)scene.colliders.size(), sizeof(SceneCollider));
+    place(SceneMirrors, (uint32_t)scene.mirrors.size(), sizeof(SceneMirror));
+    place(SceneProbes, (uint32_t)scene.probes.size(), sizeof(SceneProbe));
+    place(SceneStrings, (uint32_t)scene.strings.size(), 1);
+    header.fileSize = offset;
+
+    bytes.assign(offset, 0);
+    auto copy = [&](SceneSection section, const void* source, size_t length) {
+        if (length) std::memcpy(bytes.data() + header.sections[section].offset, source, length);
+    };
+    copy(SceneAssets, scene.assets.data(), scene.assets.size() * sizeof(SceneAsset));
+    for (size_t i = 0; i < scene.instances.size(); ++i) {
+        std::memcpy(bytes.data() + header.sections[SceneInstances].offset + i * sizeof(SceneInstance),
+                    &scene.instances[i].instance, sizeof(SceneInstance));
+        std::memcpy(bytes.data() + header.sections[SceneTransforms].offset + i * sizeof(SceneTransform),
+                    &scene.instances[i].transform, sizeof(SceneTransform));
+    }
+    copy(SceneLights, scene.lights.data(), scene.lights.size() * sizeof(SceneLight));
+    copy(SceneColliders, scene.colliders.data(), scene.colliders.size() * sizeof(SceneCollider));
+    copy(SceneMirrors, scene.mirrors.data(), scene.mirrors.size() * sizeof(SceneMirror));
+    copy(SceneProbes, scene.probes.data(), scene.probes.size() * sizeof(SceneProbe));
+    copy(SceneStrings, scene.strings.data(), scene.strings.size());
+    std::memcpy(bytes.data(), &header, sizeof(header));
+    data = bytes.data();
+    size = bytes.size();
+    return validate(path);
+}
+
+bool SceneFile::validate(const char* path) const
+{
+    auto fail = [&](const char* problem) {
+        std::cout << "ERROR: scene " << path << ": " << problem << std::endl;
+        return false;
+    };
+    if (size < sizeof(SceneHeader)) return fail("truncated header");
+    const SceneHeader& head = header();
+    if (head.version != SCENE_VERSION) return fail("unsupported version, recompile it");
+    if (head.fileSize != size) return fail("size does not match the header");
+
+    const size_t elementSizes[SceneSectionCount] = {
+        sizeof(SceneAsset), sizeof(SceneInstance), sizeof(SceneTransform), sizeof(SceneLight),
+        sizeof(SceneCollider), sizeof(SceneMirror), sizeof(SceneProbe), 1
+    };
+    for (int s = 0; s < SceneSectionCount; ++s) {
+        uint64_t end = (uint64_t)head.sections[s].offset + (uint64_t)head.sections[s].count * elementSizes[s];
+        if (head.sections[s].offset % SCENE_ALIGNMENT != 0 || end > size) return fail("section out of range");
+    }
+    uint32_t stringBytes = count(SceneStrings);
+    if (stringBytes == 0 || string(0)[stringBytes - 1] != '\0') return fail("bad string table");
+    if (count(SceneTransforms) != count(SceneInstances)) return fail("one transform per instance expected");
+
+    // Indices only; the values are used as they are
+    uint32_t instanceCount = count(SceneInstances);
+    const SceneAsset* assets = section<SceneAsset>(SceneAssets);
+    for (uint32_t i = 0; i < count(SceneAssets); ++i) {
+        if (assets[i].name >= stringBytes || assets[i].path >= stringBytes || assets[i].texture >= stringBytes)
+            return fail("asset out of range");
+    }
+    const SceneInstance* instances = section<SceneInstance>(SceneInstances);
+    for (uint32_t i = 0; i < instanceCount; ++i) {
+        if (instances[i].asset != SCENE_NONE && instances[i].asset >= count(SceneAssets)) return fail("instance of an unknown asset");
+        if (instances[i].parent != SCENE_NONE && instances[i].parent >= i) return fail("instance before its parent");
+        if (instances[i].asset == SCENE_NONE && instances[i].flags != 0) return fail("flags on a node");
+        if (instances[i].name >= stringBytes) return fail("instance name out of range");
+    }
+    if (head.campfire != SCENE_NONE && head.campfire >= instanceCount) return fail("campfire out of range");
+    const SceneLight* lights = section<SceneLight>(SceneLights);
+    for (uint32_t i = 0; i < count(SceneLights); ++i) {
+        // Light::type: 0 = directional, 1 = point, 2 = spot
+        if (lights[i].type < 0 || lights[i].type > 2 || lights[i].animation > LightFlicker) return fail("light type or animation out of range");
+        if (lights[i].parent != SCENE_NONE && lights[i].parent >= instanceCount) return fail("light parent out of range");
+    }
+    const SceneCollider* colliders = section<SceneCollider>(SceneColliders);
+    for (uint32_t i = 0; i < count(SceneColliders); ++i) {
+        bool perInstance = colliders[i].kind == ColliderInstanceBounds || colliders[i].kind == ColliderInstancePart;
+        if (colliders[i].kind > ColliderInstancePart || colliders[i].part >= stringBytes
+            || (perInstance && (colliders[i].instance >= instanceCount || instances[colliders[i].instance].asset == SCENE_NONE)))
+            return fail("collider out of range");
+    }
+    const SceneMirror* mirrors = section<SceneMirror>(SceneMirrors);
+    for (uint32_t i = 0; i < count(SceneMirrors); ++i)
+        if (mirrors[i].kind > MirrorRefract) return fail("mirror kind out of range");
+    return true;
+}
+
+bool SceneFile::save(const char* path) const
+{
+    std::ofstream out(path, std::ios::binary);
+    if (!out) {
+        std::cout << "ERROR: cannot write scene " << path << std::endl;
+        return false;
+    }
+    out.write(data, size);
+    return (bool)out;
+}
+
+bool CompileScene(const char* textPath, const char* compiledPath)
+{
+    SceneFile file;
+    if (!file.open(textPath) || !file.save(compiledPath)) return false;
+    std::cout << "Scene: compiled " << textPath << " to " << compiledPath << " (" << file.count(SceneAssets) << " models, "
+              << file.count(SceneInstances) << " instances, " << file.header().fileSize << " bytes)" << std::endl;
+    return true;
+}
+
+bool Scene::load(const char* path)
+{
+    CPU_PROFILE_SCOPE("Scene::load");
+    auto start = std::chrono::steady_clock::now();
+    SceneFile file;
+    if (!file.open(path)) return false;
+    const SceneHeader& header = file.header();
+    spawn = header.spawn;
+    campfireEntity = header.campfire == SCENE_NONE ? EntityStore::NO_ENTITY : header.campfire;
+
+    const SceneAsset* fileAssets = file.section<SceneAsset>(SceneAssets);
+    const SceneInstance* instances = file.section<SceneInstance>(SceneInstances);
+    const SceneTransform* transforms = file.section<SceneTransform>(SceneTransforms);
+    assets.clear();
+    assets.resize(file.count(SceneAssets));
+    entities = EntityStore();
+    entities.reserve(file.count(SceneInstances));
+    for (size_t i = 0; i < assets.size(); ++i) {
+        const SceneAsset& record = fileAssets[i];
+        Asset& asset = assets[i];
+        asset.name = file.string(record.name);
+        asset.model.reset(new Model(file.string(record.path)));
+        asset.model->SetTextureTiling(record.tiling);
+        asset.model->SetAlphaCutoff(record.alphaCutoff);
+        if (record.texture) asset.model->AddTexture(Texture(file.string(record.texture), "diffuse", 0));
+        asset.reflectivity = record.reflectivity;
+        asset.roughness = record.roughness;
+        glm::vec3 meshMin, meshMax;
+        asset.model->getWorldBounds(glm::mat4(1.0f), meshMin, meshMax);
+        entities.meshBoundsMin.push_back(meshMin);
+        entities.meshBoundsMax.push_back(meshMax);
+    }
+    // Entity i is instance i: the file's parent indices are entity indices
+    for (uint32_t i = 0; i < file.count(SceneInstances); ++i) {
+        uint32_t flags = 0;
+        if (instances[i].flags & SceneCastsShadow) flags |= EntityStore::CastsShadow;
+        if (instances[i].flags & SceneOccluder) flags |= EntityStore::Occluder;
+        uint32_t mesh = instances[i].asset == SCENE_NONE ? EntityStore::NO_MESH : instances[i].asset;
+        uint32_t parent = instances[i].parent == SCENE_NONE ? EntityStore::NO_ENTITY : instances[i].parent;
+        entities.create(mesh, transforms[i].position, transforms[i].rotation, transforms[i].scale, flags, parent);
+    }
+
+    const SceneLight* fileLights = file.section<SceneLight>(SceneLights);
+    lights.clear();
+    lightAnimations.clear();
+    lightProxies.clear();
+    lightParents.clear();
+    for (uint32_t i = 0; i < file.count(SceneLights); ++i) {
+        lights.push_back(Light(fileLights[i].type, fileLights[i].position, fileLights[i].direction, fileLights[i].color));
+        lightAnimations.push_back(fileLights[i].animation);
+        lightProxies.push_back(fileLights[i].proxy != 0);
+        lightParents.push_back(fileLights[i].parent == SCENE_NONE ? EntityStore::NO_ENTITY : fileLights[i].parent);
+    }
+
+    // Fixed colliders are copied; instance colliders get a slot here and are
+    // placed by updateTransforms, from the model box or the part's model-space box
+    const SceneCollider* fileColliders = file.section<SceneCollider>(SceneColliders);
+    std::vector<bool> partsBuilt(assets.size(), false);
+    colliders.clear();
+    colliderSources.clear();
+    for (uint32_t i = 0; i < file.count(SceneColliders); ++i) {
+        const SceneCollider& record = fileColliders[i];
+        if (record.kind == ColliderBox) {
+            colliders.push_back(Collider(record.a, record.b));
+            continue;
+        }
+        if (record.kind == ColliderCylinder) {
+            colliders.push_back(Collider(record.a, record.b.x, record.b.y));
+            continue;
+        }
+        ColliderSource source = {};
+        source.collider = (uint32_t)colliders.size();
+        source.entity = record.instance;
+        source.kind = record.kind;
+        if (record.kind == ColliderInstancePart) {
+            uint32_t assetIndex = instances[record.instance].asset;
+            Model& model = *assets[assetIndex].model;
+            if (!partsBuilt[assetIndex]) {
+                model.buildComponentColliders(glm::mat4(1.0f));
+                partsBuilt[assetIndex] = true;
+            }
+            const Collider* part = model.getComponentCollider(file.string(record.part));
+            if (!part) {
+                std::cout << "WARNING: no material " << file.string(record.part) << " in " << assets[assetIndex].name
+                          << ", instance " << record.instance << " gets no collider" << std::endl;
+                continue;
+            }
+            source.partMin = part->min;
+            source.partMax = part->max;
+        }
+        colliderSources.push_back(source);
+        colliders.push_back(Collider());
+    }
+
+    mirrors.assign(file.section<SceneMirror>(SceneMirrors), file.section<SceneMirror>(SceneMirrors) + file.count(SceneMirrors));
+    probes.assign(file.section<SceneProbe>(SceneProbes), file.section<SceneProbe>(SceneProbes) + file.count(SceneProbes));
+
+    float ms = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+    std::cout << "Scene: " << path << (file.mapped() ? " (mapped)" : "") << ", " << assets.size() << " models, "
+              << entities.size() << " instances, " << lights.size() << " lights, " << colliders.size() << " colliders, "
+              << mirrors.size() << " mirrors, " << probes.size() << " probes in " << ms << "ms" << std::endl;
+    return true;
+}
+
+void Scene::updateTransforms(ThreadPool& pool)
+{
+    UpdateEntityTransforms(entities, pool);
+    if (entities.moved.empty()) return;
+    for (const ColliderSource& source : colliderSources) {
+        if (!(entities.flags[source.entity] & EntityStore::Moved)) continue;
+        if (source.kind == ColliderInstanceBounds) {
+            colliders[source.collider] = Collider(entities.boundsMin[source.entity], entities.boundsMax[source.entity]);
+            continue;
+        }
+        // A trunk: a cylinder standing on the instance origin, a tenth of the part's narrow side wide
+        const glm::mat4& world = entities.worldMatrices[source.entity];
+        glm::vec3 worldMin(std::numeric_limits<float>::max());
+        glm::vec3 worldMax(-std::numeric_limits<float>::max());
+        for (int c = 0; c < 8; ++c) {
+            glm::vec3 corner((c & 1) ? source.partMax.x : source.partMin.x, (c & 2) ? source.partMax.y : source.partMin.y,
+                             (c & 4) ? source.partMax.z : source.partMin.z);
+            glm::vec3 point = glm::vec3(world * glm::vec4(corner, 1.0f));
+            worldMin = glm::min(worldMin, point);
+            worldMax = glm::max(worldMax, point);
+        }
+        glm::vec3 extent = worldMax - worldMin;
+        colliders[source.collider] = Collider(glm::vec3(world[3]), std::min(extent.x, extent.z) * 0.1f, extent.y);
+    }
+}
+
+void Scene::placeLights(std::vector<Light>& placed) const
+{
+    for (size_t i = 0; i < lights.size() && i < placed.size(); ++i) {
+        uint32_t parent = lightParents[i];
+        if (parent == EntityStore::NO_ENTITY) continue;
+        const glm::mat4& world = entities.worldMatrices[parent];
+        placed[i].position = glm::vec3(world * glm::vec4(lights[i].position, 1.0f));
+        // Rotation only; the scale of the entity does not stretch the direction
+        glm::vec3 direction = glm::mat3(world) * lights[i].direction;
+        if (glm::dot(direction, direction) > 0.0f) placed[i].direction = glm::normalize(direction);
+    }
+}
+
+void Scene::animateLights(std::vector<Light>& animated, float time) const
+{
+    for (size_t i = 0; i < lights.size() && i < animated.size(); ++i) {
+        float factor = 1.0f;
+        switch (lightAnimations[i]) {
+        case LightPulse:   factor = 0.3f + 0.7f * std::abs(std::sin(time * 0.5f)); break;
+        case LightWave:    factor = 0.5f + 0.5f * std::cos(time); break;
+        case LightFlicker: factor = 0.8f + 0.2f * std::sin(time * 10.0f); break;
+        default: break;
+        }
+        animated[i].color = lights[i].color * factor;
+    }
+}
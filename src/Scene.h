@@ -0,0 +1,236 @@
+#ifndef SCENE_H
+#define SCENE_H
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+#include "Collider.h"
+#include "EntityStore.h"
+#include "Light.h"
+#include "model.h"
+
+// Scene description: the models, their instances, lights, colliders and mirrors.
+//
+// Text form (.scene), one record per line, '#' starts a comment, paths with
+// spaces in double quotes. Rotations are degrees about x, y and z (applied y, x, z).
+//
+//   spawn    px py pz
+//   campfire <node>
+//   model    <name> <path.obj> [tiling t] [alpha cutoff] [reflectivity r] [roughness r] [texture <diffuse.png>]
+//   instance <model> px py pz  rx ry rz  sx sy sz [name <id>] [parent <id>] [noshadow] [nooccluder]
+//            [collider bounds|part <material>]
+//   node     <id> px py pz  rx ry rz  sx sy sz [parent <id>]
+//   light    directional|point|spot px py pz dx dy dz r g b a [pulse|wave|flicker] [noproxy] [parent <id>]
+//   collider cylinder px py pz radius height
+//   collider box minx miny minz maxx maxy maxz
+//   mirror   reflect|refract px py pz rx ry rz sx sy sz [refraction index]
+//   probe    px py pz [range r]
+//
+// A node is an instance without a model, something to attach things to. With a
+// parent, the transform of an instance, node or light is relative to it; the
+// parent must be named further up. The campfire sits on a named node. A probe
+// is a point the reflections are captured from (--probes), seeing `range` far.
+//
+// Compiled form (.sceneb): a SceneHeader followed by the flat arrays below,
+// little-endian, in the same layout as in memory. It is memory-mapped and used
+// in place; loading only checks the ranges. Text scenes are converted to the
+// same layout in memory, so both go through one loader.
+
+const uint32_t SCENE_VERSION = 5;
+// No asset, parent or campfire
+const uint32_t SCENE_NONE = 0xFFFFFFFFu;
+
+enum SceneSection {
+    SceneAssets,
+    SceneInstances,
+    SceneTransforms, // One per instance, same order
+    SceneLights,
+    SceneColliders,
+    SceneMirrors,
+    SceneProbes,
+    SceneStrings,    // Null-terminated names and paths; count is in bytes
+    SceneSectionCount
+};
+
+struct SceneHeader {
+    char magic[8];       // "SCENEBIN"
+    uint32_t version;
+    uint32_t fileSize;
+    struct { uint32_t offset, count; } sections[SceneSectionCount];
+    glm::vec3 spawn;     // Player start
+    uint32_t campfire;   // Instance the campfire sits on, or SCENE_NONE
+};
+
+// A model file
+struct SceneAsset {
+    uint32_t name, path, texture; // String offsets; texture 0 = none
+    float tiling;
+    float alphaCutoff;
+    float reflectivity;
+    float roughness;     // Blur of the reflection with image-based lighting, 0 = mirror
+};
+
+enum SceneInstanceFlags : uint32_t {
+    SceneCastsShadow = 1 << 0,
+    SceneOccluder    = 1 << 1, // Offered to OcclusionCuller::addStaticModel, which picks the occluders
+};
+
+// Declaration order, so parents come before their children
+struct SceneInstance {
+    uint32_t asset;      // SCENE_NONE for a node
+    uint32_t flags;
+    uint32_t parent;     // Instance index, or SCENE_NONE
+    uint32_t name;       // String offset; 0 = unnamed
+};
+
+// Relative to the parent. World matrices and bounds are derived by the EntityStore
+struct SceneTransform {
+    glm::vec3 position;
+    glm::quat rotation;
+    glm::vec3 scale;
+};
+
+enum SceneLightAnimation : uint32_t {
+    LightSteady,
+    LightPulse,          // 0.3 + 0.7 |sin(t / 2)|
+    LightWave,           // 0.5 + 0.5 cos(t)
+    LightFlicker,        // 0.8 + 0.2 sin(10 t)
+};
+
+struct SceneLight {
+    int32_t type;        // As Light::type
+    glm::vec3 position;
+    glm::vec3 direction;
+    glm::vec4 color;
+    uint32_t animation;
+    uint32_t proxy;      // Draw the small light cube
+    uint32_t parent;     // Instance the position and direction are relative to, or SCENE_NONE
+};
+
+enum SceneColliderKind : uint32_t {
+    ColliderBox,
+    ColliderCylinder,
+    ColliderInstanceBounds, // Box around an instance, from its model's bounds
+    ColliderInstancePart,   // Trunk cylinder of one material of an instance
+};
+
+struct SceneCollider {
+    uint32_t kind;
+    uint32_t instance;   // Instance kinds
+    uint32_t part;       // String offset of the material name
+    glm::vec3 a;         // Box min, or cylinder base center
+    glm::vec3 b;         // Box max, or (radius, height, 0)
+};
+
+enum SceneMirrorKind : uint32_t {
+    MirrorReflect,
+    MirrorRefract,
+};
+
+struct SceneMirror {
+    uint32_t kind;
+    float refractionIndex;
+    glm::mat4 matrix;
+};
+
+struct SceneProbe {
+    glm::vec3 position;
+    float range;         // Far plane of the capture
+};
+
+// A scene file in the compiled layout, either mapped from a .sceneb file or
+// built from a .scene text file. The arrays point into it.
+class SceneFile {
+public:
+    SceneFile() = default;
+    ~SceneFile();
+    SceneFile(const SceneFile&) = delete;
+    SceneFile& operator=(const SceneFile&) = delete;
+
+    // Text or compiled, told apart by the magic
+    bool open(const char* path);
+    // Writes the compiled form
+    bool save(const char* path) const;
+
+    const SceneHeader& header() const { return *reinterpret_cast<const SceneHeader*>(data); }
+    template <class T> const T* section(SceneSection section) const
+    {
+        return reinterpret_cast<const T*>(data + header().sections[section].offset);
+    }
+    uint32_t count(SceneSection section) const { return header().sections[section].count; }
+    const char* string(uint32_t offset) const { return section<char>(SceneStrings) + offset; }
+    bool mapped() const { return mapping != nullptr; }
+
+private:
+    bool parseText(const char* path);
+    bool validate(const char* path) const;
+    void close();
+
+    const char* data = nullptr;
+    size_t size = 0;
+    void* mapping = nullptr;  // mmap'ed compiled file
+    std::vector<char> bytes;  // Parsed text scene, or a file read without mmap
+};
+
+// Runtime structures built from a SceneFile: the loaded models, one entity
+// per instance or node (mesh = asset index), the lights, the colliders, the
+// mirrors and the reflection probes. Lights and colliders attached to
+// entities follow them through updateTransforms and placeLights.
+class Scene {
+public:
+    struct Asset {
+        std::string name;
+        std::unique_ptr<Model> model;
+        float reflectivity;
+        float roughness;
+    };
+
+    std::vector<Asset> assets;
+    // Created Dirty: updateTransforms computes their matrices and bounds
+    EntityStore entities;
+    // Base lights; attached ones are relative to their entity
+    std::vector<Light> lights;
+    std::vector<uint32_t> lightAnimations; // SceneLightAnimation per light
+    std::vector<bool> lightProxies;
+    std::vector<uint32_t> lightParents;    // Entity, or EntityStore::NO_ENTITY
+    // World space; the ones of instances are placed by updateTransforms
+    std::vector<Collider> colliders;
+    std::vector<SceneMirror> mirrors;
+    std::vector<SceneProbe> probes;
+    glm::vec3 spawn = glm::vec3(0.0f, 1.7f, 0.0f);
+    uint32_t campfireEntity = EntityStore::NO_ENTITY;
+
+    // Needs the GL context (models and textures are uploaded)
+    bool load(const char* path);
+
+    // World matrices and bounds of the changed entities (UpdateEntityTransforms),
+    // then the colliders of the entities that moved
+    void updateTransforms(ThreadPool& pool);
+
+    // World position and direction of the attached lights, from their base
+    // light and their entity's current world matrix
+    void placeLights(std::vector<Light>& placed) const;
+    // Base color of every animated light at `time`
+    void animateLights(std::vector<Light>& lights, float time) const;
+
+    bool hasCampfire() const { return campfireEntity != EntityStore::NO_ENTITY; }
+    glm::vec3 campfirePosition() const { return glm::vec3(entities.worldMatrices[campfireEntity][3]); }
+
+private:
+    // A collider that follows an instance
+    struct ColliderSource {
+        uint32_t collider;
+        uint32_t entity;
+        uint32_t kind;                // ColliderInstanceBounds or ColliderInstancePart
+        glm::vec3 partMin, partMax;   // Model-space box of the part
+    };
+    std::vector<ColliderSource> colliderSources;
+};
+
+// Converts a text scene to the compiled form
+bool CompileScene(const char* textPath, const char* compiledPath);
+
+#endif
@@ -0,0 +1,441 @@
+// ShadowAtlas.cpp - Cached shadow-map atlas with budgeted view updates
+
+#include "ShadowAtlas.h"
+#include <algorithm>
+#include <cmath>
+#include <string>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+// Creates a depth-only framebuffer around a new depth texture cleared to 1
+static void CreateDepthTarget(int size, bool compare, GLuint& texture, GLuint& fbo)
+{
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT24, size, size, 0, GL_DEPTH_COMPONENT, GL_FLOAT, nullptr);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, compare ? GL_LINEAR : GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, compare ? GL_LINEAR : GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    if (compare) {
+        // sampler2DShadow: hardware depth compare, 2x2 PCF with linear filtering
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_COMPARE_MODE, GL_COMPARE_REF_TO_TEXTURE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_COMPARE_FUNC, GL_LEQUAL);
+    }
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    glGenFramebuffers(1, &fbo);
+    glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, texture, 0);
+    glDrawBuffer(GL_NONE);
+    glReadBuffer(GL_NONE);
+    glClearDepth(1.0);
+    glClear(GL_DEPTH_BUFFER_BIT);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+// False if the box is completely outside one of the frustum planes
+static bool BoxInFrustum(const glm::mat4& viewProj, const glm::vec3& worldMin, const glm::vec3& worldMax)
+{
+    int outside[6] = { 0, 0, 0, 0, 0, 0 };
+    for (int i = 0; i < 8; ++i) {
+        glm::vec4 c = viewProj * glm::vec4((i & 1) ? worldMax.x : worldMin.x,
+                                           (i & 2) ? worldMax.y : worldMin.y,
+                                           (i & 4) ? worldMax.z : worldMin.z, 1.0f);
+        if (c.x < -c.w) outside[0]++;
+        if (c.x > c.w) outside[1]++;
+        if (c.y < -c.w) outside[2]++;
+        if (c.y > c.w) outside[3]++;
+        if (c.z < -c.w) outside[4]++;
+        if (c.z > c.w) outside[5]++;
+    }
+    for (int p = 0; p < 6; ++p) {
+        if (outside[p] == 8) return false;
+    }
+    return true;
+}
+
+// Any up vector that isn't parallel to the view direction
+static glm::vec3 UpFor(const glm::vec3& direction)
+{
+    return std::abs(direction.y) > 0.99f ? glm::vec3(0.0f, 0.0f, 1.0f) : glm::vec3(0.0f, 1.0f, 0.0f);
+}
+
+ShadowAtlas::ShadowAtlas(int size)
+    : atlasSize(size), shader("shader/shadow.vert", "shader/depth.frag")
+{
+    CreateDepthTarget(atlasSize, true, atlasTexture, atlasFBO);
+    CreateDepthTarget(atlasSize, false, staticTexture, staticFBO);
+
+    Node root;
+    root.x = 0;
+    root.y = 0;
+    root.size = atlasSize;
+    nodes.push_back(root);
+
+    glGenQueries(2, queries);
+}
+
+ShadowAtlas::~ShadowAtlas()
+{
+    glDeleteQueries(2, queries);
+    glDeleteFramebuffers(1, &atlasFBO);
+    glDeleteFramebuffers(1, &staticFBO);
+    glDeleteTextures(1, &atlasTexture);
+    glDeleteTextures(1, &staticTexture);
+    shader.Delete();
+}
+
+bool ShadowAtlas::allocate(int size, int& x, int& y)
+{
+    if (!allocateIn(0, size, x, y)) return false;
+    allocatedArea += size * size;
+    return true;
+}
+
+// Finds a free square of the given (power of two) size, splitting nodes on the way
+bool ShadowAtlas::allocateIn(int node, int size, int& x, int& y)
+{
+    if (nodes[node].used || nodes[node].size < size) return false;
+
+    if (nodes[node].size == size) {
+        if (nodes[node].firstChild >= 0) return false; // Partly used by smaller tiles
+        nodes[node].used = true;
+        x = nodes[node].x;
+        y = nodes[node].y;
+        return true;
+    }
+
+    if (nodes[node].firstChild < 0) {
+        int half = nodes[node].size / 2;
+        int first = (int)nodes.size();
+        for (int i = 0; i < 4; ++i) {
+            Node child;
+            child.x = nodes[node].x + (i & 1) * half;
+            child.y = nodes[node].y + (i >> 1) * half;
+            child.size = half;
+            nodes.push_back(child);
+        }
+        nodes[node].firstChild = first;
+    }
+    for (int i = 0; i < 4; ++i) {
+        if (allocateIn(nodes[node].firstChild + i, size, x, y)) return true;
+    }
+    return false;
+}
+
+float ShadowAtlas::occupancy() const
+{
+    return (float)allocatedArea / ((float)atlasSize * atlasSize);
+}
+
+int ShadowAtlas::addCaster(Model& model, const glm::mat4& modelMatrix, bool dynamic)
+{
+    Caster caster;
+    caster.model = &model;
+    caster.matrix = modelMatrix;
+    caster.dynamic = dynamic;
+    model.getWorldBounds(modelMatrix, caster.worldMin, caster.worldMax);
+
+    if (casters.empty()) {
+        sceneMin = caster.worldMin;
+        sceneMax = caster.worldMax;
+    } else {
+        sceneMin = glm::min(sceneMin, caster.worldMin);
+        sceneMax = glm::max(sceneMax, caster.worldMax);
+    }
+    casters.push_back(caster);
+    if (!dynamic) invalidateStatic(caster.worldMin, caster.worldMax);
+    return (int)casters.size() - 1;
+}
+
+void ShadowAtlas::moveCaster(int id, const glm::mat4& modelMatrix)
+{
+    Caster& caster = casters[id];
+    if (!caster.dynamic) invalidateStatic(caster.worldMin, caster.worldMax);
+    caster.matrix = modelMatrix;
+    caster.model->getWorldBounds(modelMatrix, caster.worldMin, caster.worldMax);
+    sceneMin = glm::min(sceneMin, caster.worldMin);
+    sceneMax = glm::max(sceneMax, caster.worldMax);
+    if (!caster.dynamic) invalidateStatic(caster.worldMin, caster.worldMax);
+}
+
+void ShadowAtlas::invalidateStatic(const glm::vec3& worldMin, const glm::vec3& worldMax)
+{
+    for (ShadowView& view : views) {
+        if (BoxInFrustum(view.renderedViewProj, worldMin, worldMax)) view.staticDirty = true;
+    }
+}
+
+bool ShadowAtlas::addLight(const std::vector<Light>& lights, size_t index)
+{
+    const Light& light = lights[index];
+    int count = light.type == 0 ? CASCADE_COUNT : (light.type == 1 ? 6 : 1);
+    int resolution = light.type == 0 ? cascadeResolution : (light.type == 1 ? cubeFaceResolution : spotResolution);
+    if ((int)views.size() + count > MAX_VIEWS) return false;
+
+    ShadowedLight shadowed;
+    shadowed.lightIndex = index;
+    shadowed.firstView = (int)views.size();
+    shadowed.viewCount = count;
+
+    // A light gets all of its tiles or none: on failure the quadtree (splits
+    // included) and the allocated area go back to how they were
+    std::vector<Node> savedNodes = nodes;
+    int savedArea = allocatedArea;
+    std::vector<ShadowView> newViews(count);
+    for (int i = 0; i < count; ++i) {
+        if (!allocate(resolution, newViews[i].x, newViews[i].y)) {
+            nodes.swap(savedNodes);
+            allocatedArea = savedArea;
+            return false;
+        }
+        newViews[i].size = resolution;
+        newViews[i].viewProj = glm::mat4(0.0f);
+        newViews[i].renderedViewProj = glm::mat4(0.0f);
+        if (light.type == 0) newViews[i].cascade = i;
+    }
+    views.insert(views.end(), newViews.begin(), newViews.end());
+    shadowedLights.push_back(shadowed);
+    return true;
+}
+
+// Orthographic cascade around the bounding sphere of one slice of the view
+// frustum. The sphere keeps the size fixed under camera rotation and the
+// center is snapped to whole texels, so the cascade only changes (and needs
+// re-rendering) once the camera has moved by at least a texel.
+glm::mat4 ShadowAtlas::cascadeMatrix(const glm::vec3& lightDirection, const Camera& camera, float nearDepth, float farDepth, int resolution) const
+{
+    glm::mat4 invView = glm::inverse(camera.view);
+    float tanHalfFov = std::tan(glm::radians(camera.FOVdeg) * 0.5f);
+    float aspect = (float)camera.width / camera.height;
+
+    glm::vec3 corners[8];
+    glm::vec3 center(0.0f);
+    for (int i = 0; i < 8; ++i) {
+        float depth = (i & 4) ? farDepth : nearDepth;
+        float halfHeight = depth * tanHalfFov;
+        glm::vec4 viewCorner(((i & 1) ? 1.0f : -1.0f) * halfHeight * aspect,
+                             ((i & 2) ? 1.0f : -1.0f) * halfHeight, -depth, 1.0f);
+        corners[i] = glm::vec3(invView * viewCorner);
+        center += corners[i] / 8.0f;
+    }
+    float radius = 0.0f;
+    for (int i = 0; i < 8; ++i) radius = std::max(radius, glm::length(corners[i] - center));
+    radius = std::ceil(radius * 4.0f) / 4.0f;
+
+    glm::vec3 direction = glm::normalize(lightDirection);
+    glm::mat4 lightView = glm::lookAt(glm::vec3(0.0f), direction, UpFor(direction));
+
+    glm::vec3 lightCenter = glm::vec3(lightView * glm::vec4(center, 1.0f));
+    float texel = 2.0f * radius / resolution;
+    lightCenter.x = std::floor(lightCenter.x / texel) * texel;
+    lightCenter.y = std::floor(lightCenter.y / texel) * texel;
+
+    // Depth range covers every caster, even the ones outside the slice
+    float minZ = 1e30f, maxZ = -1e30f;
+    for (int i = 0; i < 8; ++i) {
+        glm::vec3 corner((i & 1) ? sceneMax.x : sceneMin.x,
+                         (i & 2) ? sceneMax.y : sceneMin.y,
+                         (i & 4) ? sceneMax.z : sceneMin.z);
+        float z = (lightView * glm::vec4(corner, 1.0f)).z;
+        minZ = std::min(minZ, z);
+        maxZ = std::max(maxZ, z);
+    }
+    glm::mat4 projection = glm::ortho(lightCenter.x - radius, lightCenter.x + radius,
+                                      lightCenter.y - radius, lightCenter.y + radius,
+                                      -maxZ - 1.0f, -minZ + 1.0f);
+    return projection * lightView;
+}
+
+void ShadowAtlas::computeViews(const std::vector<Light>& lights, const Camera& camera)
+{
+    static const glm::vec3 faceAxes[6] = {
+        glm::vec3(1, 0, 0), glm::vec3(-1, 0, 0), glm::vec3(0, 1, 0),
+        glm::vec3(0, -1, 0), glm::vec3(0, 0, 1), glm::vec3(0, 0, -1)
+    };
+
+    for (ShadowedLight& shadowed : shadowedLights) {
+        const Light& light = lights[shadowed.lightIndex];
+        ShadowView* lightViews = &views[shadowed.firstView];
+
+        if (light.type == 0) {
+            float nearDepth = camera.nearPlane;
+            for (int c = 0; c < CASCADE_COUNT; ++c) {
+                lightViews[c].viewProj = cascadeMatrix(light.direction, camera, nearDepth, cascadeSplits[c], lightViews[c].size);
+                nearDepth = cascadeSplits[c];
+            }
+            continue;
+        }
+
+        // Flickering lights change their radius every frame: only grow the
+        // range, or shrink it when it's far too big, so the views stay cached
+        float radius = std::max(light.influenceRadius(influenceThreshold), 1.0f);
+        if (radius > shadowed.range || radius < shadowed.range * 0.5f) shadowed.range = std::ceil(radius);
+
+        if (light.type == 1) {
+            glm::mat4 projection = glm::perspective(glm::radians(90.0f), 1.0f, 0.05f, shadowed.range);
+            for (int f = 0; f < 6; ++f) {
+                lightViews[f].viewProj = projection * glm::lookAt(light.position, light.position + faceAxes[f], UpFor(faceAxes[f]));
+            }
+        } else {
+            glm::vec3 direction = glm::normalize(light.direction);
+            float fov = 2.0f * std::acos(SPOT_OUTER_COS) + glm::radians(5.0f);
+            glm::mat4 projection = glm::perspective(fov, 1.0f, 0.05f, shadowed.range);
+            lightViews[0].viewProj = projection * glm::lookAt(light.position, light.position + direction, UpFor(direction));
+        }
+    }
+}
+
+void ShadowAtlas::update(std::vector<Light>& lights, Camera& camera)
+{
+    cameraForward = glm::normalize(camera.Orientation);
+    for (const ShadowedLight& shadowed : shadowedLights) {
+        lights[shadowed.lightIndex].shadowIndex = shadowed.firstView;
+    }
+    computeViews(lights, camera);
+
+    // Which views need work this frame
+    std::vector<int> candidates;
+    for (size_t v = 0; v < views.size(); ++v) {
+        ShadowView& view = views[v];
+        if (view.viewProj != view.renderedViewProj) view.staticDirty = true;
+        view.hasDynamic = false;
+        for (const Caster& caster : casters) {
+            if (caster.dynamic && BoxInFrustum(view.viewProj, caster.worldMin, caster.worldMax)) {
+                view.hasDynamic = true;
+                break;
+            }
+        }
+        if (view.staticDirty || view.hasDynamic || view.hadDynamic) candidates.push_back((int)v);
+    }
+
+    // Near cascades first (they cover the most pixels), then whoever waited longest
+    std::sort(candidates.begin(), candidates.end(), [this](int a, int b) {
+        const ShadowView& va = views[a];
+        const ShadowView& vb = views[b];
+        int ca = va.cascade < 0 ? CASCADE_COUNT : va.cascade;
+        int cb = vb.cascade < 0 ? CASCADE_COUNT : vb.cascade;
+        if (ca != cb) return ca < cb;
+        return va.waitingFrames > vb.waitingFrames;
+    });
+
+    lastViewsRendered = 0;
+    lastStaticRenders = 0;
+    lastDrawCalls = 0;
+    pendingViews = 0;
+
+    // GPU time of the previous frame's shadow pass, if it's ready
+    GLuint available = 0;
+    if (frameIndex > 0) glGetQueryObjectuiv(queries[(frameIndex + 1) % 2], GL_QUERY_RESULT_AVAILABLE, &available);
+    if (available) {
+        GLuint64 elapsedNs = 0;
+        glGetQueryObjectui64v(queries[(frameIndex + 1) % 2], GL_QUERY_RESULT, &elapsedNs);
+        lastGpuMs = elapsedNs / 1.0e6f;
+    }
+
+    GLint viewport[4];
+    glGetIntegerv(GL_VIEWPORT, viewport);
+    GLint previousFramebuffer = 0;
+    glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &previousFramebuffer);
+    GLboolean cullWasEnabled = glIsEnabled(GL_CULL_FACE);
+
+    glBeginQuery(GL_TIME_ELAPSED, queries[frameIndex % 2]);
+    glDisable(GL_CULL_FACE);       // Leaves and the terrain are single planes
+    glEnable(GL_SCISSOR_TEST);
+    glEnable(GL_POLYGON_OFFSET_FILL);
+    glPolygonOffset(2.0f, 4.0f);
+    glDepthMask(GL_TRUE);
+    glDepthFunc(GL_LESS);
+
+    for (size_t i = 0; i < candidates.size(); ++i) {
+        ShadowView& view = views[candidates[i]];
+        if ((int)i >= maxViewUpdatesPerFrame) {
+            view.waitingFrames++;
+            pendingViews++;
+            continue;
+        }
+        renderView(view, camera);
+        view.waitingFrames = 0;
+    }
+
+    glDisable(GL_POLYGON_OFFSET_FILL);
+    glDisable(GL_SCISSOR_TEST);
+    if (cullWasEnabled) glEnable(GL_CULL_FACE);
+    glEndQuery(GL_TIME_ELAPSED);
+    frameIndex++;
+
+    glBindFramebuffer(GL_FRAMEBUFFER, previousFramebuffer);
+    glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+}
+
+// Refreshes one tile: static casters into the static atlas when they changed,
+// then static copy + dynamic casters into the sampled atlas
+void ShadowAtlas::renderView(ShadowView& view, Camera& camera)
+{
+    glViewport(view.x, view.y, view.size, view.size);
+    glScissor(view.x, view.y, view.size, view.size);
+
+    if (view.staticDirty) {
+        glBindFramebuffer(GL_FRAMEBUFFER, staticFBO);
+        glClear(GL_DEPTH_BUFFER_BIT);
+        drawCasters(view.viewProj, false, camera);
+        view.renderedViewProj = view.viewProj;
+        view.staticDirty = false;
+        lastStaticRenders++;
+    }
+
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, staticFBO);
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, atlasFBO);
+    glBlitFramebuffer(view.x, view.y, view.x + view.size, view.y + view.size,
+                      view.x, view.y, view.x + view.size, view.y + view.size,
+                      GL_DEPTH_BUFFER_BIT, GL_NEAREST);
+    if (view.hasDynamic) {
+        glBindFramebuffer(GL_FRAMEBUFFER, atlasFBO);
+        drawCasters(view.renderedViewProj, true, camera);
+    }
+    view.hadDynamic = view.hasDynamic;
+    lastViewsRendered++;
+}
+
+void ShadowAtlas::drawCasters(const glm::mat4& viewProj, bool dynamic, Camera& camera)
+{
+    shader.Activate();
+    glUniformMatrix4fv(glGetUniformLocation(shader.ID, "lightViewProj"), 1, GL_FALSE, glm::value_ptr(viewProj));
+    for (const Caster& caster : casters) {
+        if (caster.dynamic != dynamic) continue;
+        if (!BoxInFrustum(viewProj, caster.worldMin, caster.worldMax)) continue;
+        caster.model->Draw(shader, camera, caster.matrix);
+        lastDrawCalls += (int)caster.model->meshes.size();
+    }
+}
+
+void ShadowAtlas::bind(Shader& shader) const
+{
+    shader.Activate();
+    glActiveTexture(GL_TEXTURE0 + SHADOW_ATLAS_UNIT);
+    glBindTexture(GL_TEXTURE_2D, atlasTexture);
+    glUniform1i(glGetUniformLocation(shader.ID, "shadowAtlas"), SHADOW_ATLAS_UNIT);
+
+    // World space -> atlas texture coordinates and depth, per view
+    glm::mat4 matrices[MAX_VIEWS];
+    glm::vec4 tileBounds[MAX_VIEWS];
+    for (size_t v = 0; v < views.size(); ++v) {
+        const ShadowView& view = views[v];
+        float scale = (float)view.size / atlasSize;
+        glm::mat4 toTile = glm::translate(glm::mat4(1.0f), glm::vec3((float)view.x / atlasSize, (float)view.y / atlasSize, 0.0f));
+        toTile = glm::scale(toTile, glm::vec3(scale, scale, 1.0f));
+        glm::mat4 bias = glm::translate(glm::mat4(1.0f), glm::vec3(0.5f)) * glm::scale(glm::mat4(1.0f), glm::vec3(0.5f));
+        matrices[v] = toTile * bias * view.renderedViewProj;
+        // One texel inside the tile so the 2x2 filter never reads a neighbour
+        tileBounds[v] = glm::vec4((view.x + 1.0f) / atlasSize, (view.y + 1.0f) / atlasSize,
+                                  (view.x + view.size - 1.0f) / atlasSize, (view.y + view.size - 1.0f) / atlasSize);
+    }
+    if (!views.empty()) {
+        glUniformMatrix4fv(glGetUniformLocation(shader.ID, "shadowMatrices"), (GLsizei)views.size(), GL_FALSE, glm::value_ptr(matrices[0]));
+        glUniform4fv(glGetUniformLocation(shader.ID, "shadowTileBounds"), (GLsizei)views.size(), glm::value_ptr(tileBounds[0]));
+    }
+    glUniform3f(glGetUniformLocation(shader.ID, "cascadeSplits"), cascadeSplits[0], cascadeSplits[1], cascadeSplits[2]);
+    glUniform3fv(glGetUniformLocation(shader.ID, "shadowViewDir"), 1, glm::value_ptr(cameraForward));
+    glActiveTexture(GL_TEXTURE0);
+}
@@ -0,0 +1,126 @@
+#ifndef SHADOW_ATLAS_H
+#define SHADOW_ATLAS_H
+
+#include <vector>
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include "Light.h"
+#include "Camera.h"
+#include "model.h"
+#include "shaderClass.h"
+
+// Texture unit the lit shaders read the atlas from (shadowAtlas sampler)
+const GLuint SHADOW_ATLAS_UNIT = 7;
+
+// Shadow maps for every shadowed light packed into one depth texture:
+//  - directional lights: CASCADE_COUNT cascades following the camera
+//  - point lights: 6 cube faces, each its own 90 degree tile
+//  - spot lights: one tile covering the cone
+//
+// Static casters are rendered into a second "static" atlas that is only
+// refreshed when a view changes; dynamic casters are drawn over a copy of it.
+// Only views that actually changed are re-rendered, at most
+// maxViewUpdatesPerFrame per frame (near cascades first, then the views that
+// have waited longest).
+class ShadowAtlas {
+public:
+    static const int CASCADE_COUNT = 3;
+    // Size of the shadowMatrices[] arrays (MAX_SHADOW_VIEWS in the lit shaders)
+    static const int MAX_VIEWS = 16;
+
+    // Far end of each cascade, in view depth
+    float cascadeSplits[CASCADE_COUNT] = { 8.0f, 25.0f, 70.0f };
+    int cascadeResolution = 1024;
+    int cubeFaceResolution = 512;
+    int spotResolution = 1024;
+    // Shadow views rendered per frame at most
+    int maxViewUpdatesPerFrame = 4;
+    // Point/spot shadow range, same cutoff as the light culling
+    float influenceThreshold = 0.05f;
+
+    explicit ShadowAtlas(int size = 4096);
+    ~ShadowAtlas();
+
+    // Registers a shadow caster; returns its id for moveCaster
+    int addCaster(Model& model, const glm::mat4& modelMatrix, bool dynamic = false);
+    // Moving a static caster invalidates the cached views it leaves and enters
+    void moveCaster(int caster, const glm::mat4& modelMatrix);
+
+    // Gives lights[index] shadow maps. False if the atlas or the view arrays are full.
+    bool addLight(const std::vector<Light>& lights, size_t index);
+
+    // Assigns Light::shadowIndex and renders this frame's share of the views
+    void update(std::vector<Light>& lights, Camera& camera);
+    // Binds the atlas to SHADOW_ATLAS_UNIT and uploads the shadow uniforms
+    void bind(Shader& shader) const;
+
+    // Fraction of the atlas allocated to shadow views
+    float occupancy() const;
+
+    // Cost of the last update
+    int lastViewsRendered = 0;   // views copied or re-rendered
+    int lastStaticRenders = 0;   // of those, views whose static casters were re-drawn
+    int lastDrawCalls = 0;
+    int pendingViews = 0;        // views that wanted an update but were over budget
+    float lastGpuMs = 0.0f;      // GPU time of the shadow pass, one frame late
+
+private:
+    int atlasSize;
+    GLuint atlasTexture, atlasFBO;
+    GLuint staticTexture, staticFBO;
+    Shader shader;
+
+    struct Caster {
+        Model* model;
+        glm::mat4 matrix;
+        glm::vec3 worldMin, worldMax;
+        bool dynamic;
+    };
+    std::vector<Caster> casters;
+    // Union of every caster, sets the depth range of the cascades
+    glm::vec3 sceneMin = glm::vec3(0.0f), sceneMax = glm::vec3(0.0f);
+
+    struct ShadowView {
+        int x, y, size;                // Tile in the atlas
+        glm::mat4 viewProj;            // Wanted this frame
+        glm::mat4 renderedViewProj;    // What the tile currently holds
+        bool staticDirty = true;       // Static casters must be re-rendered
+        bool hasDynamic = false;       // Dynamic casters in view this frame
+        bool hadDynamic = false;       // ... and in the last rendered version
+        int waitingFrames = 0;
+        int cascade = -1;
+    };
+    std::vector<ShadowView> views;
+
+    struct ShadowedLight {
+        size_t lightIndex;
+        int firstView;
+        int viewCount;
+        float range = 0.0f; // Far plane of point/spot views
+    };
+    std::vector<ShadowedLight> shadowedLights;
+
+    // Quadtree allocator over the atlas
+    struct Node {
+        int x, y, size;
+        bool used = false;
+        int firstChild = -1;
+    };
+    std::vector<Node> nodes;
+    int allocatedArea = 0;
+    bool allocate(int size, int& x, int& y);
+    bool allocateIn(int node, int size, int& x, int& y);
+
+    glm::vec3 cameraForward = glm::vec3(0.0f, 0.0f, -1.0f);
+
+    GLuint queries[2];
+    int frameIndex = 0;
+
+    void computeViews(const std::vector<Light>& lights, const Camera& camera);
+    glm::mat4 cascadeMatrix(const glm::vec3& lightDirection, const Camera& camera, float nearDepth, float farDepth, int resolution) const;
+    void invalidateStatic(const glm::vec3& worldMin, const glm::vec3& worldMax);
+    void renderView(ShadowView& view, Camera& camera);
+    void drawCasters(const glm::mat4& viewProj, bool dynamic, Camera& camera);
+};
+
+#endif
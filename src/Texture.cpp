@@ -1,7 +1,10 @@
 #include"Texture.h"
+#include<iostream>
+#include"CpuProfiler.h"
 
 Texture::Texture(const char* image, const char* texType, GLuint slot)
 {
+	CPU_PROFILE_SCOPE("Texture::Texture");
 	// Assigns the type of the texture ot the texture object
 	type = texType;
 
@@ -10,7 +13,20 @@ Texture::Texture(const char* image, const char* texType, GLuint slot)
 	// Flips the image so it appears right side up
 	stbi_set_flip_vertically_on_load(true);
 	// Reads the image from a file and stores it in bytes
-	unsigned char* bytes = stbi_load(image, &widthImg, &heightImg, &numColCh, 0);
+	unsigned char* bytes;
+	{
+		CPU_PROFILE_SCOPE("stbi_load");
+		bytes = stbi_load(image, &widthImg, &heightImg, &numColCh, 0);
+	}
+	// Missing file: a white texel instead, so the scene still renders
+	unsigned char fallback[4] = { 255, 255, 255, 255 };
+	if (!bytes)
+	{
+		std::cout << "Failed to load texture: " << image << std::endl;
+		bytes = fallback;
+		widthImg = heightImg = 1;
+		numColCh = 4;
+	}
 
 	// Generates an OpenGL texture object
 	glGenTextures(1, &ID);
@@ -91,7 +107,7 @@ Texture::Texture(const char* image, const char* texType, GLuint slot)
 	glGenerateMipmap(GL_TEXTURE_2D);
 
 	// Deletes the image data as it is already in the OpenGL Texture object
-	stbi_image_free(bytes);
+	if (bytes != fallback) stbi_image_free(bytes);
 
 	// Unbinds the OpenGL Texture object so that it can't accidentally be modified
 	glBindTexture(GL_TEXTURE_2D, 0);
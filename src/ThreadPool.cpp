@@ -0,0 +1,98 @@
+#include "ThreadPool.h"
+#include "CpuProfiler.h"
+#include <algorithm>
+
+ThreadPool::ThreadPool(int workerCount) : nextIndex(0)
+{
+    if (workerCount < 0) {
+        int hw = static_cast<int>(std::thread::hardware_concurrency());
+        workerCount = std::max(0, hw - 1);
+    }
+    for (int i = 0; i < workerCount; ++i) {
+        workers.emplace_back(&ThreadPool::workerLoop, this);
+    }
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wakeWorkers.notify_all();
+    for (auto& worker : workers) {
+        worker.join();
+    }
+}
+
+// Grabs chunks of the given job until there is nothing left
+void ThreadPool::runChunks(const std::function<void(size_t, size_t)>& func, size_t count, size_t chunk)
+{
+    CPU_PROFILE_SCOPE("ThreadPool::runChunks");
+    for (;;) {
+        size_t begin = nextIndex.fetch_add(chunk);
+        if (begin >= count) break;
+        size_t end = std::min(begin + chunk, count);
+        func(begin, end);
+    }
+}
+
+void ThreadPool::workerLoop()
+{
+    CPU_PROFILE_THREAD_NAME("pool worker");
+    unsigned int seenGeneration = 0;
+    for (;;) {
+        const std::function<void(size_t, size_t)>* func;
+        size_t count, chunk;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            wakeWorkers.wait(lock, [&] { return stopping || generation != seenGeneration; });
+            if (stopping) return;
+            seenGeneration = generation;
+            // Woke up after the job already finished: nothing to do
+            if (!job) continue;
+            func = job;
+            count = jobCount;
+            chunk = jobChunk;
+            ++busyWorkers;
+        }
+
+        runChunks(*func, count, chunk);
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            --busyWorkers;
+        }
+        jobDone.notify_one();
+    }
+}
+
+void ThreadPool::parallelFor(size_t count, const std::function<void(size_t, size_t)>& func, size_t minChunk)
+{
+    CPU_PROFILE_SCOPE("ThreadPool::parallelFor");
+    if (count == 0) return;
+
+    // Small jobs (or no workers) are not worth waking anybody up for
+    if (workers.empty() || count <= minChunk) {
+        func(0, count);
+        return;
+    }
+
+    // Aim for a few chunks per thread so uneven work still balances out
+    size_t chunk = std::max<size_t>(1, std::max(minChunk, count / (threadCount() * 4)));
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        job = &func;
+        jobCount = count;
+        jobChunk = chunk;
+        nextIndex.store(0);
+        ++generation;
+    }
+    wakeWorkers.notify_all();
+
+    runChunks(func, count, chunk);
+
+    std::unique_lock<std::mutex> lock(mutex);
+    jobDone.wait(lock, [&] { return busyWorkers == 0 && nextIndex.load() >= jobCount; });
+    job = nullptr;
+}
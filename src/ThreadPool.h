@@ -0,0 +1,49 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Small persistent worker pool used to split CPU-side frame work (light binning,
+// culling, preprocessing) across cores. The calling thread always takes part in
+// the work, so a pool with zero workers simply runs everything inline.
+class ThreadPool {
+public:
+    // workerCount < 0 picks hardware_concurrency() - 1
+    explicit ThreadPool(int workerCount = -1);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    // Splits [0, count) into chunks of at least minChunk items and calls
+    // func(begin, end) for each chunk. Blocks until every chunk is done.
+    void parallelFor(size_t count, const std::function<void(size_t, size_t)>& func, size_t minChunk = 1);
+
+    // Number of threads taking part in parallelFor (workers + caller)
+    int threadCount() const { return static_cast<int>(workers.size()) + 1; }
+
+private:
+    std::vector<std::thread> workers;
+    std::mutex mutex;
+    std::condition_variable wakeWorkers;
+    std::condition_variable jobDone;
+
+    // Current job, guarded by mutex (workers copy it before running)
+    const std::function<void(size_t, size_t)>* job = nullptr;
+    size_t jobCount = 0;
+    size_t jobChunk = 1;
+    std::atomic<size_t> nextIndex;
+    int busyWorkers = 0;
+    unsigned int generation = 0;
+    bool stopping = false;
+
+    void workerLoop();
+    void runChunks(const std::function<void(size_t, size_t)>& func, size_t count, size_t chunk);
+};
+
+#endif
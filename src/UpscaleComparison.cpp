@@ -0,0 +1,103 @@
+// UpscaleComparison.cpp - Deterministic camera path and native/spatial/temporal comparison
+
+#include "UpscaleComparison.h"
+#include <cmath>
+#include <iostream>
+#include <vector>
+
+// Frames skipped before measuring, so the temporal history has a full jitter cycle
+static const int WARMUP_FRAMES = DynamicResolution::JITTER_PHASES;
+
+void OrbitCameraPath(Camera& camera, float seconds)
+{
+    // Outside the farmhouse and the tree rows, inside the terrain (-40..40)
+    const glm::vec3 center(0.0f, 4.0f, -4.0f);
+    float angle = 0.3f * seconds;
+    camera.Position = center + glm::vec3(34.0f * std::cos(angle), 6.0f + 1.0f * std::sin(seconds), 34.0f * std::sin(angle));
+    camera.Orientation = glm::normalize(center - camera.Position);
+    camera.updateMatrix(45.0f, 0.1f, 100.0f);
+}
+
+// Peak signal-to-noise ratio of the RGB channels, in dB
+static double Psnr(const std::vector<unsigned char>& a, const std::vector<unsigned char>& b)
+{
+    double squared = 0.0;
+    size_t count = 0;
+    for (size_t i = 0; i < a.size(); i += 4) {
+        for (int c = 0; c < 3; ++c) {
+            double d = (double)a[i + c] - (double)b[i + c];
+            squared += d * d;
+        }
+        count += 3;
+    }
+    double mse = squared / count;
+    if (mse <= 0.0) return 99.0;
+    return 10.0 * std::log10(255.0 * 255.0 / mse);
+}
+
+int RunUpscaleComparison(const Options& options, int width, int height, Camera& camera,
+                         const std::function<void(float)>& simulate,
+                         const std::function<void(DynamicResolution*, GLuint)>& renderScene)
+{
+    float scale = glm::clamp(options.upscaleScale, 0.1f, 1.0f);
+    DynamicResolution reference(width, height, DynamicResolution::Spatial);
+    DynamicResolution spatial(width, height, DynamicResolution::Spatial);
+    DynamicResolution temporal(width, height, DynamicResolution::Temporal);
+    reference.targetMs = spatial.targetMs = temporal.targetMs = 0.0f;
+    reference.sharpness = 0.0f;
+    spatial.minScale = spatial.maxScale = scale;
+    temporal.minScale = temporal.maxScale = scale;
+    spatial.sharpness = temporal.sharpness = options.drsSharpness;
+    DynamicResolution* modes[3] = { &reference, &spatial, &temporal };
+    const char* names[3] = { "native", "spatial", "temporal" };
+
+    GLuint texture, framebuffer;
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glGenFramebuffers(1, &framebuffer);
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, texture, 0);
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+        std::cout << "ERROR: comparison framebuffer is incomplete" << std::endl;
+
+    std::cout << "Upscale comparison: " << options.upscaleCompareFrames << " frames at " << width << "x" << height
+              << ", scale " << scale << " (" << (int)(scale * scale * 100.0f + 0.5f) << "% of the pixels)" << std::endl;
+
+    std::vector<unsigned char> images[3];
+    for (auto& image : images) image.resize((size_t)width * height * 4);
+    double psnrTotal[3] = { 0.0, 0.0, 0.0 };
+    double gpuMsTotal[3] = { 0.0, 0.0, 0.0 };
+    int measured = 0;
+
+    // Fixed time step, so every run sees the same frames
+    const float deltaTime = 1.0f / 60.0f;
+    for (int frame = 0; frame < options.upscaleCompareFrames + WARMUP_FRAMES; ++frame) {
+        simulate(deltaTime);
+        for (int m = 0; m < 3; ++m) {
+            OrbitCameraPath(camera, frame * deltaTime);
+            renderScene(modes[m], framebuffer);
+            glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+            glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, images[m].data());
+        }
+        if (frame < WARMUP_FRAMES) continue;
+        for (int m = 0; m < 3; ++m) {
+            psnrTotal[m] += Psnr(images[0], images[m]);
+            gpuMsTotal[m] += modes[m]->lastGpuMs;
+        }
+        measured++;
+    }
+
+    for (int m = 0; m < 3; ++m) {
+        std::cout << "[upscale] " << names[m] << " " << modes[m]->renderWidth() << "x" << modes[m]->renderHeight()
+                  << " gpu=" << gpuMsTotal[m] / measured << "ms";
+        if (m > 0) std::cout << " psnr=" << psnrTotal[m] / measured << "dB";
+        std::cout << std::endl;
+    }
+
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glDeleteFramebuffers(1, &framebuffer);
+    glDeleteTextures(1, &texture);
+    return 0;
+}
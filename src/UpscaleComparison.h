@@ -0,0 +1,25 @@
+#ifndef UPSCALE_COMPARISON_H
+#define UPSCALE_COMPARISON_H
+
+#include <functional>
+#include <glad/glad.h>
+#include "Camera.h"
+#include "Options.h"
+#include "DynamicResolution.h"
+
+// Places the camera on a fixed orbit around the farmhouse, `seconds` into the path
+void OrbitCameraPath(Camera& camera, float seconds);
+
+// Quality and performance comparison of the upscalers (--upscale-compare).
+// The camera follows OrbitCameraPath with a fixed time step; every frame is
+// rendered three times into an offscreen native-size target:
+//  - reference: native resolution, no sharpening
+//  - spatial upscaling at options.upscaleScale
+//  - temporal upscaling at options.upscaleScale
+// and the two upscaled images are compared to the reference (PSNR). Prints the
+// averages and returns the process exit code.
+int RunUpscaleComparison(const Options& options, int width, int height, Camera& camera,
+                         const std::function<void(float)>& simulate,
+                         const std::function<void(DynamicResolution*, GLuint)>& renderScene);
+
+#endif
@@ -1,4 +1,5 @@
 #include "model.h"
+#include "CpuProfiler.h"
 #include <fstream>
 #include <sstream>
 #include <iostream>
@@ -45,7 +46,14 @@ Model::Model(const char* file,bool LoadCollider) {
 
 Model::~Model() {}
 
-void Model::Draw(Shader& shader, Camera& camera, const glm::mat4& modelMatrix) {
+void Model::Draw(Shader& shader, Camera& camera, const glm::mat4& modelMatrix, const glm::mat4* previousModelMatrix) {
+    shader.Activate();
+    glUniform1f(glGetUniformLocation(shader.ID, "alphaCutoff"), alphaCutoff);
+    // Also needed by meshes without a material (plane.obj)
+    glUniformMatrix4fv(glGetUniformLocation(shader.ID, "model"), 1, GL_FALSE, glm::value_ptr(modelMatrix));
+    glUniformMatrix4fv(glGetUniformLocation(shader.ID, "prevModel"), 1, GL_FALSE,
+                       glm::value_ptr(previousModelMatrix ? *previousModelMatrix : modelMatrix));
+    glUniform1f(glGetUniformLocation(shader.ID, "textureTiling"), textureTiling);
     for (auto& mesh : meshes) {
         // Set material properties for this mesh
         if (!mesh.materialName.empty() && materials.find(mesh.materialName) != materials.end()) {
@@ -53,8 +61,6 @@ void Model::Draw(Shader& shader, Camera& camera, const glm::mat4& modelMatrix) {
             
             // Set material uniforms in shader
             shader.Activate();
-            glUniformMatrix4fv(glGetUniformLocation(shader.ID, "model"), 1, GL_FALSE, glm::value_ptr(modelMatrix));
-            glUniform1f(glGetUniformLocation(shader.ID, "textureTiling"), textureTiling);
             glUniform3fv(glGetUniformLocation(shader.ID, "material.ambient"), 1, glm::value_ptr(material.ambient));
             glUniform3fv(glGetUniformLocation(shader.ID, "material.diffuse"), 1, glm::value_ptr(material.diffuse));
             glUniform3fv(glGetUniformLocation(shader.ID, "material.specular"), 1, glm::value_ptr(material.specular));
@@ -77,6 +83,7 @@ void Model::AddTexture(const Texture& texture)
 
 
 void Model::loadOBJ(const char* file) {
+    CPU_PROFILE_SCOPE("Model::loadOBJ");
     std::vector<glm::vec3> positions;
     std::vector<glm::vec3> normals;
     std::vector<glm::vec2> texUVs;
@@ -203,12 +210,23 @@ void Model::loadOBJ(const char* file) {
         }
     }
     
+    // Object-space bounds, used for per-object light selection
+    if (!meshes.empty()) {
+        boundsMin = meshes[0].getMinVertex();
+        boundsMax = meshes[0].getMaxVertex();
+        for (size_t i = 1; i < meshes.size(); ++i) {
+            boundsMin = glm::min(boundsMin, meshes[i].getMinVertex());
+            boundsMax = glm::max(boundsMax, meshes[i].getMaxVertex());
+        }
+    }
+
     std::cout << "Finished loading OBJ with " << positions.size() << " vertices, " 
               << normals.size() << " normals, " << texUVs.size() << " texture coordinates, "
               << "and " << meshes.size() << " meshes" << std::endl;
 }
 
 void Model::loadMTL(const char* file, std::map<std::string, Material>& materials) {
+    CPU_PROFILE_SCOPE("Model::loadMTL");
     std::ifstream in(file);
     if (!in) {
         std::cerr << "Cannot open MTL file: " << file << std::endl;
@@ -275,6 +293,19 @@ void Model::loadMTL(const char* file, std::map<std::string, Material>& materials
     std::cout << "Loaded " << materials.size() << " materials" << std::endl;
 }
 
+void Model::getWorldBounds(const glm::mat4& modelMatrix, glm::vec3& worldMin, glm::vec3& worldMax) const {
+    worldMin = glm::vec3(std::numeric_limits<float>::max());
+    worldMax = glm::vec3(-std::numeric_limits<float>::max());
+    for (int i = 0; i < 8; ++i) {
+        glm::vec3 corner((i & 1) ? boundsMax.x : boundsMin.x,
+                         (i & 2) ? boundsMax.y : boundsMin.y,
+                         (i & 4) ? boundsMax.z : boundsMin.z);
+        glm::vec3 transformed = glm::vec3(modelMatrix * glm::vec4(corner, 1.0f));
+        worldMin = glm::min(worldMin, transformed);
+        worldMax = glm::max(worldMax, transformed);
+    }
+}
+
 void Model::buildCollider(const glm::mat4& modelMatrix) {
     if (meshes.empty()) return;
 
@@ -23,8 +23,9 @@ class Model
 public:
     // Loads model from file
     Model(const char* file, bool LoadCollider = true);
-    // Draws the model using the given shader and camera
-    void Draw(Shader& shader, Camera& camera, const glm::mat4& modelMatrix);
+    // Draws the model using the given shader and camera. previousModelMatrix is
+    // last frame's matrix for motion vectors (same as modelMatrix if not given).
+    void Draw(Shader& shader, Camera& camera, const glm::mat4& modelMatrix, const glm::mat4* previousModelMatrix = nullptr);
     // Check if model has loaded meshes
     bool IsLoaded() const { return !meshes.empty(); }
     // Destructor
@@ -43,17 +44,29 @@ public:
     
     void AddTexture(const Texture& texture);
 
+    // Axis-aligned bounds of the whole model after applying modelMatrix
+    void getWorldBounds(const glm::mat4& modelMatrix, glm::vec3& worldMin, glm::vec3& worldMax) const;
+
     // Set the texture tiling factor for this model
     void SetTextureTiling(float tiling) { textureTiling = tiling; }
     // Get the current texture tiling factor
     float GetTextureTiling() const { return textureTiling; }
 
+    // Fragments whose diffuse alpha is below this are discarded (0 = opaque model)
+    void SetAlphaCutoff(float cutoff) { alphaCutoff = cutoff; }
+    float GetAlphaCutoff() const { return alphaCutoff; }
+
     Collider collider;  // Main collider (whole model)
     std::vector<Mesh> meshes;
 
+    // Object-space bounds of all meshes, computed once when the OBJ is loaded
+    glm::vec3 boundsMin = glm::vec3(0.0f);
+    glm::vec3 boundsMax = glm::vec3(0.0f);
+
 private:
     // Default texture tiling factor (50.0f is the original value)
     float textureTiling = 50.0f;
+    float alphaCutoff = 0.0f;
     
     std::map<std::string, Material> materials;
     std::map<std::string, Collider> componentColliders;  // Colliders for individual components
@@ -1,4 +1,5 @@
 #include"shaderClass.h"
+#include"CpuProfiler.h"
 
 // Reads a text file and outputs a string with everything in the text file
 std::string get_file_contents(const char* filename)
@@ -17,12 +18,34 @@ std::string get_file_contents(const char* filename)
 	throw(errno);
 }
 
+// Reads a shader file and replaces each `#include "file"` line with that file's
+// contents, looked up next to the including file. GLSL has no #include, so
+// code shared by several shaders (shader/lighting.glsl) is pasted in here.
+std::string get_shader_source(const char* filename)
+{
+	std::string path(filename);
+	std::string directory = path.substr(0, path.find_last_of("/\\") + 1);
+	std::istringstream in(get_file_contents(filename));
+	std::string source, line;
+	while (std::getline(in, line))
+	{
+		size_t open = line.find('"');
+		size_t close = open == std::string::npos ? open : line.find('"', open + 1);
+		if (line.compare(0, 8, "#include") == 0 && close != std::string::npos)
+			source += get_shader_source((directory + line.substr(open + 1, close - open - 1)).c_str());
+		else
+			source += line + "\n";
+	}
+	return source;
+}
+
 // Constructor that build the Shader Program from 2 different shaders
 Shader::Shader(const char* vertexFile, const char* fragmentFile)
 {
+	CPU_PROFILE_SCOPE("Shader::Shader");
 	// Read vertexFile and fragmentFile and store the strings
-	std::string vertexCode = get_file_contents(vertexFile);
-	std::string fragmentCode = get_file_contents(fragmentFile);
+	std::string vertexCode = get_shader_source(vertexFile);
+	std::string fragmentCode = get_shader_source(fragmentFile);
 
 	// Convert the shader source strings into character arrays
 	const char* vertexSource = vertexCode.c_str();
@@ -56,6 +79,34 @@ Shader::Shader(const char* vertexFile, const char* fragmentFile)
 
 }
 
+// Constructor for a transform feedback program: a vertex shader only
+Shader::Shader(const char* vertexFile, const char* const* varyings, int varyingCount)
+{
+	CPU_PROFILE_SCOPE("Shader::Shader");
+	std::string vertexCode = get_shader_source(vertexFile);
+	const char* vertexSource = vertexCode.c_str();
+
+	GLuint vertexShader = glCreateShader(GL_VERTEX_SHADER);
+	glShaderSource(vertexShader, 1, &vertexSource, NULL);
+	glCompileShader(vertexShader);
+
+	ID = glCreateProgram();
+	glAttachShader(ID, vertexShader);
+	// The captured outputs must be named before linking
+	glTransformFeedbackVaryings(ID, varyingCount, varyings, GL_INTERLEAVED_ATTRIBS);
+	glLinkProgram(ID);
+	glDeleteShader(vertexShader);
+
+	GLint linked = GL_FALSE;
+	glGetProgramiv(ID, GL_LINK_STATUS, &linked);
+	if (!linked)
+	{
+		char log[1024];
+		glGetProgramInfoLog(ID, sizeof(log), NULL, log);
+		std::cout << "ERROR: transform feedback program " << vertexFile << " did not link: " << log << std::endl;
+	}
+}
+
 // Activates the Shader Program
 void Shader::Activate()
 {
@@ -9,6 +9,8 @@
 #include<cerrno>
 
 std::string get_file_contents(const char* filename);
+// get_file_contents with `#include "file"` lines expanded (paths relative to filename)
+std::string get_shader_source(const char* filename);
 
 class Shader
 {
@@ -17,6 +19,9 @@ public:
 	GLuint ID;
 	// Constructor that build the Shader Program from 2 different shaders
 	Shader(const char* vertexFile, const char* fragmentFile);
+	// Constructor for a vertex-only program whose outputs `varyings` are captured
+	// by transform feedback, interleaved in that order (nothing is rasterized)
+	Shader(const char* vertexFile, const char* const* varyings, int varyingCount);
 
 	// Activates the Shader Program
 	void Activate();